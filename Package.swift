@@ -94,6 +94,14 @@ let package = Package(
         "BUILD"
       ]
     ),
+    .testTarget(
+      name: "NSData_zlibBenchmarks",
+      dependencies: ["GTMNSData_zlib", "SenTestCase"],
+      path: "Tests/NSData_zlibBenchmarks",
+      exclude: [
+        "BUILD"
+      ]
+    ),
     .testTarget(
       name: "StringEncodingTests",
       dependencies: ["GTMStringEncoding", "SenTestCase"],
@@ -21,10 +21,14 @@
 #endif
 
 #import "GTMLogger.h"
+#import <ctype.h>
+#import <errno.h>
 #import <fcntl.h>
 #import <unistd.h>
 #import <stdlib.h>
 #import <pthread.h>
+#import <sys/time.h>
+#import <sys/uio.h>
 
 
 #if !defined(__clang__) && (__GNUC__*10+__GNUC_MINOR__ >= 42)
@@ -41,6 +45,171 @@
 // just an easy reference to one shared instance.
 static GTMLogger *gSharedLogger = nil;
 
+// Initial size of the per-thread buffer used for GTMLogByteWriter messages, it
+// grows to fit the largest message logged on the thread.
+static const size_t kGTMLogScratchBufferSize = 1024;
+
+// Per-thread UTF-8 buffer that messages are formatted into on the byte path.
+typedef struct {
+  char *bytes;
+  size_t capacity;
+  BOOL inUse;
+} GTMLogScratchBuffer;
+
+static pthread_key_t gScratchBufferKey;
+
+static void FreeScratchBuffer(void *value) {
+  GTMLogScratchBuffer *scratch = (GTMLogScratchBuffer *)value;
+  free(scratch->bytes);
+  free(scratch);
+}
+
+// Returns the scratch buffer for the current thread with room for at least
+// |capacity| bytes, or NULL if it can't be allocated.
+static GTMLogScratchBuffer *ScratchBufferWithCapacity(size_t capacity) {
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    pthread_key_create(&gScratchBufferKey, FreeScratchBuffer);
+  });
+  GTMLogScratchBuffer *scratch =
+      (GTMLogScratchBuffer *)pthread_getspecific(gScratchBufferKey);
+  if (!scratch) {
+    scratch = (GTMLogScratchBuffer *)calloc(1, sizeof(GTMLogScratchBuffer));
+    if (!scratch) return NULL;
+    if (pthread_setspecific(gScratchBufferKey, scratch) != 0) {
+      free(scratch);
+      return NULL;
+    }
+  }
+  if (scratch->capacity < capacity) {
+    size_t newCapacity = MAX(scratch->capacity, kGTMLogScratchBufferSize);
+    while (newCapacity < capacity) {
+      newCapacity *= 2;
+    }
+    char *bytes = (char *)realloc(scratch->bytes, newCapacity);
+    if (!bytes) return NULL;
+    scratch->bytes = bytes;
+    scratch->capacity = newCapacity;
+  }
+  return scratch;
+}
+
+// Returns YES if |object|'s class replaces |baseClass|'s implementation of
+// |selector|. The byte path of the built in formatters and filters uses this
+// to defer to subclasses that customized the NSString path.
+static BOOL OverridesMethod(id object, Class baseClass, SEL selector) {
+  return [object methodForSelector:selector] !=
+         [baseClass instanceMethodForSelector:selector];
+}
+
+// Copies |str| as UTF-8 into |buffer| and returns its length in bytes, which
+// may be larger than |capacity| (in which case |buffer| holds a prefix).
+static size_t CopyUTF8Bytes(CFStringRef str, char *buffer, size_t capacity) {
+  const char *cString = CFStringGetCStringPtr(str, kCFStringEncodingUTF8);
+  if (cString) {
+    size_t length = strlen(cString);
+    if (length <= capacity) {
+      memcpy(buffer, cString, length);
+    }
+    return length;
+  }
+  CFRange range = CFRangeMake(0, CFStringGetLength(str));
+  CFIndex used = 0;
+  CFIndex converted = CFStringGetBytes(str, range, kCFStringEncodingUTF8, '?',
+                                       false, (UInt8 *)buffer,
+                                       (CFIndex)capacity, &used);
+  if (converted != range.length) {
+    // Ran out of room, just measure.
+    CFStringGetBytes(str, range, kCFStringEncodingUTF8, '?', false, NULL, 0,
+                     &used);
+  }
+  return (size_t)used;
+}
+
+// Returns YES if vsnprintf formats the C string |fmt| the way CFString does,
+// i.e. it has no %@, unichar (%C, %S), wide string (%ls), %c or %n
+// conversions.
+static BOOL IsPlainCFormat(const char *fmt) {
+  for (const char *p = fmt; (p = strchr(p, '%')) != NULL; ++p) {
+    ++p;
+    p += strspn(p, "0123456789$#-+ '.*hlqLztj");
+    if (*p == '\0' || !strchr("%diouxXeEfFgGaAps", *p)) return NO;
+    if (*p == 's' && p[-1] == 'l') return NO;
+  }
+  return YES;
+}
+
+// Formats |fmt| with |args| as UTF-8 into |buffer|, see CopyUTF8Bytes.
+static size_t FormatUTF8Bytes(NSString *fmt, va_list args,
+                              char *buffer, size_t capacity)
+    NS_FORMAT_FUNCTION(1, 0);
+static size_t FormatUTF8Bytes(NSString *fmt, va_list args,
+                              char *buffer, size_t capacity) {
+  // Most formats don't need a CFString, vsnprintf writes them straight into
+  // |buffer|. %s arguments are copied as is instead of being read in the
+  // system encoding, which is what a UTF-8 log wants anyway.
+  const char *cFormat = [fmt UTF8String];
+  if (cFormat && IsPlainCFormat(cFormat)) {
+#pragma clang diagnostic push
+// |cFormat| is |fmt|, which callers check against |args|.
+#pragma clang diagnostic ignored "-Wformat-nonliteral"
+    int length = vsnprintf(buffer, capacity, cFormat, args);
+#pragma clang diagnostic pop
+    if (length < 0) return 0;
+    // vsnprintf keeps the last byte for its NUL, so an exact fit asks for one
+    // more byte to get the whole message on the next try.
+    if (length > 0 && (size_t)length >= capacity) return (size_t)length + 1;
+    return (size_t)length;
+  }
+
+  // Objects and unichars need CFString's formatting, which costs a CFString
+  // for the message and a copy out of it.
+  CFStringRef str =
+      CFStringCreateWithFormatAndArguments(kCFAllocatorDefault, NULL,
+                                           (__bridge CFStringRef)fmt, args);
+  if (!str) return 0;
+  size_t length = CopyUTF8Bytes(str, buffer, capacity);
+  CFRelease(str);
+  return length;
+}
+
+// Byte path for formatters whose NSString path has been overridden: format
+// the message as an NSString and copy it into |buffer|.
+static NSInteger FormatBytesWithString(id<GTMLogFormatter> formatter,
+                                       const char *func, NSString *fmt,
+                                       va_list args, GTMLoggerLevel level,
+                                       char *buffer, size_t capacity)
+    NS_FORMAT_FUNCTION(3, 0);
+static NSInteger FormatBytesWithString(id<GTMLogFormatter> formatter,
+                                       const char *func, NSString *fmt,
+                                       va_list args, GTMLoggerLevel level,
+                                       char *buffer, size_t capacity) {
+  NSString *fname = func ? [NSString stringWithUTF8String:func] : nil;
+  NSString *msg = [formatter stringForFunc:fname
+                                withFormat:fmt
+                                    valist:args
+                                     level:level];
+  if (!msg) return -1;
+  return (NSInteger)CopyUTF8Bytes((__bridge CFStringRef)msg, buffer, capacity);
+}
+
+// Byte path for the built in filters, which only look at the level. Subclasses
+// that override -filterAllowsMessage:level: may look at the message, so they
+// get one.
+static BOOL FilterAllowsMessageBytes(id<GTMLogFilter> filter, Class baseClass,
+                                     const char *bytes, size_t length,
+                                     GTMLoggerLevel level) {
+  NSString *msg = @"";
+  if (OverridesMethod(filter, baseClass,
+                      @selector(filterAllowsMessage:level:))) {
+    msg = [[NSString alloc] initWithBytes:bytes
+                                   length:length
+                                 encoding:NSUTF8StringEncoding];
+    if (!msg) return NO;
+  }
+  return [filter filterAllowsMessage:msg level:level];
+}
+
 
 @implementation GTMLogger
 
@@ -195,6 +364,7 @@ static GTMLogger *gSharedLogger = nil;
     } else {
       writer_ = writer;
     }
+    [self updateUseBytePath];
   }
 }
 
@@ -215,6 +385,7 @@ static GTMLogger *gSharedLogger = nil;
     } else {
       formatter_ = formatter;
     }
+    [self updateUseBytePath];
   }
 }
 
@@ -237,9 +408,18 @@ static GTMLogger *gSharedLogger = nil;
       filter_ = filter;
     }
     [self notifyFilterAfterAttachIfNeeded];
+    [self updateUseBytePath];
   }
 }
 
+- (void)updateUseBytePath {
+  useBytePath_ =
+      ([writer_ conformsToProtocol:@protocol(GTMLogByteWriter)] &&
+       [formatter_ conformsToProtocol:@protocol(GTMLogByteFormatter)] &&
+       [filter_ respondsToSelector:
+           @selector(filterAllowsMessageBytes:length:level:)]);
+}
+
 - (void)notifyFilterBeforeDetachIfNeeded {
   if (![filter_ respondsToSelector:@selector(willDetachFromLogger)]) {
     return;
@@ -325,6 +505,10 @@ static GTMLogger *gSharedLogger = nil;
   // Primary point where logging happens, logging should never throw, catch
   // everything.
   @try {
+    if (useBytePath_ &&
+        [self logBytesForFunc:func format:fmt valist:args level:level]) {
+      return;
+    }
     NSString *fname = func ? [NSString stringWithUTF8String:func] : nil;
     NSString *msg = [formatter_ stringForFunc:fname
                                    withFormat:fmt
@@ -338,6 +522,57 @@ static GTMLogger *gSharedLogger = nil;
   }
 }
 
+// Formats the message into the thread's scratch buffer and hands it to the
+// GTMLogByteWriter. Returns NO without using |args| if the message has to go
+// through the NSString path instead.
+- (BOOL)logBytesForFunc:(const char *)func
+                 format:(NSString *)fmt
+                 valist:(va_list)args
+                  level:(GTMLoggerLevel)level {
+  GTMLogScratchBuffer *scratch = ScratchBufferWithCapacity(0);
+  // A writer can log again on the same thread (e.g. a GTMLogger inside of an
+  // NSArray writer), that must not clobber the bytes still being written.
+  if (!scratch || scratch->inUse) {
+    return NO;
+  }
+  id<GTMLogByteFormatter> formatter = (id<GTMLogByteFormatter>)formatter_;
+  id<GTMLogFilter> filter = filter_;
+  id<GTMLogByteWriter> writer = (id<GTMLogByteWriter>)writer_;
+  scratch->inUse = YES;
+  @try {
+    NSInteger length;
+    while (YES) {
+      va_list argsCopy;
+      va_copy(argsCopy, args);
+      length = [formatter formatBytesForFunc:func
+                                  withFormat:fmt
+                                      valist:argsCopy
+                                       level:level
+                                      buffer:scratch->bytes
+                                    capacity:scratch->capacity];
+      va_end(argsCopy);
+      if (length < 0 || (size_t)length <= scratch->capacity) {
+        break;
+      }
+      if (!ScratchBufferWithCapacity((size_t)length)) {
+        return NO;
+      }
+    }
+    if (length >= 0 &&
+        [filter filterAllowsMessageBytes:scratch->bytes
+                                  length:(size_t)length
+                                   level:level]) {
+      [writer logMessageBytes:scratch->bytes
+                       length:(size_t)length
+                        level:level];
+    }
+  }
+  @finally {
+    scratch->inUse = NO;
+  }
+  return YES;
+}
+
 @end  // PrivateMethods
 
 
@@ -369,6 +604,43 @@ static GTMLogger *gSharedLogger = nil;
   }
 }
 
+- (void)logMessageBytes:(const char *)bytes
+                 length:(size_t)length
+                  level:(GTMLoggerLevel)level {
+  @synchronized(self) {
+    @try {
+      // The message and newline go out in one writev(), looping on short
+      // writes. Errors are dropped just like in -logMessage:level:.
+      int fd = [self fileDescriptor];
+      struct iovec iov[2] = {
+        { (void *)bytes, length },
+        { (void *)"\n", 1 },
+      };
+      struct iovec *next = iov;
+      int count = 2;
+      while (count > 0) {
+        ssize_t written = writev(fd, next, count);
+        if (written < 0) {
+          if (errno == EINTR) continue;
+          break;
+        }
+        while (count > 0 && (size_t)written >= next->iov_len) {
+          written -= next->iov_len;
+          ++next;
+          --count;
+        }
+        if (count > 0) {
+          next->iov_base = (char *)next->iov_base + written;
+          next->iov_len -= written;
+        }
+      }
+    }
+    @catch (id e) {
+      // Ignored
+    }
+  }
+}
+
 @end  // GTMFileHandleLogWriter
 
 
@@ -384,6 +656,30 @@ static GTMLogger *gSharedLogger = nil;
   }
 }
 
+- (void)logMessageBytes:(const char *)bytes
+                 length:(size_t)length
+                  level:(GTMLoggerLevel)level {
+  @synchronized(self) {
+    NSString *msg = nil;
+    id<GTMLogWriter> child = nil;
+    for (child in self) {
+      if ([child conformsToProtocol:@protocol(GTMLogByteWriter)]) {
+        [(id<GTMLogByteWriter>)child logMessageBytes:bytes
+                                              length:length
+                                               level:level];
+      } else if ([child conformsToProtocol:@protocol(GTMLogWriter)]) {
+        if (!msg) {
+          msg = [[NSString alloc] initWithBytes:bytes
+                                         length:length
+                                       encoding:NSUTF8StringEncoding];
+          if (!msg) return;
+        }
+        [child logMessage:msg level:level];
+      }
+    }
+  }
+}
+
 @end  // GTMArrayCompositeLogWriter
 
 
@@ -442,6 +738,21 @@ static GTMLogger *gSharedLogger = nil;
   return [[NSString alloc] initWithFormat:fmt arguments:args];
 }
 
+- (NSInteger)formatBytesForFunc:(const char *)func
+                     withFormat:(NSString *)fmt
+                         valist:(va_list)args
+                          level:(GTMLoggerLevel)level
+                         buffer:(char *)buffer
+                       capacity:(size_t)capacity {
+  if (OverridesMethod(self, [GTMLogBasicFormatter class],
+                      @selector(stringForFunc:withFormat:valist:level:))) {
+    return FormatBytesWithString(self, func, fmt, args, level,
+                                 buffer, capacity);
+  }
+  if (!(fmt && args)) return -1;
+  return (NSInteger)FormatUTF8Bytes(fmt, args, buffer, capacity);
+}
+
 @end  // GTMLogBasicFormatter
 
 
@@ -476,6 +787,67 @@ static GTMLogger *gSharedLogger = nil;
            [super stringForFunc:func withFormat:fmt valist:args level:level]];
 }
 
+- (NSInteger)formatBytesForFunc:(const char *)func
+                     withFormat:(NSString *)fmt
+                         valist:(va_list)args
+                          level:(GTMLoggerLevel)level
+                         buffer:(char *)buffer
+                       capacity:(size_t)capacity {
+  if (OverridesMethod(self, [GTMLogStandardFormatter class],
+                      @selector(stringForFunc:withFormat:valist:level:)) ||
+      OverridesMethod(self, [GTMLogBasicFormatter class],
+                      @selector(prettyNameForFunc:))) {
+    return FormatBytesWithString(self, func, fmt, args, level,
+                                 buffer, capacity);
+  }
+
+  // Same layout as -stringForFunc:withFormat:valist:level:, with the
+  // timestamp from localtime_r instead of |dateFormatter_|.
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  struct tm tm;
+  localtime_r(&now.tv_sec, &tm);
+  char tstamp[32];
+  strftime(tstamp, sizeof(tstamp), "%Y-%m-%d %H:%M:%S", &tm);
+
+  // C version of -prettyNameForFunc:.
+  const char *name = func ? func : "";
+  while (isspace((unsigned char)*name)) ++name;
+  size_t nameLength = strlen(name);
+  while (nameLength && isspace((unsigned char)name[nameLength - 1])) {
+    --nameLength;
+  }
+  const char *nameSuffix = "";
+  if (!nameLength) {
+    name = "(unknown)";
+    nameLength = strlen(name);
+  } else if (!((nameLength >= 2 && (name[0] == '-' || name[0] == '+') &&
+                name[1] == '[') ||
+               name[nameLength - 1] == ')')) {
+    nameSuffix = "()";
+  }
+
+  int prefixLength = snprintf(buffer, capacity,
+                              "%s.%03d %s[%d/%p] [lvl=%d] %.*s%s ",
+                              tstamp, (int)(now.tv_usec / 1000),
+                              [pname_ UTF8String], pid_, pthread_self(),
+                              level, (int)nameLength, name, nameSuffix);
+  if (prefixLength < 0) return -1;
+  size_t used = MIN((size_t)prefixLength, capacity);
+  size_t msgLength;
+  if (fmt && args) {
+    msgLength = FormatUTF8Bytes(fmt, args, buffer + used, capacity - used);
+  } else {
+    // Matches the "%@" of a nil message in the NSString path.
+    static const char kNullMessage[] = "(null)";
+    msgLength = sizeof(kNullMessage) - 1;
+    if (msgLength <= capacity - used) {
+      memcpy(buffer + used, kNullMessage, msgLength);
+    }
+  }
+  return (NSInteger)((size_t)prefixLength + msgLength);
+}
+
 @end  // GTMLogStandardFormatter
 
 static NSString *const kVerboseLoggingKey = @"GTMVerboseLogging";
@@ -560,6 +932,13 @@ static BOOL IsVerboseLoggingEnabled(NSUserDefaults *userDefaults) {
   return allow;
 }
 
+- (BOOL)filterAllowsMessageBytes:(const char *)bytes
+                          length:(size_t)length
+                           level:(GTMLoggerLevel)level {
+  return FilterAllowsMessageBytes(self, [GTMLogLevelFilter class],
+                                  bytes, length, level);
+}
+
 - (void)didAttachToLogger {
   [self startObservingUserDefaultsIfNeeded];
 }
@@ -629,6 +1008,13 @@ static BOOL IsVerboseLoggingEnabled(NSUserDefaults *userDefaults) {
   return YES;  // Allow everything through
 }
 
+- (BOOL)filterAllowsMessageBytes:(const char *)bytes
+                          length:(size_t)length
+                           level:(GTMLoggerLevel)level {
+  return FilterAllowsMessageBytes(self, [GTMLogNoFilter class],
+                                  bytes, length, level);
+}
+
 @end  // GTMLogNoFilter
 
 
@@ -663,6 +1049,13 @@ static BOOL IsVerboseLoggingEnabled(NSUserDefaults *userDefaults) {
   return [allowedLevels_ containsIndex:level];
 }
 
+- (BOOL)filterAllowsMessageBytes:(const char *)bytes
+                          length:(size_t)length
+                           level:(GTMLoggerLevel)level {
+  return FilterAllowsMessageBytes(self, [GTMLogAllowedLevelFilter class],
+                                  bytes, length, level);
+}
+
 @end  // GTMLogAllowedLevelFilter
 
 
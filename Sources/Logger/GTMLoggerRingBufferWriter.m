@@ -25,6 +25,10 @@ struct GTMRingBufferPair {
   // there is a strong reference to the NSString in this data structure. By
   // using a CFStringRef we can CFRetain it, and avoid the problem.
   CFStringRef logMessage_;
+  // Used instead of |logMessage_| for messages that came in as UTF-8 bytes,
+  // they are kept as bytes until they are written out.
+  char *logBytes_;
+  size_t logBytesLength_;
   GTMLoggerLevel level_;
 };
 
@@ -41,6 +45,14 @@ typedef void (GTMRingBufferPairCallback)(GTMLoggerRingBufferWriter *rbw,
 // Add the message and level to the ring buffer.
 - (void)addMessage:(NSString *)message level:(GTMLoggerLevel)level;
 
+// Add a copy of the message bytes and level to the ring buffer.
+- (void)addMessageBytes:(const char *)bytes
+                 length:(size_t)length
+                  level:(GTMLoggerLevel)level;
+
+// Flush the buffer if |level| calls for it.
+- (void)dumpIfNeededForLevel:(GTMLoggerLevel)level;
+
 // Walk the buffer invoking the callback.
 - (void)iterateBufferWithCallback:(GTMRingBufferPairCallback)callback;
 
@@ -178,6 +190,9 @@ static void ResetCallback(GTMLoggerRingBufferWriter *rbw,
     CFRelease(pair->logMessage_);
   }
   pair->logMessage_ = nil;
+  free(pair->logBytes_);
+  pair->logBytes_ = NULL;
+  pair->logBytesLength_ = 0;
   pair->level_ = kGTMLoggerLevelUnknown;
 }  // ResetCallback
 
@@ -197,7 +212,23 @@ static void ResetCallback(GTMLoggerRingBufferWriter *rbw,
 // ring buffer's |writer_|.
 static void PrintContentsCallback(GTMLoggerRingBufferWriter *rbw,
                                   GTMRingBufferPair *pair) {
-  [[rbw writer] logMessage:(NSString*)pair->logMessage_ level:pair->level_];
+  id<GTMLogWriter> writer = [rbw writer];
+  if (!pair->logBytes_) {
+    [writer logMessage:(NSString*)pair->logMessage_ level:pair->level_];
+  } else if ([writer conformsToProtocol:@protocol(GTMLogByteWriter)]) {
+    [(id<GTMLogByteWriter>)writer logMessageBytes:pair->logBytes_
+                                           length:pair->logBytesLength_
+                                            level:pair->level_];
+  } else {
+    NSString *message =
+        [[NSString alloc] initWithBytes:pair->logBytes_
+                                 length:pair->logBytesLength_
+                               encoding:NSUTF8StringEncoding];
+    if (message) {
+      [writer logMessage:message level:pair->level_];
+      [message release];
+    }
+  }
 }  // PrintContentsCallback
 
 
@@ -217,10 +248,7 @@ static void PrintContentsCallback(GTMLoggerRingBufferWriter *rbw,
 
   // Now store the goodies.
   GTMRingBufferPair *pair = buffer_ + newIndex;
-  if (pair->logMessage_) {
-    CFRelease(pair->logMessage_);
-    pair->logMessage_ = nil;
-  }
+  ResetCallback(self, pair);
   if (message) {
     pair->logMessage_ = CFStringCreateCopy(kCFAllocatorDefault, (CFStringRef)message);
   }
@@ -229,17 +257,56 @@ static void PrintContentsCallback(GTMLoggerRingBufferWriter *rbw,
 }  // addMessage
 
 
+// Assumes caller will do any necessary synchronization.
+- (void)addMessageBytes:(const char *)bytes
+                 length:(size_t)length
+                  level:(GTMLoggerLevel)level {
+  NSUInteger newIndex = nextIndex_;
+  nextIndex_ = (nextIndex_ + 1) % capacity_;
+
+  ++totalLogged_;
+
+  GTMRingBufferPair *pair = buffer_ + newIndex;
+  ResetCallback(self, pair);
+  // malloc(0) may return NULL, always ask for at least a byte.
+  pair->logBytes_ = (char *)malloc(length ? length : 1);
+  if (pair->logBytes_) {
+    memcpy(pair->logBytes_, bytes, length);
+    pair->logBytesLength_ = length;
+  }
+  pair->level_ = level;
+
+}  // addMessageBytes
+
+
+// Assumes caller will do any necessary synchronization.
+- (void)dumpIfNeededForLevel:(GTMLoggerLevel)level {
+  if (level >= kGTMLoggerLevelError) {
+    [self dumpContents];
+    [self reset];
+  }
+}  // dumpIfNeededForLevel
+
+
 // From the GTMLogWriter protocol.
 - (void)logMessage:(NSString *)message level:(GTMLoggerLevel)level {
   @synchronized(self) {
     [self addMessage:(NSString*)message level:level];
-
-    if (level >= kGTMLoggerLevelError) {
-      [self dumpContents];
-      [self reset];
-    }
+    [self dumpIfNeededForLevel:level];
   }
 
 }  // logMessage
 
+
+// From the GTMLogByteWriter protocol.
+- (void)logMessageBytes:(const char *)bytes
+                 length:(size_t)length
+                  level:(GTMLoggerLevel)level {
+  @synchronized(self) {
+    [self addMessageBytes:bytes length:length level:level];
+    [self dumpIfNeededForLevel:level];
+  }
+
+}  // logMessageBytes
+
 @end  // GTMLoggerRingBufferWriter
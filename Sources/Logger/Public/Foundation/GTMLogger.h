@@ -43,6 +43,14 @@
 //   certain text, or filter nothing out at all. This gives the caller the
 //   flexibility to dynamically enable debug logging in Release builds.
 //
+// Writers and formatters may optionally also adopt the byte oriented
+// GTMLogByteWriter and GTMLogByteFormatter protocols. When the writer,
+// formatter, and filter of a GTMLogger all support it, messages are formatted
+// directly into a per-thread UTF-8 scratch buffer and handed to the writer as
+// bytes, skipping the intermediate NSString and the re-encoding done by the
+// writer. (Formats with %@ or unichar conversions still go through a CFString
+// for the message text.)
+//
 // This file also declares some classes to handle the common log writer, log
 // formatter, and log filter cases. Callers can also create their own writers,
 // formatters, and filters and they can even build them on top of the ones
@@ -213,6 +221,7 @@ NS_ASSUME_NONNULL_BEGIN
   id<GTMLogWriter> writer_;
   id<GTMLogFormatter> formatter_;
   id<GTMLogFilter> filter_;
+  BOOL useBytePath_;  // YES if writer, formatter and filter all handle bytes.
 }
 
 //
@@ -366,11 +375,25 @@ typedef enum {
 @end  // GTMLogWriter
 
 
+// Protocol to be implemented by log writers that can accept a message as UTF-8
+// bytes. GTMLogger uses this instead of -logMessage:level: when its formatter
+// conforms to GTMLogByteFormatter and its filter implements
+// -filterAllowsMessageBytes:length:level:.
+@protocol GTMLogByteWriter <GTMLogWriter>
+// Writes |length| bytes of UTF-8 text (not NUL terminated) from |bytes|. The
+// buffer is only valid for the duration of the call; it is reused for the next
+// message logged on the same thread.
+- (void)logMessageBytes:(const char *)bytes
+                 length:(size_t)length
+                  level:(GTMLoggerLevel)level;
+@end  // GTMLogByteWriter
+
+
 // Simple category on NSFileHandle that makes NSFileHandles valid log writers.
 // This is convenient because something like, say, +fileHandleWithStandardError
 // now becomes a valid log writer. Log messages are written to the file handle
 // with a newline appended.
-@interface NSFileHandle (GTMFileHandleLogWriter) <GTMLogWriter>
+@interface NSFileHandle (GTMFileHandleLogWriter) <GTMLogByteWriter>
 // Opens the file at |path| in append mode, and creates the file with |mode|
 // if it didn't previously exist.
 + (instancetype)fileHandleForLoggingAtPath:(NSString *)path mode:(mode_t)mode;
@@ -387,7 +410,10 @@ typedef enum {
 // multiple log writers at the same time. Simply create an NSArray of the log
 // writers you wish to use, then set the array as the "writer" for your
 // GTMLogger instance.
-@interface NSArray (GTMArrayCompositeLogWriter) <GTMLogWriter>
+//
+// When given bytes, elements that implement GTMLogByteWriter get the bytes as
+// is; the others get a single NSString created on demand.
+@interface NSArray (GTMArrayCompositeLogWriter) <GTMLogByteWriter>
 @end  // GTMArrayCompositeLogWriter
 
 
@@ -417,10 +443,32 @@ typedef enum {
 @end  // GTMLogFormatter
 
 
+// Protocol to be implemented by log formatters that can format a message
+// straight into a UTF-8 byte buffer.
+@protocol GTMLogByteFormatter <GTMLogFormatter>
+// Formats the message into |buffer| as UTF-8 (without a NUL terminator) and
+// returns the full length of the message in bytes. If the return value is
+// larger than |capacity| the contents of |buffer| are undefined and the caller
+// should call again with a larger buffer (and a fresh copy of |args|). Returns
+// -1 if there is no message to log, the equivalent of -stringForFunc:... returning
+// nil.
+- (NSInteger)formatBytesForFunc:(nullable const char *)func
+                     withFormat:(NSString *)fmt
+                         valist:(va_list)args
+                          level:(GTMLoggerLevel)level
+                         buffer:(char *)buffer
+                       capacity:(size_t)capacity NS_FORMAT_FUNCTION(2, 0);
+@end  // GTMLogByteFormatter
+
+
 // A basic log formatter that formats a string the same way that NSLog (or
 // printf) would. It does not do anything fancy, nor does it add any data of its
 // own.
-@interface GTMLogBasicFormatter : NSObject <GTMLogFormatter>
+//
+// Subclasses that override -stringForFunc:withFormat:valist:level: or
+// -prettyNameForFunc: keep working with byte writers; the byte formatting then
+// goes through their overrides and copies the resulting string.
+@interface GTMLogBasicFormatter : NSObject <GTMLogByteFormatter>
 
 // Helper method for prettying C99 __func__ and GCC __PRETTY_FUNCTION__
 - (NSString *)prettyNameForFunc:(nullable NSString *)func;
@@ -432,6 +480,10 @@ typedef enum {
 // also prepends a timestamp and some basic process info to the message, as
 // shown in the following sample output.
 //   2007-12-30 10:29:24.177 myapp[4588/0xa07d0f60] [lvl=1] log mesage here
+//
+// When formatting bytes the timestamp comes from localtime_r()/strftime(), so
+// it always uses the Gregorian calendar and ASCII digits regardless of the
+// user's locale.
 @interface GTMLogStandardFormatter : GTMLogBasicFormatter {
  @private
   NSDateFormatter *dateFormatter_;  // yyyy-MM-dd HH:mm:ss.SSS
@@ -453,6 +505,13 @@ typedef enum {
 
 @optional
 
+// Same as -filterAllowsMessage:level: but for a message given as |length|
+// bytes of UTF-8. A filter must implement this for GTMLogger to use the
+// GTMLogByteWriter path.
+- (BOOL)filterAllowsMessageBytes:(const char *)bytes
+                          length:(size_t)length
+                           level:(GTMLoggerLevel)level;
+
 // Optionally implemented by the instance to set up the filter before the logger
 // starts to use it.
 //
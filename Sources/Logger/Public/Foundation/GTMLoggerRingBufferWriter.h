@@ -50,7 +50,10 @@ typedef struct GTMRingBufferPair GTMRingBufferPair;
 // compiled out).  You can pass nil to GTMLogger's -setFilter to have it pass
 // along all the messages.
 //
-@interface GTMLoggerRingBufferWriter : NSObject <GTMLogWriter> {
+// Messages received as bytes (GTMLogByteWriter) are buffered as bytes and
+// passed on as bytes if the writer supports it.
+//
+@interface GTMLoggerRingBufferWriter : NSObject <GTMLogByteWriter> {
  @private
   id<GTMLogWriter> writer_;
   GTMRingBufferPair *buffer_;
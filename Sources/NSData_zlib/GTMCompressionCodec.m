@@ -0,0 +1,337 @@
+//
+//  GTMCompressionCodec.m
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#if !__has_feature(objc_arc)
+#error "This file needs to be compiled with ARC enabled."
+#endif
+
+#import "GTMCompressionCodec.h"
+#import <zlib.h>
+#import "GTMLZCodec.h"
+#import "GTMNSData+zlib.h"
+#import "GTMZlibInternal.h"
+
+#define kFrameHeaderLength 20
+#define kFrameVersion 1
+static const uint8_t kFrameMagic[4] = { 'G', 'T', 'M', 'C' };
+
+GTM_INLINE void WriteLittleEndian32(uint8_t *bytes, uint32_t value) {
+  bytes[0] = (uint8_t)value;
+  bytes[1] = (uint8_t)(value >> 8);
+  bytes[2] = (uint8_t)(value >> 16);
+  bytes[3] = (uint8_t)(value >> 24);
+}
+
+GTM_INLINE uint32_t ReadLittleEndian32(const uint8_t *bytes) {
+  return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) |
+         ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+// Raw deflate, written straight into the caller's buffer.
+@interface GTMDeflateCodec : NSObject <GTMCompressionCodec>
+@end
+
+@implementation GTMDeflateCodec
+
+- (uint8_t)codecIdentifier {
+  return 1;
+}
+
+- (NSString *)codecName {
+  return @"deflate";
+}
+
+- (NSUInteger)maximumCompressedLengthForLength:(NSUInteger)length {
+  // compressBound() allows for the zlib wrapper, so is generous for raw.
+  return (NSUInteger)compressBound((uLong)length);
+}
+
+- (NSUInteger)maximumDecompressedLengthForLength:(NSUInteger)length {
+  if (length > NSUIntegerMax / kMaxDeflateRatio) {
+    return NSUIntegerMax;
+  }
+  return length * kMaxDeflateRatio;
+}
+
+- (BOOL)compressBytes:(const void *)bytes
+               length:(NSUInteger)length
+     compressionLevel:(int)level
+           intoBuffer:(void *)buffer
+             capacity:(NSUInteger)capacity
+     compressedLength:(NSUInteger *)compressedLength
+                error:(NSError **)error {
+  z_stream strm;
+  bzero(&strm, sizeof(z_stream));
+  int retCode = deflateInit2(&strm, ClampCompressionLevel(level), Z_DEFLATED,
+                             -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+  if (retCode != Z_OK) {
+    // COV_NF_START - no real way to force this in a unittest (we guard all
+    // the inputs).
+    if (error) {
+      *error = ZlibError(retCode, NULL);
+    }
+    return NO;
+    // COV_NF_END
+  }
+  const unsigned char *input = (const unsigned char *)bytes;
+  NSUInteger inputLeft = length;
+  unsigned char *output = (unsigned char *)buffer;
+  NSUInteger outputLeft = capacity;
+  do {
+    RefillInput(&strm, &input, &inputLeft);
+    RefillOutput(&strm, &output, &outputLeft);
+    retCode = deflate(&strm, inputLeft ? Z_NO_FLUSH : Z_FINISH);
+  } while (retCode == Z_OK);
+  NSUInteger written = (NSUInteger)strm.total_out;
+  deflateEnd(&strm);
+  if (retCode != Z_STREAM_END) {
+    // Z_BUF_ERROR means |buffer| was too small.
+    if (error) {
+      *error = ZlibError(retCode, NULL);
+    }
+    return NO;
+  }
+  *compressedLength = written;
+  return YES;
+} // compressBytes:length:compressionLevel:intoBuffer:capacity:compressedLength:error:
+
+- (BOOL)decompressBytes:(const void *)bytes
+                 length:(NSUInteger)length
+             intoBuffer:(void *)buffer
+           outputLength:(NSUInteger)outputLength
+                  error:(NSError **)error {
+  z_stream strm;
+  bzero(&strm, sizeof(z_stream));
+  int retCode = inflateInit2(&strm, -MAX_WBITS);
+  if (retCode != Z_OK) {
+    // COV_NF_START - no real way to force this in a unittest (we guard all
+    // the inputs).
+    if (error) {
+      *error = ZlibError(retCode, NULL);
+    }
+    return NO;
+    // COV_NF_END
+  }
+  const unsigned char *input = (const unsigned char *)bytes;
+  NSUInteger inputLeft = length;
+  unsigned char *output = (unsigned char *)buffer;
+  NSUInteger outputLeft = outputLength;
+  do {
+    RefillInput(&strm, &input, &inputLeft);
+    RefillOutput(&strm, &output, &outputLeft);
+    retCode = inflate(&strm, Z_NO_FLUSH);
+  } while (retCode == Z_OK);
+  // Windows are only refilled once used up, so a stop with anything left
+  // unused means the stream ended early or late.
+  BOOL complete = (retCode == Z_STREAM_END && strm.avail_in == 0 && inputLeft == 0 &&
+                   strm.avail_out == 0 && outputLeft == 0);
+  inflateEnd(&strm);
+  if (!complete) {
+    if (error) {
+      *error = ZlibError(retCode == Z_MEM_ERROR ? Z_MEM_ERROR : Z_DATA_ERROR, NULL);
+    }
+    return NO;
+  }
+  return YES;
+} // decompressBytes:length:intoBuffer:outputLength:error:
+
+@end
+
+// Identifiers below this are for codecs in GTM, which RegisterBuiltInCodecs()
+// adds directly.
+static const uint8_t kFirstApplicationCodecIdentifier = 128;
+
+// Registered codecs, keyed by name and by identifier. Guarded by
+// @synchronized on the dictionary keyed by name.
+static NSMutableDictionary *gCodecsByName;
+static NSMutableDictionary *gCodecsByIdentifier;
+
+static void RegisterBuiltInCodecs(void) {
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    gCodecsByName = [[NSMutableDictionary alloc] init];
+    gCodecsByIdentifier = [[NSMutableDictionary alloc] init];
+    NSArray *builtIns = @[ [[GTMDeflateCodec alloc] init], [GTMLZCodec sharedCodec] ];
+    for (id<GTMCompressionCodec> codec in builtIns) {
+      [gCodecsByName setObject:codec forKey:[codec codecName]];
+      [gCodecsByIdentifier setObject:codec forKey:@([codec codecIdentifier])];
+    }
+  });
+}
+
+@implementation GTMCompressionCodecs
+
++ (BOOL)registerCodec:(id<GTMCompressionCodec>)codec {
+  RegisterBuiltInCodecs();
+  if ([codec codecIdentifier] < kFirstApplicationCodecIdentifier) {
+    return NO;
+  }
+  NSString *name = [[codec codecName] copy];
+  NSNumber *identifier = @([codec codecIdentifier]);
+  @synchronized(gCodecsByName) {
+    if ([gCodecsByName objectForKey:name] || [gCodecsByIdentifier objectForKey:identifier]) {
+      return NO;
+    }
+    [gCodecsByName setObject:codec forKey:name];
+    [gCodecsByIdentifier setObject:codec forKey:identifier];
+  }
+  return YES;
+}
+
++ (id<GTMCompressionCodec>)codecNamed:(NSString *)name {
+  RegisterBuiltInCodecs();
+  @synchronized(gCodecsByName) {
+    return [gCodecsByName objectForKey:name];
+  }
+}
+
++ (id<GTMCompressionCodec>)codecWithIdentifier:(uint8_t)identifier {
+  RegisterBuiltInCodecs();
+  @synchronized(gCodecsByName) {
+    return [gCodecsByIdentifier objectForKey:@(identifier)];
+  }
+}
+
++ (id<GTMCompressionCodec>)deflateCodec {
+  return [self codecWithIdentifier:1];
+}
+
++ (id<GTMCompressionCodec>)lzCodec {
+  return [GTMLZCodec sharedCodec];
+}
+
++ (BOOL)isFrameBytes:(const void *)bytes length:(NSUInteger)length {
+  return bytes && length >= sizeof(kFrameMagic) &&
+         memcmp(bytes, kFrameMagic, sizeof(kFrameMagic)) == 0;
+}
+
++ (NSData *)frameByCompressingBytes:(const void *)bytes
+                             length:(NSUInteger)length
+                              codec:(id<GTMCompressionCodec>)codec
+                   compressionLevel:(int)level
+                              error:(NSError **)error {
+  if (!bytes || !length) {
+    return nil;
+  }
+
+  NSUInteger capacity = [codec maximumCompressedLengthForLength:length];
+  NSMutableData *frame = [NSMutableData dataWithLength:kFrameHeaderLength + capacity];
+  if (!frame) {
+    // COV_NF_START - can't force an allocation failure in a unittest
+    if (error) {
+      *error = ZlibError(Z_MEM_ERROR, NULL);
+    }
+    return nil;
+    // COV_NF_END
+  }
+  uint8_t *header = [frame mutableBytes];
+  memcpy(header, kFrameMagic, sizeof(kFrameMagic));
+  header[4] = kFrameVersion;
+  header[5] = [codec codecIdentifier];
+  header[6] = 0;  // flags
+  header[7] = 0;  // reserved
+  WriteLittleEndian32(header + 8, (uint32_t)length);
+  WriteLittleEndian32(header + 12, (uint32_t)((uint64_t)length >> 32));
+  WriteLittleEndian32(header + 16, [NSData gtm_crc32OfBytes:bytes length:length crc:0]);
+  NSUInteger compressedLength = 0;
+  if (![codec compressBytes:bytes
+                     length:length
+           compressionLevel:level
+                 intoBuffer:header + kFrameHeaderLength
+                   capacity:capacity
+           compressedLength:&compressedLength
+                      error:error]) {
+    return nil;
+  }
+  [frame setLength:kFrameHeaderLength + compressedLength];
+  return frame;
+} // frameByCompressingBytes:length:codec:compressionLevel:error:
+
++ (NSData *)dataByDecompressingFrameBytes:(const void *)bytes
+                                   length:(NSUInteger)length
+                            maximumLength:(NSUInteger)maximumLength
+                                    error:(NSError **)error {
+  const uint8_t *header = bytes;
+  if (![self isFrameBytes:bytes length:length] || length < kFrameHeaderLength ||
+      header[4] != kFrameVersion || header[6] != 0 || header[7] != 0) {
+    if (error) {
+      *error = ZlibError(Z_DATA_ERROR, NULL);
+    }
+    return nil;
+  }
+  id<GTMCompressionCodec> codec = [self codecWithIdentifier:header[5]];
+  if (!codec) {
+    if (error) {
+      NSString *description =
+          [NSString stringWithFormat:@"No codec registered with identifier %u", header[5]];
+      *error = [NSError errorWithDomain:GTMNSDataZlibErrorDomain
+                                   code:GTMNSDataZlibErrorUnknownCodec
+                               userInfo:@{NSLocalizedDescriptionKey : description}];
+    }
+    return nil;
+  }
+  uint64_t originalLength =
+      ReadLittleEndian32(header + 8) | ((uint64_t)ReadLittleEndian32(header + 12) << 32);
+  NSUInteger payloadLength = length - kFrameHeaderLength;
+  if (originalLength == 0 || originalLength > NSUIntegerMax ||
+      originalLength > [codec maximumDecompressedLengthForLength:payloadLength]) {
+    // Frames are never written for empty input, and a length the payload
+    // can't possibly hold is damage (or a forgery meant to make the
+    // allocation below fail), not something to reserve memory for.
+    if (error) {
+      *error = ZlibError(Z_DATA_ERROR, NULL);
+    }
+    return nil;
+  }
+  if (maximumLength && originalLength > maximumLength) {
+    if (error) {
+      NSDictionary *userInfo = @{
+        GTMNSDataZlibPartialLengthKey : @0,
+        GTMNSDataZlibRemainingBytesKey : @(length),
+      };
+      *error = [NSError errorWithDomain:GTMNSDataZlibErrorDomain
+                                   code:GTMNSDataZlibErrorOutputLimitExceeded
+                               userInfo:userInfo];
+    }
+    return nil;
+  }
+  NSMutableData *result = [NSMutableData dataWithLength:(NSUInteger)originalLength];
+  if (!result) {
+    if (error) {
+      *error = ZlibError(Z_MEM_ERROR, NULL);
+    }
+    return nil;
+  }
+  if (![codec decompressBytes:header + kFrameHeaderLength
+                       length:payloadLength
+                   intoBuffer:[result mutableBytes]
+                 outputLength:[result length]
+                        error:error]) {
+    return nil;
+  }
+  uint32_t crc = [NSData gtm_crc32OfBytes:[result bytes] length:[result length] crc:0];
+  if (crc != ReadLittleEndian32(header + 16)) {
+    if (error) {
+      *error = ZlibError(Z_DATA_ERROR, NULL);
+    }
+    return nil;
+  }
+  return result;
+} // dataByDecompressingFrameBytes:length:maximumLength:error:
+
+@end
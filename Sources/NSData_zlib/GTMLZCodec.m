@@ -0,0 +1,409 @@
+//
+//  GTMLZCodec.m
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#if !__has_feature(objc_arc)
+#error "This file needs to be compiled with ARC enabled."
+#endif
+
+#import "GTMLZCodec.h"
+#import <zlib.h>
+#import "GTMNSData+zlib.h"
+#import "GTMZlibInternal.h"
+
+// Input is compressed in independent blocks of this size, which bounds the
+// block sizes to 31 bits and lets a reader skip through them.
+#define kBlockSize (4 * 1024 * 1024)
+// Set in a block's size when it is stored uncompressed.
+#define kStoredBlockFlag 0x80000000U
+#define kBlockHeaderLength 4
+
+// A match needs at least this many bytes.
+#define kMinMatch 4
+// The format ends every block with at least this many literals, and no match
+// starts in the last kMatchFindLimit bytes.
+#define kLastLiterals 5
+#define kMatchFindLimit 12
+#define kMaxOffset 65535
+#define kMaxHashLog 16
+// The most a byte of compressed input can decode to.
+#define kMaxLZRatio 255
+
+GTM_INLINE uint32_t Read32(const uint8_t *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+GTM_INLINE uint32_t HashSequence(uint32_t sequence, int hashLog) {
+  return (sequence * 2654435761U) >> (32 - hashLog);
+}
+
+// Number of equal bytes at |a| and |b|, stopping at |limit| (for |a|). The
+// first differing byte of a little endian word is its lowest set byte.
+GTM_INLINE size_t CountMatch(const uint8_t *a, const uint8_t *b, const uint8_t *limit) {
+  const uint8_t *start = a;
+  while (a + 8 <= limit) {
+    uint64_t x, y;
+    memcpy(&x, a, 8);
+    memcpy(&y, b, 8);
+    uint64_t diff = x ^ y;
+    if (diff) {
+      return (size_t)(a - start) + (size_t)(__builtin_ctzll(diff) >> 3);
+    }
+    a += 8;
+    b += 8;
+  }
+  while (a < limit && *a == *b) {
+    ++a;
+    ++b;
+  }
+  return (size_t)(a - start);
+}
+
+// Writes a 4 bit length field's overflow: 255s then the remainder.
+GTM_INLINE uint8_t *WriteLength(uint8_t *op, size_t length) {
+  while (length >= 255) {
+    *op++ = 255;
+    length -= 255;
+  }
+  *op++ = (uint8_t)length;
+  return op;
+}
+
+static uint8_t *WriteSequence(uint8_t *op, const uint8_t *literals, size_t literalLength,
+                              size_t offset, size_t matchLength) {
+  uint8_t *token = op++;
+  *token = (uint8_t)((literalLength < 15 ? literalLength : 15) << 4);
+  if (literalLength >= 15) {
+    op = WriteLength(op, literalLength - 15);
+  }
+  memcpy(op, literals, literalLength);
+  op += literalLength;
+  if (matchLength) {
+    op[0] = (uint8_t)offset;
+    op[1] = (uint8_t)(offset >> 8);
+    op += 2;
+    size_t code = matchLength - kMinMatch;
+    *token |= (uint8_t)(code < 15 ? code : 15);
+    if (code >= 15) {
+      op = WriteLength(op, code - 15);
+    }
+  }
+  return op;
+}
+
+// Worst case output for |length| bytes of input: all literals.
+GTM_INLINE size_t BlockBound(size_t length) {
+  return length + length / 255 + 16;
+}
+
+// Greedy LZ77 with a single entry hash table, in the LZ4 block format.
+// |table| has 1 << |hashLog| entries. |output| must hold BlockBound(length).
+static size_t CompressBlock(const uint8_t *input, size_t length, uint8_t *output,
+                            uint32_t *table, int hashLog) {
+  const uint8_t *ip = input;
+  const uint8_t *anchor = input;
+  const uint8_t *end = input + length;
+  uint8_t *op = output;
+  if (length > kMatchFindLimit) {
+    const uint8_t *findLimit = end - kMatchFindLimit;
+    const uint8_t *matchLimit = end - kLastLiterals;
+    memset(table, 0, sizeof(uint32_t) << hashLog);
+    ++ip;
+    while (ip < findLimit) {
+      // Look for a match, stepping faster the longer none turns up.
+      const uint8_t *match;
+      unsigned misses = 1 << 6;
+      while (1) {
+        uint32_t sequence = Read32(ip);
+        uint32_t hash = HashSequence(sequence, hashLog);
+        match = input + table[hash];
+        table[hash] = (uint32_t)(ip - input);
+        if (match < ip && ip - match <= kMaxOffset && Read32(match) == sequence) {
+          break;
+        }
+        ip += misses++ >> 6;
+        if (ip >= findLimit) {
+          goto lastLiterals;
+        }
+      }
+      // Take in any equal bytes just before it.
+      while (ip > anchor && match > input && ip[-1] == match[-1]) {
+        --ip;
+        --match;
+      }
+      size_t matchLength = kMinMatch + CountMatch(ip + kMinMatch, match + kMinMatch, matchLimit);
+      op = WriteSequence(op, anchor, (size_t)(ip - anchor), (size_t)(ip - match), matchLength);
+      ip += matchLength;
+      anchor = ip;
+      if (ip < findLimit) {
+        // Index a position inside the match too, it's cheap and helps.
+        table[HashSequence(Read32(ip - 2), hashLog)] = (uint32_t)(ip - 2 - input);
+      }
+    }
+  }
+lastLiterals:
+  op = WriteSequence(op, anchor, (size_t)(end - anchor), 0, 0);
+  return (size_t)(op - output);
+}
+
+// Reads a length field's overflow bytes. Returns NO past |end| or on overflow.
+GTM_INLINE BOOL ReadLength(const uint8_t **ip, const uint8_t *end, size_t *length) {
+  uint8_t byte;
+  do {
+    if (*ip >= end) {
+      return NO;
+    }
+    byte = *(*ip)++;
+    if (*length > SIZE_MAX - 255) {
+      return NO;
+    }
+    *length += byte;
+  } while (byte == 255);
+  return YES;
+}
+
+// Decodes an LZ4 format block into exactly |outputLength| bytes, checking
+// every length and offset against both buffers. Where the output has room the
+// copies go 16 (or 8) bytes at a time, running past the end of the piece
+// being copied; the next piece overwrites the extra.
+static BOOL DecompressBlock(const uint8_t *input, size_t length,
+                            uint8_t *output, size_t outputLength) {
+  const uint8_t *ip = input;
+  const uint8_t *end = input + length;
+  uint8_t *op = output;
+  uint8_t *outputEnd = output + outputLength;
+  while (1) {
+    if (ip >= end) {
+      return NO;
+    }
+    unsigned token = *ip++;
+
+    size_t literalLength = token >> 4;
+    if (literalLength == 15 && !ReadLength(&ip, end, &literalLength)) {
+      return NO;
+    }
+    if (literalLength > (size_t)(end - ip) || literalLength > (size_t)(outputEnd - op)) {
+      return NO;
+    }
+    if (literalLength <= 16 && end - ip >= 16 && outputEnd - op >= 16) {
+      memcpy(op, ip, 16);
+    } else {
+      memcpy(op, ip, literalLength);
+    }
+    ip += literalLength;
+    op += literalLength;
+    if (ip == end) {
+      // The last sequence has no match.
+      return op == outputEnd;
+    }
+
+    if (end - ip < 2) {
+      return NO;
+    }
+    size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+    ip += 2;
+    size_t matchLength = token & 15;
+    if (matchLength == 15 && !ReadLength(&ip, end, &matchLength)) {
+      return NO;
+    }
+    matchLength += kMinMatch;
+    if (offset == 0 || offset > (size_t)(op - output) ||
+        matchLength > (size_t)(outputEnd - op)) {
+      return NO;
+    }
+    const uint8_t *match = op - offset;
+    size_t room = (size_t)(outputEnd - op);
+    size_t i = 0;
+    if (offset >= 16) {
+      for (; i < matchLength && i + 16 <= room; i += 16) {
+        memcpy(op + i, match + i, 16);
+      }
+    } else if (offset >= 8) {
+      for (; i < matchLength && i + 8 <= room; i += 8) {
+        memcpy(op + i, match + i, 8);
+      }
+    } else if (matchLength >= 8) {
+      // A short repeating pattern. Once its first 8 bytes are out, copy 8 at
+      // a time from a whole number of periods back.
+      size_t distance = offset * ((8 + offset - 1) / offset);
+      for (; i < 8; ++i) {
+        op[i] = match[i];
+      }
+      for (; i < matchLength && i + 8 <= room; i += 8) {
+        memcpy(op + i, op + i - distance, 8);
+      }
+    }
+    // Whatever is left at the very end of the output, a byte at a time.
+    for (; i < matchLength; ++i) {
+      op[i] = match[i];
+    }
+    op += matchLength;
+  }
+}
+
+GTM_INLINE void WriteLittleEndian32(uint8_t *bytes, uint32_t value) {
+  bytes[0] = (uint8_t)value;
+  bytes[1] = (uint8_t)(value >> 8);
+  bytes[2] = (uint8_t)(value >> 16);
+  bytes[3] = (uint8_t)(value >> 24);
+}
+
+GTM_INLINE uint32_t ReadLittleEndian32(const uint8_t *bytes) {
+  return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) |
+         ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+// A table about the size of the input, between 256 and 64K entries; clearing
+// a big table for a small input would cost more than compressing it.
+static int HashLogForLength(size_t length) {
+  int hashLog = 8;
+  while (hashLog < kMaxHashLog && ((size_t)1 << hashLog) < length) {
+    ++hashLog;
+  }
+  return hashLog;
+}
+
+@implementation GTMLZCodec
+
++ (GTMLZCodec *)sharedCodec {
+  static GTMLZCodec *sharedCodec;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    sharedCodec = [[GTMLZCodec alloc] init];
+  });
+  return sharedCodec;
+}
+
+- (uint8_t)codecIdentifier {
+  return 2;
+}
+
+- (NSString *)codecName {
+  return @"lz";
+}
+
+- (NSUInteger)maximumCompressedLengthForLength:(NSUInteger)length {
+  NSUInteger blockCount = (length + kBlockSize - 1) / kBlockSize;
+  return length + length / 255 + blockCount * (kBlockHeaderLength + 16);
+}
+
+- (NSUInteger)maximumDecompressedLengthForLength:(NSUInteger)length {
+  // Past a sequence's first few bytes, every input byte is either a literal
+  // or a 255 extending a match, so nothing expands more than 255:1.
+  if (length > NSUIntegerMax / kMaxLZRatio) {
+    return NSUIntegerMax;
+  }
+  return length * kMaxLZRatio;
+}
+
+- (BOOL)compressBytes:(const void *)bytes
+               length:(NSUInteger)length
+     compressionLevel:(int)level
+           intoBuffer:(void *)buffer
+             capacity:(NSUInteger)capacity
+     compressedLength:(NSUInteger *)compressedLength
+                error:(NSError **)error {
+  if (capacity < [self maximumCompressedLengthForLength:length]) {
+    if (error) {
+      *error = ZlibError(Z_BUF_ERROR, NULL);
+    }
+    return NO;
+  }
+  int hashLog = HashLogForLength(MIN(length, (NSUInteger)kBlockSize));
+  uint32_t *table = malloc(sizeof(uint32_t) << hashLog);
+  if (!table) {
+    // COV_NF_START - can't force an allocation failure in a unittest
+    if (error) {
+      *error = ZlibError(Z_MEM_ERROR, NULL);
+    }
+    return NO;
+    // COV_NF_END
+  }
+  const uint8_t *input = bytes;
+  uint8_t *op = buffer;
+  NSUInteger left = length;
+  while (left) {
+    size_t blockLength = MIN(left, (NSUInteger)kBlockSize);
+    uint8_t *block = op + kBlockHeaderLength;
+    uint32_t size = (uint32_t)CompressBlock(input, blockLength, block, table, hashLog);
+    if (size >= blockLength) {
+      // Didn't help, keep the bytes as they are.
+      memcpy(block, input, blockLength);
+      size = (uint32_t)blockLength;
+      WriteLittleEndian32(op, size | kStoredBlockFlag);
+    } else {
+      WriteLittleEndian32(op, size);
+    }
+    op = block + size;
+    input += blockLength;
+    left -= blockLength;
+  }
+  free(table);
+  *compressedLength = (NSUInteger)(op - (uint8_t *)buffer);
+  return YES;
+} // compressBytes:length:compressionLevel:intoBuffer:capacity:compressedLength:error:
+
+- (BOOL)decompressBytes:(const void *)bytes
+                 length:(NSUInteger)length
+             intoBuffer:(void *)buffer
+           outputLength:(NSUInteger)outputLength
+                  error:(NSError **)error {
+  const uint8_t *ip = bytes;
+  const uint8_t *end = ip + length;
+  uint8_t *op = buffer;
+  NSUInteger left = outputLength;
+  BOOL good = YES;
+  while (left) {
+    size_t blockLength = MIN(left, (NSUInteger)kBlockSize);
+    if (end - ip < kBlockHeaderLength) {
+      good = NO;
+      break;
+    }
+    uint32_t header = ReadLittleEndian32(ip);
+    ip += kBlockHeaderLength;
+    size_t size = header & ~kStoredBlockFlag;
+    if (size > (size_t)(end - ip)) {
+      good = NO;
+      break;
+    }
+    if (header & kStoredBlockFlag) {
+      good = (size == blockLength);
+      if (good) {
+        memcpy(op, ip, blockLength);
+      }
+    } else {
+      good = DecompressBlock(ip, size, op, blockLength);
+    }
+    if (!good) {
+      break;
+    }
+    ip += size;
+    op += blockLength;
+    left -= blockLength;
+  }
+  if (!good || ip != end) {
+    if (error) {
+      *error = ZlibError(Z_DATA_ERROR, NULL);
+    }
+    return NO;
+  }
+  return YES;
+} // decompressBytes:length:intoBuffer:outputLength:error:
+
+@end
@@ -18,13 +18,1022 @@
 
 #import "GTMNSData+zlib.h"
 #import <zlib.h>
+#import "GTMCompressionCodec.h"
 #import "GTMDefines.h"
+#import "GTMZlibCompressor.h"
+#import "GTMZlibInternal.h"
+#import <errno.h>
+#import <fcntl.h>
+#import <poll.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
+#import <unistd.h>
+#if defined(__x86_64__)
+#import <emmintrin.h>
+#import <wmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#import <arm_acle.h>
+#endif
+
+// Checksums over this much input are split across cores by the parallel
+// checksum apis; anything smaller isn't worth the dispatch.
+#define kParallelChecksumBlockSize (1024 * 1024)
+
+#if defined(__x86_64__)
+
+// The carry-less multiply folding from Intel's "Fast CRC Computation for
+// Generic Polynomials Using PCLMULQDQ Instruction", with the constants for
+// the reflected CRC-32 polynomial zlib uses. Folds four 16 byte lanes at a
+// time, so it needs at least 64 bytes; a tail of under 16 is left to zlib.
+#define kPclmulMinimumLength 64
+
+__attribute__((target("pclmul")))
+static uint32_t Crc32Pclmul(uint32_t crc, const unsigned char *bytes, NSUInteger length) {
+  static const uint64_t kFold4[2] __attribute__((aligned(16))) = { 0x0154442bd4, 0x01c6e41596 };
+  static const uint64_t kFold1[2] __attribute__((aligned(16))) = { 0x01751997d0, 0x00ccaa009e };
+  static const uint64_t kFold64[2] __attribute__((aligned(16))) = { 0x0163cd6124, 0x0000000000 };
+  static const uint64_t kBarrett[2] __attribute__((aligned(16))) = { 0x01db710641, 0x01f7011641 };
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+  x1 = _mm_loadu_si128((const __m128i *)(bytes + 0x00));
+  x2 = _mm_loadu_si128((const __m128i *)(bytes + 0x10));
+  x3 = _mm_loadu_si128((const __m128i *)(bytes + 0x20));
+  x4 = _mm_loadu_si128((const __m128i *)(bytes + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)~crc));
+  x0 = _mm_load_si128((const __m128i *)kFold4);
+  bytes += 64;
+  length -= 64;
+
+  // Fold 64 bytes at a time.
+  while (length >= 64) {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *)(bytes + 0x00)));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *)(bytes + 0x10)));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *)(bytes + 0x20)));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *)(bytes + 0x30)));
+    bytes += 64;
+    length -= 64;
+  }
+
+  // Fold the four lanes into one, then any remaining 16 byte blocks.
+  x0 = _mm_load_si128((const __m128i *)kFold1);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+  while (length >= 16) {
+    x2 = _mm_loadu_si128((const __m128i *)bytes);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    bytes += 16;
+    length -= 16;
+  }
+
+  // 128 bits down to 64, then a Barrett reduction to 32.
+  x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+  x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+  x1 = _mm_srli_si128(x1, 8);
+  x1 = _mm_xor_si128(x1, x2);
+  x0 = _mm_loadl_epi64((const __m128i *)kFold64);
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, x3);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+  x0 = _mm_load_si128((const __m128i *)kBarrett);
+  x2 = _mm_and_si128(x1, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+  x2 = _mm_and_si128(x2, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+  crc = ~(uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+
+  if (length) {
+    crc = (uint32_t)crc32(crc, bytes, (uInt)length);
+  }
+  return crc;
+}
+
+static BOOL HasPclmul(void) {
+  static BOOL hasPclmul;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    hasPclmul = __builtin_cpu_supports("pclmul") ? YES : NO;
+  });
+  return hasPclmul;
+}
+
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+
+// The ARMv8 CRC32 instructions use the same polynomial as zlib.
+static uint32_t Crc32Arm(uint32_t crc, const unsigned char *bytes, NSUInteger length) {
+  crc = ~crc;
+  while (length && ((uintptr_t)bytes & 7)) {
+    crc = __crc32b(crc, *bytes++);
+    --length;
+  }
+  while (length >= 32) {
+    uint64_t words[4];
+    memcpy(words, bytes, sizeof(words));
+    crc = __crc32d(crc, words[0]);
+    crc = __crc32d(crc, words[1]);
+    crc = __crc32d(crc, words[2]);
+    crc = __crc32d(crc, words[3]);
+    bytes += 32;
+    length -= 32;
+  }
+  while (length >= 8) {
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    crc = __crc32d(crc, word);
+    bytes += 8;
+    length -= 8;
+  }
+  while (length--) {
+    crc = __crc32b(crc, *bytes++);
+  }
+  return ~crc;
+}
+
+#endif
+
+// crc32() of |bytes| continuing from |crc|, using the CPU's instructions when
+// it has them. Any length works; zlib's uInt is fed in windows.
+static uint32_t Crc32Bytes(uint32_t crc, const unsigned char *bytes, NSUInteger length) {
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+  return Crc32Arm(crc, bytes, length);
+#else
+#if defined(__x86_64__)
+  if (length >= kPclmulMinimumLength && HasPclmul()) {
+    return Crc32Pclmul(crc, bytes, length);
+  }
+#endif
+  while (length) {
+    uInt window = (uInt)MIN(length, kMaxZlibWindow);
+    crc = (uint32_t)crc32(crc, bytes, window);
+    bytes += window;
+    length -= window;
+  }
+  return crc;
+#endif
+}
+
+static uint32_t Adler32Bytes(uint32_t adler, const unsigned char *bytes, NSUInteger length) {
+  while (length) {
+    uInt window = (uInt)MIN(length, kMaxZlibWindow);
+    adler = (uint32_t)adler32(adler, bytes, window);
+    bytes += window;
+    length -= window;
+  }
+  return adler;
+}
+
+// Checksums |length| bytes as kParallelChecksumBlockSize or bigger pieces on
+// all cores, combining the pieces in order.
+static uint32_t ParallelChecksum(uint32_t checksum, const unsigned char *bytes,
+                                 NSUInteger length, BOOL isCrc) {
+  NSUInteger workerCount =
+      MIN(length / kParallelChecksumBlockSize, [[NSProcessInfo processInfo] activeProcessorCount]);
+  if (workerCount < 2) {
+    return isCrc ? Crc32Bytes(checksum, bytes, length) : Adler32Bytes(checksum, bytes, length);
+  }
+  NSUInteger pieceLength = length / workerCount;
+  uint32_t *pieces = (uint32_t *)calloc(workerCount, sizeof(uint32_t));
+  if (!pieces) {
+    // COV_NF_START
+    return isCrc ? Crc32Bytes(checksum, bytes, length) : Adler32Bytes(checksum, bytes, length);
+    // COV_NF_END
+  }
+  dispatch_apply(workerCount,
+                 dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
+                 ^(size_t worker) {
+    const unsigned char *start = bytes + worker * pieceLength;
+    // The last piece takes the remainder.
+    NSUInteger count = (worker == workerCount - 1)
+        ? length - worker * pieceLength : pieceLength;
+    pieces[worker] = isCrc ? Crc32Bytes(0, start, count) : Adler32Bytes(1, start, count);
+  });
+  for (NSUInteger i = 0; i < workerCount; ++i) {
+    z_off_t count = (z_off_t)((i == workerCount - 1) ? length - i * pieceLength : pieceLength);
+    checksum = isCrc ? (uint32_t)crc32_combine(checksum, pieces[i], count)
+                     : (uint32_t)adler32_combine(checksum, pieces[i], count);
+  }
+  free(pieces);
+  return checksum;
+}
+
+// The parallel gzip input is split into blocks of this size, each compressed
+// on its own (primed with the previous kDeflateWindowSize bytes).
+#define kParallelGzipBlockSize (128 * 1024)
+#define kDeflateWindowSize (32 * 1024)
+
+// One block of a parallel gzip.
+typedef struct {
+  const unsigned char *input;
+  NSUInteger length;
+  unsigned char *output;  // Has room for kParallelGzipBlockSize's worst case.
+  NSUInteger produced;
+  uLong crc;
+  int retCode;
+} GzipBlock;
+
+// Raw deflates |block| with |strm|, using the input before it (back to
+// |start|) as the dictionary so the result is about what a single stream
+// would have produced. All but the last block end with a sync flush so they
+// can just be concatenated.
+static void CompressGzipBlock(z_stream *strm, GzipBlock *block,
+                              const unsigned char *start, uInt capacity,
+                              BOOL last) {
+  if (block->input != start) {
+    uInt dictionaryLength =
+        (uInt)MIN((NSUInteger)kDeflateWindowSize, (NSUInteger)(block->input - start));
+    int retCode = deflateSetDictionary(strm, block->input - dictionaryLength,
+                                       dictionaryLength);
+    if (retCode != Z_OK) {
+      block->retCode = retCode;  // COV_NF_LINE
+      return;  // COV_NF_LINE
+    }
+  }
+  strm->next_in = (Bytef *)block->input;
+  strm->avail_in = (uInt)block->length;
+  strm->next_out = block->output;
+  strm->avail_out = capacity;
+  int retCode = deflate(strm, last ? Z_FINISH : Z_SYNC_FLUSH);
+  BOOL done = last ? (retCode == Z_STREAM_END)
+                   : (retCode == Z_OK && strm->avail_out != 0);
+  if (!done) {
+    // COV_NF_START - the output is sized so this can't happen
+    block->retCode = (retCode == Z_OK || retCode == Z_STREAM_END) ? Z_BUF_ERROR
+                                                                   : retCode;
+    return;
+    // COV_NF_END
+  }
+  block->produced = capacity - strm->avail_out;
+  block->crc = Crc32Bytes(0, block->input, block->length);
+  block->retCode = Z_OK;
+}
+
+GTM_INLINE void WriteLittleEndian32(unsigned char *bytes, uLong value) {
+  bytes[0] = (unsigned char)(value & 0xff);
+  bytes[1] = (unsigned char)((value >> 8) & 0xff);
+  bytes[2] = (unsigned char)((value >> 16) & 0xff);
+  bytes[3] = (unsigned char)((value >> 24) & 0xff);
+}
+
+#define kGzipHeaderSize 10
+
+// Same header zlib writes: no name/time, "extra flags" for the level, unix.
+static void WriteGzipHeader(unsigned char *output, int level) {
+  output[0] = 0x1f;
+  output[1] = 0x8b;
+  output[2] = Z_DEFLATED;
+  output[3] = 0;
+  WriteLittleEndian32(output + 4, 0);
+  output[8] = (level == Z_BEST_COMPRESSION) ? 2 : ((level == Z_BEST_SPEED) ? 4 : 0);
+  output[9] = 3;
+}
+
+// Block gzip (BGZF, as written by bgzip/htslib) is a series of independent
+// gzip members of at most 64KB, each recording its own size in a "BC" extra
+// subfield, so a reader can find every member without inflating anything.
+#define kBlockGzipInputSize 0xff00
+#define kBlockGzipMaxMemberSize 0x10000
+#define kBlockGzipHeaderSize 18
+#define kGzipTrailerSize 8
+
+// The empty member bgzip ends its files with.
+static const unsigned char kBlockGzipEOF[28] = {
+  0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00,
+  0x42, 0x43, 0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00,
+};
+
+GTM_INLINE uLong ReadLittleEndian32(const unsigned char *bytes) {
+  return (uLong)bytes[0] | ((uLong)bytes[1] << 8) |
+         ((uLong)bytes[2] << 16) | ((uLong)bytes[3] << 24);
+}
+
+GTM_INLINE void WriteLittleEndian64(unsigned char *bytes, uint64_t value) {
+  for (int i = 0; i < 8; ++i) {
+    bytes[i] = (unsigned char)((value >> (8 * i)) & 0xff);
+  }
+}
+
+// If |bytes| starts with a BGZF member, returns YES and its total size.
+static BOOL ReadBlockGzipMemberSize(const unsigned char *bytes, NSUInteger length,
+                                    NSUInteger *memberSize) {
+  if (length < kBlockGzipHeaderSize + kGzipTrailerSize ||
+      !IsGzipMember(bytes, length) || bytes[2] != Z_DEFLATED ||
+      !(bytes[3] & 0x04)) {  // FEXTRA
+    return NO;
+  }
+  NSUInteger extraLength = bytes[10] | (bytes[11] << 8);
+  if (12 + extraLength > length) {
+    return NO;
+  }
+  const unsigned char *field = bytes + 12;
+  const unsigned char *extraEnd = field + extraLength;
+  while (field + 4 <= extraEnd) {
+    NSUInteger fieldLength = field[2] | (field[3] << 8);
+    if (field[0] == 'B' && field[1] == 'C' && fieldLength == 2 &&
+        field + 6 <= extraEnd) {
+      NSUInteger size = (NSUInteger)(field[4] | (field[5] << 8)) + 1;
+      if (size < 12 + extraLength + kGzipTrailerSize || size > length) {
+        return NO;
+      }
+      *memberSize = size;
+      return YES;
+    }
+    field += 4 + fieldLength;
+  }
+  return NO;
+}
+
+static NSError *ZlibMemoryError(void) {
+  // COV_NF_START - can't force an allocation failure in a unittest
+  return ZlibError(Z_MEM_ERROR, NULL);
+  // COV_NF_END
+}
+
+// Dictionary training looks for runs of kDictionaryGramLength byte "grams"
+// that show up in many samples, counted in a hashed table (collisions just
+// make the counts a little generous).
+#define kDictionaryGramLength 8
+#define kDictionaryHashBits 18
+#define kMaxDictionaryLength (32 * 1024)
+
+// A run of a sample that is a candidate for the dictionary.
+typedef struct {
+  const unsigned char *bytes;
+  NSUInteger length;
+  uint64_t score;
+} DictionarySegment;
+
+GTM_INLINE uint32_t HashDictionaryGram(const unsigned char *bytes) {
+  uint64_t value;
+  memcpy(&value, bytes, sizeof(value));
+  return (uint32_t)((value * 0x9E3779B97F4A7C15ULL) >> (64 - kDictionaryHashBits));
+}
+
+// Best score first, ties in sample order so the result is deterministic.
+static int CompareDictionarySegments(const void *a, const void *b) {
+  const DictionarySegment *lhs = a;
+  const DictionarySegment *rhs = b;
+  if (lhs->score != rhs->score) {
+    return (lhs->score < rhs->score) ? 1 : -1;
+  }
+  if (lhs->bytes != rhs->bytes) {
+    return (lhs->bytes < rhs->bytes) ? -1 : 1;
+  }
+  return 0;
+}
+
+// Fills the end of |output| (|maxLength| bytes) with the best segments of
+// |samples|, best last, and returns how many bytes were used.
+static NSUInteger TrainDictionary(NSArray *samples, unsigned char *output,
+                                  NSUInteger maxLength) {
+  NSUInteger count = [samples count];
+  NSUInteger tableSize = (NSUInteger)1 << kDictionaryHashBits;
+  uint32_t *frequency = calloc(tableSize, sizeof(uint32_t));
+  uint32_t *lastSample = calloc(tableSize, sizeof(uint32_t));
+  if (!frequency || !lastSample) {
+    // COV_NF_START
+    free(frequency);
+    free(lastSample);
+    return 0;
+    // COV_NF_END
+  }
+
+  // Count the samples each gram appears in; repeats within one sample don't
+  // count since deflate finds those on its own.
+  for (NSUInteger i = 0; i < count; ++i) {
+    NSData *sample = [samples objectAtIndex:i];
+    const unsigned char *bytes = [sample bytes];
+    NSUInteger length = [sample length];
+    for (NSUInteger j = 0; j + kDictionaryGramLength <= length; ++j) {
+      uint32_t hash = HashDictionaryGram(bytes + j);
+      if (lastSample[hash] != i + 1) {
+        lastSample[hash] = (uint32_t)(i + 1);
+        ++frequency[hash];
+      }
+    }
+  }
+  free(lastSample);
+
+  // Every run of grams common to at least 1% of the samples (and at least two
+  // of them) is a candidate, scored by how common its grams are.
+  uint32_t minFrequency = (uint32_t)MAX((NSUInteger)2, count / 100);
+  DictionarySegment *segments = NULL;
+  NSUInteger segmentCount = 0;
+  NSUInteger segmentCapacity = 0;
+  for (NSUInteger i = 0; i < count; ++i) {
+    NSData *sample = [samples objectAtIndex:i];
+    const unsigned char *bytes = [sample bytes];
+    NSUInteger length = [sample length];
+    NSUInteger j = 0;
+    while (j + kDictionaryGramLength <= length) {
+      NSUInteger start = j;
+      uint64_t score = 0;
+      uint32_t gramFrequency;
+      while (j + kDictionaryGramLength <= length &&
+             (gramFrequency = frequency[HashDictionaryGram(bytes + j)]) >= minFrequency) {
+        score += gramFrequency;
+        ++j;
+      }
+      if (j == start) {
+        ++j;
+        continue;
+      }
+      if (segmentCount == segmentCapacity) {
+        segmentCapacity = MAX(segmentCapacity * 2, (NSUInteger)64);
+        DictionarySegment *grown = realloc(segments, segmentCapacity * sizeof(DictionarySegment));
+        if (!grown) {
+          // COV_NF_START
+          free(segments);
+          free(frequency);
+          return 0;
+          // COV_NF_END
+        }
+        segments = grown;
+      }
+      DictionarySegment segment = {
+        bytes + start, j - start + kDictionaryGramLength - 1, score
+      };
+      segments[segmentCount++] = segment;
+    }
+  }
+  if (segmentCount) {
+    qsort(segments, segmentCount, sizeof(DictionarySegment), CompareDictionarySegments);
+  }
+
+  // Greedily take the best segments. The grams of a taken segment stop
+  // scoring, so the many copies of a common run are only taken once, and
+  // segments mostly covered already are skipped.
+  NSUInteger used = 0;
+  for (NSUInteger i = 0; i < segmentCount && used < maxLength; ++i) {
+    DictionarySegment *segment = &segments[i];
+    if (segment->length > maxLength - used) {
+      continue;
+    }
+    uint64_t score = 0;
+    for (NSUInteger j = 0; j + kDictionaryGramLength <= segment->length; ++j) {
+      score += frequency[HashDictionaryGram(segment->bytes + j)];
+    }
+    if (score * 2 < segment->score) {
+      continue;
+    }
+    for (NSUInteger j = 0; j + kDictionaryGramLength <= segment->length; ++j) {
+      frequency[HashDictionaryGram(segment->bytes + j)] = 0;
+    }
+    used += segment->length;
+    memcpy(output + maxLength - used, segment->bytes, segment->length);
+  }
+  free(segments);
+  free(frequency);
+  return used;
+}
+
+// The file apis map this much of the input at a time (a multiple of
+// kParallelGzipBlockSize) and buffer this much output per write().
+#define kFileMapWindowSize (64 * 1024 * 1024)
+#define kFileWriteBufferSize (1024 * 1024)
+
+static NSError *FileError(int errnum, NSString *path) {
+  NSDictionary *userInfo = [NSDictionary dictionaryWithObject:path
+                                                       forKey:NSFilePathErrorKey];
+  return [NSError errorWithDomain:NSPOSIXErrorDomain
+                             code:errnum
+                         userInfo:userInfo];
+}
+
+// Input and output for the file apis: the input is mapped a window at a time
+// (with sequential read-ahead) and the output collected into a fixed buffer,
+// so memory use doesn't depend on the file sizes.
+typedef struct {
+  int inputFD;
+  uint64_t inputSize;
+  unsigned char *map;
+  size_t mapLength;
+  int outputFD;
+  unsigned char *buffer;
+  NSUInteger buffered;
+  NSString *inputPath;
+  NSString *outputPath;
+} FileCoder;
+
+// Maps |length| bytes of the input from |offset|, replacing any earlier map.
+// mmap needs a page aligned offset and pages may be bigger than
+// kDeflateWindowSize (16KB or 64KB on some systems), so the map starts at the
+// page holding |offset| and the pointer returned is |offset|'s byte in it.
+static const unsigned char *MapInput(FileCoder *coder, uint64_t offset,
+                                     NSUInteger length, NSError **error) {
+  if (coder->map) {
+    munmap(coder->map, coder->mapLength);
+    coder->map = NULL;
+  }
+  NSUInteger slack = (NSUInteger)(offset % (uint64_t)getpagesize());
+  void *map = mmap(NULL, slack + length, PROT_READ, MAP_PRIVATE, coder->inputFD,
+                   (off_t)(offset - slack));
+  if (map == MAP_FAILED) {
+    // COV_NF_START
+    if (error) {
+      *error = FileError(errno, coder->inputPath);
+    }
+    return NULL;
+    // COV_NF_END
+  }
+  madvise(map, slack + length, MADV_SEQUENTIAL);
+  coder->map = map;
+  coder->mapLength = slack + length;
+  return (const unsigned char *)map + slack;
+}
+
+static BOOL WriteAll(FileCoder *coder, const unsigned char *bytes,
+                     NSUInteger length, NSError **error) {
+  while (length > 0) {
+    ssize_t written = write(coder->outputFD, bytes, MIN(length, (NSUInteger)SSIZE_MAX));
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;  // COV_NF_LINE
+      }
+      if (error) {
+        *error = FileError(errno, coder->outputPath);
+      }
+      return NO;
+    }
+    bytes += written;
+    length -= (NSUInteger)written;
+  }
+  return YES;
+}
+
+static BOOL FlushOutput(FileCoder *coder, NSError **error) {
+  BOOL good = WriteAll(coder, coder->buffer, coder->buffered, error);
+  coder->buffered = 0;
+  return good;
+}
+
+// Runs |strm| (deflate or inflate, per |isDeflate|) over its current input,
+// passing the output through |coder|'s buffer. Returns the last zlib result,
+// or Z_ERRNO if a write failed (|error| is set either way on failure).
+static int CodeToFile(FileCoder *coder, z_stream *strm, BOOL isDeflate,
+                      int flush, NSError **error) {
+  int retCode;
+  do {
+    if (coder->buffered == kFileWriteBufferSize &&
+        !FlushOutput(coder, error)) {
+      return Z_ERRNO;
+    }
+    strm->next_out = coder->buffer + coder->buffered;
+    strm->avail_out = (uInt)(kFileWriteBufferSize - coder->buffered);
+    uInt outWindow = strm->avail_out;
+    retCode = isDeflate ? deflate(strm, flush) : inflate(strm, flush);
+    coder->buffered += outWindow - strm->avail_out;
+    if (retCode != Z_OK && retCode != Z_STREAM_END && retCode != Z_BUF_ERROR) {
+      if (error) {
+        *error = ZlibError(retCode, strm->msg);
+      }
+      return retCode;
+    }
+  } while (retCode == Z_OK && (strm->avail_out == 0 || strm->avail_in != 0 ||
+                               (isDeflate && flush == Z_FINISH)));
+  // Z_BUF_ERROR just means no progress was possible: out of input.
+  return (retCode == Z_BUF_ERROR) ? Z_OK : retCode;
+}
+
+static BOOL DeflateFile(FileCoder *coder, int level, NSError **error) {
+  z_stream strm;
+  bzero(&strm, sizeof(z_stream));
+  int retCode = deflateInit2(&strm, level, Z_DEFLATED, 15 + 16, 8,
+                             Z_DEFAULT_STRATEGY);
+  if (retCode != Z_OK) {
+    // COV_NF_START
+    if (error) {
+      *error = ZlibError(retCode, NULL);
+    }
+    return NO;
+    // COV_NF_END
+  }
+  uint64_t offset = 0;
+  do {
+    NSUInteger length = (NSUInteger)MIN(coder->inputSize - offset,
+                                        (uint64_t)kFileMapWindowSize);
+    const unsigned char *input = NULL;
+    if (length && !(input = MapInput(coder, offset, length, error))) {
+      deflateEnd(&strm);  // COV_NF_LINE
+      return NO;  // COV_NF_LINE
+    }
+    offset += length;
+    strm.next_in = (Bytef *)input;
+    strm.avail_in = (uInt)length;
+    BOOL last = (offset == coder->inputSize);
+    retCode = CodeToFile(coder, &strm, YES, last ? Z_FINISH : Z_NO_FLUSH, error);
+    if (retCode != (last ? Z_STREAM_END : Z_OK)) {
+      deflateEnd(&strm);
+      return NO;
+    }
+  } while (offset < coder->inputSize);
+  deflateEnd(&strm);
+  return YES;
+}
+
+// pigz style: the input is cut into kParallelGzipBlockSize blocks which are
+// compressed a batch at a time on all cores (each primed with the 32KB before
+// it) and written out in order as one gzip stream.
+static BOOL ParallelDeflateFile(FileCoder *coder, int level,
+                                NSUInteger workerCount, NSError **error) {
+  uint64_t blockCount =
+      (coder->inputSize + kParallelGzipBlockSize - 1) / kParallelGzipBlockSize;
+  NSUInteger batchSize = workerCount * 4;
+  uInt slotSize = (uInt)compressBound(kParallelGzipBlockSize) + 16;
+  unsigned char *slots = (unsigned char *)malloc(batchSize * slotSize);
+  GzipBlock *blocks = (GzipBlock *)calloc(batchSize, sizeof(GzipBlock));
+  z_stream *streams = (z_stream *)calloc(workerCount, sizeof(z_stream));
+  if (!slots || !blocks || !streams) {
+    // COV_NF_START
+    free(slots);
+    free(blocks);
+    free(streams);
+    if (error) {
+      *error = ZlibMemoryError();
+    }
+    return NO;
+    // COV_NF_END
+  }
+  NSUInteger initialized = 0;
+  int retCode = Z_OK;
+  for (; initialized < workerCount; ++initialized) {
+    retCode = deflateInit2(&streams[initialized], level, Z_DEFLATED, -15, 8,
+                           Z_DEFAULT_STRATEGY);
+    if (retCode != Z_OK) {
+      break;  // COV_NF_LINE
+    }
+  }
+
+  BOOL good = (retCode == Z_OK);
+  if (good) {
+    unsigned char header[kGzipHeaderSize];
+    WriteGzipHeader(header, level);
+    good = WriteAll(coder, header, sizeof(header), error);
+  } else if (error) {
+    *error = ZlibError(retCode, NULL);  // COV_NF_LINE
+  }
+  uLong crc = crc32(0, NULL, 0);
+  uint64_t block = 0;
+  while (good && block < blockCount) {
+    // Map the next window, plus the 32KB before it for the first block's
+    // dictionary. That isn't page aligned on every system; MapInput copes.
+    uint64_t windowOffset = block * kParallelGzipBlockSize;
+    uint64_t mapOffset = windowOffset ? windowOffset - kDeflateWindowSize : 0;
+    NSUInteger windowLength = (NSUInteger)MIN(coder->inputSize - windowOffset,
+                                              (uint64_t)kFileMapWindowSize);
+    const unsigned char *map =
+        MapInput(coder, mapOffset, (NSUInteger)(windowOffset - mapOffset) + windowLength, error);
+    if (!map) {
+      good = NO;  // COV_NF_LINE
+      break;  // COV_NF_LINE
+    }
+    const unsigned char *window = map + (windowOffset - mapOffset);
+    NSUInteger windowBlocks =
+        (windowLength + kParallelGzipBlockSize - 1) / kParallelGzipBlockSize;
+    for (NSUInteger first = 0; good && first < windowBlocks; first += batchSize) {
+      NSUInteger count = MIN(batchSize, windowBlocks - first);
+      for (NSUInteger i = 0; i < count; ++i) {
+        NSUInteger offset = (first + i) * kParallelGzipBlockSize;
+        blocks[i].input = window + offset;
+        blocks[i].length = MIN((NSUInteger)kParallelGzipBlockSize, windowLength - offset);
+        blocks[i].output = slots + i * slotSize;
+      }
+      BOOL lastBatch = (block + first + count == blockCount);
+      NSUInteger workers = MIN(workerCount, count);
+      dispatch_apply(workers,
+                     dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
+                     ^(size_t worker) {
+        for (NSUInteger i = worker; i < count; i += workers) {
+          CompressGzipBlock(&streams[worker], &blocks[i], map, slotSize,
+                            lastBatch && i == count - 1);
+          int resetCode = deflateReset(&streams[worker]);
+          if (resetCode != Z_OK && blocks[i].retCode == Z_OK) {
+            blocks[i].retCode = resetCode;  // COV_NF_LINE
+          }
+        }
+      });
+      for (NSUInteger i = 0; good && i < count; ++i) {
+        if (blocks[i].retCode != Z_OK) {
+          // COV_NF_START
+          if (error) {
+            *error = ZlibError(blocks[i].retCode, NULL);
+          }
+          good = NO;
+          break;
+          // COV_NF_END
+        }
+        crc = crc32_combine(crc, blocks[i].crc, (z_off_t)blocks[i].length);
+        good = WriteAll(coder, blocks[i].output, blocks[i].produced, error);
+      }
+    }
+    block += windowBlocks;
+  }
+  if (good) {
+    unsigned char trailer[kGzipTrailerSize];
+    WriteLittleEndian32(trailer, crc);
+    WriteLittleEndian32(trailer + 4, (uLong)(coder->inputSize & 0xffffffff));
+    good = WriteAll(coder, trailer, sizeof(trailer), error);
+  }
+
+  for (NSUInteger i = 0; i < initialized; ++i) {
+    deflateEnd(&streams[i]);
+  }
+  free(streams);
+  free(blocks);
+  free(slots);
+  return good;
+}
+
+static BOOL InflateFile(FileCoder *coder, NSError **error) {
+  z_stream strm;
+  bzero(&strm, sizeof(z_stream));
+  int retCode = inflateInit2(&strm, 15 + 32);  // gzip or zlib
+  if (retCode != Z_OK) {
+    // COV_NF_START
+    if (error) {
+      *error = ZlibError(retCode, NULL);
+    }
+    return NO;
+    // COV_NF_END
+  }
+  BOOL good = YES;
+  BOOL isGzip = NO;
+  uint64_t offset = 0;
+  retCode = Z_OK;
+  while (good && offset < coder->inputSize) {
+    NSUInteger length = (NSUInteger)MIN(coder->inputSize - offset,
+                                        (uint64_t)kFileMapWindowSize);
+    const unsigned char *input = MapInput(coder, offset, length, error);
+    if (!input) {
+      good = NO;  // COV_NF_LINE
+      break;  // COV_NF_LINE
+    }
+    if (offset == 0) {
+      isGzip = IsGzipMember(input, length);
+    }
+    strm.next_in = (Bytef *)input;
+    strm.avail_in = (uInt)length;
+    do {
+      retCode = CodeToFile(coder, &strm, NO, Z_NO_FLUSH, error);
+      if (retCode == Z_STREAM_END) {
+        // Another gzip member may follow (RFC 1952), otherwise anything left
+        // is an error.
+        uint64_t used = offset + (uint64_t)(strm.next_in - input);
+        unsigned char magic[2];
+        if (used == coder->inputSize) {
+          break;
+        }
+        if (isGzip && pread(coder->inputFD, magic, 2, (off_t)used) == 2 &&
+            IsGzipMember(magic, 2)) {
+          retCode = inflateReset(&strm);
+        } else {
+          if (error) {
+            NSNumber *remaining =
+                [NSNumber numberWithUnsignedLongLong:coder->inputSize - used];
+            NSDictionary *userInfo =
+                [NSDictionary dictionaryWithObject:remaining
+                                            forKey:GTMNSDataZlibRemainingBytesKey];
+            *error = [NSError errorWithDomain:GTMNSDataZlibErrorDomain
+                                         code:GTMNSDataZlibErrorDataRemaining
+                                     userInfo:userInfo];
+          }
+          good = NO;
+        }
+      } else if (retCode != Z_OK) {
+        good = NO;  // |error| was set by CodeToFile().
+      }
+    } while (good && strm.avail_in != 0);
+    offset += length;
+  }
+  if (good && retCode != Z_STREAM_END) {
+    // Ran out of input (or there was none) before the end of the stream.
+    if (error) {
+      *error = ZlibError(Z_BUF_ERROR, strm.msg);
+    }
+    good = NO;
+  }
+  inflateEnd(&strm);
+  return good;
+}
+
+// Sets up |coder| for |inputPath| -> |outputPath|, runs |body|, and cleans up
+// (removing the output if anything failed).
+static BOOL CodeFile(NSString *inputPath, NSString *outputPath, NSError **error,
+                     BOOL (^body)(FileCoder *coder, NSError **error)) {
+  FileCoder coder;
+  bzero(&coder, sizeof(FileCoder));
+  coder.inputPath = inputPath;
+  coder.outputPath = outputPath;
+  coder.inputFD = open([inputPath fileSystemRepresentation], O_RDONLY | O_CLOEXEC);
+  if (coder.inputFD < 0) {
+    if (error) {
+      *error = FileError(errno, inputPath);
+    }
+    return NO;
+  }
+  struct stat info;
+  if (fstat(coder.inputFD, &info) != 0) {
+    // COV_NF_START
+    if (error) {
+      *error = FileError(errno, inputPath);
+    }
+    close(coder.inputFD);
+    return NO;
+    // COV_NF_END
+  }
+  coder.inputSize = (uint64_t)info.st_size;
+  coder.outputFD = open([outputPath fileSystemRepresentation],
+                        O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+  if (coder.outputFD < 0) {
+    if (error) {
+      *error = FileError(errno, outputPath);
+    }
+    close(coder.inputFD);
+    return NO;
+  }
+  // Only truncate once it's certain the output isn't the input.
+  struct stat outputInfo;
+  int errnum = 0;
+  if (fstat(coder.outputFD, &outputInfo) != 0) {
+    errnum = errno;  // COV_NF_LINE
+  } else if (outputInfo.st_dev == info.st_dev && outputInfo.st_ino == info.st_ino) {
+    errnum = EINVAL;
+  } else if (ftruncate(coder.outputFD, 0) != 0) {
+    errnum = errno;  // COV_NF_LINE
+  }
+  if (errnum) {
+    if (error) {
+      *error = FileError(errnum, outputPath);
+    }
+    close(coder.outputFD);
+    close(coder.inputFD);
+    return NO;
+  }
+  coder.buffer = (unsigned char *)malloc(kFileWriteBufferSize);
+  BOOL good = (coder.buffer != NULL);
+  if (!good && error) {
+    *error = ZlibMemoryError();  // COV_NF_LINE
+  }
+  good = good && body(&coder, error) && FlushOutput(&coder, error);
+  if (coder.map) {
+    munmap(coder.map, coder.mapLength);
+  }
+  free(coder.buffer);
+  close(coder.inputFD);
+  if (close(coder.outputFD) != 0 && good) {
+    // COV_NF_START
+    if (error) {
+      *error = FileError(errno, outputPath);
+    }
+    good = NO;
+    // COV_NF_END
+  }
+  if (!good) {
+    unlink([outputPath fileSystemRepresentation]);
+  }
+  return good;
+}
+
+// The "ToSink" apis inflate into a buffer this size and write it out before
+// inflating more.
+#define kSinkBufferSize (256 * 1024)
+// A sink that would block is retried after this long, doubling up to
+// kSinkMaximumWait (in microseconds).
+#define kSinkInitialWait 50
+#define kSinkMaximumWait (10 * 1000)
+// An output that takes nothing for this many seconds fails with ETIMEDOUT,
+// rather than hanging the caller forever.
+#define kSinkDefaultTimeout 60.0
+
+// Hands |length| bytes to the output of an InflateToSink(); it must take all
+// of them, waiting out any backpressure, or fail and set |error|.
+typedef BOOL (^SinkWriter)(const unsigned char *bytes, NSUInteger length, NSError **error);
+
+// Backs off before an output that would block is retried. Returns NO, with
+// ETIMEDOUT in |error|, once the waits since it last took anything add up to
+// |timeout| seconds.
+static BOOL WaitForSink(useconds_t *wait, NSTimeInterval *waited,
+                        NSTimeInterval timeout, NSError **error) {
+  if (*waited >= timeout) {
+    if (error) {
+      *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ETIMEDOUT userInfo:nil];
+    }
+    return NO;
+  }
+  usleep(*wait);
+  *waited += *wait / 1e6;
+  *wait = MIN(*wait * 2, (useconds_t)kSinkMaximumWait);
+  return YES;
+}
+
+// Inflates gzip or zlib |input| through a fixed buffer into |writer|. Like
+// InflateFile(), concatenated gzip members are all inflated.
+static BOOL InflateToSink(const unsigned char *input, NSUInteger length,
+                          SinkWriter writer, NSError **error) {
+  if (!input) {
+    length = 0;
+  }
+  z_stream strm;
+  bzero(&strm, sizeof(z_stream));
+  int retCode = inflateInit2(&strm, 15 + 32);  // gzip or zlib
+  unsigned char *buffer = (unsigned char *)malloc(kSinkBufferSize);
+  if (retCode != Z_OK || !buffer) {
+    // COV_NF_START
+    if (retCode == Z_OK) {
+      inflateEnd(&strm);
+      retCode = Z_MEM_ERROR;
+    }
+    free(buffer);
+    if (error) {
+      *error = ZlibError(retCode, NULL);
+    }
+    return NO;
+    // COV_NF_END
+  }
 
-#define kChunkSize 1024
+  BOOL isGzip = IsGzipMember(input, length);
+  NSUInteger offset = 0;
+  BOOL good = YES;
+  while (good) {
+    uInt window = (uInt)MIN(length - offset, kMaxZlibWindow);
+    strm.next_in = (Bytef *)(input ? input + offset : NULL);
+    strm.avail_in = window;
+    strm.next_out = buffer;
+    strm.avail_out = kSinkBufferSize;
+    retCode = inflate(&strm, Z_NO_FLUSH);
+    offset += window - strm.avail_in;
+    NSUInteger produced = kSinkBufferSize - strm.avail_out;
+    if (produced && !writer(buffer, produced, error)) {
+      good = NO;
+    } else if (retCode == Z_STREAM_END) {
+      if (offset == length) {
+        break;
+      }
+      // Another gzip member may follow (RFC 1952), otherwise anything left
+      // is an error.
+      if (isGzip && IsGzipMember(input + offset, length - offset)) {
+        retCode = inflateReset(&strm);
+        if (retCode != Z_OK) {
+          // COV_NF_START
+          if (error) {
+            *error = ZlibError(retCode, strm.msg);
+          }
+          good = NO;
+          // COV_NF_END
+        }
+      } else {
+        if (error) {
+          NSNumber *remaining = [NSNumber numberWithUnsignedInteger:length - offset];
+          NSDictionary *userInfo =
+              [NSDictionary dictionaryWithObject:remaining
+                                          forKey:GTMNSDataZlibRemainingBytesKey];
+          *error = [NSError errorWithDomain:GTMNSDataZlibErrorDomain
+                                       code:GTMNSDataZlibErrorDataRemaining
+                                   userInfo:userInfo];
+        }
+        good = NO;
+      }
+    } else if (retCode == Z_BUF_ERROR && !produced) {
+      // No progress possible: the input ran out (or there was none) before
+      // the end of the stream.
+      if (error) {
+        *error = ZlibError(Z_BUF_ERROR, strm.msg);
+      }
+      good = NO;
+    } else if (retCode != Z_OK && retCode != Z_BUF_ERROR) {
+      if (error) {
+        *error = ZlibError(retCode, strm.msg);
+      }
+      good = NO;
+    }
+  }
+  inflateEnd(&strm);
+  free(buffer);
+  return good;
+}
 
 NSString *const GTMNSDataZlibErrorDomain = @"com.google.GTMNSDataZlibErrorDomain";
 NSString *const GTMNSDataZlibErrorKey = @"GTMNSDataZlibErrorKey";
 NSString *const GTMNSDataZlibRemainingBytesKey = @"GTMNSDataZlibRemainingBytesKey";
+NSString *const GTMNSDataZlibPartialLengthKey = @"GTMNSDataZlibPartialLengthKey";
 
 typedef enum {
   CompressionModeZlib,
@@ -32,16 +1041,69 @@ typedef enum {
   CompressionModeRaw,
 } CompressionMode;
 
+static GTMZlibStreamFormat FormatForMode(CompressionMode mode) {
+  GTMZlibStreamFormat format = GTMZlibStreamFormatZlib;
+  switch (mode) {
+    case CompressionModeZlib:
+      // nothing to do
+      break;
+
+    case CompressionModeGzip:
+      format = GTMZlibStreamFormatGzip;
+      break;
+
+    case CompressionModeRaw:
+      format = GTMZlibStreamFormatRaw;
+      break;
+  }
+  return format;
+}
+
 @interface NSData (GTMZlibAdditionsPrivate)
 + (NSData *)gtm_dataByCompressingBytes:(const void *)bytes
                                 length:(NSUInteger)length
                       compressionLevel:(int)level
                                   mode:(CompressionMode)mode
+                            dictionary:(NSData *)dictionary
+                                 error:(NSError **)error;
++ (NSData *)gtm_dataByCompressingBytes:(const void *)bytes
+                                length:(NSUInteger)length
+                               options:(GTMZlibCompressionOptions *)options
+                                  mode:(CompressionMode)mode
+                                 error:(NSError **)error;
++ (NSData *)gtm_dataByCompressingBytes:(const void *)bytes
+                                length:(NSUInteger)length
+                      targetThroughput:(double)targetThroughput
+                                  mode:(CompressionMode)mode
                                  error:(NSError **)error;
++ (NSData *)gtm_dataByCompressingDataArray:(NSArray *)dataArray
+                          compressionLevel:(int)level
+                                      mode:(CompressionMode)mode
+                                     error:(NSError **)error;
++ (NSData *)gtm_dataByCompressingDispatchData:(dispatch_data_t)data
+                             compressionLevel:(int)level
+                                         mode:(CompressionMode)mode
+                                        error:(NSError **)error;
 + (NSData *)gtm_dataByInflatingBytes:(const void *)bytes
                               length:(NSUInteger)length
                            isRawData:(BOOL)isRawData
+                      expectedLength:(NSUInteger)expectedLength
+                       maximumLength:(NSUInteger)maximumLength
+                        maximumRatio:(NSUInteger)maximumRatio
+                          dictionary:(NSData *)dictionary
                                error:(NSError **)error;
++ (NSData *)gtm_dataByParallelCompressingBytes:(const void *)bytes
+                                       length:(NSUInteger)length
+                             compressionLevel:(int)level
+                                        error:(NSError **)error;
++ (NSData *)gtm_dataByBlockCompressingBytes:(const void *)bytes
+                                    length:(NSUInteger)length
+                          compressionLevel:(int)level
+                                     index:(NSData **)index
+                                     error:(NSError **)error;
++ (NSData *)gtm_dataByParallelDecompressingBytes:(const void *)bytes
+                                         length:(NSUInteger)length
+                                          error:(NSError **)error;
 @end
 
 @implementation NSData (GTMZlibAdditionsPrivate)
@@ -50,380 +1112,1456 @@ typedef enum {
                                 length:(NSUInteger)length
                       compressionLevel:(int)level
                                   mode:(CompressionMode)mode
+                            dictionary:(NSData *)dictionary
                                  error:(NSError **)error {
   if (!bytes || !length) {
     return nil;
   }
 
-#if defined(__LP64__) && __LP64__
-  // Don't support > 32bit length for 64 bit, see note in header.
-  if (length > UINT_MAX) {
-    if (error) {
-      *error = [NSError errorWithDomain:GTMNSDataZlibErrorDomain
-                                   code:GTMNSDataZlibErrorGreaterThan32BitsToCompress
-                               userInfo:nil];
-    }
+  // A pooled compressor skips setting up a new zlib stream for every call.
+  return [GTMZlibCompressor compressBytes:bytes
+                                   length:length
+                                   format:FormatForMode(mode)
+                         compressionLevel:level
+                               dictionary:dictionary
+                                    error:error];
+} // gtm_dataByCompressingBytes:length:compressionLevel:mode:dictionary:error:
+
++ (NSData *)gtm_dataByCompressingBytes:(const void *)bytes
+                                length:(NSUInteger)length
+                               options:(GTMZlibCompressionOptions *)options
+                                  mode:(CompressionMode)mode
+                                 error:(NSError **)error {
+  if (!bytes || !length) {
     return nil;
   }
-#endif
+  return [GTMZlibCompressor compressBytes:bytes
+                                   length:length
+                                   format:FormatForMode(mode)
+                                  options:options
+                               dictionary:nil
+                                    error:error];
+} // gtm_dataByCompressingBytes:length:options:mode:error:
+
++ (NSData *)gtm_dataByCompressingBytes:(const void *)bytes
+                                length:(NSUInteger)length
+                      targetThroughput:(double)targetThroughput
+                                  mode:(CompressionMode)mode
+                                 error:(NSError **)error {
+  if (!bytes || !length) {
+    return nil;
+  }
+
+  // Start in the middle and let the stream find the level that keeps up.
+  GTMZlibStream *stream = [GTMZlibStream deflateStreamWithFormat:FormatForMode(mode)
+                                                compressionLevel:Z_DEFAULT_COMPRESSION
+                                                           error:error];
+  if (!stream) {
+    return nil;  // COV_NF_LINE
+  }
+  [stream setTargetThroughput:targetThroughput];
+  [stream setOutputChunkSize:256 * 1024];
+  NSMutableData *result = [NSMutableData data];
+  GTMZlibStreamOutputHandler handler = ^(const void *output, NSUInteger outputLength) {
+    [result appendBytes:output length:outputLength];
+  };
+  if (![stream appendBytes:bytes length:length outputHandler:handler error:error] ||
+      ![stream finishWithOutputHandler:handler error:error]) {
+    return nil;  // COV_NF_LINE
+  }
+  return result;
+} // gtm_dataByCompressingBytes:length:targetThroughput:mode:error:
+
++ (NSData *)gtm_dataByCompressingDataArray:(NSArray *)dataArray
+                          compressionLevel:(int)level
+                                      mode:(CompressionMode)mode
+                                     error:(NSError **)error {
+  NSUInteger length = 0;
+  for (NSData *data in dataArray) {
+    length += [data length];
+  }
+  if (!length) {
+    return nil;
+  }
+  return [GTMZlibCompressor compressDataArray:dataArray
+                                       format:FormatForMode(mode)
+                             compressionLevel:level
+                                        error:error];
+} // gtm_dataByCompressingDataArray:compressionLevel:mode:error:
+
++ (NSData *)gtm_dataByCompressingDispatchData:(dispatch_data_t)data
+                             compressionLevel:(int)level
+                                         mode:(CompressionMode)mode
+                                        error:(NSError **)error {
+  if (!data || !dispatch_data_get_size(data)) {
+    return nil;
+  }
+  return [GTMZlibCompressor compressDispatchData:data
+                                          format:FormatForMode(mode)
+                                compressionLevel:level
+                                           error:error];
+} // gtm_dataByCompressingDispatchData:compressionLevel:mode:error:
+
++ (NSData *)gtm_dataByInflatingBytes:(const void *)bytes
+                              length:(NSUInteger)length
+                           isRawData:(BOOL)isRawData
+                      expectedLength:(NSUInteger)expectedLength
+                       maximumLength:(NSUInteger)maximumLength
+                        maximumRatio:(NSUInteger)maximumRatio
+                          dictionary:(NSData *)dictionary
+                               error:(NSError **)error {
+  if (!bytes || !length) {
+    return nil;
+  }
+
+  if (!isRawData && [GTMCompressionCodecs isFrameBytes:bytes length:length]) {
+    // A codec frame records its length, so the limits are checked up front.
+    NSUInteger limit = maximumLength;
+    if (maximumRatio && length <= NSUIntegerMax / maximumRatio) {
+      NSUInteger ratioLimit = MAX(length * maximumRatio, (NSUInteger)1);
+      limit = limit ? MIN(limit, ratioLimit) : ratioLimit;
+    }
+    return [GTMCompressionCodecs dataByDecompressingFrameBytes:bytes
+                                                        length:length
+                                                 maximumLength:limit
+                                                         error:error];
+  }
+
+  // Raw has no header; otherwise detect zlib or gzip.
+  GTMZlibStreamFormat format =
+      isRawData ? GTMZlibStreamFormatRaw : GTMZlibStreamFormatAutoDetect;
+  return [GTMZlibDecompressor decompressBytes:bytes
+                                       length:length
+                                       format:format
+                               expectedLength:expectedLength
+                          maximumOutputLength:maximumLength
+                      maximumCompressionRatio:maximumRatio
+                                   dictionary:dictionary
+                                        error:error];
+} // gtm_dataByInflatingBytes:length:isRawData:expectedLength:maximumLength:maximumRatio:dictionary:error:
+
++ (NSData *)gtm_dataByParallelCompressingBytes:(const void *)bytes
+                                       length:(NSUInteger)length
+                             compressionLevel:(int)level
+                                        error:(NSError **)error {
+  if (!bytes || !length) {
+    return nil;
+  }
+
+  NSUInteger blockCount =
+      (length + kParallelGzipBlockSize - 1) / kParallelGzipBlockSize;
+  NSUInteger workerCount =
+      MIN(blockCount, [[NSProcessInfo processInfo] activeProcessorCount]);
+  if (workerCount < 2) {
+    // Nothing to be gained, do it the normal way.
+    return [self gtm_dataByCompressingBytes:bytes
+                                     length:length
+                           compressionLevel:level
+                                       mode:CompressionModeGzip
+                                 dictionary:nil
+                                      error:error];
+  }
+
+  level = ClampCompressionLevel(level);
+
+  // Each block gets a slot big enough for its worst case (plus the few bytes
+  // a sync flush adds), laid out between the gzip header and trailer. Once
+  // they are all done the blocks are slid down to close the gaps.
+  uInt slotSize = (uInt)compressBound(kParallelGzipBlockSize) + 16;
+  if (blockCount > (NSUIntegerMax - kGzipHeaderSize - kGzipTrailerSize) / slotSize) {
+    // COV_NF_START
+    if (error) {
+      *error = ZlibMemoryError();
+    }
+    return nil;
+    // COV_NF_END
+  }
+  NSMutableData *result =
+      [NSMutableData dataWithLength:kGzipHeaderSize + blockCount * slotSize + kGzipTrailerSize];
+  GzipBlock *blocks = (GzipBlock *)calloc(blockCount, sizeof(GzipBlock));
+  if (!result || !blocks) {
+    // COV_NF_START
+    free(blocks);
+    if (error) {
+      *error = ZlibMemoryError();
+    }
+    return nil;
+    // COV_NF_END
+  }
+  const unsigned char *input = (const unsigned char *)bytes;
+  unsigned char *output = (unsigned char *)[result mutableBytes];
+  for (NSUInteger i = 0; i < blockCount; ++i) {
+    NSUInteger offset = i * kParallelGzipBlockSize;
+    blocks[i].input = input + offset;
+    blocks[i].length = MIN((NSUInteger)kParallelGzipBlockSize, length - offset);
+    blocks[i].output = output + kGzipHeaderSize + i * slotSize;
+  }
+
+  // Each worker reuses one stream for every workerCount'th block.
+  dispatch_apply(workerCount,
+                 dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
+                 ^(size_t worker) {
+    z_stream strm;
+    bzero(&strm, sizeof(z_stream));
+    int retCode = deflateInit2(&strm, level, Z_DEFLATED, -15, 8,
+                               Z_DEFAULT_STRATEGY);
+    for (NSUInteger i = worker; i < blockCount; i += workerCount) {
+      if (retCode != Z_OK) {
+        blocks[i].retCode = retCode;  // COV_NF_LINE
+        continue;  // COV_NF_LINE
+      }
+      CompressGzipBlock(&strm, &blocks[i], input, slotSize, i == blockCount - 1);
+      retCode = deflateReset(&strm);
+    }
+    if (retCode == Z_OK) {
+      deflateEnd(&strm);
+    }
+  });
+
+  // Stitch the blocks together and combine their crcs.
+  NSUInteger produced = kGzipHeaderSize;
+  uLong crc = crc32(0, NULL, 0);
+  for (NSUInteger i = 0; i < blockCount; ++i) {
+    if (blocks[i].retCode != Z_OK) {
+      // COV_NF_START
+      if (error) {
+        *error = ZlibError(blocks[i].retCode, NULL);
+      }
+      free(blocks);
+      return nil;
+      // COV_NF_END
+    }
+    memmove(output + produced, blocks[i].output, blocks[i].produced);
+    produced += blocks[i].produced;
+    crc = crc32_combine(crc, blocks[i].crc, (z_off_t)blocks[i].length);
+  }
+  free(blocks);
+
+  WriteGzipHeader(output, level);
+  WriteLittleEndian32(output + produced, crc);
+  WriteLittleEndian32(output + produced + 4, (uLong)(length & 0xffffffff));
+  [result setLength:produced + kGzipTrailerSize];
+  return result;
+} // gtm_dataByParallelCompressingBytes:length:compressionLevel:error:
+
++ (NSData *)gtm_dataByBlockCompressingBytes:(const void *)bytes
+                                    length:(NSUInteger)length
+                          compressionLevel:(int)level
+                                     index:(NSData **)index
+                                     error:(NSError **)error {
+  if (!bytes || !length) {
+    return nil;
+  }
+  level = ClampCompressionLevel(level);
+
+  // Like the parallel gzip, members are compressed into worst case slots of
+  // the result and then slid together. Every member fits in 64KB.
+  NSUInteger blockCount = (length + kBlockGzipInputSize - 1) / kBlockGzipInputSize;
+  if (blockCount > (NSUIntegerMax - sizeof(kBlockGzipEOF)) / kBlockGzipMaxMemberSize) {
+    // COV_NF_START
+    if (error) {
+      *error = ZlibMemoryError();
+    }
+    return nil;
+    // COV_NF_END
+  }
+  NSMutableData *result =
+      [NSMutableData dataWithLength:blockCount * kBlockGzipMaxMemberSize + sizeof(kBlockGzipEOF)];
+  GzipBlock *blocks = (GzipBlock *)calloc(blockCount, sizeof(GzipBlock));
+  if (!result || !blocks) {
+    // COV_NF_START
+    free(blocks);
+    if (error) {
+      *error = ZlibMemoryError();
+    }
+    return nil;
+    // COV_NF_END
+  }
+  const unsigned char *input = (const unsigned char *)bytes;
+  unsigned char *output = (unsigned char *)[result mutableBytes];
+  for (NSUInteger i = 0; i < blockCount; ++i) {
+    NSUInteger offset = i * kBlockGzipInputSize;
+    blocks[i].input = input + offset;
+    blocks[i].length = MIN((NSUInteger)kBlockGzipInputSize, length - offset);
+    blocks[i].output = output + i * kBlockGzipMaxMemberSize + kBlockGzipHeaderSize;
+  }
+
+  NSUInteger workerCount =
+      MAX(MIN(blockCount, [[NSProcessInfo processInfo] activeProcessorCount]), (NSUInteger)1);
+  const uInt payloadCapacity =
+      kBlockGzipMaxMemberSize - kBlockGzipHeaderSize - kGzipTrailerSize;
+  dispatch_apply(workerCount,
+                 dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
+                 ^(size_t worker) {
+    z_stream strm;
+    bzero(&strm, sizeof(z_stream));
+    int retCode = deflateInit2(&strm, level, Z_DEFLATED, -15, 8,
+                               Z_DEFAULT_STRATEGY);
+    for (NSUInteger i = worker; i < blockCount; i += workerCount) {
+      if (retCode != Z_OK) {
+        blocks[i].retCode = retCode;  // COV_NF_LINE
+        continue;  // COV_NF_LINE
+      }
+      // Members are independent, so no dictionary and each one finishes.
+      CompressGzipBlock(&strm, &blocks[i], blocks[i].input, payloadCapacity, YES);
+      retCode = deflateReset(&strm);
+    }
+    if (retCode == Z_OK) {
+      deflateEnd(&strm);
+    }
+  });
+
+  NSMutableData *indexData = nil;
+  unsigned char *indexBytes = NULL;
+  if (index) {
+    // Same layout as a bgzip .gzi file: the entry count, then the compressed
+    // and uncompressed offsets of every member after the first.
+    indexData = [NSMutableData dataWithLength:8 + (blockCount - 1) * 16];
+    indexBytes = (unsigned char *)[indexData mutableBytes];
+    WriteLittleEndian64(indexBytes, blockCount - 1);
+    indexBytes += 8;
+  }
+
+  NSUInteger produced = 0;
+  for (NSUInteger i = 0; i < blockCount; ++i) {
+    if (blocks[i].retCode != Z_OK) {
+      // COV_NF_START
+      if (error) {
+        *error = ZlibError(blocks[i].retCode, NULL);
+      }
+      free(blocks);
+      return nil;
+      // COV_NF_END
+    }
+    if (indexBytes && i > 0) {
+      WriteLittleEndian64(indexBytes, produced);
+      WriteLittleEndian64(indexBytes + 8, i * kBlockGzipInputSize);
+      indexBytes += 16;
+    }
+    unsigned char *member = output + produced;
+    NSUInteger memberSize =
+        kBlockGzipHeaderSize + blocks[i].produced + kGzipTrailerSize;
+    memmove(member + kBlockGzipHeaderSize, blocks[i].output, blocks[i].produced);
+    // The bgzip header is the EOF member's with this member's size.
+    memcpy(member, kBlockGzipEOF, kBlockGzipHeaderSize);
+    member[16] = (unsigned char)((memberSize - 1) & 0xff);
+    member[17] = (unsigned char)(((memberSize - 1) >> 8) & 0xff);
+    unsigned char *trailer = member + memberSize - kGzipTrailerSize;
+    WriteLittleEndian32(trailer, blocks[i].crc);
+    WriteLittleEndian32(trailer + 4, blocks[i].length);
+    produced += memberSize;
+  }
+  free(blocks);
+
+  memcpy(output + produced, kBlockGzipEOF, sizeof(kBlockGzipEOF));
+  produced += sizeof(kBlockGzipEOF);
+  [result setLength:produced];
+  if (index) {
+    *index = indexData;
+  }
+  return result;
+} // gtm_dataByBlockCompressingBytes:length:compressionLevel:index:error:
+
++ (NSData *)gtm_dataByParallelDecompressingBytes:(const void *)bytes
+                                         length:(NSUInteger)length
+                                          error:(NSError **)error {
+  if (!bytes || !length) {
+    return nil;
+  }
+
+  // Find every member and where its output goes. Anything that isn't all
+  // BGZF members can't be split up, so it is inflated serially.
+  typedef struct {
+    NSUInteger offset;
+    NSUInteger size;
+    NSUInteger outputOffset;
+    NSUInteger outputSize;
+    int retCode;
+  } Member;
+  const unsigned char *input = (const unsigned char *)bytes;
+  NSUInteger memberCount = 0;
+  NSUInteger memberCapacity = 0;
+  Member *members = NULL;
+  NSUInteger offset = 0;
+  NSUInteger totalOutput = 0;
+  while (offset < length) {
+    NSUInteger memberSize;
+    if (!ReadBlockGzipMemberSize(input + offset, length - offset, &memberSize)) {
+      memberCount = 0;
+      break;
+    }
+    if (memberCount == memberCapacity) {
+      memberCapacity = MAX(memberCapacity * 2, (NSUInteger)64);
+      Member *newMembers = (Member *)realloc(members, memberCapacity * sizeof(Member));
+      if (!newMembers) {
+        // COV_NF_START
+        free(members);
+        if (error) {
+          *error = ZlibMemoryError();
+        }
+        return nil;
+        // COV_NF_END
+      }
+      members = newMembers;
+    }
+    Member *member = &members[memberCount++];
+    member->offset = offset;
+    member->size = memberSize;
+    member->outputOffset = totalOutput;
+    member->outputSize = ReadLittleEndian32(input + offset + memberSize - 4);
+    member->retCode = Z_OK;
+    if (member->outputSize > kBlockGzipMaxMemberSize) {
+      // Not a real BGZF member, don't trust the size for allocating.
+      memberCount = 0;
+      break;
+    }
+    totalOutput += member->outputSize;
+    offset += memberSize;
+  }
+  if (!memberCount || !totalOutput) {
+    // Not BGZF, or nothing to parallelize.
+    free(members);
+    return [self gtm_dataByInflatingBytes:bytes
+                                   length:length
+                                isRawData:NO
+                           expectedLength:0
+                            maximumLength:0
+                             maximumRatio:0
+                               dictionary:nil
+                                    error:error];
+  }
+
+  NSMutableData *result = [NSMutableData dataWithLength:totalOutput];
+  if (!result) {
+    // COV_NF_START
+    free(members);
+    if (error) {
+      *error = ZlibMemoryError();
+    }
+    return nil;
+    // COV_NF_END
+  }
+  unsigned char *output = (unsigned char *)[result mutableBytes];
+
+  NSUInteger workerCount =
+      MAX(MIN(memberCount, [[NSProcessInfo processInfo] activeProcessorCount]), (NSUInteger)1);
+  dispatch_apply(workerCount,
+                 dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
+                 ^(size_t worker) {
+    z_stream strm;
+    bzero(&strm, sizeof(z_stream));
+    int retCode = inflateInit2(&strm, 15 + 16);  // gzip only
+    for (NSUInteger i = worker; i < memberCount; i += workerCount) {
+      if (retCode != Z_OK) {
+        members[i].retCode = retCode;  // COV_NF_LINE
+        continue;  // COV_NF_LINE
+      }
+      // Each member has to exactly fill its slot.
+      strm.next_in = (Bytef *)input + members[i].offset;
+      strm.avail_in = (uInt)members[i].size;
+      strm.next_out = output + members[i].outputOffset;
+      strm.avail_out = (uInt)members[i].outputSize;
+      retCode = inflate(&strm, Z_FINISH);
+      if (retCode == Z_STREAM_END) {
+        if (strm.avail_in || strm.avail_out) {
+          members[i].retCode = Z_DATA_ERROR;
+        }
+      } else {
+        members[i].retCode = (retCode == Z_OK) ? Z_BUF_ERROR : retCode;
+      }
+      retCode = inflateReset(&strm);
+    }
+    if (retCode == Z_OK) {
+      inflateEnd(&strm);
+    }
+  });
+
+  for (NSUInteger i = 0; i < memberCount; ++i) {
+    if (members[i].retCode != Z_OK) {
+      if (error) {
+        *error = ZlibError(members[i].retCode, NULL);
+      }
+      free(members);
+      return nil;
+    }
+  }
+  free(members);
+  return result;
+} // gtm_dataByParallelDecompressingBytes:length:error:
+
+@end
+
+
+@implementation NSData (GTMZLibAdditions)
+
++ (NSData *)gtm_dataByGzippingBytes:(const void *)bytes
+                             length:(NSUInteger)length
+                              error:(NSError **)error {
+  return [self gtm_dataByCompressingBytes:bytes
+                                   length:length
+                         compressionLevel:Z_DEFAULT_COMPRESSION
+                                     mode:CompressionModeGzip
+                               dictionary:nil
+                                    error:error];
+} // gtm_dataByGzippingBytes:length:error:
+
++ (NSData *)gtm_dataByGzippingData:(NSData *)data error:(NSError **)error {
+  return [self gtm_dataByCompressingBytes:[data bytes]
+                                   length:[data length]
+                         compressionLevel:Z_DEFAULT_COMPRESSION
+                                     mode:CompressionModeGzip
+                               dictionary:nil
+                                    error:error];
+} // gtm_dataByGzippingData:error:
+
++ (NSData *)gtm_dataByGzippingBytes:(const void *)bytes
+                             length:(NSUInteger)length
+                   compressionLevel:(int)level
+                              error:(NSError **)error{
+  return [self gtm_dataByCompressingBytes:bytes
+                                   length:length
+                         compressionLevel:level
+                                     mode:CompressionModeGzip
+                               dictionary:nil
+                                    error:error];
+} // gtm_dataByGzippingBytes:length:level:error
+
++ (NSData *)gtm_dataByGzippingData:(NSData *)data
+                  compressionLevel:(int)level
+                             error:(NSError **)error{
+  return [self gtm_dataByCompressingBytes:[data bytes]
+                                   length:[data length]
+                         compressionLevel:level
+                                     mode:CompressionModeGzip
+                               dictionary:nil
+                                    error:error];
+} // gtm_dataByGzippingData:level:error
+
++ (NSData *)gtm_dataByParallelGzippingBytes:(const void *)bytes
+                                     length:(NSUInteger)length
+                           compressionLevel:(int)level
+                                      error:(NSError **)error {
+  return [self gtm_dataByParallelCompressingBytes:bytes
+                                          length:length
+                                compressionLevel:level
+                                           error:error];
+} // gtm_dataByParallelGzippingBytes:length:compressionLevel:error:
+
++ (NSData *)gtm_dataByParallelGzippingData:(NSData *)data
+                          compressionLevel:(int)level
+                                     error:(NSError **)error {
+  return [self gtm_dataByParallelCompressingBytes:[data bytes]
+                                          length:[data length]
+                                compressionLevel:level
+                                           error:error];
+} // gtm_dataByParallelGzippingData:compressionLevel:error:
+
++ (NSData *)gtm_dataByBlockGzippingBytes:(const void *)bytes
+                                  length:(NSUInteger)length
+                        compressionLevel:(int)level
+                                   index:(NSData **)index
+                                   error:(NSError **)error {
+  return [self gtm_dataByBlockCompressingBytes:bytes
+                                       length:length
+                             compressionLevel:level
+                                        index:index
+                                        error:error];
+} // gtm_dataByBlockGzippingBytes:length:compressionLevel:index:error:
+
++ (NSData *)gtm_dataByBlockGzippingData:(NSData *)data
+                       compressionLevel:(int)level
+                                  index:(NSData **)index
+                                  error:(NSError **)error {
+  return [self gtm_dataByBlockCompressingBytes:[data bytes]
+                                       length:[data length]
+                             compressionLevel:level
+                                        index:index
+                                        error:error];
+} // gtm_dataByBlockGzippingData:compressionLevel:index:error:
+
+#pragma mark -
+
++ (NSData *)gtm_dataByDeflatingBytes:(const void *)bytes
+                              length:(NSUInteger)length
+                               error:(NSError **)error{
+  return [self gtm_dataByCompressingBytes:bytes
+                                   length:length
+                         compressionLevel:Z_DEFAULT_COMPRESSION
+                                     mode:CompressionModeZlib
+                               dictionary:nil
+                                    error:error];
+} // gtm_dataByDeflatingBytes:length:error
+
++ (NSData *)gtm_dataByDeflatingData:(NSData *)data error:(NSError **)error {
+  return [self gtm_dataByCompressingBytes:[data bytes]
+                                   length:[data length]
+                         compressionLevel:Z_DEFAULT_COMPRESSION
+                                     mode:CompressionModeZlib
+                               dictionary:nil
+                                    error:error];
+} // gtm_dataByDeflatingData:
+
++ (NSData *)gtm_dataByDeflatingBytes:(const void *)bytes
+                              length:(NSUInteger)length
+                    compressionLevel:(int)level
+                               error:(NSError **)error {
+  return [self gtm_dataByCompressingBytes:bytes
+                                   length:length
+                         compressionLevel:level
+                                     mode:CompressionModeZlib
+                               dictionary:nil
+                                    error:error];
+} // gtm_dataByDeflatingBytes:length:level:error:
+
++ (NSData *)gtm_dataByDeflatingData:(NSData *)data
+                   compressionLevel:(int)level
+                              error:(NSError **)error {
+  return [self gtm_dataByCompressingBytes:[data bytes]
+                                   length:[data length]
+                         compressionLevel:level
+                                     mode:CompressionModeZlib
+                               dictionary:nil
+                                    error:error];
+} // gtm_dataByDeflatingData:level:error:
+
+#pragma mark -
+
++ (NSData *)gtm_dataByInflatingBytes:(const void *)bytes
+                              length:(NSUInteger)length
+                               error:(NSError **)error {
+  return [self gtm_dataByInflatingBytes:bytes
+                                 length:length
+                              isRawData:NO
+                         expectedLength:0
+                          maximumLength:0
+                           maximumRatio:0
+                             dictionary:nil
+                                  error:error];
+} // gtm_dataByInflatingBytes:length:error:
+
++ (NSData *)gtm_dataByInflatingData:(NSData *)data
+                              error:(NSError **)error {
+  return [self gtm_dataByInflatingBytes:[data bytes]
+                                 length:[data length]
+                              isRawData:NO
+                         expectedLength:0
+                          maximumLength:0
+                           maximumRatio:0
+                             dictionary:nil
+                                  error:error];
+} // gtm_dataByInflatingData:
+
++ (NSData *)gtm_dataByInflatingBytes:(const void *)bytes
+                              length:(NSUInteger)length
+                      expectedLength:(NSUInteger)expectedLength
+                               error:(NSError **)error {
+  return [self gtm_dataByInflatingBytes:bytes
+                                 length:length
+                              isRawData:NO
+                         expectedLength:expectedLength
+                          maximumLength:0
+                           maximumRatio:0
+                             dictionary:nil
+                                  error:error];
+} // gtm_dataByInflatingBytes:length:expectedLength:error:
+
++ (NSData *)gtm_dataByInflatingData:(NSData *)data
+                     expectedLength:(NSUInteger)expectedLength
+                              error:(NSError **)error {
+  return [self gtm_dataByInflatingBytes:[data bytes]
+                                 length:[data length]
+                              isRawData:NO
+                         expectedLength:expectedLength
+                          maximumLength:0
+                           maximumRatio:0
+                             dictionary:nil
+                                  error:error];
+} // gtm_dataByInflatingData:expectedLength:error:
+
++ (NSData *)gtm_dataByParallelInflatingBytes:(const void *)bytes
+                                      length:(NSUInteger)length
+                                       error:(NSError **)error {
+  return [self gtm_dataByParallelDecompressingBytes:bytes
+                                            length:length
+                                             error:error];
+} // gtm_dataByParallelInflatingBytes:length:error:
+
++ (NSData *)gtm_dataByParallelInflatingData:(NSData *)data
+                                      error:(NSError **)error {
+  return [self gtm_dataByParallelDecompressingBytes:[data bytes]
+                                            length:[data length]
+                                             error:error];
+} // gtm_dataByParallelInflatingData:error:
+
+#pragma mark -
+
++ (NSData *)gtm_dataByRawDeflatingBytes:(const void *)bytes
+                                 length:(NSUInteger)length
+                                  error:(NSError **)error {
+  return [self gtm_dataByCompressingBytes:bytes
+                                   length:length
+                         compressionLevel:Z_DEFAULT_COMPRESSION
+                                     mode:CompressionModeRaw
+                               dictionary:nil
+                                    error:error];
+} // gtm_dataByRawDeflatingBytes:length:error:
+
++ (NSData *)gtm_dataByRawDeflatingData:(NSData *)data error:(NSError **)error {
+  return [self gtm_dataByCompressingBytes:[data bytes]
+                                   length:[data length]
+                         compressionLevel:Z_DEFAULT_COMPRESSION
+                                     mode:CompressionModeRaw
+                               dictionary:nil
+                                    error:error];
+} // gtm_dataByRawDeflatingData:error:
+
++ (NSData *)gtm_dataByRawDeflatingBytes:(const void *)bytes
+                                 length:(NSUInteger)length
+                       compressionLevel:(int)level
+                                  error:(NSError **)error{
+  return [self gtm_dataByCompressingBytes:bytes
+                                   length:length
+                         compressionLevel:level
+                                     mode:CompressionModeRaw
+                               dictionary:nil
+                                    error:error];
+} // gtm_dataByRawDeflatingBytes:length:compressionLevel:error:
+
++ (NSData *)gtm_dataByRawDeflatingData:(NSData *)data
+                      compressionLevel:(int)level
+                                 error:(NSError **)error {
+  return [self gtm_dataByCompressingBytes:[data bytes]
+                                   length:[data length]
+                         compressionLevel:level
+                                     mode:CompressionModeRaw
+                               dictionary:nil
+                                    error:error];
+} // gtm_dataByRawDeflatingData:compressionLevel:error:
+
++ (NSData *)gtm_dataByRawInflatingBytes:(const void *)bytes
+                                 length:(NSUInteger)length
+                                  error:(NSError **)error{
+  return [self gtm_dataByInflatingBytes:bytes
+                                 length:length
+                              isRawData:YES
+                         expectedLength:0
+                          maximumLength:0
+                           maximumRatio:0
+                             dictionary:nil
+                                  error:error];
+} // gtm_dataByRawInflatingBytes:length:error:
+
++ (NSData *)gtm_dataByRawInflatingData:(NSData *)data
+                                 error:(NSError **)error {
+  return [self gtm_dataByInflatingBytes:[data bytes]
+                                 length:[data length]
+                              isRawData:YES
+                         expectedLength:0
+                          maximumLength:0
+                           maximumRatio:0
+                             dictionary:nil
+                                  error:error];
+} // gtm_dataByRawInflatingData:error:
+
++ (NSData *)gtm_dataByRawInflatingBytes:(const void *)bytes
+                                 length:(NSUInteger)length
+                         expectedLength:(NSUInteger)expectedLength
+                                  error:(NSError **)error {
+  return [self gtm_dataByInflatingBytes:bytes
+                                 length:length
+                              isRawData:YES
+                         expectedLength:expectedLength
+                          maximumLength:0
+                           maximumRatio:0
+                             dictionary:nil
+                                  error:error];
+} // gtm_dataByRawInflatingBytes:length:expectedLength:error:
+
++ (NSData *)gtm_dataByRawInflatingData:(NSData *)data
+                        expectedLength:(NSUInteger)expectedLength
+                                 error:(NSError **)error {
+  return [self gtm_dataByInflatingBytes:[data bytes]
+                                 length:[data length]
+                              isRawData:YES
+                         expectedLength:expectedLength
+                          maximumLength:0
+                           maximumRatio:0
+                             dictionary:nil
+                                  error:error];
+} // gtm_dataByRawInflatingData:expectedLength:error:
+
+#pragma mark -
+
++ (NSData *)gtm_dataByDeflatingBytes:(const void *)bytes
+                              length:(NSUInteger)length
+                    compressionLevel:(int)level
+                          dictionary:(NSData *)dictionary
+                               error:(NSError **)error {
+  return [self gtm_dataByCompressingBytes:bytes
+                                   length:length
+                         compressionLevel:level
+                                     mode:CompressionModeZlib
+                               dictionary:dictionary
+                                    error:error];
+} // gtm_dataByDeflatingBytes:length:compressionLevel:dictionary:error:
+
++ (NSData *)gtm_dataByDeflatingData:(NSData *)data
+                   compressionLevel:(int)level
+                         dictionary:(NSData *)dictionary
+                              error:(NSError **)error {
+  return [self gtm_dataByCompressingBytes:[data bytes]
+                                   length:[data length]
+                         compressionLevel:level
+                                     mode:CompressionModeZlib
+                               dictionary:dictionary
+                                    error:error];
+} // gtm_dataByDeflatingData:compressionLevel:dictionary:error:
+
++ (NSData *)gtm_dataByInflatingBytes:(const void *)bytes
+                              length:(NSUInteger)length
+                          dictionary:(NSData *)dictionary
+                               error:(NSError **)error {
+  return [self gtm_dataByInflatingBytes:bytes
+                                 length:length
+                              isRawData:NO
+                         expectedLength:0
+                          maximumLength:0
+                           maximumRatio:0
+                             dictionary:dictionary
+                                  error:error];
+} // gtm_dataByInflatingBytes:length:dictionary:error:
+
++ (NSData *)gtm_dataByInflatingData:(NSData *)data
+                         dictionary:(NSData *)dictionary
+                              error:(NSError **)error {
+  return [self gtm_dataByInflatingBytes:[data bytes]
+                                 length:[data length]
+                              isRawData:NO
+                         expectedLength:0
+                          maximumLength:0
+                           maximumRatio:0
+                             dictionary:dictionary
+                                  error:error];
+} // gtm_dataByInflatingData:dictionary:error:
+
++ (NSData *)gtm_dataByRawDeflatingBytes:(const void *)bytes
+                                 length:(NSUInteger)length
+                       compressionLevel:(int)level
+                             dictionary:(NSData *)dictionary
+                                  error:(NSError **)error {
+  return [self gtm_dataByCompressingBytes:bytes
+                                   length:length
+                         compressionLevel:level
+                                     mode:CompressionModeRaw
+                               dictionary:dictionary
+                                    error:error];
+} // gtm_dataByRawDeflatingBytes:length:compressionLevel:dictionary:error:
+
++ (NSData *)gtm_dataByRawDeflatingData:(NSData *)data
+                      compressionLevel:(int)level
+                            dictionary:(NSData *)dictionary
+                                 error:(NSError **)error {
+  return [self gtm_dataByCompressingBytes:[data bytes]
+                                   length:[data length]
+                         compressionLevel:level
+                                     mode:CompressionModeRaw
+                               dictionary:dictionary
+                                    error:error];
+} // gtm_dataByRawDeflatingData:compressionLevel:dictionary:error:
+
++ (NSData *)gtm_dataByRawInflatingBytes:(const void *)bytes
+                                 length:(NSUInteger)length
+                             dictionary:(NSData *)dictionary
+                                  error:(NSError **)error {
+  return [self gtm_dataByInflatingBytes:bytes
+                                 length:length
+                              isRawData:YES
+                         expectedLength:0
+                          maximumLength:0
+                           maximumRatio:0
+                             dictionary:dictionary
+                                  error:error];
+} // gtm_dataByRawInflatingBytes:length:dictionary:error:
 
-  if (level == Z_DEFAULT_COMPRESSION) {
-    // the default value is actually outside the range, so we have to let it
-    // through specifically.
-  } else if (level < Z_BEST_SPEED) {
-    level = Z_BEST_SPEED;
-  } else if (level > Z_BEST_COMPRESSION) {
-    level = Z_BEST_COMPRESSION;
-  }
++ (NSData *)gtm_dataByRawInflatingData:(NSData *)data
+                            dictionary:(NSData *)dictionary
+                                 error:(NSError **)error {
+  return [self gtm_dataByInflatingBytes:[data bytes]
+                                 length:[data length]
+                              isRawData:YES
+                         expectedLength:0
+                          maximumLength:0
+                           maximumRatio:0
+                             dictionary:dictionary
+                                  error:error];
+} // gtm_dataByRawInflatingData:dictionary:error:
 
-  z_stream strm;
-  bzero(&strm, sizeof(z_stream));
++ (NSData *)gtm_dictionaryFromSamples:(NSArray *)samples
+                            maxLength:(NSUInteger)maxLength {
+  if (maxLength == 0 || maxLength > kMaxDictionaryLength) {
+    maxLength = kMaxDictionaryLength;
+  }
+  NSMutableData *dictionary = [NSMutableData dataWithLength:maxLength];
+  unsigned char *bytes = [dictionary mutableBytes];
+  NSUInteger used = TrainDictionary(samples, bytes, maxLength);
+  // The segments were laid down from the end back, slide them to the front.
+  memmove(bytes, bytes + maxLength - used, used);
+  [dictionary setLength:used];
+  return dictionary;
+} // gtm_dictionaryFromSamples:maxLength:
 
-  int memLevel = 8; // the default
-  int windowBits = 15; // the default
-  switch (mode) {
-    case CompressionModeZlib:
-      // nothing to do
-      break;
+#pragma mark -
 
-    case CompressionModeGzip:
-      windowBits += 16; // enable gzip header instead of zlib header
-      break;
++ (BOOL)gtm_gzipFileAtPath:(NSString *)sourcePath
+                    toPath:(NSString *)destinationPath
+          compressionLevel:(int)level
+                     error:(NSError **)error {
+  return [self gtm_gzipFileAtPath:sourcePath
+                           toPath:destinationPath
+                 compressionLevel:level
+                         parallel:NO
+                            error:error];
+} // gtm_gzipFileAtPath:toPath:compressionLevel:error:
 
-    case CompressionModeRaw:
-      windowBits *= -1; // Negative to mean no header.
-      break;
-  }
-  int retCode;
-  if ((retCode = deflateInit2(&strm, level, Z_DEFLATED, windowBits,
-                              memLevel, Z_DEFAULT_STRATEGY)) != Z_OK) {
-    // COV_NF_START - no real way to force this in a unittest (we guard all args)
-    if (error) {
-      NSDictionary *userInfo = [NSDictionary dictionaryWithObject:[NSNumber numberWithInt:retCode]
-                                                           forKey:GTMNSDataZlibErrorKey];
-      *error = [NSError errorWithDomain:GTMNSDataZlibErrorDomain
-                                   code:GTMNSDataZlibErrorInternal
-                               userInfo:userInfo];
++ (BOOL)gtm_gzipFileAtPath:(NSString *)sourcePath
+                    toPath:(NSString *)destinationPath
+          compressionLevel:(int)level
+                  parallel:(BOOL)parallel
+                     error:(NSError **)error {
+  level = ClampCompressionLevel(level);
+  return CodeFile(sourcePath, destinationPath, error,
+                  ^BOOL(FileCoder *coder, NSError **blockError) {
+    uint64_t blockCount =
+        (coder->inputSize + kParallelGzipBlockSize - 1) / kParallelGzipBlockSize;
+    NSUInteger workerCount =
+        (NSUInteger)MIN(blockCount,
+                        (uint64_t)[[NSProcessInfo processInfo] activeProcessorCount]);
+    if (parallel && workerCount >= 2) {
+      return ParallelDeflateFile(coder, level, workerCount, blockError);
     }
-    return nil;
-    // COV_NF_END
-  }
+    return DeflateFile(coder, level, blockError);
+  });
+} // gtm_gzipFileAtPath:toPath:compressionLevel:parallel:error:
 
-  // hint the size at 1/4 the input size
-  NSMutableData *result = [NSMutableData dataWithCapacity:(length/4)];
-  unsigned char output[kChunkSize];
++ (BOOL)gtm_gunzipFileAtPath:(NSString *)sourcePath
+                      toPath:(NSString *)destinationPath
+                       error:(NSError **)error {
+  return CodeFile(sourcePath, destinationPath, error,
+                  ^BOOL(FileCoder *coder, NSError **blockError) {
+    return InflateFile(coder, blockError);
+  });
+} // gtm_gunzipFileAtPath:toPath:error:
 
-  // setup the input
-  strm.avail_in = (unsigned int)length;
-  strm.next_in = (unsigned char*)bytes;
+#pragma mark -
 
-  // loop to collect the data
-  do {
-    // update what we're passing in
-    strm.avail_out = kChunkSize;
-    strm.next_out = output;
-    retCode = deflate(&strm, Z_FINISH);
-    if ((retCode != Z_OK) && (retCode != Z_STREAM_END)) {
-      // COV_NF_START - no real way to force this in a unittest
-      // (in inflate, we can feed bogus/truncated data to test, but an error
-      // here would be some internal issue w/in zlib, and there isn't any real
-      // way to test it)
-      if (error) {
-        NSDictionary *userInfo = [NSDictionary dictionaryWithObject:[NSNumber numberWithInt:retCode]
-                                                             forKey:GTMNSDataZlibErrorKey];
-        *error = [NSError errorWithDomain:GTMNSDataZlibErrorDomain
-                                     code:GTMNSDataZlibErrorInternal
-                                 userInfo:userInfo];
++ (BOOL)gtm_inflateBytes:(const void *)bytes
+                  length:(NSUInteger)length
+        toFileDescriptor:(int)fileDescriptor
+                   error:(NSError **)error {
+  SinkWriter writer = ^BOOL(const unsigned char *output, NSUInteger outputLength,
+                            NSError **writeError) {
+    while (outputLength > 0) {
+      ssize_t written = write(fileDescriptor, output, MIN(outputLength, (NSUInteger)SSIZE_MAX));
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;  // COV_NF_LINE
+        }
+        if (errno == EAGAIN) {
+          // A non-blocking descriptor that is full; wait until it drains.
+          struct pollfd pollInfo = { fileDescriptor, POLLOUT, 0 };
+          int ready = poll(&pollInfo, 1, (int)(kSinkDefaultTimeout * 1000));
+          if (ready > 0 || (ready < 0 && errno == EINTR)) {
+            continue;
+          }
+          if (ready == 0) {
+            errno = ETIMEDOUT;
+          }
+        }
+        if (writeError) {
+          *writeError = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+        }
+        return NO;
       }
-      deflateEnd(&strm);
-      return nil;
-      // COV_NF_END
+      output += written;
+      outputLength -= (NSUInteger)written;
     }
-    // collect what we got
-    unsigned gotBack = kChunkSize - strm.avail_out;
-    if (gotBack > 0) {
-      [result appendBytes:output length:gotBack];
-    }
-
-  } while (retCode == Z_OK);
-
-  // if the loop exits, we used all input and the stream ended
-  _GTMDevAssert(strm.avail_in == 0,
-                @"thought we finished deflate w/o using all input, %u bytes left",
-                strm.avail_in);
-  _GTMDevAssert(retCode == Z_STREAM_END,
-                @"thought we finished deflate w/o getting a result of stream end, code %d",
-                retCode);
-
-  // clean up
-  deflateEnd(&strm);
-
-  return result;
-} // gtm_dataByCompressingBytes:length:compressionLevel:useGzip:
-
-+ (NSData *)gtm_dataByInflatingBytes:(const void *)bytes
-                              length:(NSUInteger)length
-                           isRawData:(BOOL)isRawData
-                               error:(NSError **)error {
-  if (!bytes || !length) {
-    return nil;
-  }
+    return YES;
+  };
+  return InflateToSink((const unsigned char *)bytes, length, writer, error);
+} // gtm_inflateBytes:length:toFileDescriptor:error:
 
-#if defined(__LP64__) && __LP64__
-  // Don't support > 32bit length for 64 bit, see note in header.
-  if (length > UINT_MAX) {
-    return nil;
-  }
-#endif
++ (BOOL)gtm_inflateData:(NSData *)data
+       toFileDescriptor:(int)fileDescriptor
+                  error:(NSError **)error {
+  return [self gtm_inflateBytes:[data bytes]
+                         length:[data length]
+               toFileDescriptor:fileDescriptor
+                          error:error];
+} // gtm_inflateData:toFileDescriptor:error:
 
-  z_stream strm;
-  bzero(&strm, sizeof(z_stream));
++ (BOOL)gtm_inflateBytes:(const void *)bytes
+                  length:(NSUInteger)length
+          toOutputStream:(NSOutputStream *)outputStream
+                   error:(NSError **)error {
+  SinkWriter writer = ^BOOL(const unsigned char *output, NSUInteger outputLength,
+                            NSError **writeError) {
+    useconds_t wait = kSinkInitialWait;
+    NSTimeInterval waited = 0;
+    while (outputLength > 0) {
+      NSStreamStatus status = [outputStream streamStatus];
+      BOOL writable = (status == NSStreamStatusOpen || status == NSStreamStatusWriting);
+      if (writable && ![outputStream hasSpaceAvailable]) {
+        if (!WaitForSink(&wait, &waited, kSinkDefaultTimeout, writeError)) {
+          return NO;
+        }
+        continue;
+      }
+      NSInteger written =
+          writable ? [outputStream write:output
+                               maxLength:MIN(outputLength, (NSUInteger)NSIntegerMax)]
+                   : -1;
+      if (written <= 0) {
+        // Closed, failed, or out of capacity (a fixed size buffer stream).
+        if (writeError) {
+          NSError *streamError = [outputStream streamError];
+          *writeError = streamError ? streamError
+                                    : [NSError errorWithDomain:NSPOSIXErrorDomain
+                                                          code:(written ? EPIPE : ENOSPC)
+                                                      userInfo:nil];
+        }
+        return NO;
+      }
+      output += written;
+      outputLength -= (NSUInteger)written;
+      wait = kSinkInitialWait;
+      waited = 0;
+    }
+    return YES;
+  };
+  return InflateToSink((const unsigned char *)bytes, length, writer, error);
+} // gtm_inflateBytes:length:toOutputStream:error:
 
-  // setup the input
-  strm.avail_in = (unsigned int)length;
-  strm.next_in = (unsigned char*)bytes;
++ (BOOL)gtm_inflateData:(NSData *)data
+         toOutputStream:(NSOutputStream *)outputStream
+                  error:(NSError **)error {
+  return [self gtm_inflateBytes:[data bytes]
+                         length:[data length]
+                 toOutputStream:outputStream
+                          error:error];
+} // gtm_inflateData:toOutputStream:error:
 
-  int windowBits = 15; // 15 to enable any window size
-  if (isRawData) {
-    windowBits *= -1; // make it negative to signal no header.
-  } else {
-    windowBits += 32; // and +32 to enable zlib or gzip header detection.
-  }
++ (void)gtm_inflateData:(NSData *)data
+         toOutputStream:(NSOutputStream *)outputStream
+        completionQueue:(dispatch_queue_t)completionQueue
+             completion:(void (^)(BOOL succeeded, NSError *error))completion {
+  data = [data copy];
+  dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+    NSError *error = nil;
+    BOOL succeeded = [self gtm_inflateData:data toOutputStream:outputStream error:&error];
+    dispatch_async(completionQueue, ^{
+      completion(succeeded, succeeded ? nil : error);
+    });
+  });
+} // gtm_inflateData:toOutputStream:completionQueue:completion:
 
-  int retCode;
-  if ((retCode = inflateInit2(&strm, windowBits)) != Z_OK) {
-    // COV_NF_START - no real way to force this in a unittest (we guard all args)
-    if (error) {
-      NSDictionary *userInfo = [NSDictionary dictionaryWithObject:[NSNumber numberWithInt:retCode]
-                                                           forKey:GTMNSDataZlibErrorKey];
-      *error = [NSError errorWithDomain:GTMNSDataZlibErrorDomain
-                                   code:GTMNSDataZlibErrorInternal
-                               userInfo:userInfo];
-    }
-    return nil;
-    // COV_NF_END
-  }
++ (BOOL)gtm_inflateBytes:(const void *)bytes
+                  length:(NSUInteger)length
+                  toSink:(GTMZlibOutputSink)sink
+                   error:(NSError **)error {
+  return [self gtm_inflateBytes:bytes
+                         length:length
+                         toSink:sink
+                        timeout:kSinkDefaultTimeout
+                          error:error];
+} // gtm_inflateBytes:length:toSink:error:
 
-  // hint the size at 4x the input size
-  NSMutableData *result = [NSMutableData dataWithCapacity:(length*4)];
-  unsigned char output[kChunkSize];
++ (BOOL)gtm_inflateData:(NSData *)data
+                 toSink:(GTMZlibOutputSink)sink
+                  error:(NSError **)error {
+  return [self gtm_inflateBytes:[data bytes]
+                         length:[data length]
+                         toSink:sink
+                        timeout:kSinkDefaultTimeout
+                          error:error];
+} // gtm_inflateData:toSink:error:
 
-  // loop to collect the data
-  do {
-    // update what we're passing in
-    strm.avail_out = kChunkSize;
-    strm.next_out = output;
-    retCode = inflate(&strm, Z_NO_FLUSH);
-    if ((retCode != Z_OK) && (retCode != Z_STREAM_END)) {
-      if (error) {
-        NSMutableDictionary *userInfo =
-            [NSMutableDictionary dictionaryWithObject:[NSNumber numberWithInt:retCode]
-                                               forKey:GTMNSDataZlibErrorKey];
-        if (strm.msg) {
-          NSString *message = [NSString stringWithUTF8String:strm.msg];
-          if (message) {
-            [userInfo setObject:message forKey:NSLocalizedDescriptionKey];
-          }
++ (BOOL)gtm_inflateBytes:(const void *)bytes
+                  length:(NSUInteger)length
+                  toSink:(GTMZlibOutputSink)sink
+                 timeout:(NSTimeInterval)timeout
+                   error:(NSError **)error {
+  SinkWriter writer = ^BOOL(const unsigned char *output, NSUInteger outputLength,
+                            NSError **writeError) {
+    useconds_t wait = kSinkInitialWait;
+    NSTimeInterval waited = 0;
+    while (outputLength > 0) {
+      NSInteger taken = sink(output, outputLength, writeError);
+      if (taken < 0) {
+        return NO;
+      }
+      if (taken == 0) {
+        if (!WaitForSink(&wait, &waited, timeout, writeError)) {
+          return NO;
         }
-        *error = [NSError errorWithDomain:GTMNSDataZlibErrorDomain
-                                     code:GTMNSDataZlibErrorInternal
-                                 userInfo:userInfo];
+        continue;
       }
-      inflateEnd(&strm);
-      return nil;
-    }
-    // collect what we got
-    unsigned gotBack = kChunkSize - strm.avail_out;
-    if (gotBack > 0) {
-      [result appendBytes:output length:gotBack];
+      _GTMDevAssert((NSUInteger)taken <= outputLength, @"sink took more than it was given");
+      taken = MIN(taken, (NSInteger)outputLength);
+      output += taken;
+      outputLength -= (NSUInteger)taken;
+      wait = kSinkInitialWait;
+      waited = 0;
     }
+    return YES;
+  };
+  return InflateToSink((const unsigned char *)bytes, length, writer, error);
+} // gtm_inflateBytes:length:toSink:timeout:error:
 
-  } while (retCode == Z_OK);
++ (BOOL)gtm_inflateData:(NSData *)data
+                 toSink:(GTMZlibOutputSink)sink
+                timeout:(NSTimeInterval)timeout
+                  error:(NSError **)error {
+  return [self gtm_inflateBytes:[data bytes]
+                         length:[data length]
+                         toSink:sink
+                        timeout:timeout
+                          error:error];
+} // gtm_inflateData:toSink:timeout:error:
 
-  // make sure there wasn't more data tacked onto the end of a valid compressed
-  // stream.
-  if (strm.avail_in != 0) {
-    if (error) {
-      NSDictionary *userInfo =
-          [NSDictionary dictionaryWithObject:[NSNumber numberWithUnsignedInt:strm.avail_in]
-                                      forKey:GTMNSDataZlibRemainingBytesKey];
-      *error = [NSError errorWithDomain:GTMNSDataZlibErrorDomain
-                                   code:GTMNSDataZlibErrorDataRemaining
-                               userInfo:userInfo];
-    }
-    result = nil;
-  }
-  // the only way out of the loop was by hitting the end of the stream
-  _GTMDevAssert(retCode == Z_STREAM_END,
-                @"thought we finished inflate w/o getting a result of stream end, code %d",
-                retCode);
+#pragma mark -
 
-  // clean up
-  inflateEnd(&strm);
++ (NSData *)gtm_dataByInflatingBytes:(const void *)bytes
+                              length:(NSUInteger)length
+                       maximumLength:(NSUInteger)maxLength
+                        maximumRatio:(NSUInteger)maxRatio
+                               error:(NSError **)error {
+  return [self gtm_dataByInflatingBytes:bytes
+                                 length:length
+                              isRawData:NO
+                         expectedLength:0
+                          maximumLength:maxLength
+                           maximumRatio:maxRatio
+                             dictionary:nil
+                                  error:error];
+} // gtm_dataByInflatingBytes:length:maximumLength:maximumRatio:error:
 
-  return result;
-} // gtm_dataByInflatingBytes:length:windowBits:
++ (NSData *)gtm_dataByInflatingData:(NSData *)data
+                      maximumLength:(NSUInteger)maxLength
+                       maximumRatio:(NSUInteger)maxRatio
+                              error:(NSError **)error {
+  return [self gtm_dataByInflatingBytes:[data bytes]
+                                 length:[data length]
+                              isRawData:NO
+                         expectedLength:0
+                          maximumLength:maxLength
+                           maximumRatio:maxRatio
+                             dictionary:nil
+                                  error:error];
+} // gtm_dataByInflatingData:maximumLength:maximumRatio:error:
 
-@end
++ (NSData *)gtm_dataByRawInflatingBytes:(const void *)bytes
+                                 length:(NSUInteger)length
+                          maximumLength:(NSUInteger)maxLength
+                           maximumRatio:(NSUInteger)maxRatio
+                                  error:(NSError **)error {
+  return [self gtm_dataByInflatingBytes:bytes
+                                 length:length
+                              isRawData:YES
+                         expectedLength:0
+                          maximumLength:maxLength
+                           maximumRatio:maxRatio
+                             dictionary:nil
+                                  error:error];
+} // gtm_dataByRawInflatingBytes:length:maximumLength:maximumRatio:error:
 
++ (NSData *)gtm_dataByRawInflatingData:(NSData *)data
+                         maximumLength:(NSUInteger)maxLength
+                          maximumRatio:(NSUInteger)maxRatio
+                                 error:(NSError **)error {
+  return [self gtm_dataByInflatingBytes:[data bytes]
+                                 length:[data length]
+                              isRawData:YES
+                         expectedLength:0
+                          maximumLength:maxLength
+                           maximumRatio:maxRatio
+                             dictionary:nil
+                                  error:error];
+} // gtm_dataByRawInflatingData:maximumLength:maximumRatio:error:
 
-@implementation NSData (GTMZLibAdditions)
+#pragma mark -
 
 + (NSData *)gtm_dataByGzippingBytes:(const void *)bytes
                              length:(NSUInteger)length
+                            options:(GTMZlibCompressionOptions *)options
                               error:(NSError **)error {
   return [self gtm_dataByCompressingBytes:bytes
                                    length:length
-                         compressionLevel:Z_DEFAULT_COMPRESSION
+                                  options:options
                                      mode:CompressionModeGzip
                                     error:error];
-} // gtm_dataByGzippingBytes:length:error:
+} // gtm_dataByGzippingBytes:length:options:error:
 
-+ (NSData *)gtm_dataByGzippingData:(NSData *)data error:(NSError **)error {
++ (NSData *)gtm_dataByGzippingData:(NSData *)data
+                           options:(GTMZlibCompressionOptions *)options
+                             error:(NSError **)error {
   return [self gtm_dataByCompressingBytes:[data bytes]
                                    length:[data length]
-                         compressionLevel:Z_DEFAULT_COMPRESSION
+                                  options:options
                                      mode:CompressionModeGzip
                                     error:error];
-} // gtm_dataByGzippingData:error:
+} // gtm_dataByGzippingData:options:error:
 
-+ (NSData *)gtm_dataByGzippingBytes:(const void *)bytes
-                             length:(NSUInteger)length
-                   compressionLevel:(int)level
-                              error:(NSError **)error{
++ (NSData *)gtm_dataByDeflatingBytes:(const void *)bytes
+                              length:(NSUInteger)length
+                             options:(GTMZlibCompressionOptions *)options
+                               error:(NSError **)error {
   return [self gtm_dataByCompressingBytes:bytes
                                    length:length
-                         compressionLevel:level
-                                     mode:CompressionModeGzip
+                                  options:options
+                                     mode:CompressionModeZlib
                                     error:error];
-} // gtm_dataByGzippingBytes:length:level:error
+} // gtm_dataByDeflatingBytes:length:options:error:
 
-+ (NSData *)gtm_dataByGzippingData:(NSData *)data
-                  compressionLevel:(int)level
-                             error:(NSError **)error{
++ (NSData *)gtm_dataByDeflatingData:(NSData *)data
+                            options:(GTMZlibCompressionOptions *)options
+                              error:(NSError **)error {
   return [self gtm_dataByCompressingBytes:[data bytes]
                                    length:[data length]
-                         compressionLevel:level
-                                     mode:CompressionModeGzip
+                                  options:options
+                                     mode:CompressionModeZlib
                                     error:error];
-} // gtm_dataByGzippingData:level:error
+} // gtm_dataByDeflatingData:options:error:
+
++ (NSData *)gtm_dataByRawDeflatingBytes:(const void *)bytes
+                                 length:(NSUInteger)length
+                                options:(GTMZlibCompressionOptions *)options
+                                  error:(NSError **)error {
+  return [self gtm_dataByCompressingBytes:bytes
+                                   length:length
+                                  options:options
+                                     mode:CompressionModeRaw
+                                    error:error];
+} // gtm_dataByRawDeflatingBytes:length:options:error:
+
++ (NSData *)gtm_dataByRawDeflatingData:(NSData *)data
+                               options:(GTMZlibCompressionOptions *)options
+                                 error:(NSError **)error {
+  return [self gtm_dataByCompressingBytes:[data bytes]
+                                   length:[data length]
+                                  options:options
+                                     mode:CompressionModeRaw
+                                    error:error];
+} // gtm_dataByRawDeflatingData:options:error:
 
 #pragma mark -
 
-+ (NSData *)gtm_dataByDeflatingBytes:(const void *)bytes
-                              length:(NSUInteger)length
-                               error:(NSError **)error{
++ (NSData *)gtm_dataByGzippingBytes:(const void *)bytes
+                             length:(NSUInteger)length
+                   targetThroughput:(double)targetThroughput
+                              error:(NSError **)error {
   return [self gtm_dataByCompressingBytes:bytes
                                    length:length
-                         compressionLevel:Z_DEFAULT_COMPRESSION
-                                     mode:CompressionModeZlib
+                         targetThroughput:targetThroughput
+                                     mode:CompressionModeGzip
                                     error:error];
-} // gtm_dataByDeflatingBytes:length:error
+} // gtm_dataByGzippingBytes:length:targetThroughput:error:
 
-+ (NSData *)gtm_dataByDeflatingData:(NSData *)data error:(NSError **)error {
++ (NSData *)gtm_dataByGzippingData:(NSData *)data
+                  targetThroughput:(double)targetThroughput
+                             error:(NSError **)error {
   return [self gtm_dataByCompressingBytes:[data bytes]
                                    length:[data length]
-                         compressionLevel:Z_DEFAULT_COMPRESSION
-                                     mode:CompressionModeZlib
+                         targetThroughput:targetThroughput
+                                     mode:CompressionModeGzip
                                     error:error];
-} // gtm_dataByDeflatingData:
+} // gtm_dataByGzippingData:targetThroughput:error:
 
 + (NSData *)gtm_dataByDeflatingBytes:(const void *)bytes
                               length:(NSUInteger)length
-                    compressionLevel:(int)level
+                    targetThroughput:(double)targetThroughput
                                error:(NSError **)error {
   return [self gtm_dataByCompressingBytes:bytes
                                    length:length
-                         compressionLevel:level
+                         targetThroughput:targetThroughput
                                      mode:CompressionModeZlib
                                     error:error];
-} // gtm_dataByDeflatingBytes:length:level:error:
+} // gtm_dataByDeflatingBytes:length:targetThroughput:error:
 
 + (NSData *)gtm_dataByDeflatingData:(NSData *)data
-                   compressionLevel:(int)level
+                   targetThroughput:(double)targetThroughput
                               error:(NSError **)error {
   return [self gtm_dataByCompressingBytes:[data bytes]
                                    length:[data length]
-                         compressionLevel:level
+                         targetThroughput:targetThroughput
                                      mode:CompressionModeZlib
                                     error:error];
-} // gtm_dataByDeflatingData:level:error:
-
-#pragma mark -
-
-+ (NSData *)gtm_dataByInflatingBytes:(const void *)bytes
-                              length:(NSUInteger)length
-                               error:(NSError **)error {
-  return [self gtm_dataByInflatingBytes:bytes
-                                 length:length
-                              isRawData:NO
-                                  error:error];
-} // gtm_dataByInflatingBytes:length:error:
-
-+ (NSData *)gtm_dataByInflatingData:(NSData *)data
-                              error:(NSError **)error {
-  return [self gtm_dataByInflatingBytes:[data bytes]
-                                 length:[data length]
-                              isRawData:NO
-                                  error:error];
-} // gtm_dataByInflatingData:
-
-#pragma mark -
+} // gtm_dataByDeflatingData:targetThroughput:error:
 
 + (NSData *)gtm_dataByRawDeflatingBytes:(const void *)bytes
                                  length:(NSUInteger)length
+                       targetThroughput:(double)targetThroughput
                                   error:(NSError **)error {
   return [self gtm_dataByCompressingBytes:bytes
                                    length:length
-                         compressionLevel:Z_DEFAULT_COMPRESSION
+                         targetThroughput:targetThroughput
                                      mode:CompressionModeRaw
                                     error:error];
-} // gtm_dataByRawDeflatingBytes:length:error:
+} // gtm_dataByRawDeflatingBytes:length:targetThroughput:error:
 
-+ (NSData *)gtm_dataByRawDeflatingData:(NSData *)data error:(NSError **)error {
++ (NSData *)gtm_dataByRawDeflatingData:(NSData *)data
+                      targetThroughput:(double)targetThroughput
+                                 error:(NSError **)error {
   return [self gtm_dataByCompressingBytes:[data bytes]
                                    length:[data length]
-                         compressionLevel:Z_DEFAULT_COMPRESSION
+                         targetThroughput:targetThroughput
                                      mode:CompressionModeRaw
                                     error:error];
-} // gtm_dataByRawDeflatingData:error:
+} // gtm_dataByRawDeflatingData:targetThroughput:error:
 
-+ (NSData *)gtm_dataByRawDeflatingBytes:(const void *)bytes
-                                 length:(NSUInteger)length
+#pragma mark -
+
++ (NSData *)gtm_dataByGzippingDataArray:(NSArray *)dataArray
                        compressionLevel:(int)level
-                                  error:(NSError **)error{
-  return [self gtm_dataByCompressingBytes:bytes
-                                   length:length
-                         compressionLevel:level
-                                     mode:CompressionModeRaw
-                                    error:error];
-} // gtm_dataByRawDeflatingBytes:length:compressionLevel:error:
+                                  error:(NSError **)error {
+  return [self gtm_dataByCompressingDataArray:dataArray
+                             compressionLevel:level
+                                         mode:CompressionModeGzip
+                                        error:error];
+} // gtm_dataByGzippingDataArray:compressionLevel:error:
 
-+ (NSData *)gtm_dataByRawDeflatingData:(NSData *)data
++ (NSData *)gtm_dataByGzippingDispatchData:(dispatch_data_t)data
+                          compressionLevel:(int)level
+                                     error:(NSError **)error {
+  return [self gtm_dataByCompressingDispatchData:data
+                                compressionLevel:level
+                                            mode:CompressionModeGzip
+                                           error:error];
+} // gtm_dataByGzippingDispatchData:compressionLevel:error:
+
++ (NSData *)gtm_dataByDeflatingDataArray:(NSArray *)dataArray
+                        compressionLevel:(int)level
+                                   error:(NSError **)error {
+  return [self gtm_dataByCompressingDataArray:dataArray
+                             compressionLevel:level
+                                         mode:CompressionModeZlib
+                                        error:error];
+} // gtm_dataByDeflatingDataArray:compressionLevel:error:
+
++ (NSData *)gtm_dataByDeflatingDispatchData:(dispatch_data_t)data
+                           compressionLevel:(int)level
+                                      error:(NSError **)error {
+  return [self gtm_dataByCompressingDispatchData:data
+                                compressionLevel:level
+                                            mode:CompressionModeZlib
+                                           error:error];
+} // gtm_dataByDeflatingDispatchData:compressionLevel:error:
+
++ (NSData *)gtm_dataByRawDeflatingDataArray:(NSArray *)dataArray
+                           compressionLevel:(int)level
+                                      error:(NSError **)error {
+  return [self gtm_dataByCompressingDataArray:dataArray
+                             compressionLevel:level
+                                         mode:CompressionModeRaw
+                                        error:error];
+} // gtm_dataByRawDeflatingDataArray:compressionLevel:error:
+
++ (NSData *)gtm_dataByRawDeflatingDispatchData:(dispatch_data_t)data
+                              compressionLevel:(int)level
+                                         error:(NSError **)error {
+  return [self gtm_dataByCompressingDispatchData:data
+                                compressionLevel:level
+                                            mode:CompressionModeRaw
+                                           error:error];
+} // gtm_dataByRawDeflatingDispatchData:compressionLevel:error:
+
+#pragma mark -
+
+- (uint32_t)gtm_crc32 {
+  __block uint32_t crc = 0;
+  // Discontiguous data is checksummed in place, region by region.
+  [self enumerateByteRangesUsingBlock:^(const void *bytes, NSRange byteRange, BOOL *stop) {
+    crc = Crc32Bytes(crc, (const unsigned char *)bytes, byteRange.length);
+  }];
+  return crc;
+} // gtm_crc32
+
+- (uint32_t)gtm_adler32 {
+  __block uint32_t adler = 1;
+  [self enumerateByteRangesUsingBlock:^(const void *bytes, NSRange byteRange, BOOL *stop) {
+    adler = Adler32Bytes(adler, (const unsigned char *)bytes, byteRange.length);
+  }];
+  return adler;
+} // gtm_adler32
+
+- (uint32_t)gtm_parallelCrc32 {
+  __block uint32_t crc = 0;
+  [self enumerateByteRangesUsingBlock:^(const void *bytes, NSRange byteRange, BOOL *stop) {
+    crc = ParallelChecksum(crc, (const unsigned char *)bytes, byteRange.length, YES);
+  }];
+  return crc;
+} // gtm_parallelCrc32
+
+- (uint32_t)gtm_parallelAdler32 {
+  __block uint32_t adler = 1;
+  [self enumerateByteRangesUsingBlock:^(const void *bytes, NSRange byteRange, BOOL *stop) {
+    adler = ParallelChecksum(adler, (const unsigned char *)bytes, byteRange.length, NO);
+  }];
+  return adler;
+} // gtm_parallelAdler32
+
++ (uint32_t)gtm_crc32OfBytes:(const void *)bytes
+                      length:(NSUInteger)length
+                         crc:(uint32_t)crc {
+  if (!bytes) {
+    return crc;
+  }
+  return Crc32Bytes(crc, (const unsigned char *)bytes, length);
+} // gtm_crc32OfBytes:length:crc:
+
++ (uint32_t)gtm_adler32OfBytes:(const void *)bytes
+                        length:(NSUInteger)length
+                         adler:(uint32_t)adler {
+  if (!bytes) {
+    return adler;
+  }
+  return Adler32Bytes(adler, (const unsigned char *)bytes, length);
+} // gtm_adler32OfBytes:length:adler:
+
++ (uint32_t)gtm_crc32ByCombiningCrc32:(uint32_t)crc1
+                            withCrc32:(uint32_t)crc2
+                               length:(uint64_t)length2 {
+  return (uint32_t)crc32_combine(crc1, crc2, (z_off_t)length2);
+} // gtm_crc32ByCombiningCrc32:withCrc32:length:
+
++ (uint32_t)gtm_adler32ByCombiningAdler32:(uint32_t)adler1
+                              withAdler32:(uint32_t)adler2
+                                   length:(uint64_t)length2 {
+  return (uint32_t)adler32_combine(adler1, adler2, (z_off_t)length2);
+} // gtm_adler32ByCombiningAdler32:withAdler32:length:
+
+#pragma mark -
+
++ (NSData *)gtm_dataByCompressingBytes:(const void *)bytes
+                                length:(NSUInteger)length
+                                 codec:(id<GTMCompressionCodec>)codec
                       compressionLevel:(int)level
                                  error:(NSError **)error {
+  return [GTMCompressionCodecs frameByCompressingBytes:bytes
+                                                length:length
+                                                 codec:codec
+                                      compressionLevel:level
+                                                 error:error];
+} // gtm_dataByCompressingBytes:length:codec:compressionLevel:error:
+
++ (NSData *)gtm_dataByCompressingData:(NSData *)data
+                                codec:(id<GTMCompressionCodec>)codec
+                     compressionLevel:(int)level
+                                error:(NSError **)error {
   return [self gtm_dataByCompressingBytes:[data bytes]
                                    length:[data length]
+                                    codec:codec
                          compressionLevel:level
-                                     mode:CompressionModeRaw
                                     error:error];
-} // gtm_dataByRawDeflatingData:compressionLevel:error:
-
-+ (NSData *)gtm_dataByRawInflatingBytes:(const void *)bytes
-                                 length:(NSUInteger)length
-                                  error:(NSError **)error{
-  return [self gtm_dataByInflatingBytes:bytes
-                                 length:length
-                              isRawData:YES
-                                  error:error];
-} // gtm_dataByRawInflatingBytes:length:error:
-
-+ (NSData *)gtm_dataByRawInflatingData:(NSData *)data
-                                 error:(NSError **)error {
-  return [self gtm_dataByInflatingBytes:[data bytes]
-                                 length:[data length]
-                              isRawData:YES
-                                  error:error];
-} // gtm_dataByRawInflatingData:error:
+} // gtm_dataByCompressingData:codec:compressionLevel:error:
 
 @end
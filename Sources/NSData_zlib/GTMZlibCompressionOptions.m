@@ -0,0 +1,208 @@
+//
+//  GTMZlibCompressionOptions.m
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#if !__has_feature(objc_arc)
+#error "This file needs to be compiled with ARC enabled."
+#endif
+
+#import "GTMZlibCompressionOptions.h"
+#import <math.h>
+#import <zlib.h>
+
+NSString *const GTMZlibCompressionPresetFastText = @"fast-text";
+NSString *const GTMZlibCompressionPresetSmallMemory = @"small-memory";
+NSString *const GTMZlibCompressionPresetBinaryRLE = @"binary-rle";
+NSString *const GTMZlibCompressionPresetHuffmanOnly = @"huffman-only";
+NSString *const GTMZlibCompressionPresetAutomatic = @"auto";
+
+// Automatic selection looks at up to kSampleSize bytes, in kSampleSliceSize
+// slices spread evenly over larger inputs.
+static const NSUInteger kSampleSize = 64 * 1024;
+static const NSUInteger kSampleSliceSize = 4 * 1024;
+
+// Past this share of bytes repeating the one before, RLE finds nearly all the
+// matches the full search would.
+static const double kRunFractionForRLE = 0.5;
+// This share of printable ASCII and whitespace is taken as text.
+static const double kTextFractionForText = 0.95;
+// Past this many bits per byte there are few matches worth searching for,
+// Huffman coding alone gets about the same ratio several times faster.
+static const double kEntropyForHuffmanOnly = 7.0;
+
+GTM_INLINE int ClampInt(int value, int low, int high) {
+  return value < low ? low : (value > high ? high : value);
+}
+
+@implementation GTMZlibCompressionOptions
+
+@synthesize compressionLevel = compressionLevel_;
+@synthesize strategy = strategy_;
+@synthesize memoryLevel = memoryLevel_;
+@synthesize windowBits = windowBits_;
+@synthesize automatic = automatic_;
+
++ (instancetype)defaultOptions {
+  return [[self alloc] init];
+}
+
++ (instancetype)optionsWithPreset:(NSString *)preset {
+  GTMZlibCompressionOptions *options = [self defaultOptions];
+  if ([preset isEqualToString:GTMZlibCompressionPresetFastText]) {
+    [options setCompressionLevel:Z_BEST_SPEED];
+    [options setMemoryLevel:9];
+  } else if ([preset isEqualToString:GTMZlibCompressionPresetSmallMemory]) {
+    [options setMemoryLevel:2];
+    [options setWindowBits:10];
+  } else if ([preset isEqualToString:GTMZlibCompressionPresetBinaryRLE]) {
+    [options setStrategy:GTMZlibCompressionStrategyRLE];
+  } else if ([preset isEqualToString:GTMZlibCompressionPresetHuffmanOnly]) {
+    [options setStrategy:GTMZlibCompressionStrategyHuffmanOnly];
+  } else if ([preset isEqualToString:GTMZlibCompressionPresetAutomatic]) {
+    [options setAutomatic:YES];
+  } else {
+    options = nil;
+  }
+  return options;
+}
+
++ (instancetype)optionsForBytes:(const void *)bytes length:(NSUInteger)length {
+  if (!bytes || !length) {
+    return [self defaultOptions];
+  }
+  const unsigned char *input = (const unsigned char *)bytes;
+  NSUInteger sliceCount = 1;
+  NSUInteger sliceLength = length;
+  if (length > kSampleSize) {
+    sliceCount = kSampleSize / kSampleSliceSize;
+    sliceLength = kSampleSliceSize;
+  }
+  NSUInteger histogram[256] = { 0 };
+  NSUInteger repeats = 0;
+  NSUInteger text = 0;
+  for (NSUInteger slice = 0; slice < sliceCount; ++slice) {
+    NSUInteger offset =
+        (sliceCount == 1) ? 0 : (length - sliceLength) / (sliceCount - 1) * slice;
+    const unsigned char *sample = input + offset;
+    for (NSUInteger i = 0; i < sliceLength; ++i) {
+      unsigned char c = sample[i];
+      ++histogram[c];
+      if (i > 0 && sample[i - 1] == c) {
+        ++repeats;
+      }
+      if ((c >= 0x20 && c < 0x7f) || c == '\n' || c == '\r' || c == '\t') {
+        ++text;
+      }
+    }
+  }
+  double sampled = (double)(sliceCount * sliceLength);
+  double entropy = 0;
+  for (int i = 0; i < 256; ++i) {
+    if (histogram[i]) {
+      double p = histogram[i] / sampled;
+      entropy -= p * log2(p);
+    }
+  }
+
+  NSString *preset = nil;
+  if (repeats / sampled >= kRunFractionForRLE) {
+    preset = GTMZlibCompressionPresetBinaryRLE;
+  } else if (text / sampled >= kTextFractionForText) {
+    preset = GTMZlibCompressionPresetFastText;
+  } else if (entropy >= kEntropyForHuffmanOnly) {
+    preset = GTMZlibCompressionPresetHuffmanOnly;
+  }
+  return preset ? [self optionsWithPreset:preset] : [self defaultOptions];
+}
+
+- (instancetype)init {
+  if ((self = [super init])) {
+    compressionLevel_ = Z_DEFAULT_COMPRESSION;
+    strategy_ = GTMZlibCompressionStrategyDefault;
+    memoryLevel_ = 8;
+    windowBits_ = MAX_WBITS;
+  }
+  return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+  GTMZlibCompressionOptions *copy = [[[self class] allocWithZone:zone] init];
+  copy->compressionLevel_ = compressionLevel_;
+  copy->strategy_ = strategy_;
+  copy->memoryLevel_ = memoryLevel_;
+  copy->windowBits_ = windowBits_;
+  copy->automatic_ = automatic_;
+  return copy;
+}
+
+- (void)setCompressionLevel:(int)level {
+  if (level != Z_DEFAULT_COMPRESSION) {
+    level = ClampInt(level, Z_BEST_SPEED, Z_BEST_COMPRESSION);
+  }
+  compressionLevel_ = level;
+}
+
+- (void)setStrategy:(GTMZlibCompressionStrategy)strategy {
+  if (strategy < GTMZlibCompressionStrategyDefault ||
+      strategy > GTMZlibCompressionStrategyFixed) {
+    strategy = GTMZlibCompressionStrategyDefault;
+  }
+  strategy_ = strategy;
+}
+
+- (void)setMemoryLevel:(int)memoryLevel {
+  memoryLevel_ = ClampInt(memoryLevel, 1, MAX_MEM_LEVEL);
+}
+
+- (void)setWindowBits:(int)windowBits {
+  // zlib quietly turns 8 into 9 for deflate, so don't offer it.
+  windowBits_ = ClampInt(windowBits, 9, MAX_WBITS);
+}
+
+- (GTMZlibCompressionOptions *)resolvedOptionsForBytes:(const void *)bytes
+                                                length:(NSUInteger)length {
+  if (!automatic_) {
+    return self;
+  }
+  return [[self class] optionsForBytes:bytes length:length];
+}
+
+- (BOOL)isEqual:(id)object {
+  if (![object isKindOfClass:[GTMZlibCompressionOptions class]]) {
+    return NO;
+  }
+  GTMZlibCompressionOptions *other = object;
+  return compressionLevel_ == other->compressionLevel_ &&
+         strategy_ == other->strategy_ &&
+         memoryLevel_ == other->memoryLevel_ &&
+         windowBits_ == other->windowBits_ &&
+         automatic_ == other->automatic_;
+}
+
+- (NSUInteger)hash {
+  return (NSUInteger)((compressionLevel_ + 1) | (strategy_ << 4) |
+                      (memoryLevel_ << 8) | (windowBits_ << 12) |
+                      (automatic_ << 16));
+}
+
+- (NSString *)description {
+  return [NSString stringWithFormat:@"<%@ %p: level %d, strategy %ld, memoryLevel %d, windowBits %d%@>",
+                                    [self class], self, compressionLevel_, (long)strategy_,
+                                    memoryLevel_, windowBits_, automatic_ ? @", automatic" : @""];
+}
+
+@end
@@ -0,0 +1,402 @@
+//
+//  GTMZlibCompressionQueue.m
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#if !__has_feature(objc_arc)
+#error "This file needs to be compiled with ARC enabled."
+#endif
+
+#import "GTMZlibCompressionQueue.h"
+#import "GTMZlibCompressor.h"
+
+// A worker takes queued tasks as one batch until they add up to this much
+// input (a bigger task is always a batch of its own)...
+static const NSUInteger kBatchInputLength = 256 * 1024;
+// ...or there are this many.
+static const NSUInteger kMaxBatchCount = 64;
+
+typedef enum {
+  TaskStatePending,
+  TaskStateRunning,
+  TaskStateFinished,
+} TaskState;
+
+@interface GTMZlibCompressionQueue ()
+- (BOOL)removePendingTask:(GTMZlibCompressionTask *)task;
+@end
+
+@interface GTMZlibCompressionTask () {
+ @package
+  NSData *input_;
+  BOOL compress_;
+  GTMZlibStreamFormat format_;
+  int level_;
+  dispatch_queue_t callbackQueue_;
+  GTMZlibCompressionCompletion completion_;
+  CFAbsoluteTime submitTime_;
+  // Guarded by the task.
+  TaskState state_;
+  BOOL cancelled_;
+  __weak GTMZlibCompressionQueue *queue_;
+  // Filled in by the worker.
+  NSData *result_;
+  NSError *error_;
+}
+- (instancetype)initPrivate;
+@end
+
+static NSError *CancelledError(void) {
+  return [NSError errorWithDomain:NSCocoaErrorDomain
+                             code:NSUserCancelledError
+                         userInfo:nil];
+}
+
+@implementation GTMZlibCompressionTask
+
+- (instancetype)initPrivate {
+  return [super init];
+}
+
+- (BOOL)isCancelled {
+  @synchronized(self) {
+    return cancelled_;
+  }
+}
+
+- (void)cancel {
+  @synchronized(self) {
+    if (cancelled_ || state_ == TaskStateFinished) {
+      return;
+    }
+    cancelled_ = YES;
+    if (state_ != TaskStatePending) {
+      // The worker reports it once it's done.
+      return;
+    }
+  }
+  // Still queued: take it out and report it now. If a worker got to it first
+  // the worker sees the flag instead.
+  if ([queue_ removePendingTask:self]) {
+    @synchronized(self) {
+      state_ = TaskStateFinished;
+    }
+    GTMZlibCompressionCompletion completion = completion_;
+    completion_ = nil;
+    dispatch_async(callbackQueue_, ^{
+      completion(nil, CancelledError());
+    });
+  }
+}
+
+@end
+
+@implementation GTMZlibCompressionQueue {
+  // All guarded by |pending_|.
+  NSMutableArray *pending_;
+  NSUInteger pendingInputLength_;
+  NSUInteger activeWorkers_;
+  uint64_t completed_;
+  uint64_t cancelled_;
+  uint64_t batches_;
+  uint64_t started_;
+  NSTimeInterval totalWaitTime_;
+  NSTimeInterval maximumWaitTime_;
+  NSTimeInterval totalRunTime_;
+}
+
+@synthesize maximumConcurrentWorkers = maximumConcurrentWorkers_;
+
++ (GTMZlibCompressionQueue *)sharedQueue {
+  static GTMZlibCompressionQueue *sharedQueue;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    sharedQueue = [[GTMZlibCompressionQueue alloc] initWithMaximumConcurrentWorkers:0];
+  });
+  return sharedQueue;
+}
+
+- (instancetype)initWithMaximumConcurrentWorkers:(NSUInteger)maximumConcurrentWorkers {
+  if ((self = [super init])) {
+    if (!maximumConcurrentWorkers) {
+      maximumConcurrentWorkers = [[NSProcessInfo processInfo] activeProcessorCount];
+    }
+    maximumConcurrentWorkers_ = maximumConcurrentWorkers;
+    pending_ = [[NSMutableArray alloc] init];
+  }
+  return self;
+}
+
+- (GTMZlibCompressionTask *)compressData:(NSData *)data
+                                  format:(GTMZlibStreamFormat)format
+                        compressionLevel:(int)level
+                           callbackQueue:(dispatch_queue_t)callbackQueue
+                              completion:(GTMZlibCompressionCompletion)completion {
+  return [self submitData:data
+                 compress:YES
+                   format:format
+         compressionLevel:level
+            callbackQueue:callbackQueue
+               completion:completion];
+}
+
+- (GTMZlibCompressionTask *)decompressData:(NSData *)data
+                                    format:(GTMZlibStreamFormat)format
+                             callbackQueue:(dispatch_queue_t)callbackQueue
+                                completion:(GTMZlibCompressionCompletion)completion {
+  return [self submitData:data
+                 compress:NO
+                   format:format
+         compressionLevel:0
+            callbackQueue:callbackQueue
+               completion:completion];
+}
+
+- (GTMZlibCompressionTask *)submitData:(NSData *)data
+                              compress:(BOOL)compress
+                                format:(GTMZlibStreamFormat)format
+                      compressionLevel:(int)level
+                         callbackQueue:(dispatch_queue_t)callbackQueue
+                            completion:(GTMZlibCompressionCompletion)completion {
+  GTMZlibCompressionTask *task = [[GTMZlibCompressionTask alloc] initPrivate];
+  // The caller may go on to change a mutable input.
+  task->input_ = [data copy];
+  task->compress_ = compress;
+  task->format_ = format;
+  task->level_ = level;
+  task->callbackQueue_ = callbackQueue ? callbackQueue : dispatch_get_main_queue();
+  task->completion_ = [completion copy];
+  task->queue_ = self;
+  task->submitTime_ = CFAbsoluteTimeGetCurrent();
+
+  BOOL startWorker = NO;
+  @synchronized(pending_) {
+    [pending_ addObject:task];
+    pendingInputLength_ += [task->input_ length];
+    // Another worker only helps if there's more than the running ones will
+    // take in their next batches.
+    if (activeWorkers_ < maximumConcurrentWorkers_ &&
+        (activeWorkers_ == 0 || pendingInputLength_ > activeWorkers_ * kBatchInputLength ||
+         [pending_ count] > activeWorkers_ * kMaxBatchCount)) {
+      ++activeWorkers_;
+      startWorker = YES;
+    }
+  }
+  if (startWorker) {
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+      [self runWorker];
+    });
+  }
+  return task;
+}
+
+- (BOOL)removePendingTask:(GTMZlibCompressionTask *)task {
+  @synchronized(pending_) {
+    NSUInteger index = [pending_ indexOfObjectIdenticalTo:task];
+    if (index == NSNotFound) {
+      return NO;
+    }
+    [pending_ removeObjectAtIndex:index];
+    pendingInputLength_ -= [task->input_ length];
+    ++cancelled_;
+    return YES;
+  }
+}
+
+// Takes the next batch off the queue, or returns nil (and retires the
+// worker) once there is nothing left.
+- (NSArray *)nextBatch {
+  @synchronized(pending_) {
+    NSUInteger count = 0;
+    NSUInteger length = 0;
+    for (GTMZlibCompressionTask *task in pending_) {
+      NSUInteger taskLength = [task->input_ length];
+      if (count > 0 && (count == kMaxBatchCount || length + taskLength > kBatchInputLength)) {
+        break;
+      }
+      ++count;
+      length += taskLength;
+    }
+    if (!count) {
+      --activeWorkers_;
+      return nil;
+    }
+    NSRange range = NSMakeRange(0, count);
+    NSArray *batch = [pending_ subarrayWithRange:range];
+    [pending_ removeObjectsInRange:range];
+    pendingInputLength_ -= length;
+    ++batches_;
+
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    for (GTMZlibCompressionTask *task in batch) {
+      @synchronized(task) {
+        task->state_ = TaskStateRunning;
+      }
+      NSTimeInterval wait = now - task->submitTime_;
+      totalWaitTime_ += wait;
+      maximumWaitTime_ = MAX(maximumWaitTime_, wait);
+      ++started_;
+    }
+    return batch;
+  }
+}
+
+- (void)runWorker {
+  NSArray *batch;
+  while ((batch = [self nextBatch])) {
+    NSUInteger finished = 0;
+    NSUInteger cancelled = 0;
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (GTMZlibCompressionTask *task in batch) {
+      @autoreleasepool {
+        if ([task isCancelled]) {
+          continue;
+        }
+        NSError *error = nil;
+        NSData *input = task->input_;
+        if (task->compress_) {
+          task->result_ = [GTMZlibCompressor compressBytes:[input bytes]
+                                                    length:[input length]
+                                                    format:task->format_
+                                          compressionLevel:task->level_
+                                                dictionary:nil
+                                                     error:&error];
+        } else {
+          task->result_ = [GTMZlibDecompressor decompressBytes:[input bytes]
+                                                        length:[input length]
+                                                        format:task->format_
+                                                expectedLength:0
+                                                    dictionary:nil
+                                                         error:&error];
+        }
+        task->error_ = error;
+      }
+    }
+    NSTimeInterval runTime = CFAbsoluteTimeGetCurrent() - start;
+
+    // One delivery per callback queue for the whole batch, in order.
+    NSMutableArray *deliveries = [NSMutableArray array];
+    for (GTMZlibCompressionTask *task in batch) {
+      @synchronized(task) {
+        task->state_ = TaskStateFinished;
+        if (task->cancelled_) {
+          task->result_ = nil;
+          task->error_ = CancelledError();
+          ++cancelled;
+        } else {
+          ++finished;
+        }
+      }
+      task->input_ = nil;
+      NSMutableArray *delivery = nil;
+      for (NSMutableArray *candidate in deliveries) {
+        GTMZlibCompressionTask *first = [candidate firstObject];
+        if (first->callbackQueue_ == task->callbackQueue_) {
+          delivery = candidate;
+          break;
+        }
+      }
+      if (!delivery) {
+        delivery = [NSMutableArray array];
+        [deliveries addObject:delivery];
+      }
+      [delivery addObject:task];
+    }
+    @synchronized(pending_) {
+      completed_ += finished;
+      cancelled_ += cancelled;
+      totalRunTime_ += runTime;
+    }
+    for (NSArray *delivery in deliveries) {
+      GTMZlibCompressionTask *first = [delivery firstObject];
+      dispatch_async(first->callbackQueue_, ^{
+        for (GTMZlibCompressionTask *task in delivery) {
+          GTMZlibCompressionCompletion completion = task->completion_;
+          NSData *result = task->result_;
+          NSError *error = task->error_;
+          task->completion_ = nil;
+          task->result_ = nil;
+          task->error_ = nil;
+          completion(result, error);
+        }
+      });
+    }
+  }
+}
+
+- (GTMZlibCompressionQueueStatistics)statistics {
+  GTMZlibCompressionQueueStatistics statistics;
+  @synchronized(pending_) {
+    statistics.pendingTasks = [pending_ count];
+    statistics.activeWorkers = activeWorkers_;
+    statistics.completedTasks = completed_;
+    statistics.cancelledTasks = cancelled_;
+    statistics.batches = batches_;
+    statistics.averageWaitTime = started_ ? totalWaitTime_ / started_ : 0;
+    statistics.maximumWaitTime = maximumWaitTime_;
+    statistics.averageRunTime = started_ ? totalRunTime_ / started_ : 0;
+  }
+  return statistics;
+}
+
+- (void)resetStatistics {
+  @synchronized(pending_) {
+    completed_ = 0;
+    cancelled_ = 0;
+    batches_ = 0;
+    started_ = 0;
+    totalWaitTime_ = 0;
+    maximumWaitTime_ = 0;
+    totalRunTime_ = 0;
+  }
+}
+
+@end
+
+@implementation NSData (GTMZlibAsyncAdditions)
+
++ (GTMZlibCompressionTask *)gtm_gzipData:(NSData *)data
+                        compressionLevel:(int)level
+                           callbackQueue:(dispatch_queue_t)callbackQueue
+                              completion:(GTMZlibCompressionCompletion)completion {
+  return [[GTMZlibCompressionQueue sharedQueue] compressData:data
+                                                      format:GTMZlibStreamFormatGzip
+                                            compressionLevel:level
+                                               callbackQueue:callbackQueue
+                                                  completion:completion];
+} // gtm_gzipData:compressionLevel:callbackQueue:completion:
+
++ (GTMZlibCompressionTask *)gtm_deflateData:(NSData *)data
+                           compressionLevel:(int)level
+                              callbackQueue:(dispatch_queue_t)callbackQueue
+                                 completion:(GTMZlibCompressionCompletion)completion {
+  return [[GTMZlibCompressionQueue sharedQueue] compressData:data
+                                                      format:GTMZlibStreamFormatZlib
+                                            compressionLevel:level
+                                               callbackQueue:callbackQueue
+                                                  completion:completion];
+} // gtm_deflateData:compressionLevel:callbackQueue:completion:
+
++ (GTMZlibCompressionTask *)gtm_inflateData:(NSData *)data
+                              callbackQueue:(dispatch_queue_t)callbackQueue
+                                 completion:(GTMZlibCompressionCompletion)completion {
+  return [[GTMZlibCompressionQueue sharedQueue] decompressData:data
+                                                        format:GTMZlibStreamFormatAutoDetect
+                                                 callbackQueue:callbackQueue
+                                                    completion:completion];
+} // gtm_inflateData:callbackQueue:completion:
+
+@end
@@ -0,0 +1,1119 @@
+//
+//  GTMZlibCompressor.m
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#if !__has_feature(objc_arc)
+#error "This file needs to be compiled with ARC enabled."
+#endif
+
+#import "GTMZlibCompressor.h"
+#import <zlib.h>
+#import "GTMNSData+zlib.h"
+#import "GTMZlibInternal.h"
+
+// The smallest output buffer (and smallest growth step) used.
+#define kChunkSize 1024
+
+// Without a better idea of the inflated size, don't speculatively reserve more
+// than this; beyond it the output grows as needed.
+#define kMaxGuessedInflateSize (64 * 1024 * 1024)
+
+// One contiguous piece of a scattered input.
+typedef struct {
+  const unsigned char *bytes;
+  NSUInteger length;
+} InputRegion;
+
+// Collects the regions of |data|'s storage without coalescing it. They stay
+// valid for as long as |data| does.
+static void AppendRegionsOfData(NSMutableData *regions, NSData *data) {
+  [data enumerateByteRangesUsingBlock:^(const void *bytes, NSRange byteRange, BOOL *stop) {
+    InputRegion region = { (const unsigned char *)bytes, byteRange.length };
+    [regions appendBytes:&region length:sizeof(region)];
+  }];
+}
+
+static void AppendRegionsOfDispatchData(NSMutableData *regions, dispatch_data_t data) {
+  dispatch_data_apply(data, ^bool(dispatch_data_t piece, size_t offset,
+                                  const void *bytes, size_t size) {
+    InputRegion region = { (const unsigned char *)bytes, size };
+    [regions appendBytes:&region length:sizeof(region)];
+    return true;
+  });
+}
+
+// Points |strm|'s output at the unused part of |result|, which has |produced|
+// bytes filled in so far, growing it geometrically (but never past
+// |maxCapacity|) when full. zlib writes straight into the data's storage, so
+// there is no intermediate copy.
+static BOOL PrepareOutput(z_stream *strm, NSMutableData *result,
+                          NSUInteger produced, NSUInteger maxCapacity) {
+  NSUInteger capacity = [result length];
+  if (produced == capacity) {
+    NSUInteger growBy = MAX(capacity, (NSUInteger)kChunkSize);
+    if (capacity > NSUIntegerMax - growBy || capacity >= maxCapacity) {
+      return NO;  // COV_NF_LINE
+    }
+    capacity = MIN(capacity + growBy, maxCapacity);
+    [result setLength:capacity];
+    if ([result length] != capacity) {
+      return NO;  // COV_NF_LINE
+    }
+  }
+  strm->next_out = (Bytef *)[result mutableBytes] + produced;
+  strm->avail_out = (uInt)MIN(capacity - produced, kMaxZlibWindow);
+  return YES;
+}
+
+// YES if the next input for |strm| (what zlib hasn't used yet, followed by
+// the windows not yet handed to it) starts another gzip member.
+static BOOL GzipMemberFollows(const z_stream *strm, const unsigned char *input,
+                              NSUInteger inputLeft) {
+  unsigned char magic[2];
+  NSUInteger found = 0;
+  for (uInt i = 0; i < strm->avail_in && found < 2; ++i) {
+    magic[found++] = strm->next_in[i];
+  }
+  for (NSUInteger i = 0; i < inputLeft && found < 2; ++i) {
+    magic[found++] = input[i];
+  }
+  return IsGzipMember(magic, found);
+}
+
+// For a gzip payload the trailer holds the uncompressed length (mod 2^32),
+// which makes a good first guess at the output size. Returns 0 if |bytes|
+// isn't gzip or the value is implausible.
+static NSUInteger GzipTrailerLength(const unsigned char *bytes, NSUInteger length) {
+  // 10 byte header, at least 2 bytes of data, 8 byte trailer.
+  if (length < 20 || !IsGzipMember(bytes, length)) {
+    return 0;
+  }
+  const unsigned char *isize = bytes + length - 4;
+  NSUInteger size = (NSUInteger)isize[0] | ((NSUInteger)isize[1] << 8) |
+                    ((NSUInteger)isize[2] << 16) | ((NSUInteger)isize[3] << 24);
+  if (length <= NSUIntegerMax / kMaxDeflateRatio &&
+      size > length * kMaxDeflateRatio) {
+    return 0;
+  }
+  return size;
+}
+
+// Primes |strm| with a preset dictionary. zlib only uses the last 32KB of it,
+// but a zlib stream identifies it by the adler32 of the whole thing.
+static int SetDeflateDictionary(z_stream *strm, NSData *dictionary) {
+  if ([dictionary length] > kMaxZlibWindow) {
+    return Z_STREAM_ERROR;  // COV_NF_LINE
+  }
+  return deflateSetDictionary(strm, [dictionary bytes], (uInt)[dictionary length]);
+}
+
+static int SetInflateDictionary(z_stream *strm, NSData *dictionary) {
+  if ([dictionary length] > kMaxZlibWindow) {
+    return Z_STREAM_ERROR;  // COV_NF_LINE
+  }
+  return inflateSetDictionary(strm, [dictionary bytes], (uInt)[dictionary length]);
+}
+
+static int ZlibStrategy(GTMZlibCompressionStrategy strategy) {
+  switch (strategy) {
+    case GTMZlibCompressionStrategyDefault:
+      break;
+    case GTMZlibCompressionStrategyFiltered:
+      return Z_FILTERED;
+    case GTMZlibCompressionStrategyHuffmanOnly:
+      return Z_HUFFMAN_ONLY;
+    case GTMZlibCompressionStrategyRLE:
+      return Z_RLE;
+    case GTMZlibCompressionStrategyFixed:
+      return Z_FIXED;
+  }
+  return Z_DEFAULT_STRATEGY;
+}
+
+#pragma mark Pool
+
+// The pool key for compressors. Each setting fits in four bits (levels are
+// -1...9); decompressors set bit 24 to keep apart.
+static NSNumber *CompressorKey(GTMZlibStreamFormat format, int level,
+                               GTMZlibCompressionStrategy strategy,
+                               int memoryLevel, int windowBits) {
+  return [NSNumber numberWithInteger:format | ((level + 1) << 4) |
+                                     (strategy << 8) | (memoryLevel << 12) |
+                                     (windowBits << 16)];
+}
+
+// Idle compressors and decompressors, keyed by their configuration. Up to one
+// per core is kept for each configuration, and twice that in all; beyond that
+// they are just released. A configuration nobody has borrowed or returned for
+// kIdleContextTimeout seconds is dropped, and the whole pool is dropped when
+// the system runs short of memory, so nothing stays pinned once the work that
+// needed it is done.
+#define kIdleContextTimeout 30
+
+static NSMutableDictionary *gIdleContexts;
+// When each configuration in gIdleContexts was last borrowed or returned, as
+// NSProcessInfo's systemUptime.
+static NSMutableDictionary *gLastUseTimes;
+static NSUInteger gIdleCount;
+static NSUInteger gMaxIdlePerConfiguration;
+static NSUInteger gMaxIdle;
+static BOOL gSweepScheduled;
+static dispatch_source_t gMemoryPressureSource;
+
+// Takes out the configurations last used at or before |cutoff| (all of them
+// for DBL_MAX) and returns them, so the caller can release them once out of
+// the lock. Call with gIdleContexts locked.
+static NSArray *RemoveIdleContextsUsedBefore(NSTimeInterval cutoff) {
+  NSMutableArray *removed = [NSMutableArray array];
+  for (NSNumber *key in [gLastUseTimes allKeys]) {
+    if ([[gLastUseTimes objectForKey:key] doubleValue] <= cutoff) {
+      NSMutableArray *contexts = [gIdleContexts objectForKey:key];
+      gIdleCount -= [contexts count];
+      [removed addObject:contexts];
+      [gIdleContexts removeObjectForKey:key];
+      [gLastUseTimes removeObjectForKey:key];
+    }
+  }
+  return removed;
+}
+
+// Arranges for unused configurations to be dropped, while there are any.
+// Call with gIdleContexts locked.
+static void ScheduleIdleSweep(void) {
+  if (gSweepScheduled || gIdleCount == 0) {
+    return;
+  }
+  gSweepScheduled = YES;
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kIdleContextTimeout * NSEC_PER_SEC),
+                 dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+    NSArray *removed;
+    @synchronized(gIdleContexts) {
+      gSweepScheduled = NO;
+      NSTimeInterval now = [[NSProcessInfo processInfo] systemUptime];
+      removed = RemoveIdleContextsUsedBefore(now - kIdleContextTimeout);
+      ScheduleIdleSweep();
+    }
+    removed = nil;  // Released out of the lock.
+  });
+}
+
+static NSMutableDictionary *IdleContexts(void) {
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    gIdleContexts = [[NSMutableDictionary alloc] init];
+    gLastUseTimes = [[NSMutableDictionary alloc] init];
+    gMaxIdlePerConfiguration = [[NSProcessInfo processInfo] activeProcessorCount];
+    gMaxIdle = 2 * gMaxIdlePerConfiguration;
+    gMemoryPressureSource =
+        dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+                               DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL,
+                               dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+    dispatch_source_set_event_handler(gMemoryPressureSource, ^{
+      NSArray *removed;
+      @synchronized(gIdleContexts) {
+        removed = RemoveIdleContextsUsedBefore(DBL_MAX);
+      }
+      removed = nil;  // Released out of the lock.
+    });
+    dispatch_resume(gMemoryPressureSource);
+  });
+  return gIdleContexts;
+}
+
+static id BorrowContext(NSNumber *key) {
+  NSMutableDictionary *idle = IdleContexts();
+  @synchronized(idle) {
+    NSMutableArray *contexts = [idle objectForKey:key];
+    id context = [contexts lastObject];
+    if (context) {
+      [contexts removeLastObject];
+      --gIdleCount;
+      [gLastUseTimes setObject:@([[NSProcessInfo processInfo] systemUptime]) forKey:key];
+    }
+    return context;
+  }
+}
+
+static void ReturnContext(id context, NSNumber *key) {
+  NSMutableDictionary *idle = IdleContexts();
+  @synchronized(idle) {
+    NSMutableArray *contexts = [idle objectForKey:key];
+    if ([contexts count] >= gMaxIdlePerConfiguration || gIdleCount >= gMaxIdle) {
+      return;
+    }
+    if (!contexts) {
+      contexts = [NSMutableArray array];
+      [idle setObject:contexts forKey:key];
+    }
+    [contexts addObject:context];
+    ++gIdleCount;
+    [gLastUseTimes setObject:@([[NSProcessInfo processInfo] systemUptime]) forKey:key];
+    ScheduleIdleSweep();
+  }
+}
+
+#pragma mark -
+
+@implementation GTMZlibCompressor {
+  z_stream strm_;
+  BOOL initialized_;
+  BOOL needsReset_;
+  // What |strm_| was set up with; differs from |options_| when automatic.
+  GTMZlibCompressionOptions *streamOptions_;
+}
+
+@synthesize format = format_;
+@synthesize options = options_;
+
++ (instancetype)compressorWithFormat:(GTMZlibStreamFormat)format
+                    compressionLevel:(int)level
+                               error:(NSError **)error {
+  return [[self alloc] initWithFormat:format compressionLevel:level error:error];
+}
+
++ (instancetype)compressorWithFormat:(GTMZlibStreamFormat)format
+                             options:(GTMZlibCompressionOptions *)options
+                               error:(NSError **)error {
+  return [[self alloc] initWithFormat:format options:options error:error];
+}
+
+- (instancetype)initWithFormat:(GTMZlibStreamFormat)format
+              compressionLevel:(int)level
+                         error:(NSError **)error {
+  GTMZlibCompressionOptions *options = [GTMZlibCompressionOptions defaultOptions];
+  [options setCompressionLevel:level];
+  return [self initWithFormat:format options:options error:error];
+}
+
+- (instancetype)initWithFormat:(GTMZlibStreamFormat)format
+                       options:(GTMZlibCompressionOptions *)options
+                         error:(NSError **)error {
+  if ((self = [super init])) {
+    if (format == GTMZlibStreamFormatAutoDetect) {
+      format = GTMZlibStreamFormatZlib;
+    }
+    format_ = format;
+    options_ = options ? [options copy] : [GTMZlibCompressionOptions defaultOptions];
+    if (![self setUpStreamWithOptions:[options_ resolvedOptionsForBytes:NULL length:0]
+                                error:error]) {
+      return nil;  // COV_NF_LINE
+    }
+  }
+  return self;
+}
+
+- (void)dealloc {
+  if (initialized_) {
+    deflateEnd(&strm_);
+  }
+}
+
+- (int)compressionLevel {
+  return [options_ compressionLevel];
+}
+
+// (Re)creates |strm_| for |options|; the window and memory sizes can't be
+// changed on a live stream.
+- (BOOL)setUpStreamWithOptions:(GTMZlibCompressionOptions *)options
+                         error:(NSError **)error {
+  if (initialized_) {
+    deflateEnd(&strm_);
+    initialized_ = NO;
+  }
+  int retCode = deflateInit2(&strm_, [options compressionLevel], Z_DEFLATED,
+                             WindowBitsForFormat(format_, [options windowBits]),
+                             [options memoryLevel],
+                             ZlibStrategy([options strategy]));
+  if (retCode != Z_OK) {
+    // COV_NF_START - no real way to force this in a unittest (we guard all args)
+    if (error) {
+      *error = ZlibError(retCode, strm_.msg);
+    }
+    return NO;
+    // COV_NF_END
+  }
+  initialized_ = YES;
+  needsReset_ = NO;
+  streamOptions_ = options;
+  return YES;
+}
+
+- (NSData *)compressBytes:(const void *)bytes
+                   length:(NSUInteger)length
+               dictionary:(NSData *)dictionary
+                    error:(NSError **)error {
+  InputRegion region = { (const unsigned char *)bytes, length };
+  return [self compressRegions:&region count:1 dictionary:dictionary error:error];
+}
+
+// Compresses the concatenation of |regions| into one stream, handing each to
+// zlib in turn.
+- (NSData *)compressRegions:(const InputRegion *)regions
+                      count:(NSUInteger)count
+                 dictionary:(NSData *)dictionary
+                      error:(NSError **)error {
+  NSUInteger length = 0;
+  NSUInteger firstRegion = 0;
+  for (NSUInteger i = 0; i < count; ++i) {
+    if (!length) {
+      firstRegion = i;
+    }
+    length += regions[i].length;
+  }
+  // An automatic choice goes by the first region with any data in it.
+  GTMZlibCompressionOptions *options =
+      [options_ resolvedOptionsForBytes:count ? regions[firstRegion].bytes : NULL
+                                 length:count ? regions[firstRegion].length : 0];
+  if (options != streamOptions_ && ![options isEqual:streamOptions_] &&
+      ![self setUpStreamWithOptions:options error:error]) {
+    return nil;  // COV_NF_LINE
+  }
+  int retCode;
+  if (needsReset_ && (retCode = deflateReset(&strm_)) != Z_OK) {
+    // COV_NF_START
+    if (error) {
+      *error = ZlibError(retCode, strm_.msg);
+    }
+    return nil;
+    // COV_NF_END
+  }
+  needsReset_ = YES;
+  if ([dictionary length] &&
+      (retCode = SetDeflateDictionary(&strm_, dictionary)) != Z_OK) {
+    // Only fails for gzip, which has no way to record a dictionary.
+    if (error) {
+      *error = ZlibError(retCode, strm_.msg);
+    }
+    return nil;
+  }
+
+  // deflateBound() is the worst case, so normally the output is written in
+  // place in one pass and never needs to grow.
+  uLong bound = deflateBound(&strm_, (uLong)length);
+  NSMutableData *result =
+      [NSMutableData dataWithLength:MAX((NSUInteger)bound, (NSUInteger)kChunkSize)];
+  if (!result) {
+    // COV_NF_START
+    if (error) {
+      *error = ZlibError(Z_MEM_ERROR, NULL);
+    }
+    return nil;
+    // COV_NF_END
+  }
+  NSUInteger produced = 0;
+
+  const unsigned char *input = NULL;
+  NSUInteger inputLeft = 0;
+  NSUInteger nextRegion = 0;
+  strm_.next_in = NULL;
+  strm_.avail_in = 0;
+
+  do {
+    // Move on to the next region once zlib has all of this one.
+    while (strm_.avail_in == 0 && inputLeft == 0 && nextRegion < count) {
+      input = regions[nextRegion].bytes;
+      inputLeft = regions[nextRegion].length;
+      ++nextRegion;
+    }
+    // only finish once the last window of the last region is in
+    RefillInput(&strm_, &input, &inputLeft);
+    BOOL isLastWindow = (inputLeft == 0 && nextRegion == count);
+    if (!PrepareOutput(&strm_, result, produced, NSUIntegerMax)) {
+      // COV_NF_START
+      if (error) {
+        *error = ZlibError(Z_MEM_ERROR, NULL);
+      }
+      return nil;
+      // COV_NF_END
+    }
+    uInt outWindow = strm_.avail_out;
+    retCode = deflate(&strm_, isLastWindow ? Z_FINISH : Z_NO_FLUSH);
+    if ((retCode != Z_OK) && (retCode != Z_STREAM_END)) {
+      // COV_NF_START - an error here would be some internal issue w/in zlib
+      if (error) {
+        *error = ZlibError(retCode, strm_.msg);
+      }
+      return nil;
+      // COV_NF_END
+    }
+    produced += outWindow - strm_.avail_out;
+  } while (retCode == Z_OK);
+  [result setLength:produced];
+
+  _GTMDevAssert(strm_.avail_in == 0 && inputLeft == 0,
+                @"thought we finished deflate w/o using all input, %llu bytes left",
+                (unsigned long long)(strm_.avail_in + inputLeft));
+  return result;
+}
+
+- (NSData *)compressData:(NSData *)data error:(NSError **)error {
+  return [self compressBytes:[data bytes]
+                      length:[data length]
+                  dictionary:nil
+                       error:error];
+}
+
+- (NSData *)compressDataArray:(NSArray *)dataArray error:(NSError **)error {
+  NSMutableData *regions = [NSMutableData data];
+  for (NSData *data in dataArray) {
+    AppendRegionsOfData(regions, data);
+  }
+  return [self compressRegions:[regions bytes]
+                         count:[regions length] / sizeof(InputRegion)
+                    dictionary:nil
+                         error:error];
+}
+
+- (NSData *)compressDispatchData:(dispatch_data_t)data error:(NSError **)error {
+  NSMutableData *regions = [NSMutableData data];
+  AppendRegionsOfDispatchData(regions, data);
+  return [self compressRegions:[regions bytes]
+                         count:[regions length] / sizeof(InputRegion)
+                    dictionary:nil
+                         error:error];
+}
+
++ (NSData *)compressBytes:(const void *)bytes
+                   length:(NSUInteger)length
+                   format:(GTMZlibStreamFormat)format
+         compressionLevel:(int)level
+               dictionary:(NSData *)dictionary
+                    error:(NSError **)error {
+  GTMZlibCompressor *compressor = [self borrowCompressorWithFormat:format
+                                                  compressionLevel:level
+                                                             error:error];
+  NSData *result = [compressor compressBytes:bytes
+                                      length:length
+                                  dictionary:dictionary
+                                       error:error];
+  [compressor returnToPool];
+  return result;
+}
+
++ (NSData *)compressDataArray:(NSArray *)dataArray
+                       format:(GTMZlibStreamFormat)format
+             compressionLevel:(int)level
+                        error:(NSError **)error {
+  GTMZlibCompressor *compressor = [self borrowCompressorWithFormat:format
+                                                  compressionLevel:level
+                                                             error:error];
+  NSData *result = [compressor compressDataArray:dataArray error:error];
+  [compressor returnToPool];
+  return result;
+}
+
++ (NSData *)compressDispatchData:(dispatch_data_t)data
+                          format:(GTMZlibStreamFormat)format
+                compressionLevel:(int)level
+                           error:(NSError **)error {
+  GTMZlibCompressor *compressor = [self borrowCompressorWithFormat:format
+                                                  compressionLevel:level
+                                                             error:error];
+  NSData *result = [compressor compressDispatchData:data error:error];
+  [compressor returnToPool];
+  return result;
+}
+
+// Takes a compressor for |format| and |level| from the pool, or makes one.
+// Hand it back with returnToPool.
++ (GTMZlibCompressor *)borrowCompressorWithFormat:(GTMZlibStreamFormat)format
+                                 compressionLevel:(int)level
+                                            error:(NSError **)error {
+  if (format == GTMZlibStreamFormatAutoDetect) {
+    format = GTMZlibStreamFormatZlib;
+  }
+  level = ClampCompressionLevel(level);
+  GTMZlibCompressor *compressor =
+      BorrowContext(CompressorKey(format, level, GTMZlibCompressionStrategyDefault,
+                                  8, MAX_WBITS));
+  if (!compressor) {
+    compressor = [[self alloc] initWithFormat:format compressionLevel:level error:error];
+  }
+  return compressor;
+}
+
+- (void)returnToPool {
+  GTMZlibCompressionOptions *options = streamOptions_;
+  ReturnContext(self, CompressorKey(format_, [options compressionLevel], [options strategy],
+                                    [options memoryLevel], [options windowBits]));
+}
+
++ (NSData *)compressBytes:(const void *)bytes
+                   length:(NSUInteger)length
+                   format:(GTMZlibStreamFormat)format
+                  options:(GTMZlibCompressionOptions *)options
+               dictionary:(NSData *)dictionary
+                    error:(NSError **)error {
+  if (format == GTMZlibStreamFormatAutoDetect) {
+    format = GTMZlibStreamFormatZlib;
+  }
+  // Pooled compressors are keyed by what they were set up with, so an
+  // automatic choice is made here rather than by the compressor.
+  options = options ? [options resolvedOptionsForBytes:bytes length:length]
+                    : [GTMZlibCompressionOptions defaultOptions];
+  NSNumber *key = CompressorKey(format, [options compressionLevel], [options strategy],
+                                [options memoryLevel], [options windowBits]);
+  GTMZlibCompressor *compressor = BorrowContext(key);
+  if (!compressor) {
+    compressor = [[self alloc] initWithFormat:format options:options error:error];
+    if (!compressor) {
+      return nil;  // COV_NF_LINE
+    }
+  }
+  NSData *result = [compressor compressBytes:bytes
+                                      length:length
+                                  dictionary:dictionary
+                                       error:error];
+  [compressor returnToPool];
+  return result;
+}
+
+@end
+
+@implementation GTMZlibDecompressor {
+  z_stream strm_;
+  BOOL initialized_;
+  BOOL needsReset_;
+}
+
+@synthesize format = format_;
+@synthesize maximumOutputLength = maximumOutputLength_;
+@synthesize maximumCompressionRatio = maximumCompressionRatio_;
+
++ (instancetype)decompressorWithFormat:(GTMZlibStreamFormat)format
+                                 error:(NSError **)error {
+  return [[self alloc] initWithFormat:format error:error];
+}
+
+- (instancetype)initWithFormat:(GTMZlibStreamFormat)format
+                         error:(NSError **)error {
+  if ((self = [super init])) {
+    format_ = format;
+    int retCode = inflateInit2(&strm_, WindowBitsForFormat(format_, MAX_WBITS));
+    if (retCode != Z_OK) {
+      // COV_NF_START - no real way to force this in a unittest (we guard all args)
+      if (error) {
+        *error = ZlibError(retCode, strm_.msg);
+      }
+      return nil;
+      // COV_NF_END
+    }
+    initialized_ = YES;
+  }
+  return self;
+}
+
+- (void)dealloc {
+  if (initialized_) {
+    inflateEnd(&strm_);
+  }
+}
+
+- (NSData *)decompressBytes:(const void *)bytes
+                     length:(NSUInteger)length
+             expectedLength:(NSUInteger)expectedLength
+                 dictionary:(NSData *)dictionary
+                      error:(NSError **)error {
+  int retCode;
+  if (needsReset_ && (retCode = inflateReset(&strm_)) != Z_OK) {
+    // COV_NF_START
+    if (error) {
+      *error = ZlibError(retCode, strm_.msg);
+    }
+    return nil;
+    // COV_NF_END
+  }
+  needsReset_ = YES;
+
+  BOOL isRawData = (format_ == GTMZlibStreamFormatRaw);
+  // A raw stream has no header to ask for the dictionary, so it has to be set
+  // up front; zlib streams ask for it (Z_NEED_DICT) below.
+  if (isRawData && [dictionary length] &&
+      (retCode = SetInflateDictionary(&strm_, dictionary)) != Z_OK) {
+    // COV_NF_START - any dictionary is valid for a raw stream
+    if (error) {
+      *error = ZlibError(retCode, strm_.msg);
+    }
+    return nil;
+    // COV_NF_END
+  }
+
+  const unsigned char *input = (const unsigned char *)bytes;
+  NSUInteger inputLeft = length;
+  strm_.next_in = (Bytef *)input;
+  strm_.avail_in = 0;
+  BOOL isGzip = (format_ == GTMZlibStreamFormatGzip ||
+                 format_ == GTMZlibStreamFormatAutoDetect) &&
+                IsGzipMember(input, length);
+
+  // The output may not go past |limit|; room for one byte more is what tells
+  // a stream that ends right at the limit from one that would go on.
+  NSUInteger limit = NSUIntegerMax;
+  if (maximumOutputLength_) {
+    limit = maximumOutputLength_;
+  }
+  if (maximumCompressionRatio_ && length <= NSUIntegerMax / maximumCompressionRatio_) {
+    limit = MIN(limit, MAX(length * maximumCompressionRatio_, (NSUInteger)1));
+  }
+  NSUInteger maxCapacity = (limit == NSUIntegerMax) ? limit : limit + 1;
+
+  // Size the output from the caller's hint, or the gzip trailer, falling back
+  // to 4x the input size.
+  NSUInteger capacity = expectedLength;
+  if (!capacity && isGzip) {
+    capacity = GzipTrailerLength(input, length);
+  }
+  if (!capacity) {
+    capacity = (length < kMaxGuessedInflateSize / 4) ? length * 4
+                                                      : kMaxGuessedInflateSize;
+  }
+  capacity = MIN(MAX(capacity, (NSUInteger)kChunkSize), maxCapacity);
+  NSMutableData *result = [NSMutableData dataWithLength:capacity];
+  if (!result) {
+    // COV_NF_START
+    if (error) {
+      *error = ZlibError(Z_MEM_ERROR, NULL);
+    }
+    return nil;
+    // COV_NF_END
+  }
+  NSUInteger produced = 0;
+
+  do {
+    RefillInput(&strm_, &input, &inputLeft);
+    if (!PrepareOutput(&strm_, result, produced, maxCapacity)) {
+      // COV_NF_START
+      if (error) {
+        *error = ZlibError(Z_MEM_ERROR, NULL);
+      }
+      return nil;
+      // COV_NF_END
+    }
+    uInt outWindow = strm_.avail_out;
+    retCode = inflate(&strm_, Z_NO_FLUSH);
+    if (retCode == Z_NEED_DICT && [dictionary length]) {
+      // Z_DATA_ERROR here means it isn't the dictionary the data was made with.
+      retCode = SetInflateDictionary(&strm_, dictionary);
+    }
+    if ((retCode != Z_OK) && (retCode != Z_STREAM_END)) {
+      if (error) {
+        *error = ZlibError(retCode, strm_.msg);
+      }
+      return nil;
+    }
+    produced += outWindow - strm_.avail_out;
+    if (produced > limit) {
+      // Stop right away, whatever else the input might hold.
+      if (error) {
+        NSNumber *partialLength = [NSNumber numberWithUnsignedInteger:limit];
+        NSNumber *remaining =
+            [NSNumber numberWithUnsignedInteger:strm_.avail_in + inputLeft];
+        NSDictionary *userInfo =
+            [NSDictionary dictionaryWithObjectsAndKeys:
+                partialLength, GTMNSDataZlibPartialLengthKey,
+                remaining, GTMNSDataZlibRemainingBytesKey,
+                nil];
+        *error = [NSError errorWithDomain:GTMNSDataZlibErrorDomain
+                                     code:GTMNSDataZlibErrorOutputLimitExceeded
+                                 userInfo:userInfo];
+      }
+      return nil;
+    }
+
+    // A gzip file can be a series of members (RFC 1952), each a complete gzip
+    // stream, so keep going if another one follows.
+    if (retCode == Z_STREAM_END && isGzip &&
+        GzipMemberFollows(&strm_, input, inputLeft)) {
+      retCode = inflateReset(&strm_);
+      if (retCode != Z_OK) {
+        // COV_NF_START
+        if (error) {
+          *error = ZlibError(retCode, strm_.msg);
+        }
+        return nil;
+        // COV_NF_END
+      }
+    }
+  } while (retCode == Z_OK);
+  [result setLength:produced];
+
+  // make sure there wasn't more data tacked onto the end of a valid compressed
+  // stream.
+  NSUInteger remaining = strm_.avail_in + inputLeft;
+  if (remaining != 0) {
+    if (error) {
+      NSDictionary *userInfo =
+          [NSDictionary dictionaryWithObject:[NSNumber numberWithUnsignedInteger:remaining]
+                                      forKey:GTMNSDataZlibRemainingBytesKey];
+      *error = [NSError errorWithDomain:GTMNSDataZlibErrorDomain
+                                   code:GTMNSDataZlibErrorDataRemaining
+                               userInfo:userInfo];
+    }
+    return nil;
+  }
+  return result;
+}
+
+- (NSData *)decompressData:(NSData *)data error:(NSError **)error {
+  return [self decompressBytes:[data bytes]
+                        length:[data length]
+                expectedLength:0
+                    dictionary:nil
+                         error:error];
+}
+
++ (NSData *)decompressBytes:(const void *)bytes
+                     length:(NSUInteger)length
+                     format:(GTMZlibStreamFormat)format
+             expectedLength:(NSUInteger)expectedLength
+                 dictionary:(NSData *)dictionary
+                      error:(NSError **)error {
+  return [self decompressBytes:bytes
+                        length:length
+                        format:format
+                expectedLength:expectedLength
+           maximumOutputLength:0
+       maximumCompressionRatio:0
+                    dictionary:dictionary
+                         error:error];
+}
+
++ (NSData *)decompressBytes:(const void *)bytes
+                     length:(NSUInteger)length
+                     format:(GTMZlibStreamFormat)format
+             expectedLength:(NSUInteger)expectedLength
+        maximumOutputLength:(NSUInteger)maximumOutputLength
+    maximumCompressionRatio:(NSUInteger)maximumCompressionRatio
+                 dictionary:(NSData *)dictionary
+                      error:(NSError **)error {
+  // Kept apart from the compressor keys.
+  NSNumber *key = [NSNumber numberWithInteger:(1 << 24) | format];
+  GTMZlibDecompressor *decompressor = BorrowContext(key);
+  if (!decompressor) {
+    decompressor = [[self alloc] initWithFormat:format error:error];
+    if (!decompressor) {
+      return nil;  // COV_NF_LINE
+    }
+  }
+  [decompressor setMaximumOutputLength:maximumOutputLength];
+  [decompressor setMaximumCompressionRatio:maximumCompressionRatio];
+  NSData *result = [decompressor decompressBytes:bytes
+                                          length:length
+                                  expectedLength:expectedLength
+                                      dictionary:dictionary
+                                           error:error];
+  ReturnContext(decompressor, key);
+  return result;
+}
+
+@end
+
+#pragma mark -
+
+// Every sync flush ends with an empty stored block, whose length fields are
+// these four bytes; the message framing leaves them off.
+static const unsigned char kSyncFlushMarker[] = { 0x00, 0x00, 0xff, 0xff };
+
+// An empty stored block without the marker: what an empty message compresses
+// to (RFC 7692 7.2.3.6). It is valid at any point between messages.
+static const unsigned char kEmptyMessage[] = { 0x00 };
+
+@implementation GTMZlibMessageCompressor {
+  z_stream strm_;
+  BOOL initialized_;
+  BOOL needsReset_;
+}
+
+@synthesize compressionLevel = compressionLevel_;
+@synthesize contextTakeover = contextTakeover_;
+
++ (instancetype)compressorWithCompressionLevel:(int)level
+                                         error:(NSError **)error {
+  return [[self alloc] initWithCompressionLevel:level
+                                contextTakeover:YES
+                                          error:error];
+}
+
+- (instancetype)initWithCompressionLevel:(int)level
+                         contextTakeover:(BOOL)contextTakeover
+                                   error:(NSError **)error {
+  if ((self = [super init])) {
+    compressionLevel_ = ClampCompressionLevel(level);
+    contextTakeover_ = contextTakeover;
+    int retCode = deflateInit2(&strm_, compressionLevel_, Z_DEFLATED,
+                               WindowBitsForFormat(GTMZlibStreamFormatRaw, MAX_WBITS), 8,
+                               Z_DEFAULT_STRATEGY);
+    if (retCode != Z_OK) {
+      // COV_NF_START - no real way to force this in a unittest (we guard all args)
+      if (error) {
+        *error = ZlibError(retCode, strm_.msg);
+      }
+      return nil;
+      // COV_NF_END
+    }
+    initialized_ = YES;
+  }
+  return self;
+}
+
+- (void)dealloc {
+  if (initialized_) {
+    deflateEnd(&strm_);
+  }
+}
+
+- (NSData *)compressMessageBytes:(const void *)bytes
+                          length:(NSUInteger)length
+                           error:(NSError **)error {
+  if (length == 0) {
+    // A second sync flush in a row has nothing to output, so zlib would refuse
+    // it; the empty block is the same whatever the window holds.
+    return [NSData dataWithBytes:kEmptyMessage length:sizeof(kEmptyMessage)];
+  }
+  int retCode;
+  if (needsReset_ && (retCode = deflateReset(&strm_)) != Z_OK) {
+    // COV_NF_START
+    if (error) {
+      *error = ZlibError(retCode, strm_.msg);
+    }
+    return nil;
+    // COV_NF_END
+  }
+  // Without context takeover each message starts over.
+  needsReset_ = !contextTakeover_;
+
+  // deflateBound() covers a finished stream, which is about what a flushed
+  // one takes too, so the output rarely has to grow.
+  uLong bound = deflateBound(&strm_, (uLong)length);
+  NSMutableData *result =
+      [NSMutableData dataWithLength:MAX((NSUInteger)bound, (NSUInteger)kChunkSize)];
+  if (!result) {
+    // COV_NF_START
+    if (error) {
+      *error = ZlibError(Z_MEM_ERROR, NULL);
+    }
+    return nil;
+    // COV_NF_END
+  }
+  NSUInteger produced = 0;
+
+  const unsigned char *input = (const unsigned char *)bytes;
+  NSUInteger inputLeft = length;
+  strm_.next_in = (Bytef *)input;
+  strm_.avail_in = 0;
+
+  do {
+    // only flush once the last window is in
+    RefillInput(&strm_, &input, &inputLeft);
+    if (!PrepareOutput(&strm_, result, produced, NSUIntegerMax)) {
+      // COV_NF_START
+      needsReset_ = YES;
+      if (error) {
+        *error = ZlibError(Z_MEM_ERROR, NULL);
+      }
+      return nil;
+      // COV_NF_END
+    }
+    uInt outWindow = strm_.avail_out;
+    retCode = deflate(&strm_, (inputLeft == 0) ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+    if (retCode == Z_BUF_ERROR) {
+      // The flush was all out already, there's nothing more to do.
+      break;
+    }
+    if (retCode != Z_OK) {
+      // COV_NF_START - an error here would be some internal issue w/in zlib
+      needsReset_ = YES;
+      if (error) {
+        *error = ZlibError(retCode, strm_.msg);
+      }
+      return nil;
+      // COV_NF_END
+    }
+    produced += outWindow - strm_.avail_out;
+    // A flush is complete once zlib stops filling all the room it was given.
+  } while (inputLeft > 0 || strm_.avail_in > 0 || strm_.avail_out == 0);
+
+  _GTMDevAssert(produced >= sizeof(kSyncFlushMarker) &&
+                    memcmp((const unsigned char *)[result bytes] + produced -
+                               sizeof(kSyncFlushMarker),
+                           kSyncFlushMarker, sizeof(kSyncFlushMarker)) == 0,
+                @"sync flush didn't end with the marker");
+  [result setLength:produced - sizeof(kSyncFlushMarker)];
+  return result;
+}
+
+- (NSData *)compressMessage:(NSData *)message error:(NSError **)error {
+  return [self compressMessageBytes:[message bytes]
+                             length:[message length]
+                              error:error];
+}
+
+@end
+
+@implementation GTMZlibMessageDecompressor {
+  z_stream strm_;
+  BOOL initialized_;
+  BOOL needsReset_;
+}
+
+@synthesize contextTakeover = contextTakeover_;
+@synthesize maximumMessageLength = maximumMessageLength_;
+
++ (instancetype)decompressorWithError:(NSError **)error {
+  return [[self alloc] initWithContextTakeover:YES error:error];
+}
+
+- (instancetype)initWithContextTakeover:(BOOL)contextTakeover
+                                  error:(NSError **)error {
+  if ((self = [super init])) {
+    contextTakeover_ = contextTakeover;
+    int retCode = inflateInit2(&strm_, WindowBitsForFormat(GTMZlibStreamFormatRaw, MAX_WBITS));
+    if (retCode != Z_OK) {
+      // COV_NF_START - no real way to force this in a unittest (we guard all args)
+      if (error) {
+        *error = ZlibError(retCode, strm_.msg);
+      }
+      return nil;
+      // COV_NF_END
+    }
+    initialized_ = YES;
+  }
+  return self;
+}
+
+- (void)dealloc {
+  if (initialized_) {
+    inflateEnd(&strm_);
+  }
+}
+
+- (NSData *)decompressMessageBytes:(const void *)bytes
+                            length:(NSUInteger)length
+                             error:(NSError **)error {
+  int retCode;
+  if (needsReset_ && (retCode = inflateReset(&strm_)) != Z_OK) {
+    // COV_NF_START
+    if (error) {
+      *error = ZlibError(retCode, strm_.msg);
+    }
+    return nil;
+    // COV_NF_END
+  }
+  // Any failure below leaves the window unusable, so start over next time
+  // unless the message decodes.
+  needsReset_ = YES;
+
+  NSUInteger limit = maximumMessageLength_ ? maximumMessageLength_ : NSUIntegerMax;
+  NSUInteger maxCapacity = (limit == NSUIntegerMax) ? limit : limit + 1;
+  NSUInteger capacity = (length < kMaxGuessedInflateSize / 4) ? length * 4
+                                                               : kMaxGuessedInflateSize;
+  capacity = MIN(MAX(capacity, (NSUInteger)kChunkSize), maxCapacity);
+  NSMutableData *result = [NSMutableData dataWithLength:capacity];
+  if (!result) {
+    // COV_NF_START
+    if (error) {
+      *error = ZlibError(Z_MEM_ERROR, NULL);
+    }
+    return nil;
+    // COV_NF_END
+  }
+  NSUInteger produced = 0;
+
+  const unsigned char *input = (const unsigned char *)bytes;
+  NSUInteger inputLeft = length;
+  strm_.next_in = (Bytef *)input;
+  strm_.avail_in = 0;
+  BOOL markerIn = NO;
+  BOOL streamEnded = NO;
+
+  do {
+    RefillInput(&strm_, &input, &inputLeft);
+    if (strm_.avail_in == 0 && inputLeft == 0 && !markerIn) {
+      // The message is all in, put back the end of its sync flush.
+      strm_.next_in = (Bytef *)kSyncFlushMarker;
+      strm_.avail_in = sizeof(kSyncFlushMarker);
+      markerIn = YES;
+    }
+    if (!PrepareOutput(&strm_, result, produced, maxCapacity)) {
+      // COV_NF_START
+      if (error) {
+        *error = ZlibError(Z_MEM_ERROR, NULL);
+      }
+      return nil;
+      // COV_NF_END
+    }
+    uInt outWindow = strm_.avail_out;
+    retCode = inflate(&strm_, Z_SYNC_FLUSH);
+    if (retCode == Z_BUF_ERROR && markerIn && strm_.avail_in == 0) {
+      // Everything is in and out.
+      break;
+    }
+    if ((retCode != Z_OK) && (retCode != Z_STREAM_END)) {
+      if (error) {
+        *error = ZlibError(retCode, strm_.msg);
+      }
+      return nil;
+    }
+    produced += outWindow - strm_.avail_out;
+    if (produced > limit) {
+      if (error) {
+        NSNumber *partialLength = [NSNumber numberWithUnsignedInteger:limit];
+        NSUInteger unused = markerIn ? 0 : strm_.avail_in + inputLeft;
+        NSNumber *remaining = [NSNumber numberWithUnsignedInteger:unused];
+        NSDictionary *userInfo =
+            [NSDictionary dictionaryWithObjectsAndKeys:
+                partialLength, GTMNSDataZlibPartialLengthKey,
+                remaining, GTMNSDataZlibRemainingBytesKey,
+                nil];
+        *error = [NSError errorWithDomain:GTMNSDataZlibErrorDomain
+                                     code:GTMNSDataZlibErrorOutputLimitExceeded
+                                 userInfo:userInfo];
+      }
+      return nil;
+    }
+    streamEnded = (retCode == Z_STREAM_END);
+  } while (!streamEnded &&
+           !(markerIn && strm_.avail_in == 0 && strm_.avail_out != 0));
+  [result setLength:produced];
+
+  if (streamEnded && !markerIn) {
+    // Only the marker may follow a final block.
+    NSUInteger remaining = strm_.avail_in + inputLeft;
+    if (remaining != 0) {
+      if (error) {
+        NSDictionary *userInfo =
+            [NSDictionary dictionaryWithObject:[NSNumber numberWithUnsignedInteger:remaining]
+                                        forKey:GTMNSDataZlibRemainingBytesKey];
+        *error = [NSError errorWithDomain:GTMNSDataZlibErrorDomain
+                                     code:GTMNSDataZlibErrorDataRemaining
+                                 userInfo:userInfo];
+      }
+      return nil;
+    }
+  }
+  // A finished stream can't take another message, so that starts over too.
+  needsReset_ = streamEnded || !contextTakeover_;
+  return result;
+}
+
+- (NSData *)decompressMessage:(NSData *)message error:(NSError **)error {
+  return [self decompressMessageBytes:[message bytes]
+                               length:[message length]
+                                error:error];
+}
+
+@end
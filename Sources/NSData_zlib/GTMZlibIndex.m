@@ -0,0 +1,522 @@
+//
+//  GTMZlibIndex.m
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#if !__has_feature(objc_arc)
+#error "This file needs to be compiled with ARC enabled."
+#endif
+
+#import "GTMZlibIndex.h"
+#import <zlib.h>
+#import "GTMNSData+zlib.h"
+#import "GTMZlibInternal.h"
+
+// How far back deflate can refer, and so how much history a point keeps.
+#define kWindowSize 32768
+
+static const NSUInteger kDefaultSpanSize = 1024 * 1024;
+
+// Serialized form, all little-endian:
+//   "GTMZIDX" 0x01, format (1), reserved (3), point count (4),
+//   compressed length (8), uncompressed length (8)
+// then for each point:
+//   compressed offset (8), uncompressed offset (8), bits (1),
+//   window length (2), packed window length (4), raw deflated window.
+static const unsigned char kSerializedMagic[8] = { 'G', 'T', 'M', 'Z', 'I', 'D', 'X', 0x01 };
+#define kSerializedHeaderSize 32
+#define kSerializedPointSize 23
+
+typedef struct {
+  uint64_t in;     // Offset of the first full byte in the compressed data.
+  uint64_t out;    // Offset in the uncompressed data.
+  int bits;        // Bits of the byte before |in| that belong to the point.
+  unsigned char *window;  // Output before |out|, up to kWindowSize.
+  uInt windowLength;
+} GTMZlibAccessPoint;
+
+GTM_INLINE uint64_t ReadLittleEndian(const unsigned char *bytes, int size) {
+  uint64_t value = 0;
+  for (int i = size - 1; i >= 0; --i) {
+    value = (value << 8) | bytes[i];
+  }
+  return value;
+}
+
+static void AppendLittleEndian(NSMutableData *data, uint64_t value, int size) {
+  unsigned char bytes[8];
+  for (int i = 0; i < size; ++i) {
+    bytes[i] = (unsigned char)((value >> (8 * i)) & 0xff);
+  }
+  [data appendBytes:bytes length:size];
+}
+
+@implementation GTMZlibIndex {
+  GTMZlibAccessPoint *points_;
+  NSUInteger pointCount_;
+}
+
+@synthesize format = format_;
+@synthesize compressedLength = compressedLength_;
+@synthesize uncompressedLength = uncompressedLength_;
+
+- (instancetype)initWithFormat:(GTMZlibStreamFormat)format {
+  if ((self = [super init])) {
+    format_ = format;
+  }
+  return self;
+}
+
+- (void)dealloc {
+  for (NSUInteger i = 0; i < pointCount_; ++i) {
+    free(points_[i].window);
+  }
+  free(points_);
+}
+
+- (NSUInteger)accessPointCount {
+  return pointCount_;
+}
+
+// Adds a point, taking ownership of |window|. Returns NO if out of memory.
+- (BOOL)addPointWithIn:(uint64_t)in
+                   out:(uint64_t)out
+                  bits:(int)bits
+                window:(unsigned char *)window
+          windowLength:(uInt)windowLength {
+  if ((pointCount_ & (pointCount_ - 1)) == 0) {
+    // Grow at each power of two.
+    NSUInteger capacity = MAX(pointCount_ * 2, (NSUInteger)8);
+    GTMZlibAccessPoint *points =
+        (GTMZlibAccessPoint *)realloc(points_, capacity * sizeof(GTMZlibAccessPoint));
+    if (!points) {
+      // COV_NF_START
+      free(window);
+      return NO;
+      // COV_NF_END
+    }
+    points_ = points;
+  }
+  GTMZlibAccessPoint *point = &points_[pointCount_++];
+  point->in = in;
+  point->out = out;
+  point->bits = bits;
+  point->window = window;
+  point->windowLength = windowLength;
+  return YES;
+}
+
++ (instancetype)indexWithData:(NSData *)data
+                       format:(GTMZlibStreamFormat)format
+                     spanSize:(NSUInteger)spanSize
+                        error:(NSError **)error {
+  const unsigned char *bytes = (const unsigned char *)[data bytes];
+  uint64_t length = [data length];
+  if (format == GTMZlibStreamFormatAutoDetect) {
+    format = IsGzipMember(bytes, (NSUInteger)length) ? GTMZlibStreamFormatGzip
+                                                     : GTMZlibStreamFormatZlib;
+  }
+  if (!spanSize) {
+    spanSize = kDefaultSpanSize;
+  }
+
+  GTMZlibIndex *index = [[self alloc] initWithFormat:format];
+  index->compressedLength_ = length;
+
+  z_stream strm;
+  bzero(&strm, sizeof(z_stream));
+  int retCode = inflateInit2(&strm, WindowBitsForFormat(format, MAX_WBITS));
+  if (retCode != Z_OK) {
+    // COV_NF_START - no real way to force this in a unittest (we guard all args)
+    if (error) {
+      *error = ZlibError(retCode, strm.msg);
+    }
+    return nil;
+    // COV_NF_END
+  }
+
+  // Inflate everything into a circular window, stopping at each deflate block
+  // boundary to see if it's time for another point.
+  unsigned char window[kWindowSize];
+  if (format == GTMZlibStreamFormatRaw) {
+    // With no header inflate doesn't stop before the first block, but the
+    // start of the data is a fine point to begin from.
+    [index addPointWithIn:0 out:0 bits:0 window:NULL windowLength:0];
+  }
+  const unsigned char *input = bytes;
+  NSUInteger inputLeft = (NSUInteger)length;
+  uint64_t totalIn = 0;
+  uint64_t totalOut = 0;
+  uint64_t lastPoint = 0;
+  strm.avail_out = 0;
+  while (YES) {
+    if (strm.avail_out == 0) {
+      strm.next_out = window;
+      strm.avail_out = kWindowSize;
+    }
+    RefillInput(&strm, &input, &inputLeft);
+    uInt inBefore = strm.avail_in;
+    uInt outBefore = strm.avail_out;
+    retCode = inflate(&strm, Z_BLOCK);
+    totalIn += inBefore - strm.avail_in;
+    totalOut += outBefore - strm.avail_out;
+    if (retCode == Z_NEED_DICT) {
+      retCode = Z_DATA_ERROR;
+    }
+    if (retCode != Z_OK && retCode != Z_STREAM_END) {
+      // Z_BUF_ERROR means the data ended early.
+      if (error) {
+        *error = ZlibError(retCode, strm.msg);
+      }
+      inflateEnd(&strm);
+      return nil;
+    }
+    if (retCode == Z_STREAM_END) {
+      if (format == GTMZlibStreamFormatGzip && totalIn + 2 <= length &&
+          IsGzipMember(bytes + totalIn, 2)) {
+        // Another member follows.
+        inflateReset(&strm);
+        continue;
+      }
+      break;
+    }
+
+    // bit 128: at the end of a block header, bit 64: it was the last block.
+    BOOL atBlockBoundary = (strm.data_type & 128) && !(strm.data_type & 64);
+    if (atBlockBoundary &&
+        (index->pointCount_ == 0 || totalOut - lastPoint >= spanSize)) {
+      uInt windowLength = (uInt)MIN(totalOut, (uint64_t)kWindowSize);
+      unsigned char *pointWindow = NULL;
+      if (windowLength) {
+        pointWindow = (unsigned char *)malloc(windowLength);
+        if (!pointWindow) {
+          // COV_NF_START
+          if (error) {
+            *error = ZlibError(Z_MEM_ERROR, NULL);
+          }
+          inflateEnd(&strm);
+          return nil;
+          // COV_NF_END
+        }
+        if (totalOut < kWindowSize) {
+          // Hasn't wrapped yet.
+          memcpy(pointWindow, window, windowLength);
+        } else {
+          // Oldest output is just past what's been written this time around.
+          uInt used = kWindowSize - strm.avail_out;
+          memcpy(pointWindow, window + used, strm.avail_out);
+          memcpy(pointWindow + strm.avail_out, window, used);
+        }
+      }
+      if (![index addPointWithIn:totalIn
+                             out:totalOut
+                            bits:strm.data_type & 7
+                          window:pointWindow
+                    windowLength:windowLength]) {
+        // COV_NF_START
+        if (error) {
+          *error = ZlibError(Z_MEM_ERROR, NULL);
+        }
+        inflateEnd(&strm);
+        return nil;
+        // COV_NF_END
+      }
+      lastPoint = totalOut;
+    }
+  }
+  inflateEnd(&strm);
+
+  if (totalIn != length) {
+    if (error) {
+      NSDictionary *userInfo =
+          [NSDictionary dictionaryWithObject:[NSNumber numberWithUnsignedLongLong:length - totalIn]
+                                      forKey:GTMNSDataZlibRemainingBytesKey];
+      *error = [NSError errorWithDomain:GTMNSDataZlibErrorDomain
+                                   code:GTMNSDataZlibErrorDataRemaining
+                               userInfo:userInfo];
+    }
+    return nil;
+  }
+  index->uncompressedLength_ = totalOut;
+  return index;
+}
+
++ (instancetype)indexWithSerializedData:(NSData *)serializedData
+                                  error:(NSError **)error {
+  const unsigned char *bytes = (const unsigned char *)[serializedData bytes];
+  NSUInteger length = [serializedData length];
+  NSError *badIndex = ZlibError(Z_DATA_ERROR, "invalid index");
+  if (length < kSerializedHeaderSize ||
+      memcmp(bytes, kSerializedMagic, sizeof(kSerializedMagic)) != 0 ||
+      bytes[8] > GTMZlibStreamFormatRaw) {
+    if (error) {
+      *error = badIndex;
+    }
+    return nil;
+  }
+
+  GTMZlibIndex *index = [[self alloc] initWithFormat:(GTMZlibStreamFormat)bytes[8]];
+  NSUInteger pointCount = (NSUInteger)ReadLittleEndian(bytes + 12, 4);
+  index->compressedLength_ = ReadLittleEndian(bytes + 16, 8);
+  index->uncompressedLength_ = ReadLittleEndian(bytes + 24, 8);
+
+  NSUInteger offset = kSerializedHeaderSize;
+  uint64_t lastOut = 0;
+  for (NSUInteger i = 0; i < pointCount; ++i) {
+    if (length - offset < kSerializedPointSize) {
+      if (error) {
+        *error = badIndex;
+      }
+      return nil;
+    }
+    const unsigned char *point = bytes + offset;
+    uint64_t in = ReadLittleEndian(point, 8);
+    uint64_t out = ReadLittleEndian(point + 8, 8);
+    int bits = point[16];
+    uInt windowLength = (uInt)ReadLittleEndian(point + 17, 2);
+    NSUInteger packedLength = (NSUInteger)ReadLittleEndian(point + 19, 4);
+    offset += kSerializedPointSize;
+    if (bits > 7 || (bits && in == 0) || windowLength > kWindowSize || out < lastOut ||
+        out > index->uncompressedLength_ || in > index->compressedLength_ ||
+        packedLength > length - offset) {
+      if (error) {
+        *error = badIndex;
+      }
+      return nil;
+    }
+    lastOut = out;
+
+    unsigned char *window = NULL;
+    if (windowLength) {
+      window = (unsigned char *)malloc(windowLength);
+      if (!window) {
+        // COV_NF_START
+        if (error) {
+          *error = ZlibError(Z_MEM_ERROR, NULL);
+        }
+        return nil;
+        // COV_NF_END
+      }
+      z_stream strm;
+      bzero(&strm, sizeof(z_stream));
+      int retCode = inflateInit2(&strm, -15);
+      if (retCode == Z_OK) {
+        strm.next_in = (Bytef *)bytes + offset;
+        strm.avail_in = (uInt)packedLength;
+        strm.next_out = window;
+        strm.avail_out = windowLength;
+        retCode = inflate(&strm, Z_FINISH);
+        if (retCode == Z_STREAM_END && (strm.avail_out || strm.avail_in)) {
+          retCode = Z_DATA_ERROR;
+        }
+        inflateEnd(&strm);
+      }
+      if (retCode != Z_STREAM_END) {
+        free(window);
+        if (error) {
+          *error = badIndex;
+        }
+        return nil;
+      }
+    }
+    offset += packedLength;
+    if (![index addPointWithIn:in
+                           out:out
+                          bits:bits
+                        window:window
+                  windowLength:windowLength]) {
+      // COV_NF_START
+      if (error) {
+        *error = ZlibError(Z_MEM_ERROR, NULL);
+      }
+      return nil;
+      // COV_NF_END
+    }
+  }
+  if (offset != length) {
+    if (error) {
+      *error = badIndex;
+    }
+    return nil;
+  }
+  return index;
+}
+
+- (NSData *)serializedData {
+  NSMutableData *result = [NSMutableData dataWithBytes:kSerializedMagic
+                                                length:sizeof(kSerializedMagic)];
+  AppendLittleEndian(result, (uint64_t)format_, 1);
+  AppendLittleEndian(result, 0, 3);
+  AppendLittleEndian(result, pointCount_, 4);
+  AppendLittleEndian(result, compressedLength_, 8);
+  AppendLittleEndian(result, uncompressedLength_, 8);
+
+  unsigned char packed[kWindowSize + 64];
+  z_stream strm;
+  bzero(&strm, sizeof(z_stream));
+  int retCode = deflateInit2(&strm, Z_BEST_COMPRESSION, Z_DEFLATED, -15, 8,
+                             Z_DEFAULT_STRATEGY);
+  _GTMDevAssert(retCode == Z_OK, @"deflateInit2 failed %d", retCode);
+  for (NSUInteger i = 0; i < pointCount_; ++i) {
+    const GTMZlibAccessPoint *point = &points_[i];
+    uInt packedLength = 0;
+    if (point->windowLength) {
+      strm.next_in = point->window;
+      strm.avail_in = point->windowLength;
+      strm.next_out = packed;
+      strm.avail_out = (uInt)sizeof(packed);
+      retCode = deflate(&strm, Z_FINISH);
+      _GTMDevAssert(retCode == Z_STREAM_END, @"deflate of window failed %d", retCode);
+      packedLength = (uInt)sizeof(packed) - strm.avail_out;
+      deflateReset(&strm);
+    }
+    AppendLittleEndian(result, point->in, 8);
+    AppendLittleEndian(result, point->out, 8);
+    AppendLittleEndian(result, (uint64_t)point->bits, 1);
+    AppendLittleEndian(result, point->windowLength, 2);
+    AppendLittleEndian(result, packedLength, 4);
+    [result appendBytes:packed length:packedLength];
+  }
+  deflateEnd(&strm);
+  return result;
+}
+
+- (NSData *)readRange:(NSRange)range
+             fromData:(NSData *)data
+                error:(NSError **)error {
+  if ([data length] != compressedLength_) {
+    if (error) {
+      *error = ZlibError(Z_DATA_ERROR, "data doesn't match the index");
+    }
+    return nil;
+  }
+  uint64_t offset = range.location;
+  if (offset >= uncompressedLength_ || !range.length || !pointCount_) {
+    return [NSData data];
+  }
+  NSUInteger wanted = (NSUInteger)MIN((uint64_t)range.length,
+                                      uncompressedLength_ - offset);
+
+  // Last point at or before |offset|.
+  NSUInteger low = 0;
+  NSUInteger high = pointCount_;
+  while (high - low > 1) {
+    NSUInteger middle = low + (high - low) / 2;
+    if (points_[middle].out <= offset) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+  const GTMZlibAccessPoint *point = &points_[low];
+
+  const unsigned char *bytes = (const unsigned char *)[data bytes];
+  uint64_t length = compressedLength_;
+  z_stream strm;
+  bzero(&strm, sizeof(z_stream));
+  // Points are inside the raw data.
+  int retCode = inflateInit2(&strm, WindowBitsForFormat(GTMZlibStreamFormatRaw, MAX_WBITS));
+  if (retCode != Z_OK) {
+    // COV_NF_START - no real way to force this in a unittest (we guard all args)
+    if (error) {
+      *error = ZlibError(retCode, strm.msg);
+    }
+    return nil;
+    // COV_NF_END
+  }
+  const unsigned char *input = bytes + point->in;
+  NSUInteger inputLeft = (NSUInteger)(length - point->in);
+  if (point->bits) {
+    retCode = inflatePrime(&strm, point->bits, input[-1] >> (8 - point->bits));
+  }
+  if (retCode == Z_OK && point->windowLength) {
+    retCode = inflateSetDictionary(&strm, point->window, point->windowLength);
+  }
+  if (retCode != Z_OK) {
+    // COV_NF_START
+    if (error) {
+      *error = ZlibError(retCode, strm.msg);
+    }
+    inflateEnd(&strm);
+    return nil;
+    // COV_NF_END
+  }
+
+  NSMutableData *result = [NSMutableData dataWithLength:wanted];
+  unsigned char *output = (unsigned char *)[result mutableBytes];
+  unsigned char discard[kWindowSize];
+  uint64_t skip = offset - point->out;
+  NSUInteger produced = 0;
+  BOOL raw = YES;
+  while (produced < wanted) {
+    uInt outWindow;
+    if (skip) {
+      outWindow = (uInt)MIN(skip, (uint64_t)sizeof(discard));
+      strm.next_out = discard;
+    } else {
+      outWindow = (uInt)MIN(wanted - produced, kMaxZlibWindow);
+      strm.next_out = output + produced;
+    }
+    strm.avail_out = outWindow;
+    RefillInput(&strm, &input, &inputLeft);
+    retCode = inflate(&strm, Z_NO_FLUSH);
+    uInt got = outWindow - strm.avail_out;
+    if (skip) {
+      skip -= got;
+    } else {
+      produced += got;
+    }
+    if (retCode == Z_NEED_DICT) {
+      retCode = Z_DATA_ERROR;
+    }
+    if (retCode != Z_OK && retCode != Z_STREAM_END) {
+      if (error) {
+        *error = ZlibError(retCode, strm.msg);
+      }
+      inflateEnd(&strm);
+      return nil;
+    }
+    if (retCode == Z_STREAM_END) {
+      // Into the next gzip member, if there is one. Starting from a point
+      // zlib was reading raw deflate, so it left the trailer.
+      uint64_t consumed = (uint64_t)(input - bytes) - strm.avail_in;
+      if (raw) {
+        consumed += 8;
+      }
+      if (format_ != GTMZlibStreamFormatGzip || consumed + 2 > length ||
+          !IsGzipMember(bytes + consumed, 2)) {
+        break;
+      }
+      input = bytes + consumed;
+      inputLeft = (NSUInteger)(length - consumed);
+      strm.avail_in = 0;
+      raw = NO;
+      inflateReset2(&strm, WindowBitsForFormat(GTMZlibStreamFormatGzip, MAX_WBITS));
+    }
+  }
+  inflateEnd(&strm);
+
+  if (produced != wanted) {
+    // The data ended before the index said it would.
+    if (error) {
+      *error = ZlibError(Z_BUF_ERROR, NULL);
+    }
+    return nil;
+  }
+  return result;
+}
+
+@end
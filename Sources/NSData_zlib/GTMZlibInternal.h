@@ -0,0 +1,111 @@
+//
+//  GTMZlibInternal.h
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+// Helpers shared by the NSData_zlib sources. Not part of the public api.
+
+#import <Foundation/Foundation.h>
+#import <zlib.h>
+#import "GTMDefines.h"
+#import "GTMNSData+zlib.h"
+#import "GTMZlibStream.h"
+
+// zlib tracks input and output with a uInt, so buffers larger than this are
+// handed to it one window at a time.
+static const NSUInteger kMaxZlibWindow = UINT_MAX;
+
+// deflate can't do better than roughly 1032:1, so anything claiming more is
+// bogus and not worth reserving memory for.
+#define kMaxDeflateRatio 1032
+
+// A GTMNSDataZlibErrorInternal error for |retCode|, with zlib's |msg| (if
+// any) as the description.
+GTM_INLINE NSError *ZlibError(int retCode, const char *msg) {
+  NSMutableDictionary *userInfo =
+      [NSMutableDictionary dictionaryWithObject:[NSNumber numberWithInt:retCode]
+                                         forKey:GTMNSDataZlibErrorKey];
+  if (msg) {
+    NSString *message = [NSString stringWithUTF8String:msg];
+    if (message) {
+      [userInfo setObject:message forKey:NSLocalizedDescriptionKey];
+    }
+  }
+  return [NSError errorWithDomain:GTMNSDataZlibErrorDomain
+                             code:GTMNSDataZlibErrorInternal
+                         userInfo:userInfo];
+}
+
+GTM_INLINE int ClampCompressionLevel(int level) {
+  if (level == Z_DEFAULT_COMPRESSION) {
+    // the default value is actually outside the range, so we have to let it
+    // through specifically.
+  } else if (level < Z_BEST_SPEED) {
+    level = Z_BEST_SPEED;
+  } else if (level > Z_BEST_COMPRESSION) {
+    level = Z_BEST_COMPRESSION;
+  }
+  return level;
+}
+
+GTM_INLINE BOOL IsGzipMember(const unsigned char *bytes, NSUInteger length) {
+  return length >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b;
+}
+
+// The windowBits argument for deflateInit2/inflateInit2 to get |format|.
+// |windowBits| is the log2 of the window size, normally MAX_WBITS.
+// GTMZlibStreamFormatAutoDetect only means something to inflate.
+GTM_INLINE int WindowBitsForFormat(GTMZlibStreamFormat format, int windowBits) {
+  switch (format) {
+    case GTMZlibStreamFormatZlib:
+      break;
+    case GTMZlibStreamFormatGzip:
+      windowBits += 16;  // gzip header instead of zlib header
+      break;
+    case GTMZlibStreamFormatRaw:
+      windowBits *= -1;  // Negative to mean no header.
+      break;
+    case GTMZlibStreamFormatAutoDetect:
+      windowBits += 32;  // zlib or gzip header detection (inflate only).
+      break;
+  }
+  return windowBits;
+}
+
+// Refills |strm|'s input from |*input|/|*inputLeft| once zlib has used up the
+// current window.
+GTM_INLINE void RefillInput(z_stream *strm, const unsigned char **input,
+                            NSUInteger *inputLeft) {
+  if (strm->avail_in == 0 && *inputLeft > 0) {
+    uInt window = (uInt)MIN(*inputLeft, kMaxZlibWindow);
+    strm->next_in = (Bytef *)*input;
+    strm->avail_in = window;
+    *input += window;
+    *inputLeft -= window;
+  }
+}
+
+// Same for the output, from |*output|/|*outputLeft|.
+GTM_INLINE void RefillOutput(z_stream *strm, unsigned char **output,
+                             NSUInteger *outputLeft) {
+  if (strm->avail_out == 0 && *outputLeft > 0) {
+    uInt window = (uInt)MIN(*outputLeft, kMaxZlibWindow);
+    strm->next_out = *output;
+    strm->avail_out = window;
+    *output += window;
+    *outputLeft -= window;
+  }
+}
@@ -0,0 +1,454 @@
+//
+//  GTMZlibStream.m
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#if !__has_feature(objc_arc)
+#error "This file needs to be compiled with ARC enabled."
+#endif
+
+#import "GTMZlibStream.h"
+#import <zlib.h>
+#import "GTMNSData+zlib.h"
+#import "GTMZlibInternal.h"
+
+static const NSUInteger kDefaultOutputChunkSize = 64 * 1024;
+
+// With a throughput target, the level is reconsidered after this much input.
+static const NSUInteger kAdaptiveSliceLength = 256 * 1024;
+// Only go up a level nobody has timed yet when this far ahead of the target.
+static const double kHeadroomToRaiseLevel = 1.5;
+// After this many checks without a change, the timing for the next level up
+// is forgotten so that it gets retried (conditions may have changed).
+static const int kSteadyChecksBeforeRetry = 16;
+
+// What the stream has measured at each level.
+typedef struct {
+  // Input bytes per second, 0 if not timed yet.
+  double speeds[Z_BEST_COMPRESSION + 1];
+  int steadyChecks;
+} LevelController;
+
+// Records |length| bytes compressed at |level| in |busy| seconds out of
+// |elapsed|, and returns the level to use next.
+static int NextCompressionLevel(LevelController *controller, int level,
+                                NSUInteger length, NSTimeInterval busy,
+                                NSTimeInterval elapsed, double targetThroughput,
+                                double budget) {
+  if (busy <= 0) {
+    return level;
+  }
+  double *speeds = controller->speeds;
+  double speed = length / busy;
+  speeds[level] = speeds[level] ? (speeds[level] + speed) / 2 : speed;
+
+  double target = targetThroughput;
+  if (budget > 0 && elapsed > 0) {
+    target = MAX(target, length / elapsed / budget);
+  }
+  if (target <= 0) {
+    return level;
+  }
+
+  if (speeds[level] < target) {
+    // Skip straight past levels already known to be too slow.
+    controller->steadyChecks = 0;
+    int next = level - 1;
+    while (next > Z_BEST_SPEED && speeds[next] && speeds[next] < target) {
+      --next;
+    }
+    return MAX(next, Z_BEST_SPEED);
+  }
+  if (level < Z_BEST_COMPRESSION) {
+    if (++controller->steadyChecks >= kSteadyChecksBeforeRetry) {
+      speeds[level + 1] = 0;
+      controller->steadyChecks = 0;
+    }
+    double up = speeds[level + 1];
+    if (up ? up >= target : speeds[level] >= target * kHeadroomToRaiseLevel) {
+      controller->steadyChecks = 0;
+      return level + 1;
+    }
+  }
+  return level;
+}
+
+@implementation GTMZlibStream {
+  z_stream strm_;
+  BOOL initialized_;
+  unsigned char *chunk_;
+  NSUInteger chunkSize_;
+  // Adaptive level state.
+  LevelController controller_;
+  NSUInteger sliceLength_;
+  NSTimeInterval sliceBusyTime_;
+  NSTimeInterval sliceStartTime_;
+}
+
+@synthesize deflating = deflating_;
+@synthesize format = format_;
+@synthesize finished = finished_;
+@synthesize outputChunkSize = outputChunkSize_;
+@synthesize totalBytesIn = totalBytesIn_;
+@synthesize totalBytesOut = totalBytesOut_;
+@synthesize compressionLevel = compressionLevel_;
+@synthesize targetThroughput = targetThroughput_;
+@synthesize CPUBudget = CPUBudget_;
+
++ (instancetype)deflateStreamWithFormat:(GTMZlibStreamFormat)format
+                       compressionLevel:(int)level
+                                  error:(NSError **)error {
+  return [[self alloc] initWithDeflate:YES
+                                format:format
+                      compressionLevel:level
+                                 error:error];
+}
+
++ (instancetype)inflateStreamWithFormat:(GTMZlibStreamFormat)format
+                                  error:(NSError **)error {
+  return [[self alloc] initWithDeflate:NO
+                                format:format
+                      compressionLevel:Z_DEFAULT_COMPRESSION
+                                 error:error];
+}
+
+- (instancetype)initWithDeflate:(BOOL)deflate
+                         format:(GTMZlibStreamFormat)format
+               compressionLevel:(int)level
+                          error:(NSError **)error {
+  if ((self = [super init])) {
+    deflating_ = deflate;
+    format_ = format;
+    outputChunkSize_ = kDefaultOutputChunkSize;
+
+    // AutoDetect only means something when inflating; deflate makes zlib.
+    if (deflate && format == GTMZlibStreamFormatAutoDetect) {
+      format = GTMZlibStreamFormatZlib;
+    }
+    int windowBits = WindowBitsForFormat(format, MAX_WBITS);
+
+    int retCode;
+    if (deflate) {
+      level = ClampCompressionLevel(level);
+      // Z_DEFAULT_COMPRESSION is 6 in every zlib version.
+      compressionLevel_ = (level == Z_DEFAULT_COMPRESSION) ? 6 : level;
+      retCode = deflateInit2(&strm_, level, Z_DEFLATED, windowBits, 8,
+                             Z_DEFAULT_STRATEGY);
+    } else {
+      retCode = inflateInit2(&strm_, windowBits);
+    }
+    if (retCode != Z_OK) {
+      // COV_NF_START - no real way to force this in a unittest (we guard all args)
+      if (error) {
+        *error = ZlibError(retCode, strm_.msg);
+      }
+      return nil;
+      // COV_NF_END
+    }
+    initialized_ = YES;
+  }
+  return self;
+}
+
+- (void)dealloc {
+  if (initialized_) {
+    if (deflating_) {
+      deflateEnd(&strm_);
+    } else {
+      inflateEnd(&strm_);
+    }
+  }
+  free(chunk_);
+}
+
+- (BOOL)processBytes:(const void *)bytes
+              length:(NSUInteger)length
+           bytesRead:(NSUInteger *)bytesRead
+            toBuffer:(void *)buffer
+            capacity:(NSUInteger)capacity
+        bytesWritten:(NSUInteger *)bytesWritten
+               flush:(GTMZlibStreamFlush)flush
+               error:(NSError **)error {
+  *bytesRead = 0;
+  *bytesWritten = 0;
+  if (finished_ || !capacity) {
+    return YES;
+  }
+
+  int zFlush = Z_NO_FLUSH;
+  switch (flush) {
+    case GTMZlibStreamFlushNone:
+      zFlush = Z_NO_FLUSH;
+      break;
+    case GTMZlibStreamFlushSync:
+      zFlush = Z_SYNC_FLUSH;
+      break;
+    case GTMZlibStreamFlushFinish:
+      // inflate() only needs to be told to hand back what it has.
+      zFlush = deflating_ ? Z_FINISH : Z_SYNC_FLUSH;
+      break;
+  }
+
+  const unsigned char *input = (const unsigned char *)bytes;
+  NSUInteger inputLeft = bytes ? length : 0;
+  unsigned char *output = (unsigned char *)buffer;
+  NSUInteger outputLeft = capacity;
+
+  // zlib counts in uInt, so anything over 4GB is fed through in windows.
+  while (YES) {
+    uInt inWindow = (uInt)MIN(inputLeft, kMaxZlibWindow);
+    uInt outWindow = (uInt)MIN(outputLeft, kMaxZlibWindow);
+    strm_.next_in = (Bytef *)input;
+    strm_.avail_in = inWindow;
+    strm_.next_out = output;
+    strm_.avail_out = outWindow;
+
+    // Only flush once the last of the input is in the window.
+    int windowFlush = (inWindow == inputLeft) ? zFlush : Z_NO_FLUSH;
+    int retCode = deflating_ ? deflate(&strm_, windowFlush)
+                             : inflate(&strm_, windowFlush);
+
+    NSUInteger consumed = inWindow - strm_.avail_in;
+    NSUInteger produced = outWindow - strm_.avail_out;
+    input += consumed;
+    inputLeft -= consumed;
+    output += produced;
+    outputLeft -= produced;
+    *bytesRead += consumed;
+    *bytesWritten += produced;
+    totalBytesIn_ += consumed;
+    totalBytesOut_ += produced;
+
+    if (retCode == Z_STREAM_END) {
+      finished_ = YES;
+      break;
+    }
+    // Z_BUF_ERROR just means no progress was possible with what was given.
+    if (retCode != Z_OK && retCode != Z_BUF_ERROR) {
+      if (error) {
+        *error = ZlibError(retCode, strm_.msg);
+      }
+      return NO;
+    }
+    if (!outputLeft || (!consumed && !produced)) {
+      break;
+    }
+    // Out of input; keep going only if a flush filled a >4GB output window.
+    if (!inputLeft && !(strm_.avail_out == 0 && windowFlush != Z_NO_FLUSH)) {
+      break;
+    }
+  }
+  return YES;
+}
+
+// Runs |bytes| through the stream a chunk at a time, handing output to
+// |handler|.
+- (BOOL)drainBytes:(const void *)bytes
+            length:(NSUInteger)length
+             flush:(GTMZlibStreamFlush)flush
+     outputHandler:(GTMZlibStreamOutputHandler)handler
+             error:(NSError **)error {
+  NSUInteger chunkSize = MAX(outputChunkSize_, (NSUInteger)1);
+  if (chunkSize != chunkSize_) {
+    unsigned char *chunk = (unsigned char *)realloc(chunk_, chunkSize);
+    if (!chunk) {
+      // COV_NF_START
+      if (error) {
+        *error = ZlibError(Z_MEM_ERROR, NULL);
+      }
+      return NO;
+      // COV_NF_END
+    }
+    chunk_ = chunk;
+    chunkSize_ = chunkSize;
+  }
+
+  const unsigned char *input = (const unsigned char *)bytes;
+  NSUInteger inputLeft = bytes ? length : 0;
+  BOOL more;
+  do {
+    NSUInteger read, written;
+    if (![self processBytes:input
+                     length:inputLeft
+                  bytesRead:&read
+                   toBuffer:chunk_
+                   capacity:chunkSize_
+               bytesWritten:&written
+                      flush:flush
+                      error:error]) {
+      return NO;
+    }
+    input += read;
+    inputLeft -= read;
+    if (written) {
+      handler(chunk_, written);
+    }
+    // A full chunk means zlib may have more to hand back.
+    more = !finished_ && (inputLeft || written == chunkSize_);
+  } while (more);
+
+  if (inputLeft) {
+    if (error) {
+      NSDictionary *userInfo =
+          [NSDictionary dictionaryWithObject:[NSNumber numberWithUnsignedInteger:inputLeft]
+                                      forKey:GTMNSDataZlibRemainingBytesKey];
+      *error = [NSError errorWithDomain:GTMNSDataZlibErrorDomain
+                                   code:GTMNSDataZlibErrorDataRemaining
+                               userInfo:userInfo];
+    }
+    return NO;
+  }
+  return YES;
+}
+
+// Switches deflate to |level|. zlib ends the current block first, so this can
+// produce output.
+- (BOOL)changeCompressionLevel:(int)level
+                 outputHandler:(GTMZlibStreamOutputHandler)handler
+                         error:(NSError **)error {
+  int retCode;
+  do {
+    strm_.next_in = NULL;
+    strm_.avail_in = 0;
+    strm_.next_out = chunk_;
+    strm_.avail_out = (uInt)MIN(chunkSize_, kMaxZlibWindow);
+    retCode = deflateParams(&strm_, level, Z_DEFAULT_STRATEGY);
+    NSUInteger produced = MIN(chunkSize_, kMaxZlibWindow) - strm_.avail_out;
+    totalBytesOut_ += produced;
+    if (produced) {
+      handler(chunk_, produced);
+    } else if (retCode == Z_BUF_ERROR) {
+      // Nothing more came out; leave the level for the next check.
+      return YES;
+    }
+  } while (retCode == Z_BUF_ERROR);
+  if (retCode != Z_OK) {
+    // COV_NF_START - only a corrupt stream state can get here
+    if (error) {
+      *error = ZlibError(retCode, strm_.msg);
+    }
+    return NO;
+    // COV_NF_END
+  }
+  compressionLevel_ = level;
+  return YES;
+}
+
+// Like drainBytes:length:flush:outputHandler:error:, but when a target is set
+// the input goes through in slices, timing each and adjusting the level in
+// between.
+- (BOOL)runBytes:(const void *)bytes
+          length:(NSUInteger)length
+           flush:(GTMZlibStreamFlush)flush
+   outputHandler:(GTMZlibStreamOutputHandler)handler
+           error:(NSError **)error {
+  if (!deflating_ || (targetThroughput_ <= 0 && CPUBudget_ <= 0)) {
+    return [self drainBytes:bytes
+                     length:length
+                      flush:flush
+              outputHandler:handler
+                      error:error];
+  }
+
+  NSProcessInfo *processInfo = [NSProcessInfo processInfo];
+  if (!sliceStartTime_) {
+    sliceStartTime_ = [processInfo systemUptime];
+  }
+  const unsigned char *input = (const unsigned char *)bytes;
+  NSUInteger inputLeft = bytes ? length : 0;
+  do {
+    // Short appends add up to one slice.
+    NSUInteger sliceLength = MIN(inputLeft, kAdaptiveSliceLength - sliceLength_);
+    BOOL last = (sliceLength == inputLeft);
+    NSTimeInterval start = [processInfo systemUptime];
+    if (![self drainBytes:input
+                   length:sliceLength
+                    flush:(last ? flush : GTMZlibStreamFlushNone)
+            outputHandler:handler
+                    error:error]) {
+      return NO;
+    }
+    NSTimeInterval now = [processInfo systemUptime];
+    sliceBusyTime_ += now - start;
+    sliceLength_ += sliceLength;
+    input += sliceLength;
+    inputLeft -= sliceLength;
+
+    if (sliceLength_ >= kAdaptiveSliceLength && !finished_) {
+      int level = NextCompressionLevel(&controller_, compressionLevel_, sliceLength_,
+                                       sliceBusyTime_, now - sliceStartTime_,
+                                       targetThroughput_, CPUBudget_);
+      sliceLength_ = 0;
+      sliceBusyTime_ = 0;
+      sliceStartTime_ = now;
+      if (level != compressionLevel_ &&
+          ![self changeCompressionLevel:level outputHandler:handler error:error]) {
+        return NO;  // COV_NF_LINE
+      }
+    }
+  } while (inputLeft);
+  return YES;
+}
+
+- (BOOL)appendBytes:(const void *)bytes
+             length:(NSUInteger)length
+      outputHandler:(GTMZlibStreamOutputHandler)handler
+              error:(NSError **)error {
+  return [self runBytes:bytes
+                 length:length
+                  flush:GTMZlibStreamFlushNone
+          outputHandler:handler
+                  error:error];
+}
+
+- (BOOL)appendData:(NSData *)data
+     outputHandler:(GTMZlibStreamOutputHandler)handler
+             error:(NSError **)error {
+  return [self appendBytes:[data bytes]
+                    length:[data length]
+             outputHandler:handler
+                     error:error];
+}
+
+- (BOOL)flushWithOutputHandler:(GTMZlibStreamOutputHandler)handler
+                         error:(NSError **)error {
+  return [self runBytes:NULL
+                 length:0
+                  flush:GTMZlibStreamFlushSync
+          outputHandler:handler
+                  error:error];
+}
+
+- (BOOL)finishWithOutputHandler:(GTMZlibStreamOutputHandler)handler
+                          error:(NSError **)error {
+  if (![self runBytes:NULL
+               length:0
+                flush:GTMZlibStreamFlushFinish
+        outputHandler:handler
+                error:error]) {
+    return NO;
+  }
+  if (!finished_) {
+    // Only inflate can get here, the compressed data ended early.
+    if (error) {
+      *error = ZlibError(Z_BUF_ERROR, NULL);
+    }
+    return NO;
+  }
+  return YES;
+}
+
+@end
@@ -0,0 +1,129 @@
+//
+//  GTMCompressionCodec.h
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#import <Foundation/Foundation.h>
+#import "GTMDefines.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A one shot compression algorithm that can be used in a GTMCompressionCodecs
+/// frame.
+//
+// Codecs work on whole buffers and must be safe to call from several threads
+// at once. Errors should be in GTMNSDataZlibErrorDomain (damaged input is
+// GTMNSDataZlibErrorInternal with a GTMNSDataZlibErrorKey of Z_DATA_ERROR).
+@protocol GTMCompressionCodec <NSObject>
+
+/// The byte that marks this codec in a frame. 1-127 are for codecs in GTM,
+/// 128-255 for applications.
+@property(nonatomic, readonly) uint8_t codecIdentifier;
+
+/// A short name to look the codec up by, like @"deflate".
+@property(nonatomic, readonly, copy) NSString *codecName;
+
+/// The largest output compressing |length| bytes can produce.
+- (NSUInteger)maximumCompressedLengthForLength:(NSUInteger)length;
+
+/// The most that |length| bytes of this codec's output can decompress to
+/// (NSUIntegerMax if it overflows). A frame whose header claims more is
+/// rejected as damaged before any memory is reserved for it.
+- (NSUInteger)maximumDecompressedLengthForLength:(NSUInteger)length;
+
+/// Compresses |length| bytes into |buffer|, which holds |capacity| bytes (at
+/// least maximumCompressedLengthForLength:), setting |compressedLength| to
+/// the bytes written. |level| is a zlib style 1-9 (or Z_DEFAULT_COMPRESSION),
+/// which a codec may ignore.
+- (BOOL)compressBytes:(const void *)bytes
+               length:(NSUInteger)length
+     compressionLevel:(int)level
+           intoBuffer:(void *)buffer
+             capacity:(NSUInteger)capacity
+     compressedLength:(NSUInteger *)compressedLength
+                error:(NSError **)error;
+
+/// Decompresses all of |length| bytes into exactly |outputLength| bytes at
+/// |buffer|. Fails if the input is damaged, has anything left over, or doesn't
+/// decompress to exactly |outputLength| bytes.
+- (BOOL)decompressBytes:(const void *)bytes
+                 length:(NSUInteger)length
+             intoBuffer:(void *)buffer
+           outputLength:(NSUInteger)outputLength
+                  error:(NSError **)error;
+
+@end
+
+/// The codec registry and the self describing frame that codec output is
+/// wrapped in.
+//
+// A frame is a 20 byte header followed by the codec's output:
+//   "GTMC", version (1), codec identifier, flags (0), reserved (0),
+//   original length (64 bit little endian),
+//   CRC-32 of the original bytes (32 bit little endian).
+// The magic can't be mistaken for a zlib or gzip header, so
+// +[NSData gtm_dataByInflatingData:error:] and friends recognise frames along
+// with zlib and gzip streams.
+//
+// "deflate" (raw deflate, identifier 1) and "lz" (GTMLZCodec, identifier 2) are
+// always registered.
+@interface GTMCompressionCodecs : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Makes |codec| available for decoding frames and by name. Returns NO if its
+/// identifier is below 128 (those are kept for codecs in GTM, so frames
+/// written by an application can't later be read by the wrong codec) or if
+/// its identifier or name is already taken.
++ (BOOL)registerCodec:(id<GTMCompressionCodec>)codec;
+
+/// Returns the registered codec called |name|, or nil.
++ (nullable id<GTMCompressionCodec>)codecNamed:(NSString *)name;
+
+/// Returns the registered codec with |identifier|, or nil.
++ (nullable id<GTMCompressionCodec>)codecWithIdentifier:(uint8_t)identifier;
+
+/// zlib's raw deflate: slower, smaller output.
++ (id<GTMCompressionCodec>)deflateCodec;
+
+/// GTMLZCodec: fast, especially to decompress, with larger output.
++ (id<GTMCompressionCodec>)lzCodec;
+
+/// Returns YES if |bytes| starts with a frame header.
++ (BOOL)isFrameBytes:(const void *)bytes length:(NSUInteger)length;
+
+/// Returns a frame holding |length| bytes compressed with |codec| (which need
+/// not be registered) at compression |level|.
++ (nullable NSData *)frameByCompressingBytes:(const void *)bytes
+                                      length:(NSUInteger)length
+                                       codec:(id<GTMCompressionCodec>)codec
+                            compressionLevel:(int)level
+                                       error:(NSError **)error;
+
+/// Decodes the frame in |bytes|, checking the CRC-32. A frame whose header
+/// says it holds more than |maximumLength| bytes (0 for no limit) fails with
+/// GTMNSDataZlibErrorOutputLimitExceeded before anything is decompressed; an
+/// unregistered codec fails with GTMNSDataZlibErrorUnknownCodec. Even with no
+/// limit, a header claiming more than the codec's
+/// maximumDecompressedLengthForLength: of the payload is treated as damage.
++ (nullable NSData *)dataByDecompressingFrameBytes:(const void *)bytes
+                                            length:(NSUInteger)length
+                                     maximumLength:(NSUInteger)maximumLength
+                                             error:(NSError **)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,40 @@
+//
+//  GTMLZCodec.h
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#import <Foundation/Foundation.h>
+#import "GTMCompressionCodec.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A byte oriented LZ77 codec built for speed over ratio, for caches and IPC.
+//
+// Input is cut into 4MB blocks, each stored as a 32 bit little endian size and
+// an LZ4 format block (a block that doesn't get smaller is stored as is, with
+// the size's top bit set). Matching is greedy with a single entry hash table,
+// so compressing runs at several hundred MB/s and decompressing at a few GB/s,
+// with output typically 20-40% larger than deflate's. The compression level
+// is ignored. Decompressing checks every length and offset, so damaged input
+// fails rather than reading or writing out of bounds.
+@interface GTMLZCodec : NSObject <GTMCompressionCodec>
+
+/// The "lz" codec, identifier 2.
++ (GTMLZCodec *)sharedCodec;
+
+@end
+
+NS_ASSUME_NONNULL_END
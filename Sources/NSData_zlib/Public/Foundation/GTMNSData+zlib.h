@@ -21,12 +21,22 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+@class GTMZlibCompressionOptions;
+@protocol GTMCompressionCodec;
+
+/// Receives inflated output for the "ToSink" apis. Returns how many of the
+/// |length| bytes it took: all, some, 0 if it would block right now (the rest
+/// is offered again shortly), or -1 to stop with |error| set.
+typedef NSInteger (^GTMZlibOutputSink)(const void *bytes, NSUInteger length,
+                                        NSError **error);
+
 /// Helpers for dealing w/ zlib inflate/deflate calls.
 @interface NSData (GTMZLibAdditions)
 
-// NOTE: For 64bit, none of these apis handle input sizes >32bits, they will
-// return nil when given such data.  To handle data of that size you really
-// should be streaming it rather then doing it all in memory.
+// NOTE: Input of any size is handled, zlib is fed >32bit buffers a window at
+// a time. Memory mapped data (NSDataReadingMappedAlways) works fine as input,
+// but the result is always built in memory; for very large payloads consider
+// GTMZlibStream instead.
 
 #pragma mark Gzip Compression
 
@@ -56,6 +66,53 @@ NS_ASSUME_NONNULL_BEGIN
                            compressionLevel:(int)level
                                       error:(NSError **)error;
 
+/// Return an autoreleased NSData w/ the result of gzipping the bytes on all cores.
+//
+// The input is split into 128KB blocks that are compressed concurrently, each
+// primed with the 32KB before it, and stitched into one standard gzip stream
+// (any gzip reader, including gtm_dataByInflatingData:, can decode it). The
+// result is typically within a fraction of a percent of the single threaded
+// size. Small inputs, or machines with one core, just use the serial path.
++ (nullable NSData *)gtm_dataByParallelGzippingBytes:(const void *)bytes
+                                              length:(NSUInteger)length
+                                    compressionLevel:(int)level
+                                               error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of gzipping the payload of |data| on all cores.
+//
+// See gtm_dataByParallelGzippingBytes:length:compressionLevel:error:.
++ (nullable NSData *)gtm_dataByParallelGzippingData:(NSData *)data
+                                   compressionLevel:(int)level
+                                              error:(NSError **)error;
+
+#pragma mark Block Gzip (BGZF)
+
+/// Return an autoreleased NSData w/ the result of block gzipping the bytes.
+//
+// The output is BGZF, as written by bgzip: a series of independent gzip
+// members of at most 64KB (each recording its size in the header) followed by
+// an empty end marker member. Any gzip reader can decode it, and
+// gtm_dataByParallelInflatingData:error: can decode the members concurrently.
+// Compression is done on all cores; the result is a little larger than a
+// single gzip stream since members don't share history.
+//
+// If |index| is non-NULL it is set to a bgzip style .gzi index: a
+// little-endian uint64 entry count followed by a (compressed offset,
+// uncompressed offset) uint64 pair for each member after the first.
++ (nullable NSData *)gtm_dataByBlockGzippingBytes:(const void *)bytes
+                                           length:(NSUInteger)length
+                                 compressionLevel:(int)level
+                                            index:(NSData *_Nullable *_Nullable)index
+                                            error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of block gzipping the payload of |data|.
+//
+// See gtm_dataByBlockGzippingBytes:length:compressionLevel:index:error:.
++ (nullable NSData *)gtm_dataByBlockGzippingData:(NSData *)data
+                                compressionLevel:(int)level
+                                           index:(NSData *_Nullable *_Nullable)index
+                                           error:(NSError **)error;
+
 #pragma mark Zlib "Stream" Compression
 
 // NOTE: deflate is *NOT* gzip.  deflate is a "zlib" stream.  pick which one
@@ -91,7 +148,9 @@ NS_ASSUME_NONNULL_BEGIN
 
 /// Return an autoreleased NSData w/ the result of decompressing the bytes.
 //
-// The bytes to decompress can be zlib or gzip payloads.
+// The bytes to decompress can be zlib or gzip payloads. Gzip payloads may be
+// several concatenated members (what `cat a.gz b.gz` makes), the result is
+// all of their contents.
 + (nullable NSData *)gtm_dataByInflatingBytes:(const void *)bytes
                                        length:(NSUInteger)length
                                         error:(NSError **)error;
@@ -102,6 +161,39 @@ NS_ASSUME_NONNULL_BEGIN
 + (nullable NSData *)gtm_dataByInflatingData:(NSData *)data
                                        error:(NSError **)error;
 
+/// Return an autoreleased NSData w/ the result of decompressing the bytes.
+//
+// |expectedLength| is a hint at the decompressed size. When it is right the
+// output is written in place with no copying or reallocation; when it is wrong
+// the result is still correct. Pass 0 to use the gzip trailer (if any) or a
+// guess.
++ (nullable NSData *)gtm_dataByInflatingBytes:(const void *)bytes
+                                       length:(NSUInteger)length
+                               expectedLength:(NSUInteger)expectedLength
+                                        error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of decompressing the payload of |data|.
+//
+// See gtm_dataByInflatingBytes:length:expectedLength:error: for |expectedLength|.
++ (nullable NSData *)gtm_dataByInflatingData:(NSData *)data
+                              expectedLength:(NSUInteger)expectedLength
+                                       error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of decompressing the bytes on all cores.
+//
+// For block gzip (BGZF) payloads the members are inflated concurrently, each
+// straight into its place in the result. Anything else is decompressed like
+// gtm_dataByInflatingBytes:length:error:.
++ (nullable NSData *)gtm_dataByParallelInflatingBytes:(const void *)bytes
+                                               length:(NSUInteger)length
+                                                error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of decompressing the payload of |data| on all cores.
+//
+// See gtm_dataByParallelInflatingBytes:length:error:.
++ (nullable NSData *)gtm_dataByParallelInflatingData:(NSData *)data
+                                               error:(NSError **)error;
+
 #pragma mark "Raw" Compression Support
 
 // NOTE: raw deflate is *NOT* gzip or deflate.  it does not include a header
@@ -152,13 +244,450 @@ NS_ASSUME_NONNULL_BEGIN
 + (nullable NSData *)gtm_dataByRawInflatingData:(NSData *)data
                                           error:(NSError **)error;
 
+/// Return an autoreleased NSData w/ the result of *raw* decompressing the bytes.
+//
+// See gtm_dataByInflatingBytes:length:expectedLength:error: for |expectedLength|.
++ (nullable NSData *)gtm_dataByRawInflatingBytes:(const void *)bytes
+                                          length:(NSUInteger)length
+                                  expectedLength:(NSUInteger)expectedLength
+                                           error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of *raw* decompressing the payload of |data|.
+//
+// See gtm_dataByInflatingBytes:length:expectedLength:error: for |expectedLength|.
++ (nullable NSData *)gtm_dataByRawInflatingData:(NSData *)data
+                                 expectedLength:(NSUInteger)expectedLength
+                                          error:(NSError **)error;
+
+#pragma mark File Compression
+
+// These work file to file in constant memory: the input is mapped a window at
+// a time with sequential read-ahead and the output goes out in large writes,
+// instead of both files being held in memory. If anything fails the
+// destination is removed. File system errors are in NSPOSIXErrorDomain.
+
+/// Gzips the file at |sourcePath| into |destinationPath| (replacing it).
+//
+// |level| can be 1-9, any other values will be clipped to that range.
++ (BOOL)gtm_gzipFileAtPath:(NSString *)sourcePath
+                    toPath:(NSString *)destinationPath
+          compressionLevel:(int)level
+                     error:(NSError **)error;
+
+/// Gzips the file at |sourcePath| into |destinationPath| (replacing it),
+/// optionally on all cores.
+//
+// With |parallel| the input is compressed in 128KB blocks on all cores and
+// written as a single standard gzip stream, as for
+// gtm_dataByParallelGzippingBytes:length:compressionLevel:error:.
++ (BOOL)gtm_gzipFileAtPath:(NSString *)sourcePath
+                    toPath:(NSString *)destinationPath
+          compressionLevel:(int)level
+                  parallel:(BOOL)parallel
+                     error:(NSError **)error;
+
+/// Decompresses the gzip (or zlib) file at |sourcePath| into |destinationPath|
+/// (replacing it).
+//
+// Concatenated gzip members are all decompressed.
++ (BOOL)gtm_gunzipFileAtPath:(NSString *)sourcePath
+                      toPath:(NSString *)destinationPath
+                       error:(NSError **)error;
+
+#pragma mark Inflating To A Sink
+
+// These decompress gzip (including concatenated members) or zlib data
+// straight into a file descriptor, an NSOutputStream or a block, a fixed
+// 256KB at a time, so memory use stays the same however big the output is.
+// Each piece is written out before more is inflated: a non-blocking
+// descriptor is waited on with poll(), and a stream without space or a sink
+// that would block is retried with a short backoff. An output that takes
+// nothing for 60 seconds (or the sink's |timeout|) fails with ETIMEDOUT in
+// NSPOSIXErrorDomain. Empty input fails like truncated input. Returns NO if
+// the data is bad or the output fails; what had been inflated by then has
+// already been written.
+//
+// These block the calling thread until done, so whatever drains the output
+// (the reader of a pipe or a bound stream pair, say) must run on another
+// thread: a stream scheduled on the caller's own runloop never gets serviced
+// and the call just times out. The completionQueue: variant does the work in
+// the background instead.
+
+/// Inflates the bytes into |fileDescriptor|. Write errors are in
+/// NSPOSIXErrorDomain.
++ (BOOL)gtm_inflateBytes:(const void *)bytes
+                  length:(NSUInteger)length
+        toFileDescriptor:(int)fileDescriptor
+                   error:(NSError **)error;
+
+/// Inflates the payload of |data| into |fileDescriptor|.
++ (BOOL)gtm_inflateData:(NSData *)data
+       toFileDescriptor:(int)fileDescriptor
+                  error:(NSError **)error;
+
+/// Inflates the bytes into |outputStream|, which must already be open. Write
+/// errors are the stream's streamError.
++ (BOOL)gtm_inflateBytes:(const void *)bytes
+                  length:(NSUInteger)length
+          toOutputStream:(NSOutputStream *)outputStream
+                   error:(NSError **)error;
+
+/// Inflates the payload of |data| into |outputStream|.
++ (BOOL)gtm_inflateData:(NSData *)data
+         toOutputStream:(NSOutputStream *)outputStream
+                  error:(NSError **)error;
+
+/// Inflates the payload of |data| into |outputStream| on a background queue
+/// and then calls |completion| on |completionQueue|, so the stream can be
+/// serviced by the caller's runloop meanwhile.
++ (void)gtm_inflateData:(NSData *)data
+         toOutputStream:(NSOutputStream *)outputStream
+        completionQueue:(dispatch_queue_t)completionQueue
+             completion:(void (^)(BOOL succeeded, NSError *_Nullable error))completion;
+
+/// Inflates the bytes into |sink|.
++ (BOOL)gtm_inflateBytes:(const void *)bytes
+                  length:(NSUInteger)length
+                  toSink:(GTMZlibOutputSink)sink
+                   error:(NSError **)error;
+
+/// Inflates the payload of |data| into |sink|.
++ (BOOL)gtm_inflateData:(NSData *)data
+                 toSink:(GTMZlibOutputSink)sink
+                  error:(NSError **)error;
+
+/// Inflates the bytes into |sink|, giving up once it has taken nothing for
+/// |timeout| seconds.
++ (BOOL)gtm_inflateBytes:(const void *)bytes
+                  length:(NSUInteger)length
+                  toSink:(GTMZlibOutputSink)sink
+                 timeout:(NSTimeInterval)timeout
+                   error:(NSError **)error;
+
+/// Inflates the payload of |data| into |sink|, giving up once it has taken
+/// nothing for |timeout| seconds.
++ (BOOL)gtm_inflateData:(NSData *)data
+                 toSink:(GTMZlibOutputSink)sink
+                timeout:(NSTimeInterval)timeout
+                  error:(NSError **)error;
+
+#pragma mark Preset Dictionaries
+
+// A preset dictionary is data the compressor pretends it has already seen, so
+// even the first bytes of a payload can refer back to it. For small payloads
+// (a few KB or less) with a lot in common, such as JSON records, this can
+// improve the ratio several fold. Both sides have to use the same dictionary;
+// a zlib stream records the dictionary's adler32 so a mismatch is caught, a
+// raw stream just decodes to garbage (or fails). Only the last 32KB of a
+// dictionary is used. Gzip has no way to record a dictionary, so only zlib
+// and raw streams are supported.
+
+/// Return an autoreleased NSData w/ the result of deflating the bytes using |dictionary|.
+//
+// |level| can be 1-9, any other values will be clipped to that range.
++ (nullable NSData *)gtm_dataByDeflatingBytes:(const void *)bytes
+                                       length:(NSUInteger)length
+                             compressionLevel:(int)level
+                                   dictionary:(nullable NSData *)dictionary
+                                        error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of deflating the payload of |data| using |dictionary|.
++ (nullable NSData *)gtm_dataByDeflatingData:(NSData *)data
+                            compressionLevel:(int)level
+                                  dictionary:(nullable NSData *)dictionary
+                                       error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of decompressing the bytes using |dictionary|.
+//
+// The bytes can be zlib or gzip payloads; |dictionary| is only used if the
+// payload asks for one. If it does and |dictionary| is nil the error's
+// GTMNSDataZlibErrorKey is Z_NEED_DICT, if it's the wrong one Z_DATA_ERROR.
++ (nullable NSData *)gtm_dataByInflatingBytes:(const void *)bytes
+                                       length:(NSUInteger)length
+                                   dictionary:(nullable NSData *)dictionary
+                                        error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of decompressing the payload of |data| using |dictionary|.
++ (nullable NSData *)gtm_dataByInflatingData:(NSData *)data
+                                  dictionary:(nullable NSData *)dictionary
+                                       error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of *raw* deflating the bytes using |dictionary|.
+//
+// |level| can be 1-9, any other values will be clipped to that range.
+//  *No* header is added to the resulting data.
++ (nullable NSData *)gtm_dataByRawDeflatingBytes:(const void *)bytes
+                                          length:(NSUInteger)length
+                                compressionLevel:(int)level
+                                      dictionary:(nullable NSData *)dictionary
+                                           error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of *raw* deflating the payload of |data| using |dictionary|.
++ (nullable NSData *)gtm_dataByRawDeflatingData:(NSData *)data
+                               compressionLevel:(int)level
+                                     dictionary:(nullable NSData *)dictionary
+                                          error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of *raw* decompressing the bytes using |dictionary|.
++ (nullable NSData *)gtm_dataByRawInflatingBytes:(const void *)bytes
+                                          length:(NSUInteger)length
+                                      dictionary:(nullable NSData *)dictionary
+                                           error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of *raw* decompressing the payload of |data| using |dictionary|.
++ (nullable NSData *)gtm_dataByRawInflatingData:(NSData *)data
+                                     dictionary:(nullable NSData *)dictionary
+                                          error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ a preset dictionary built from |samples|.
+//
+// The samples should be representative payloads (a few hundred is plenty).
+// Byte runs common to many samples are collected, the most valuable placed
+// last since deflate reaches recent data most cheaply, up to |maxLength|
+// bytes (0 or anything over 32KB means 32KB). The result may be shorter, or
+// empty if the samples have little in common.
++ (NSData *)gtm_dictionaryFromSamples:(NSArray<NSData *> *)samples
+                            maxLength:(NSUInteger)maxLength;
+
+#pragma mark Bounded Decompression
+
+// Untrusted input can expand enormously (a few KB of deflate data can decode
+// to gigabytes). These stop as soon as the output would pass |maxLength| bytes
+// or |maxRatio| times the input length, with a GTMNSDataZlibErrorOutputLimitExceeded
+// error, instead of decoding (and allocating) the whole thing first. Either
+// limit can be 0 for none.
+
+/// Return an autoreleased NSData w/ the result of decompressing the bytes, within the given limits.
+//
+// The bytes to decompress can be zlib or gzip payloads.
++ (nullable NSData *)gtm_dataByInflatingBytes:(const void *)bytes
+                                       length:(NSUInteger)length
+                                maximumLength:(NSUInteger)maxLength
+                                 maximumRatio:(NSUInteger)maxRatio
+                                        error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of decompressing the payload of |data|, within the given limits.
++ (nullable NSData *)gtm_dataByInflatingData:(NSData *)data
+                               maximumLength:(NSUInteger)maxLength
+                                maximumRatio:(NSUInteger)maxRatio
+                                       error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of *raw* decompressing the bytes, within the given limits.
++ (nullable NSData *)gtm_dataByRawInflatingBytes:(const void *)bytes
+                                          length:(NSUInteger)length
+                                   maximumLength:(NSUInteger)maxLength
+                                    maximumRatio:(NSUInteger)maxRatio
+                                           error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of *raw* decompressing the payload of |data|, within the given limits.
++ (nullable NSData *)gtm_dataByRawInflatingData:(NSData *)data
+                                  maximumLength:(NSUInteger)maxLength
+                                   maximumRatio:(NSUInteger)maxRatio
+                                          error:(NSError **)error;
+
+#pragma mark Compression Options
+
+// These take a GTMZlibCompressionOptions (nil for the defaults) to pick the
+// strategy, memory level and window size, or a named preset such as
+// "binary-rle" or "auto". The results decode with the normal inflate apis.
+
+/// Return an autoreleased NSData w/ the result of gzipping the bytes using |options|.
++ (nullable NSData *)gtm_dataByGzippingBytes:(const void *)bytes
+                                      length:(NSUInteger)length
+                                     options:(nullable GTMZlibCompressionOptions *)options
+                                       error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of gzipping the payload of |data| using |options|.
++ (nullable NSData *)gtm_dataByGzippingData:(NSData *)data
+                                    options:(nullable GTMZlibCompressionOptions *)options
+                                      error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of deflating the bytes using |options|.
++ (nullable NSData *)gtm_dataByDeflatingBytes:(const void *)bytes
+                                       length:(NSUInteger)length
+                                      options:(nullable GTMZlibCompressionOptions *)options
+                                        error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of deflating the payload of |data| using |options|.
++ (nullable NSData *)gtm_dataByDeflatingData:(NSData *)data
+                                     options:(nullable GTMZlibCompressionOptions *)options
+                                       error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of *raw* deflating the bytes using |options|.
+//
+//  *No* header is added to the resulting data.
++ (nullable NSData *)gtm_dataByRawDeflatingBytes:(const void *)bytes
+                                          length:(NSUInteger)length
+                                         options:(nullable GTMZlibCompressionOptions *)options
+                                           error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of *raw* deflating the payload of |data| using |options|.
++ (nullable NSData *)gtm_dataByRawDeflatingData:(NSData *)data
+                                        options:(nullable GTMZlibCompressionOptions *)options
+                                          error:(NSError **)error;
+
+#pragma mark Adaptive Compression
+
+// These pick the compression level as they go: the input is compressed in
+// slices, and the level drops when the measured speed falls below
+// |targetThroughput| (input bytes per second) and rises again when there is
+// time to spare, so the same call gets faster when the machine is busy and
+// smaller when it isn't. See GTMZlibStream's targetThroughput and CPUBudget
+// to do the same on a stream.
+
+/// Return an autoreleased NSData w/ the result of gzipping the bytes at about |targetThroughput|.
++ (nullable NSData *)gtm_dataByGzippingBytes:(const void *)bytes
+                                      length:(NSUInteger)length
+                            targetThroughput:(double)targetThroughput
+                                       error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of gzipping the payload of |data| at about |targetThroughput|.
++ (nullable NSData *)gtm_dataByGzippingData:(NSData *)data
+                           targetThroughput:(double)targetThroughput
+                                      error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of deflating the bytes at about |targetThroughput|.
++ (nullable NSData *)gtm_dataByDeflatingBytes:(const void *)bytes
+                                       length:(NSUInteger)length
+                             targetThroughput:(double)targetThroughput
+                                        error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of deflating the payload of |data| at about |targetThroughput|.
++ (nullable NSData *)gtm_dataByDeflatingData:(NSData *)data
+                            targetThroughput:(double)targetThroughput
+                                       error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of *raw* deflating the bytes at about |targetThroughput|.
+//
+//  *No* header is added to the resulting data.
++ (nullable NSData *)gtm_dataByRawDeflatingBytes:(const void *)bytes
+                                          length:(NSUInteger)length
+                                targetThroughput:(double)targetThroughput
+                                           error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of *raw* deflating the payload of |data| at about |targetThroughput|.
++ (nullable NSData *)gtm_dataByRawDeflatingData:(NSData *)data
+                               targetThroughput:(double)targetThroughput
+                                          error:(NSError **)error;
+
+#pragma mark Scatter-Gather Compression
+
+// These compress input that is in several pieces, an array of NSData or a
+// dispatch_data_t, as if it were one buffer, handing each piece to zlib in
+// turn instead of first copying them all into one NSData. Discontiguous
+// NSData objects are read region by region too. Empty input gives nil, like
+// the other apis.
+
+/// Return an autoreleased NSData w/ the result of gzipping the concatenation of |dataArray|.
+//
+// |level| can be 1-9, any other values will be clipped to that range.
++ (nullable NSData *)gtm_dataByGzippingDataArray:(NSArray<NSData *> *)dataArray
+                                compressionLevel:(int)level
+                                           error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of gzipping the regions of |data|.
++ (nullable NSData *)gtm_dataByGzippingDispatchData:(dispatch_data_t)data
+                                   compressionLevel:(int)level
+                                              error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of deflating the concatenation of |dataArray|.
+//
+// |level| can be 1-9, any other values will be clipped to that range.
++ (nullable NSData *)gtm_dataByDeflatingDataArray:(NSArray<NSData *> *)dataArray
+                                 compressionLevel:(int)level
+                                            error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of deflating the regions of |data|.
++ (nullable NSData *)gtm_dataByDeflatingDispatchData:(dispatch_data_t)data
+                                    compressionLevel:(int)level
+                                               error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of *raw* deflating the concatenation of |dataArray|.
+//
+// |level| can be 1-9, any other values will be clipped to that range.
++ (nullable NSData *)gtm_dataByRawDeflatingDataArray:(NSArray<NSData *> *)dataArray
+                                    compressionLevel:(int)level
+                                               error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of *raw* deflating the regions of |data|.
++ (nullable NSData *)gtm_dataByRawDeflatingDispatchData:(dispatch_data_t)data
+                                       compressionLevel:(int)level
+                                                  error:(NSError **)error;
+
+#pragma mark Checksums
+
+// CRC-32 (the gzip, zip and PNG checksum) and Adler-32 (the zlib stream
+// checksum), the same values zlib's crc32() and adler32() return. CRC-32 uses
+// the CPU's carry-less multiply (x86_64) or CRC32 (arm64) instructions where
+// it has them. The parallel versions split inputs of a few MB or more across
+// cores and merge the pieces with crc32_combine()/adler32_combine().
+
+/// Returns the CRC-32 of the receiver's bytes.
+- (uint32_t)gtm_crc32;
+
+/// Returns the Adler-32 of the receiver's bytes.
+- (uint32_t)gtm_adler32;
+
+/// Returns the CRC-32 of the receiver's bytes, checksumming pieces on all cores.
+- (uint32_t)gtm_parallelCrc32;
+
+/// Returns the Adler-32 of the receiver's bytes, checksumming pieces on all cores.
+- (uint32_t)gtm_parallelAdler32;
+
+/// Returns the CRC-32 of |length| bytes continuing from |crc| (0 to start), so
+/// a checksum can be built up a piece at a time.
++ (uint32_t)gtm_crc32OfBytes:(nullable const void *)bytes
+                      length:(NSUInteger)length
+                         crc:(uint32_t)crc;
+
+/// Returns the Adler-32 of |length| bytes continuing from |adler| (1 to start).
++ (uint32_t)gtm_adler32OfBytes:(nullable const void *)bytes
+                        length:(NSUInteger)length
+                         adler:(uint32_t)adler;
+
+/// Returns the CRC-32 of two pieces back to back, given the CRC-32 of each and
+/// the length of the second.
++ (uint32_t)gtm_crc32ByCombiningCrc32:(uint32_t)crc1
+                            withCrc32:(uint32_t)crc2
+                               length:(uint64_t)length2;
+
+/// Returns the Adler-32 of two pieces back to back, given the Adler-32 of each
+/// and the length of the second.
++ (uint32_t)gtm_adler32ByCombiningAdler32:(uint32_t)adler1
+                              withAdler32:(uint32_t)adler2
+                                   length:(uint64_t)length2;
+
+#pragma mark Codecs
+
+// Compression with any GTMCompressionCodec (see GTMCompressionCodec.h), such
+// as the fast GTMLZCodec, wrapped in a frame that records the codec, length
+// and CRC-32. gtm_dataByInflatingData:error: and the other gzip/zlib inflating
+// apis (including the bounded ones) recognise and decode these frames.
+
+/// Return an autoreleased NSData w/ the result of compressing the bytes with
+/// |codec| at compression |level| (which the codec may ignore).
++ (nullable NSData *)gtm_dataByCompressingBytes:(const void *)bytes
+                                         length:(NSUInteger)length
+                                          codec:(id<GTMCompressionCodec>)codec
+                               compressionLevel:(int)level
+                                          error:(NSError **)error;
+
+/// Return an autoreleased NSData w/ the result of compressing the data with
+/// |codec| at compression |level| (which the codec may ignore).
++ (nullable NSData *)gtm_dataByCompressingData:(NSData *)data
+                                         codec:(id<GTMCompressionCodec>)codec
+                              compressionLevel:(int)level
+                                         error:(NSError **)error;
+
 @end
 
 FOUNDATION_EXPORT NSString *const GTMNSDataZlibErrorDomain;
 FOUNDATION_EXPORT NSString *const GTMNSDataZlibErrorKey;  // NSNumber
 FOUNDATION_EXPORT NSString *const GTMNSDataZlibRemainingBytesKey;  // NSNumber
+FOUNDATION_EXPORT NSString *const GTMNSDataZlibPartialLengthKey;  // NSNumber
 
 typedef NS_ENUM(NSInteger, GTMNSDataZlibError) {
+  // No longer returned, input of any size is supported.
   GTMNSDataZlibErrorGreaterThan32BitsToCompress = 1024,
   // An internal zlib error.
   // GTMNSDataZlibErrorKey will contain the error value.
@@ -167,7 +696,15 @@ typedef NS_ENUM(NSInteger, GTMNSDataZlibError) {
   GTMNSDataZlibErrorInternal,
   // There was left over data in the buffer that was not used.
   // GTMNSDataZlibRemainingBytesKey will contain number of remaining bytes.
-  GTMNSDataZlibErrorDataRemaining
+  GTMNSDataZlibErrorDataRemaining,
+  // Decompressing stopped because the output passed a length or ratio limit.
+  // GTMNSDataZlibPartialLengthKey will contain the number of bytes that had
+  // been produced within the limit, GTMNSDataZlibRemainingBytesKey the number
+  // of input bytes not yet consumed.
+  GTMNSDataZlibErrorOutputLimitExceeded,
+  // The data is a GTMCompressionCodecs frame for a codec that isn't
+  // registered.
+  GTMNSDataZlibErrorUnknownCodec
 };
 
 NS_ASSUME_NONNULL_END
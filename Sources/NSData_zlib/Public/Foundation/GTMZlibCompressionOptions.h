@@ -0,0 +1,108 @@
+//
+//  GTMZlibCompressionOptions.h
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#import <Foundation/Foundation.h>
+#import "GTMDefines.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// How deflate searches for matches (the zlib |strategy|).
+typedef NS_ENUM(NSInteger, GTMZlibCompressionStrategy) {
+  /// Normal string matching (Z_DEFAULT_STRATEGY).
+  GTMZlibCompressionStrategyDefault,
+  /// Favors Huffman coding over short matches, for data like filtered images
+  /// that is mostly small, somewhat random values (Z_FILTERED).
+  GTMZlibCompressionStrategyFiltered,
+  /// No matching at all, just Huffman coding of the bytes (Z_HUFFMAN_ONLY).
+  /// Very fast; good for data with a skewed byte distribution but few repeats.
+  GTMZlibCompressionStrategyHuffmanOnly,
+  /// Only matches runs of a repeated byte (Z_RLE). Nearly as fast as
+  /// Huffman only, and close to the default ratio on data like images and
+  /// sparse binary records.
+  GTMZlibCompressionStrategyRLE,
+  /// Fixed Huffman codes only, no dynamic trees (Z_FIXED).
+  GTMZlibCompressionStrategyFixed,
+};
+
+// The named presets, see optionsWithPreset:.
+
+/// Level 1 with the fastest hashing; for text and JSON where speed matters more
+/// than the last few percent.
+FOUNDATION_EXPORT NSString *const GTMZlibCompressionPresetFastText;  // "fast-text"
+/// A 1KB window and small hash table, under 8KB of deflate state instead of
+/// about 256KB (and a 1KB window to inflate), at some cost in ratio and speed.
+/// For many concurrent streams or constrained devices.
+FOUNDATION_EXPORT NSString *const GTMZlibCompressionPresetSmallMemory;  // "small-memory"
+/// GTMZlibCompressionStrategyRLE, for binary data.
+FOUNDATION_EXPORT NSString *const GTMZlibCompressionPresetBinaryRLE;  // "binary-rle"
+/// GTMZlibCompressionStrategyHuffmanOnly, for data that barely compresses.
+FOUNDATION_EXPORT NSString *const GTMZlibCompressionPresetHuffmanOnly;  // "huffman-only"
+/// Picks one of the others for each input by sampling it, see
+/// optionsForBytes:length:.
+FOUNDATION_EXPORT NSString *const GTMZlibCompressionPresetAutomatic;  // "auto"
+
+/// The deflate parameters the GTMNSData+zlib apis otherwise fix.
+//
+// Everything a reader needs is in the compressed stream, so data compressed
+// with any options decodes with the normal inflate apis.
+@interface GTMZlibCompressionOptions : NSObject <NSCopying>
+
+/// The same as the plain GTMNSData+zlib apis use.
++ (instancetype)defaultOptions;
+
+/// Returns the options for the named preset (the GTMZlibCompressionPreset
+/// constants), or nil for an unknown name.
++ (nullable instancetype)optionsWithPreset:(NSString *)preset;
+
+/// Picks options for |bytes| from a sample of it.
+//
+// Up to 64KB, spread across the input, is checked for the share of repeated
+// bytes, how much of it is text and its byte entropy: long runs get
+// binary-rle, text gets fast-text, near random data gets huffman-only and
+// anything else the defaults.
++ (instancetype)optionsForBytes:(nullable const void *)bytes length:(NSUInteger)length;
+
+/// 1-9 or Z_DEFAULT_COMPRESSION (the default); other values are clipped like
+/// the GTMNSData+zlib apis.
+@property(nonatomic) int compressionLevel;
+
+/// Defaults to GTMZlibCompressionStrategyDefault.
+@property(nonatomic) GTMZlibCompressionStrategy strategy;
+
+/// How much memory to use for the match finder, 1-9 (defaults to 8); lower
+/// uses less memory and is a little slower and compresses a little worse.
+/// Other values are clipped.
+@property(nonatomic) int memoryLevel;
+
+/// The log2 of the window size, 9-15 (defaults to 15, a 32KB window). Smaller
+/// windows need less memory on both ends but find fewer matches. Other values
+/// are clipped.
+@property(nonatomic) int windowBits;
+
+/// YES for GTMZlibCompressionPresetAutomatic; the other properties are then
+/// ignored.
+@property(nonatomic, getter=isAutomatic) BOOL automatic;
+
+/// Returns the options to use for |bytes|: the result of
+/// optionsForBytes:length: if automatic, otherwise self.
+- (GTMZlibCompressionOptions *)resolvedOptionsForBytes:(nullable const void *)bytes
+                                                length:(NSUInteger)length;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,133 @@
+//
+//  GTMZlibCompressionQueue.h
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#import <Foundation/Foundation.h>
+#import "GTMDefines.h"
+#import "GTMZlibStream.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Called with the result, or nil and an error. A cancelled task gets
+/// NSCocoaErrorDomain/NSUserCancelledError.
+typedef void (^GTMZlibCompressionCompletion)(NSData *_Nullable result,
+                                             NSError *_Nullable error);
+
+/// A job submitted to a GTMZlibCompressionQueue.
+@interface GTMZlibCompressionTask : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Cancels the task. If it hasn't started it is dropped from the queue, if it
+/// is running its result is thrown away; either way the completion is called
+/// with a cancellation error. Does nothing once the task has finished.
+- (void)cancel;
+
+@property(nonatomic, readonly, getter=isCancelled) BOOL cancelled;
+
+@end
+
+/// A snapshot of a queue's activity, to help size it.
+typedef struct {
+  /// Tasks waiting for a worker.
+  NSUInteger pendingTasks;
+  /// Workers running right now (at most maximumConcurrentWorkers).
+  NSUInteger activeWorkers;
+  /// Since the queue was created or the statistics were reset.
+  uint64_t completedTasks;
+  uint64_t cancelledTasks;
+  /// Worker wakeups; with batching this is lower than completedTasks.
+  uint64_t batches;
+  /// From submission to a worker starting the task.
+  NSTimeInterval averageWaitTime;
+  NSTimeInterval maximumWaitTime;
+  /// Time spent compressing or decompressing.
+  NSTimeInterval averageRunTime;
+} GTMZlibCompressionQueueStatistics;
+
+/// Compresses and decompresses off the calling thread.
+//
+// Work runs on at most maximumConcurrentWorkers threads at once, however much
+// is submitted, and each completion is called on the queue given with it.
+// Small tasks submitted close together are picked up by one worker as a batch
+// (up to about 256KB of input) rather than a wakeup each, and their
+// completions for the same callback queue are delivered in one block. Tasks
+// start in the order they were submitted. The results are the same as the
+// GTMNSData+zlib apis give, except empty input gives an empty stream rather
+// than nil.
+//
+// All methods are thread safe.
+@interface GTMZlibCompressionQueue : NSObject
+
+/// A queue with a worker per core, shared by everything in the process.
++ (GTMZlibCompressionQueue *)sharedQueue;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Designated initializer. |maximumConcurrentWorkers| of 0 means one per core.
+- (instancetype)initWithMaximumConcurrentWorkers:(NSUInteger)maximumConcurrentWorkers
+    NS_DESIGNATED_INITIALIZER;
+
+@property(nonatomic, readonly) NSUInteger maximumConcurrentWorkers;
+
+/// Compresses |data| into |format| (GTMZlibStreamFormatAutoDetect means zlib)
+/// at compression |level|, then calls |completion| on |callbackQueue| (the main
+/// queue if NULL).
+- (GTMZlibCompressionTask *)compressData:(NSData *)data
+                                  format:(GTMZlibStreamFormat)format
+                        compressionLevel:(int)level
+                           callbackQueue:(nullable dispatch_queue_t)callbackQueue
+                              completion:(GTMZlibCompressionCompletion)completion;
+
+/// Decompresses |data| in |format|, then calls |completion| on |callbackQueue|
+/// (the main queue if NULL).
+- (GTMZlibCompressionTask *)decompressData:(NSData *)data
+                                    format:(GTMZlibStreamFormat)format
+                             callbackQueue:(nullable dispatch_queue_t)callbackQueue
+                                completion:(GTMZlibCompressionCompletion)completion;
+
+/// Current statistics.
+- (GTMZlibCompressionQueueStatistics)statistics;
+
+/// Zeroes the counters and times in the statistics.
+- (void)resetStatistics;
+
+@end
+
+/// Asynchronous versions of GTMNSData+zlib apis, on the shared queue.
+@interface NSData (GTMZlibAsyncAdditions)
+
+/// Gzips |data| at compression |level| off the calling thread.
++ (GTMZlibCompressionTask *)gtm_gzipData:(NSData *)data
+                        compressionLevel:(int)level
+                           callbackQueue:(nullable dispatch_queue_t)callbackQueue
+                              completion:(GTMZlibCompressionCompletion)completion;
+
+/// Deflates |data| at compression |level| off the calling thread.
++ (GTMZlibCompressionTask *)gtm_deflateData:(NSData *)data
+                           compressionLevel:(int)level
+                              callbackQueue:(nullable dispatch_queue_t)callbackQueue
+                                 completion:(GTMZlibCompressionCompletion)completion;
+
+/// Decompresses gzip or zlib |data| off the calling thread.
++ (GTMZlibCompressionTask *)gtm_inflateData:(NSData *)data
+                              callbackQueue:(nullable dispatch_queue_t)callbackQueue
+                                 completion:(GTMZlibCompressionCompletion)completion;
+
+@end
+
+NS_ASSUME_NONNULL_END
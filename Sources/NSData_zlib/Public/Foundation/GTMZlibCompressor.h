@@ -0,0 +1,260 @@
+//
+//  GTMZlibCompressor.h
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#import <Foundation/Foundation.h>
+#import "GTMDefines.h"
+#import "GTMZlibCompressionOptions.h"
+#import "GTMZlibStream.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// One shot compression that reuses its zlib state between calls.
+//
+// Setting up a deflate stream allocates about 256KB (and an inflate stream
+// about 7KB plus a 32KB window on first use); for small payloads that costs
+// more than the compression itself. A compressor sets up its stream once and
+// only resets it for each payload. Each result is a complete, independent
+// stream, the same as the GTMNSData+zlib apis produce.
+//
+// A compressor is not thread safe; use it from one thread at a time. The
+// class methods borrow a compressor from a shared, thread safe pool, which is
+// what the GTMNSData+zlib apis use. The pool holds at most two idle
+// compressors and decompressors per core, releases any configuration that
+// goes unused for 30 seconds, and empties itself under memory pressure.
+@interface GTMZlibCompressor : NSObject
+
+/// Returns a compressor for |format| at compression |level| (1-9, other values
+/// are clipped like the GTMNSData+zlib apis, Z_DEFAULT_COMPRESSION is
+/// allowed). GTMZlibStreamFormatAutoDetect means GTMZlibStreamFormatZlib.
++ (nullable instancetype)compressorWithFormat:(GTMZlibStreamFormat)format
+                             compressionLevel:(int)level
+                                        error:(NSError **)error;
+
+/// Returns a compressor for |format| using |options| (nil for the defaults).
++ (nullable instancetype)compressorWithFormat:(GTMZlibStreamFormat)format
+                                      options:(nullable GTMZlibCompressionOptions *)options
+                                        error:(NSError **)error;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+- (nullable instancetype)initWithFormat:(GTMZlibStreamFormat)format
+                       compressionLevel:(int)level
+                                  error:(NSError **)error;
+
+/// Designated initializer. |options| are copied. With automatic options the
+/// choice is made for each payload, and the zlib state is only set up again
+/// when it changes.
+- (nullable instancetype)initWithFormat:(GTMZlibStreamFormat)format
+                                options:(nullable GTMZlibCompressionOptions *)options
+                                  error:(NSError **)error NS_DESIGNATED_INITIALIZER;
+
+@property(nonatomic, readonly) GTMZlibStreamFormat format;
+@property(nonatomic, readonly) int compressionLevel;
+@property(nonatomic, readonly, copy) GTMZlibCompressionOptions *options;
+
+/// Compresses |length| bytes into a new stream, primed with |dictionary| if
+/// given (zlib and raw only, see GTMNSData+zlib's Preset Dictionaries).
+- (nullable NSData *)compressBytes:(nullable const void *)bytes
+                            length:(NSUInteger)length
+                        dictionary:(nullable NSData *)dictionary
+                             error:(NSError **)error;
+
+/// Compresses the bytes of |data| into a new stream.
+- (nullable NSData *)compressData:(NSData *)data error:(NSError **)error;
+
+/// Compresses the concatenation of |dataArray| into a new stream.
+//
+// Each piece (and each region of a discontiguous NSData) is handed to zlib in
+// turn, so they are never copied into one buffer first.
+- (nullable NSData *)compressDataArray:(NSArray<NSData *> *)dataArray
+                                 error:(NSError **)error;
+
+/// Compresses the regions of |data| into a new stream without coalescing them.
+- (nullable NSData *)compressDispatchData:(dispatch_data_t)data error:(NSError **)error;
+
+/// Compresses |length| bytes with a compressor from the shared pool.
++ (nullable NSData *)compressBytes:(nullable const void *)bytes
+                            length:(NSUInteger)length
+                            format:(GTMZlibStreamFormat)format
+                  compressionLevel:(int)level
+                        dictionary:(nullable NSData *)dictionary
+                             error:(NSError **)error;
+
+/// Compresses the concatenation of |dataArray| with a compressor from the
+/// shared pool.
++ (nullable NSData *)compressDataArray:(NSArray<NSData *> *)dataArray
+                                format:(GTMZlibStreamFormat)format
+                      compressionLevel:(int)level
+                                 error:(NSError **)error;
+
+/// Compresses the regions of |data| with a compressor from the shared pool.
++ (nullable NSData *)compressDispatchData:(dispatch_data_t)data
+                                   format:(GTMZlibStreamFormat)format
+                         compressionLevel:(int)level
+                                    error:(NSError **)error;
+
+/// Compresses |length| bytes with a compressor from the shared pool, set up
+/// with |options| (nil for the defaults).
++ (nullable NSData *)compressBytes:(nullable const void *)bytes
+                            length:(NSUInteger)length
+                            format:(GTMZlibStreamFormat)format
+                           options:(nullable GTMZlibCompressionOptions *)options
+                        dictionary:(nullable NSData *)dictionary
+                             error:(NSError **)error;
+
+@end
+
+/// One shot decompression that reuses its zlib state between calls.
+//
+// See GTMZlibCompressor. Gzip input may be several concatenated members, and
+// data after the end of the stream is an error (GTMNSDataZlibErrorDataRemaining),
+// just like gtm_dataByInflatingData:.
+@interface GTMZlibDecompressor : NSObject
+
+/// Returns a decompressor for data in |format|.
++ (nullable instancetype)decompressorWithFormat:(GTMZlibStreamFormat)format
+                                          error:(NSError **)error;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Designated initializer.
+- (nullable instancetype)initWithFormat:(GTMZlibStreamFormat)format
+                                  error:(NSError **)error NS_DESIGNATED_INITIALIZER;
+
+@property(nonatomic, readonly) GTMZlibStreamFormat format;
+
+/// If non zero, decompressing fails with GTMNSDataZlibErrorOutputLimitExceeded
+/// as soon as the output would pass this many bytes. Defaults to 0.
+@property(nonatomic) NSUInteger maximumOutputLength;
+
+/// If non zero, decompressing fails with GTMNSDataZlibErrorOutputLimitExceeded
+/// as soon as the output would pass this multiple of the input length.
+/// Defaults to 0.
+@property(nonatomic) NSUInteger maximumCompressionRatio;
+
+/// Decompresses |length| bytes holding a complete stream.
+//
+// |expectedLength| is a hint at the result size (0 to use the gzip trailer or
+// a guess), see gtm_dataByInflatingBytes:length:expectedLength:error:.
+// |dictionary| is used if the stream needs one (or up front for raw data).
+- (nullable NSData *)decompressBytes:(nullable const void *)bytes
+                              length:(NSUInteger)length
+                      expectedLength:(NSUInteger)expectedLength
+                          dictionary:(nullable NSData *)dictionary
+                               error:(NSError **)error;
+
+/// Decompresses the bytes of |data|.
+- (nullable NSData *)decompressData:(NSData *)data error:(NSError **)error;
+
+/// Decompresses |length| bytes with a decompressor from the shared pool.
++ (nullable NSData *)decompressBytes:(nullable const void *)bytes
+                              length:(NSUInteger)length
+                              format:(GTMZlibStreamFormat)format
+                      expectedLength:(NSUInteger)expectedLength
+                          dictionary:(nullable NSData *)dictionary
+                               error:(NSError **)error;
+
+/// Decompresses |length| bytes with a decompressor from the shared pool,
+/// stopping at the given limits (0 for none, see maximumOutputLength and
+/// maximumCompressionRatio).
++ (nullable NSData *)decompressBytes:(nullable const void *)bytes
+                              length:(NSUInteger)length
+                              format:(GTMZlibStreamFormat)format
+                      expectedLength:(NSUInteger)expectedLength
+                 maximumOutputLength:(NSUInteger)maximumOutputLength
+             maximumCompressionRatio:(NSUInteger)maximumCompressionRatio
+                          dictionary:(nullable NSData *)dictionary
+                               error:(NSError **)error;
+
+@end
+
+/// Compresses a series of messages as one continuous raw deflate stream.
+//
+// This is the framing of websocket permessage-deflate (RFC 7692): each
+// message is ended with a sync flush, so the peer can decode it as soon as it
+// arrives, and the 0x00 0x00 0xff 0xff that ends every sync flush is left off.
+// With context takeover (the default) the 32KB window carries over from one
+// message to the next, so a message can refer back to earlier ones; for
+// streams of small, similar messages that compresses far better than
+// compressing each one on its own, and costs no latency.
+//
+// Messages must be decoded in order by a GTMZlibMessageDecompressor with the
+// same contextTakeover. Not thread safe.
+@interface GTMZlibMessageCompressor : NSObject
+
+/// Returns a compressor at compression |level| with context takeover.
++ (nullable instancetype)compressorWithCompressionLevel:(int)level
+                                                  error:(NSError **)error;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Designated initializer. |level| is treated like the GTMNSData+zlib apis.
+/// Without |contextTakeover| each message starts from an empty window.
+- (nullable instancetype)initWithCompressionLevel:(int)level
+                                  contextTakeover:(BOOL)contextTakeover
+                                            error:(NSError **)error NS_DESIGNATED_INITIALIZER;
+
+@property(nonatomic, readonly) int compressionLevel;
+@property(nonatomic, readonly) BOOL contextTakeover;
+
+/// Compresses the next message, returning it without the sync flush marker.
+- (nullable NSData *)compressMessageBytes:(nullable const void *)bytes
+                                   length:(NSUInteger)length
+                                    error:(NSError **)error;
+
+/// Compresses the bytes of |message| as the next message.
+- (nullable NSData *)compressMessage:(NSData *)message error:(NSError **)error;
+
+@end
+
+/// Decompresses the messages of a GTMZlibMessageCompressor.
+//
+// The marker left off by the compressor is put back before decoding. A message
+// that ends the deflate stream (a final block, as some peers send when not
+// taking over context) is accepted, and the next message starts a fresh
+// stream. After an error the shared window is gone, so following messages are
+// decoded as if from a fresh stream; normally the channel should be dropped.
+@interface GTMZlibMessageDecompressor : NSObject
+
+/// Returns a decompressor with context takeover.
++ (nullable instancetype)decompressorWithError:(NSError **)error;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Designated initializer.
+- (nullable instancetype)initWithContextTakeover:(BOOL)contextTakeover
+                                           error:(NSError **)error NS_DESIGNATED_INITIALIZER;
+
+@property(nonatomic, readonly) BOOL contextTakeover;
+
+/// If non zero, decompressing a message fails with
+/// GTMNSDataZlibErrorOutputLimitExceeded as soon as it would pass this many
+/// bytes. Defaults to 0.
+@property(nonatomic) NSUInteger maximumMessageLength;
+
+/// Decompresses the next message.
+- (nullable NSData *)decompressMessageBytes:(nullable const void *)bytes
+                                     length:(NSUInteger)length
+                                      error:(NSError **)error;
+
+/// Decompresses the bytes of |message| as the next message.
+- (nullable NSData *)decompressMessage:(NSData *)message error:(NSError **)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
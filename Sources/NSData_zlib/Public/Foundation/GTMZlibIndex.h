@@ -0,0 +1,81 @@
+//
+//  GTMZlibIndex.h
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#import <Foundation/Foundation.h>
+#import "GTMDefines.h"
+#import "GTMZlibStream.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Random access into zlib, gzip or raw deflate data.
+//
+// Deflate data can normally only be read from the start. An index records
+// "access points" as it inflates the data once: the position in both the
+// compressed and uncompressed data plus the 32KB of output before it (what
+// deflate may refer back to). Reading a range then only inflates from the
+// closest access point before it, at most one span, instead of everything
+// before it. This is the approach of zlib's examples/zran.c.
+//
+// Each access point costs up to 32KB, so the span trades index size against
+// how much has to be inflated for a read. Concatenated gzip members are
+// supported.
+//
+// An index can be serialized (with the windows compressed) and stored next to
+// the data it describes. It is immutable and safe to use from any thread.
+@interface GTMZlibIndex : NSObject
+
+/// Builds an index for |data| with an access point about every |spanSize|
+/// bytes of output (0 means 1MB). |format| may be GTMZlibStreamFormatAutoDetect
+/// to accept zlib or gzip.
++ (nullable instancetype)indexWithData:(NSData *)data
+                                format:(GTMZlibStreamFormat)format
+                              spanSize:(NSUInteger)spanSize
+                                 error:(NSError **)error;
+
+/// Recreates an index from the output of |serializedData|.
++ (nullable instancetype)indexWithSerializedData:(NSData *)serializedData
+                                           error:(NSError **)error;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// The format of the indexed data (never GTMZlibStreamFormatAutoDetect).
+@property(nonatomic, readonly) GTMZlibStreamFormat format;
+
+/// Length of the compressed data the index was built from.
+@property(nonatomic, readonly) uint64_t compressedLength;
+
+/// Length of the data once inflated.
+@property(nonatomic, readonly) uint64_t uncompressedLength;
+
+/// Number of access points.
+@property(nonatomic, readonly) NSUInteger accessPointCount;
+
+/// A compact form of the index to save and pass to
+/// indexWithSerializedData:error: later.
+- (NSData *)serializedData;
+
+/// Returns the bytes in |range| of the uncompressed data, reading only the
+/// part of |data| needed. |data| must be the data the index was built from.
+/// A range past the end is clipped to the end.
+- (nullable NSData *)readRange:(NSRange)range
+                      fromData:(NSData *)data
+                         error:(NSError **)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
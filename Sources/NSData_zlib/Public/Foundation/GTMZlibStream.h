@@ -0,0 +1,177 @@
+//
+//  GTMZlibStream.h
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#import <Foundation/Foundation.h>
+#import "GTMDefines.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// The header/trailer a GTMZlibStream reads or writes.
+typedef NS_ENUM(NSInteger, GTMZlibStreamFormat) {
+  /// zlib header and adler32 trailer (what the "Deflating" apis produce).
+  GTMZlibStreamFormatZlib,
+  /// gzip header and crc32 trailer.
+  GTMZlibStreamFormatGzip,
+  /// No header or trailer at all (what the "RawDeflating" apis produce).
+  GTMZlibStreamFormatRaw,
+  /// Inflate only: accept either zlib or gzip, like gtm_dataByInflatingData:.
+  /// Deflate streams treat this as GTMZlibStreamFormatZlib.
+  GTMZlibStreamFormatAutoDetect,
+};
+
+/// How much pending output a GTMZlibStream should force out.
+typedef NS_ENUM(NSInteger, GTMZlibStreamFlush) {
+  /// Let zlib buffer as it sees fit (Z_NO_FLUSH).
+  GTMZlibStreamFlushNone,
+  /// Output everything for the input so far, ending on a byte boundary
+  /// (Z_SYNC_FLUSH). The stream can continue afterwards.
+  GTMZlibStreamFlushSync,
+  /// End the stream (Z_FINISH). For inflate this just drains the output.
+  GTMZlibStreamFlushFinish,
+};
+
+/// Receives output from a GTMZlibStream. |bytes| is only valid for the
+/// duration of the call.
+typedef void (^GTMZlibStreamOutputHandler)(const void *bytes, NSUInteger length);
+
+/// Incremental deflate/inflate.
+//
+// Unlike the GTMNSData+zlib apis, which need the whole input in memory and
+// build the whole output in one NSData, a stream takes its input in chunks of
+// any size and hands back output as it is produced, either to a block or into
+// caller supplied buffers. Memory use is the zlib state plus one output chunk
+// no matter how much data goes through.
+//
+// The output is compatible with the GTMNSData+zlib apis in both directions.
+//
+// A stream is not thread safe; use it from one thread at a time.
+@interface GTMZlibStream : NSObject
+
+/// Returns a stream that compresses to |format| at compression |level| (1-9,
+/// other values are clipped like the GTMNSData+zlib apis, Z_DEFAULT_COMPRESSION
+/// is allowed).
++ (nullable instancetype)deflateStreamWithFormat:(GTMZlibStreamFormat)format
+                                compressionLevel:(int)level
+                                           error:(NSError **)error;
+
+/// Returns a stream that decompresses data in |format|.
++ (nullable instancetype)inflateStreamWithFormat:(GTMZlibStreamFormat)format
+                                           error:(NSError **)error;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Designated initializer. |level| is ignored for inflate streams.
+- (nullable instancetype)initWithDeflate:(BOOL)deflate
+                                  format:(GTMZlibStreamFormat)format
+                        compressionLevel:(int)level
+                                   error:(NSError **)error NS_DESIGNATED_INITIALIZER;
+
+/// YES for a compressing stream, NO for a decompressing one.
+@property(nonatomic, readonly, getter=isDeflating) BOOL deflating;
+
+@property(nonatomic, readonly) GTMZlibStreamFormat format;
+
+/// YES once the end of the stream has been written (deflate) or read
+/// (inflate). No further input is accepted.
+@property(nonatomic, readonly, getter=isFinished) BOOL finished;
+
+/// The largest chunk handed to a GTMZlibStreamOutputHandler. Defaults to
+/// 64KB.
+@property(nonatomic) NSUInteger outputChunkSize;
+
+/// Bytes consumed and produced so far.
+@property(nonatomic, readonly) uint64_t totalBytesIn;
+@property(nonatomic, readonly) uint64_t totalBytesOut;
+
+#pragma mark Adaptive Compression
+
+/// The level deflate is compressing at now. Starts at the level the stream was
+/// created with (Z_DEFAULT_COMPRESSION is reported as 6) and moves when a
+/// targetThroughput or CPUBudget is set. 0 for inflate streams.
+@property(nonatomic, readonly) int compressionLevel;
+
+/// Input bytes per second the stream should compress at, or 0 (the default)
+/// to keep the level fixed.
+//
+// The stream times itself over every 256KB of input and, between those
+// slices, lowers the level when it is slower than the target and tries a
+// higher one when there is room to spare. A level change ends the current
+// deflate block, so output stays readable by any inflater. Adjustments only
+// happen in the Block Output apis; the Caller Buffer Output api leaves the
+// level alone.
+@property(nonatomic) double targetThroughput;
+
+/// The share of one core (0-1) the stream may spend compressing, or 0 (the
+/// default) for no limit.
+//
+// The time spent in deflate is compared with the time input took to arrive
+// (including whatever the caller did between appends), so a stream fed at
+// 10MB/s with a budget of 0.25 aims to compress at 40MB/s or better. With
+// both set the stricter target wins.
+@property(nonatomic) double CPUBudget;
+
+#pragma mark Block Output
+
+/// Feeds |length| bytes to the stream; any output is passed to |handler|.
+//
+// For inflate streams, data after the end of the compressed stream is an
+// error (GTMNSDataZlibErrorDataRemaining) just like for gtm_dataByInflatingData:.
+- (BOOL)appendBytes:(const void *)bytes
+             length:(NSUInteger)length
+      outputHandler:(GTMZlibStreamOutputHandler)handler
+              error:(NSError **)error;
+
+/// Same as appendBytes:length:outputHandler:error: for the bytes of |data|.
+- (BOOL)appendData:(NSData *)data
+     outputHandler:(GTMZlibStreamOutputHandler)handler
+             error:(NSError **)error;
+
+/// Forces out all output for the input so far (GTMZlibStreamFlushSync), so a
+/// reader can decode everything written up to this point.
+- (BOOL)flushWithOutputHandler:(GTMZlibStreamOutputHandler)handler
+                         error:(NSError **)error;
+
+/// Ends the stream. For deflate this writes the trailer; for inflate it drains
+/// the remaining output and fails with a Z_BUF_ERROR if the compressed data
+/// was truncated.
+- (BOOL)finishWithOutputHandler:(GTMZlibStreamOutputHandler)handler
+                          error:(NSError **)error;
+
+#pragma mark Caller Buffer Output
+
+/// Runs the stream over |bytes| writing into |buffer|.
+//
+// On return |bytesRead| is how much of the input was used and |bytesWritten|
+// how much of |buffer| was filled. Call again with the unused input and more
+// room until all input is used; when flushing, also until |bytesWritten| is
+// less than |capacity| (or the stream is finished for
+// GTMZlibStreamFlushFinish). |bytes| may be NULL if |length| is 0.
+//
+// Returns NO and sets |error| only for corrupt input or internal zlib errors.
+- (BOOL)processBytes:(nullable const void *)bytes
+              length:(NSUInteger)length
+           bytesRead:(NSUInteger *)bytesRead
+            toBuffer:(void *)buffer
+            capacity:(NSUInteger)capacity
+        bytesWritten:(NSUInteger *)bytesWritten
+               flush:(GTMZlibStreamFlush)flush
+               error:(NSError **)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -22,6 +22,12 @@
 
 #import "GTMStringEncoding.h"
 
+#if defined(__x86_64__)
+#import <immintrin.h>
+#elif defined(__aarch64__)
+#import <arm_neon.h>
+#endif
+
 NSString *const GTMStringEncodingErrorDomain = @"com.google.GTMStringEncodingErrorDomain";
 NSString *const GTMStringEncodingBadCharacterIndexKey = @"GTMStringEncodingBadCharacterIndexKey";
 
@@ -31,7 +37,516 @@ enum {
   kIgnoreChar = -3
 };
 
-@implementation GTMStringEncoding
+// Base64 alphabets with the SIMD kernels start with these; only the
+// characters for 62 and 63 vary.
+static const char kBase64Letters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+
+#if defined(__x86_64__)
+
+// The base64 kernels follow Wojciech Muła's SSE/AVX2 base64 work: a shuffle
+// and two multiplies split every 3 bytes into four 6 bit values, and the
+// alphabet is a handful of range checks. Only SSSE3 is needed; AVX2 does two
+// groups of 12 bytes at once.
+
+static BOOL HasSSSE3(void) {
+  static BOOL hasSSSE3;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    hasSSSE3 = __builtin_cpu_supports("ssse3") ? YES : NO;
+  });
+  return hasSSSE3;
+}
+
+static BOOL HasAVX2(void) {
+  static BOOL hasAVX2;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    hasAVX2 = __builtin_cpu_supports("avx2") ? YES : NO;
+  });
+  return hasAVX2;
+}
+
+// Spreads bytes 0-11 of |in| into four 6 bit values per 3 bytes.
+__attribute__((target("ssse3")))
+GTM_INLINE __m128i SplitBase64Groups(__m128i in) {
+  in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+  __m128i high = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+                                 _mm_set1_epi32(0x04000040));
+  __m128i low = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+                                _mm_set1_epi32(0x01000010));
+  return _mm_or_si128(high, low);
+}
+
+// Maps 6 bit values to characters: each range of the alphabet is a fixed
+// offset from its values, picked from |offsets| by range.
+__attribute__((target("ssse3")))
+GTM_INLINE __m128i Base64Characters(__m128i values, __m128i offsets) {
+  __m128i range = _mm_subs_epu8(values, _mm_set1_epi8(51));
+  __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), values);
+  range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+  return _mm_add_epi8(values, _mm_shuffle_epi8(offsets, range));
+}
+
+__attribute__((target("ssse3")))
+GTM_INLINE __m128i Base64Offsets(const char *charMap) {
+  return _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                       '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                       (char)(charMap[62] - 62), (char)(charMap[63] - 63), 'A', 0, 0);
+}
+
+// 0xff where |lo| <= |in| < |lo| + |count| (unsigned).
+__attribute__((target("ssse3")))
+GTM_INLINE __m128i InRange(__m128i in, char lo, char count) {
+  __m128i offset = _mm_sub_epi8(in, _mm_set1_epi8(lo));
+  return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(count - 1)), offset);
+}
+
+// Maps characters to 6 bit values, clearing |*valid| lanes for anything not
+// in the alphabet.
+__attribute__((target("ssse3")))
+GTM_INLINE __m128i Base64Values(__m128i in, const char *charMap, __m128i *valid) {
+  __m128i upper = InRange(in, 'A', 26);
+  __m128i lower = InRange(in, 'a', 26);
+  __m128i digit = InRange(in, '0', 10);
+  __m128i is62 = _mm_cmpeq_epi8(in, _mm_set1_epi8(charMap[62]));
+  __m128i is63 = _mm_cmpeq_epi8(in, _mm_set1_epi8(charMap[63]));
+  __m128i offset = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+  offset = _mm_or_si128(offset, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+  offset = _mm_or_si128(offset, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+  offset = _mm_or_si128(offset, _mm_and_si128(is62, _mm_set1_epi8((char)(62 - charMap[62]))));
+  offset = _mm_or_si128(offset, _mm_and_si128(is63, _mm_set1_epi8((char)(63 - charMap[63]))));
+  *valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(is62, is63)));
+  return _mm_add_epi8(in, offset);
+}
+
+// Packs four 6 bit values per 32 bit lane into 3 bytes, in bytes 0-11.
+__attribute__((target("ssse3")))
+GTM_INLINE __m128i JoinBase64Groups(__m128i values) {
+  __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+  __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+  return _mm_shuffle_epi8(groups, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                                -1, -1, -1, -1));
+}
+
+__attribute__((target("ssse3")))
+static NSUInteger EncodeBase64SSSE3(const unsigned char *in, NSUInteger inLen,
+                                    unsigned char *out, const char *charMap) {
+  __m128i offsets = Base64Offsets(charMap);
+  NSUInteger inPos = 0;
+  unsigned char *outPos = out;
+  // 16 byte loads, 12 bytes used.
+  for (; inLen - inPos >= 16; inPos += 12, outPos += 16) {
+    __m128i in16 = _mm_loadu_si128((const __m128i *)(in + inPos));
+    _mm_storeu_si128((__m128i *)outPos, Base64Characters(SplitBase64Groups(in16), offsets));
+  }
+  return inPos;
+}
+
+__attribute__((target("avx2")))
+static NSUInteger EncodeBase64AVX2(const unsigned char *in, NSUInteger inLen,
+                                   unsigned char *out, const char *charMap) {
+  __m128i offsets = Base64Offsets(charMap);
+  __m256i offsets2 = _mm256_broadcastsi128_si256(offsets);
+  __m256i shuffle = _mm256_broadcastsi128_si256(
+      _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+  NSUInteger inPos = 0;
+  unsigned char *outPos = out;
+  // Two 16 byte loads 12 bytes apart, 24 bytes used.
+  for (; inLen - inPos >= 28; inPos += 24, outPos += 32) {
+    __m256i in32 = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(in + inPos))),
+        _mm_loadu_si128((const __m128i *)(in + inPos + 12)), 1);
+    in32 = _mm256_shuffle_epi8(in32, shuffle);
+    __m256i high = _mm256_mulhi_epu16(_mm256_and_si256(in32, _mm256_set1_epi32(0x0fc0fc00)),
+                                      _mm256_set1_epi32(0x04000040));
+    __m256i low = _mm256_mullo_epi16(_mm256_and_si256(in32, _mm256_set1_epi32(0x003f03f0)),
+                                     _mm256_set1_epi32(0x01000010));
+    __m256i values = _mm256_or_si256(high, low);
+    __m256i range = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), values);
+    range = _mm256_or_si256(range, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+    __m256i chars = _mm256_add_epi8(values, _mm256_shuffle_epi8(offsets2, range));
+    _mm256_storeu_si256((__m256i *)outPos, chars);
+  }
+  // Finish what's left of the vector sized input 12 bytes at a time.
+  return inPos + EncodeBase64SSSE3(in + inPos, inLen - inPos, outPos, charMap);
+}
+
+__attribute__((target("ssse3")))
+static NSUInteger DecodeBase64SSSE3(const unsigned char *in, NSUInteger inLen,
+                                    unsigned char *out, NSUInteger outLen,
+                                    const char *charMap) {
+  NSUInteger inPos = 0;
+  NSUInteger outPos = 0;
+  // 16 characters make 12 bytes, stored 16 at a time.
+  for (; inLen - inPos >= 16 && outLen - outPos >= 16; inPos += 16, outPos += 12) {
+    __m128i valid;
+    __m128i values = Base64Values(_mm_loadu_si128((const __m128i *)(in + inPos)), charMap,
+                                  &valid);
+    if (_mm_movemask_epi8(valid) != 0xffff) {
+      break;
+    }
+    _mm_storeu_si128((__m128i *)(out + outPos), JoinBase64Groups(values));
+  }
+  return inPos;
+}
+
+__attribute__((target("avx2")))
+static NSUInteger DecodeBase64AVX2(const unsigned char *in, NSUInteger inLen,
+                                   unsigned char *out, NSUInteger outLen,
+                                   const char *charMap) {
+  __m256i upperStart = _mm256_set1_epi8('A');
+  __m256i lowerStart = _mm256_set1_epi8('a');
+  __m256i digitStart = _mm256_set1_epi8('0');
+  __m256i letterLimit = _mm256_set1_epi8(25);
+  __m256i digitLimit = _mm256_set1_epi8(9);
+  __m256i char62 = _mm256_set1_epi8(charMap[62]);
+  __m256i char63 = _mm256_set1_epi8(charMap[63]);
+  NSUInteger inPos = 0;
+  NSUInteger outPos = 0;
+  // 32 characters make 24 bytes, stored 32 at a time.
+  for (; inLen - inPos >= 32 && outLen - outPos >= 32; inPos += 32, outPos += 24) {
+    __m256i in32 = _mm256_loadu_si256((const __m256i *)(in + inPos));
+    __m256i t = _mm256_sub_epi8(in32, upperStart);
+    __m256i upper = _mm256_cmpeq_epi8(_mm256_min_epu8(t, letterLimit), t);
+    t = _mm256_sub_epi8(in32, lowerStart);
+    __m256i lower = _mm256_cmpeq_epi8(_mm256_min_epu8(t, letterLimit), t);
+    t = _mm256_sub_epi8(in32, digitStart);
+    __m256i digit = _mm256_cmpeq_epi8(_mm256_min_epu8(t, digitLimit), t);
+    __m256i is62 = _mm256_cmpeq_epi8(in32, char62);
+    __m256i is63 = _mm256_cmpeq_epi8(in32, char63);
+    __m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+                                    _mm256_or_si256(digit, _mm256_or_si256(is62, is63)));
+    if ((uint32_t)_mm256_movemask_epi8(valid) != 0xffffffffU) {
+      break;
+    }
+    __m256i offset = _mm256_and_si256(upper, _mm256_set1_epi8(-'A'));
+    offset = _mm256_or_si256(offset, _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a')));
+    offset = _mm256_or_si256(offset, _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+    offset = _mm256_or_si256(
+        offset, _mm256_and_si256(is62, _mm256_set1_epi8((char)(62 - charMap[62]))));
+    offset = _mm256_or_si256(
+        offset, _mm256_and_si256(is63, _mm256_set1_epi8((char)(63 - charMap[63]))));
+    __m256i values = _mm256_add_epi8(in32, offset);
+    __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    __m256i groups = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+    groups = _mm256_shuffle_epi8(groups, _mm256_broadcastsi128_si256(_mm_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)));
+    // Close the gap between the lanes' 12 bytes.
+    groups = _mm256_permutevar8x32_epi32(groups, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+    _mm256_storeu_si256((__m256i *)(out + outPos), groups);
+  }
+  return inPos + DecodeBase64SSSE3(in + inPos, inLen - inPos, out + outPos, outLen - outPos,
+                                   charMap);
+}
+
+// Encodes whole 3 byte groups from the start of |in| into |out|, returning
+// how many bytes were used (4/3 as many characters are written).
+static NSUInteger EncodeBase64Vector(const unsigned char *in, NSUInteger inLen,
+                                     unsigned char *out, const char *charMap) {
+  if (HasAVX2()) {
+    return EncodeBase64AVX2(in, inLen, out, charMap);
+  } else if (HasSSSE3()) {
+    return EncodeBase64SSSE3(in, inLen, out, charMap);
+  }
+  return 0;  // COV_NF_LINE
+}
+
+// Decodes whole 4 character groups from the start of |in| into |out| (which
+// holds |outLen| bytes), stopping before any group with a character not in
+// the alphabet (padding, ignored characters, synonyms, errors). Returns how
+// many characters were used (3/4 as many bytes are written).
+static NSUInteger DecodeBase64Vector(const unsigned char *in, NSUInteger inLen,
+                                     unsigned char *out, NSUInteger outLen,
+                                     const char *charMap) {
+  if (HasAVX2()) {
+    return DecodeBase64AVX2(in, inLen, out, outLen, charMap);
+  } else if (HasSSSE3()) {
+    return DecodeBase64SSSE3(in, inLen, out, outLen, charMap);
+  }
+  return 0;  // COV_NF_LINE
+}
+
+#elif defined(__aarch64__)
+
+// NEON loads and stores de-interleave and interleave the groups for free, so
+// 48 bytes become four vectors of 6 bit values with a few shifts; the
+// alphabet is a 64 entry table lookup one way and range checks the other.
+
+static NSUInteger EncodeBase64Vector(const unsigned char *in, NSUInteger inLen,
+                                     unsigned char *out, const char *charMap) {
+  uint8x16x4_t table = vld1q_u8_x4((const uint8_t *)charMap);
+  uint8x16_t mask = vdupq_n_u8(0x3f);
+  NSUInteger inPos = 0;
+  unsigned char *outPos = out;
+  for (; inLen - inPos >= 48; inPos += 48, outPos += 64) {
+    uint8x16x3_t bytes = vld3q_u8(in + inPos);
+    uint8x16x4_t chars;
+    chars.val[0] = vqtbl4q_u8(table, vshrq_n_u8(bytes.val[0], 2));
+    chars.val[1] = vqtbl4q_u8(
+        table, vandq_u8(vorrq_u8(vshlq_n_u8(bytes.val[0], 4), vshrq_n_u8(bytes.val[1], 4)), mask));
+    chars.val[2] = vqtbl4q_u8(
+        table, vandq_u8(vorrq_u8(vshlq_n_u8(bytes.val[1], 2), vshrq_n_u8(bytes.val[2], 6)), mask));
+    chars.val[3] = vqtbl4q_u8(table, vandq_u8(bytes.val[2], mask));
+    vst4q_u8(outPos, chars);
+  }
+  return inPos;
+}
+
+// Maps characters to 6 bit values, setting |*invalid| lanes for anything not
+// in the alphabet.
+GTM_INLINE uint8x16_t Base64Values(uint8x16_t in, const char *charMap, uint8x16_t *invalid) {
+  uint8x16_t upper = vcleq_u8(vsubq_u8(in, vdupq_n_u8('A')), vdupq_n_u8(25));
+  uint8x16_t lower = vcleq_u8(vsubq_u8(in, vdupq_n_u8('a')), vdupq_n_u8(25));
+  uint8x16_t digit = vcleq_u8(vsubq_u8(in, vdupq_n_u8('0')), vdupq_n_u8(9));
+  uint8x16_t is62 = vceqq_u8(in, vdupq_n_u8((uint8_t)charMap[62]));
+  uint8x16_t is63 = vceqq_u8(in, vdupq_n_u8((uint8_t)charMap[63]));
+  uint8x16_t offset = vandq_u8(upper, vdupq_n_u8((uint8_t)-'A'));
+  offset = vorrq_u8(offset, vandq_u8(lower, vdupq_n_u8((uint8_t)(26 - 'a'))));
+  offset = vorrq_u8(offset, vandq_u8(digit, vdupq_n_u8((uint8_t)(52 - '0'))));
+  offset = vorrq_u8(offset, vandq_u8(is62, vdupq_n_u8((uint8_t)(62 - charMap[62]))));
+  offset = vorrq_u8(offset, vandq_u8(is63, vdupq_n_u8((uint8_t)(63 - charMap[63]))));
+  uint8x16_t valid = vorrq_u8(vorrq_u8(upper, lower), vorrq_u8(digit, vorrq_u8(is62, is63)));
+  *invalid = vorrq_u8(*invalid, vmvnq_u8(valid));
+  return vaddq_u8(in, offset);
+}
+
+static NSUInteger DecodeBase64Vector(const unsigned char *in, NSUInteger inLen,
+                                     unsigned char *out, NSUInteger outLen,
+                                     const char *charMap) {
+  NSUInteger inPos = 0;
+  NSUInteger outPos = 0;
+  for (; inLen - inPos >= 64 && outLen - outPos >= 48; inPos += 64, outPos += 48) {
+    uint8x16x4_t chars = vld4q_u8(in + inPos);
+    uint8x16_t invalid = vdupq_n_u8(0);
+    uint8x16_t v0 = Base64Values(chars.val[0], charMap, &invalid);
+    uint8x16_t v1 = Base64Values(chars.val[1], charMap, &invalid);
+    uint8x16_t v2 = Base64Values(chars.val[2], charMap, &invalid);
+    uint8x16_t v3 = Base64Values(chars.val[3], charMap, &invalid);
+    if (vmaxvq_u8(invalid)) {
+      break;
+    }
+    uint8x16x3_t bytes;
+    bytes.val[0] = vorrq_u8(vshlq_n_u8(v0, 2), vshrq_n_u8(v1, 4));
+    bytes.val[1] = vorrq_u8(vshlq_n_u8(v1, 4), vshrq_n_u8(v2, 2));
+    bytes.val[2] = vorrq_u8(vshlq_n_u8(v2, 6), v3);
+    vst3q_u8(out + outPos, bytes);
+  }
+  return inPos;
+}
+
+#else
+
+static NSUInteger EncodeBase64Vector(const unsigned char *in, NSUInteger inLen,
+                                     unsigned char *out, const char *charMap) {
+  return 0;
+}
+
+static NSUInteger DecodeBase64Vector(const unsigned char *in, NSUInteger inLen,
+                                     unsigned char *out, NSUInteger outLen,
+                                     const char *charMap) {
+  return 0;
+}
+
+#endif
+
+// Every alphabet has a fixed group size: the fewest bytes that make a whole
+// number of characters (1 byte for base 2, 4, 16 and 256ths; 3 for base 8
+// and 64; 5 for base 32; 7 for base 128). The group kernels below work on as
+// many whole groups as fit in a 64 bit word, with the shift a compile time
+// constant so the character loops unroll into straight line code. They leave
+// the last few bytes (and anything unusual when decoding) to the generic loop.
+
+typedef NSUInteger (*GroupEncoder)(const unsigned char *in, NSUInteger inLen,
+                                   unsigned char *out, const char *charMap);
+typedef NSUInteger (*GroupDecoder)(const char *in, NSUInteger inLen,
+                                   unsigned char *out, NSUInteger outLen,
+                                   const int *reverseCharMap);
+
+// Bytes handled per 64 bit word for each shift: whole groups only.
+GTM_INLINE int WordBytes(int shift) {
+  int groupBytes = (shift % 2) ? shift : (shift % 4) ? shift / 2 : 1;
+  return 8 / groupBytes * groupBytes;
+}
+
+GTM_INLINE NSUInteger EncodeGroups(const unsigned char *in, NSUInteger inLen,
+                                   unsigned char *out, const char *charMap,
+                                   const int shift) {
+  const int wordBytes = WordBytes(shift);
+  const int wordChars = wordBytes * 8 / shift;
+  const uint64_t mask = (1 << shift) - 1;
+  NSUInteger inPos = 0;
+  // Full 8 byte loads, |wordBytes| used.
+  for (; inLen - inPos >= 8; inPos += wordBytes, out += wordChars) {
+    uint64_t word;
+    memcpy(&word, in + inPos, sizeof(word));
+    word = NSSwapBigLongLongToHost(word);
+    for (int i = 0; i < wordChars; i++) {
+      out[i] = (unsigned char)charMap[(word >> (64 - shift * (i + 1))) & mask];
+    }
+  }
+  return inPos;
+}
+
+GTM_INLINE NSUInteger DecodeGroups(const char *in, NSUInteger inLen,
+                                   unsigned char *out, NSUInteger outLen,
+                                   const int *reverseCharMap, const int shift) {
+  const int wordBytes = WordBytes(shift);
+  const int wordChars = wordBytes * 8 / shift;
+  NSUInteger inPos = 0;
+  NSUInteger outPos = 0;
+  // |wordChars| characters at a time, stored as a full 8 byte word.
+  for (; inLen - inPos >= (NSUInteger)wordChars && outLen - outPos >= 8;
+       inPos += wordChars, outPos += wordBytes) {
+    uint64_t word = 0;
+    int all = 0;
+    for (int i = 0; i < wordChars; i++) {
+      unsigned char c = (unsigned char)in[inPos + i];
+      // Anything outside 7-bit ASCII is unknown.
+      int val = reverseCharMap[c & 0x7f];
+      all |= val | -(int)(c >> 7);
+      word = (word << shift) | (uint64_t)(val & ((1 << shift) - 1));
+    }
+    if (all < 0) {
+      // Padding, an ignored or unknown character; the generic loop sorts it out.
+      break;
+    }
+    word = NSSwapHostLongLongToBig(word << (64 - wordBytes * 8));
+    memcpy(out + outPos, &word, sizeof(word));
+  }
+  return inPos;
+}
+
+#define GROUP_KERNELS(shift)                                                   \
+  static NSUInteger EncodeGroups##shift(const unsigned char *in,             \
+                                        NSUInteger inLen, unsigned char *out,  \
+                                        const char *charMap) {                 \
+    return EncodeGroups(in, inLen, out, charMap, shift);                      \
+  }                                                                            \
+  static NSUInteger DecodeGroups##shift(const char *in, NSUInteger inLen,     \
+                                        unsigned char *out, NSUInteger outLen, \
+                                        const int *reverseCharMap) {           \
+    return DecodeGroups(in, inLen, out, outLen, reverseCharMap, shift);       \
+  }
+
+GROUP_KERNELS(1)
+GROUP_KERNELS(2)
+GROUP_KERNELS(3)
+GROUP_KERNELS(4)
+GROUP_KERNELS(5)
+GROUP_KERNELS(6)
+GROUP_KERNELS(7)
+
+#undef GROUP_KERNELS
+
+// Indexed by shift.
+static const GroupEncoder kGroupEncoders[8] = {
+  NULL, EncodeGroups1, EncodeGroups2, EncodeGroups3,
+  EncodeGroups4, EncodeGroups5, EncodeGroups6, EncodeGroups7,
+};
+static const GroupDecoder kGroupDecoders[8] = {
+  NULL, DecodeGroups1, DecodeGroups2, DecodeGroups3,
+  DecodeGroups4, DecodeGroups5, DecodeGroups6, DecodeGroups7,
+};
+
+// With setDoParallel:, inputs are split into pieces of at least this many
+// bytes or characters, one per core.
+#define kParallelPieceSize (1024 * 1024)
+
+static NSUInteger ParallelWorkerCount(NSUInteger length) {
+  return MIN(length / kParallelPieceSize, [[NSProcessInfo processInfo] activeProcessorCount]);
+}
+
+static NSError *BadCharacterError(GTMStringEncodingError code, NSUInteger index) {
+  NSDictionary *userInfo =
+      [NSDictionary dictionaryWithObject:[NSNumber numberWithUnsignedInteger:index]
+                                  forKey:GTMStringEncodingBadCharacterIndexKey];
+  return [NSError errorWithDomain:GTMStringEncodingErrorDomain
+                             code:code
+                         userInfo:userInfo];
+}
+
+static NSError *BufferTooSmallError(void) {
+  return [NSError errorWithDomain:GTMStringEncodingErrorDomain
+                             code:GTMStringEncodingErrorBufferTooSmall
+                         userInfo:nil];
+}
+
+@interface GTMStringEncoding ()
+
+// The cores of encode:error: and decode:error:, shared with GTMStringEncoder
+// and GTMStringDecoder. The bits of a partial character (or byte) are carried
+// from one call to the next in |bits| and |bitCount|, and whether padding has
+// started in |sawPadding|.
+- (NSUInteger)encodedLengthForLength:(NSUInteger)length bitCount:(int)bitCount;
+- (NSUInteger)finishEncodingLengthForBitCount:(int)bitCount length:(NSUInteger)length;
+- (NSUInteger)decodedLengthForLength:(NSUInteger)length bitCount:(int)bitCount;
+- (NSUInteger)encodeBytes:(const unsigned char *)inBuf
+                   length:(NSUInteger)inLen
+                 toBuffer:(unsigned char *)outBuf
+                     bits:(unsigned int *)bits
+                 bitCount:(int *)bitCount;
+// Writes the last partial character and the padding for a string that so far
+// has |length| characters.
+- (NSUInteger)finishEncodingBits:(unsigned int)bits
+                        bitCount:(int)bitCount
+                          length:(NSUInteger)length
+                        toBuffer:(unsigned char *)outBuf;
+// Returns NSNotFound on a bad character, whose index in the error is
+// |indexBase| + its offset in |inBuf|.
+- (NSUInteger)decodeCharacters:(const char *)inBuf
+                        length:(NSUInteger)inLen
+                      toBuffer:(unsigned char *)outBuf
+                      capacity:(NSUInteger)capacity
+                          bits:(unsigned int *)bits
+                      bitCount:(int *)bitCount
+                    sawPadding:(BOOL *)sawPadding
+                     indexBase:(NSUInteger)indexBase
+                         error:(NSError **)error;
+- (BOOL)finishDecodingBits:(unsigned int)bits bitCount:(int)bitCount error:(NSError **)error;
+
+// Whole inputs, serially or split into |workerCount| pieces on all cores.
+- (NSUInteger)encodeBytes:(const unsigned char *)inBuf
+                   length:(NSUInteger)inLen
+                 toBuffer:(unsigned char *)outBuf;
+- (NSUInteger)encodeBytes:(const unsigned char *)inBuf
+                   length:(NSUInteger)inLen
+                 toBuffer:(unsigned char *)outBuf
+              workerCount:(NSUInteger)workerCount;
+- (NSUInteger)decodeCharacters:(const char *)inBuf
+                        length:(NSUInteger)inLen
+                      toBuffer:(unsigned char *)outBuf
+                      capacity:(NSUInteger)capacity
+                         error:(NSError **)error;
+- (NSUInteger)decodeCharacters:(const char *)inBuf
+                        length:(NSUInteger)inLen
+                      toBuffer:(unsigned char *)outBuf
+                      capacity:(NSUInteger)capacity
+                   workerCount:(NSUInteger)workerCount
+                         error:(NSError **)error;
+// Decodes the pieces between |starts| to |outStarts| on all cores, returning
+// NO if one before the last doesn't fill its output. |outputLength| is the
+// total, or NSNotFound if the last piece fails.
+- (BOOL)decodePieces:(const char *)inBuf
+              starts:(const NSUInteger *)starts
+            toBuffer:(unsigned char *)outBuf
+           outStarts:(const NSUInteger *)outStarts
+         workerCount:(NSUInteger)workerCount
+        outputLength:(NSUInteger *)outputLength
+               error:(NSError **)error;
+
+@end
+
+@implementation GTMStringEncoding {
+  // From kGroupEncoders/kGroupDecoders for shift_.
+  GroupEncoder encodeGroups_;
+  GroupDecoder decodeGroups_;
+  // The alphabet is RFC 4648 base64, so the base64 kernels apply.
+  BOOL useBase64Kernels_;
+  BOOL doParallel_;
+  // Some characters are skipped when decoding (see ignoreCharacters:).
+  BOOL ignoresCharacters_;
+}
 
 + (instancetype)binaryStringEncoding {
   return [self stringEncodingWithString:@"01"];
@@ -126,6 +641,10 @@ GTM_INLINE int lcm(int a, int b) {
       shift_++;
     mask_ = (1 << shift_) - 1;
     padLen_ = lcm(8, shift_) / shift_;
+    useBase64Kernels_ =
+        (length == 64 && memcmp(charMap_, kBase64Letters, sizeof(kBase64Letters) - 1) == 0);
+    encodeGroups_ = kGroupEncoders[shift_];
+    decodeGroups_ = kGroupDecoders[shift_];
   }
   return self;
 }
@@ -156,6 +675,7 @@ GTM_INLINE int lcm(int a, int b) {
     _GTMDevAssert(reverseCharMap_[c] == kUnknownChar,
                   @"Character already mapped");
     reverseCharMap_[c] = kIgnoreChar;
+    ignoresCharacters_ = YES;
   }
 }
 
@@ -167,56 +687,116 @@ GTM_INLINE int lcm(int a, int b) {
   doPad_ = doPad;
 }
 
+- (BOOL)doParallel {
+  return doParallel_;
+}
+
+- (void)setDoParallel:(BOOL)doParallel {
+  doParallel_ = doParallel;
+}
+
 - (void)setPaddingChar:(char)c {
+  if (reverseCharMap_[(int)c] >= 0) {
+    // Padding taken from the alphabet is only understood by the generic loop.
+    useBase64Kernels_ = NO;
+  }
   paddingChar_ = c;
   reverseCharMap_[(int)c] = kPaddingChar;
 }
 
-- (NSString *)encode:(NSData *)inData error:(NSError **)error {
-  NSUInteger inLen = [inData length];
-  if (inLen <= 0) {
-    return @"";
-  }
-  unsigned char *inBuf = (unsigned char *)[inData bytes];
-  NSUInteger inPos = 0;
-
-  NSUInteger outLen = (inLen * 8 + shift_ - 1) / shift_;
+- (NSUInteger)encodedLengthForLength:(NSUInteger)length {
+  NSUInteger outLen = (length * 8 + shift_ - 1) / shift_;
   if (doPad_) {
     outLen = ((outLen + padLen_ - 1) / padLen_) * padLen_;
   }
-  NSMutableData *outData = [NSMutableData dataWithLength:outLen];
-  unsigned char *outBuf = (unsigned char *)[outData mutableBytes];
-  NSUInteger outPos = 0;
+  return outLen;
+}
 
-  unsigned int buffer = inBuf[inPos++];
-  int bitsLeft = 8;
-  while (bitsLeft > 0 || inPos < inLen) {
-    if (bitsLeft < shift_) {
-      if (inPos < inLen) {
-        buffer <<= 8;
-        buffer |= (inBuf[inPos++] & 0xff);
-        bitsLeft += 8;
-      } else {
-        int pad = shift_ - bitsLeft;
-        buffer <<= pad;
-        bitsLeft += pad;
-      }
+- (NSUInteger)maximumDecodedLengthForLength:(NSUInteger)length {
+  return length * shift_ / 8;
+}
+
+- (BOOL)encodeBytes:(const void *)bytes
+             length:(NSUInteger)length
+         intoBuffer:(char *)buffer
+           capacity:(NSUInteger)capacity
+       outputLength:(NSUInteger *)outputLength
+              error:(NSError **)error {
+  if (capacity < [self encodedLengthForLength:length]) {
+    if (error) {
+      *error = BufferTooSmallError();
     }
-    int idx = (buffer >> (bitsLeft - shift_)) & mask_;
-    bitsLeft -= shift_;
-    outBuf[outPos++] = charMap_[idx];
+    return NO;
+  }
+  NSUInteger workerCount = doParallel_ ? ParallelWorkerCount(length) : 0;
+  if (workerCount >= 2) {
+    *outputLength = [self encodeBytes:(const unsigned char *)bytes
+                               length:length
+                             toBuffer:(unsigned char *)buffer
+                          workerCount:workerCount];
+  } else {
+    *outputLength = [self encodeBytes:(const unsigned char *)bytes
+                               length:length
+                             toBuffer:(unsigned char *)buffer];
   }
+  return YES;
+}
 
-  if (doPad_) {
-    while (outPos < outLen)
-      outBuf[outPos++] = paddingChar_;
+- (BOOL)decodeCharacters:(const char *)characters
+                  length:(NSUInteger)length
+              intoBuffer:(void *)buffer
+                capacity:(NSUInteger)capacity
+            outputLength:(NSUInteger *)outputLength
+                   error:(NSError **)error {
+  NSUInteger workerCount = doParallel_ ? ParallelWorkerCount(length) : 0;
+  NSUInteger outLen;
+  if (workerCount >= 2) {
+    outLen = [self decodeCharacters:characters
+                             length:length
+                           toBuffer:(unsigned char *)buffer
+                           capacity:capacity
+                        workerCount:workerCount
+                              error:error];
+  } else {
+    outLen = [self decodeCharacters:characters
+                             length:length
+                           toBuffer:(unsigned char *)buffer
+                           capacity:capacity
+                              error:error];
+  }
+  if (outLen == NSNotFound) {
+    return NO;
   }
+  *outputLength = outLen;
+  return YES;
+}
 
-  [outData setLength:outPos];
+- (NSString *)encode:(NSData *)inData error:(NSError **)error {
+  NSUInteger inLen = [inData length];
+  if (inLen <= 0) {
+    return @"";
+  }
 
-  NSString *value = [[NSString alloc] initWithData:outData
-                                         encoding:NSASCIIStringEncoding];
+  // Encoded straight into the string's storage.
+  NSUInteger outLen = [self encodedLengthForLength:inLen];
+  char *outBuf = malloc(outLen);
+  if (!outBuf) {
+    return nil;
+  }
+  NSUInteger outPos = 0;
+  [self encodeBytes:[inData bytes]
+             length:inLen
+         intoBuffer:outBuf
+           capacity:outLen
+       outputLength:&outPos
+              error:NULL];
+
+  NSString *value = [[NSString alloc] initWithBytesNoCopy:outBuf
+                                                   length:outPos
+                                                 encoding:NSASCIIStringEncoding
+                                             freeWhenDone:YES];
   if (!value) {
+    free(outBuf);
     if (error) {
       *error = [NSError errorWithDomain:GTMStringEncodingErrorDomain
                                    code:GTMStringEncodingErrorUnableToConverToAscii
@@ -242,91 +822,611 @@ GTM_INLINE int lcm(int a, int b) {
 }
 
 - (NSData *)decode:(NSString *)inString error:(NSError **)error {
-  char *inBuf = (char *)[inString cStringUsingEncoding:NSASCIIStringEncoding];
+  // Strings stored as ASCII are read in place; anything else is converted,
+  // which fails if it isn't all ASCII.
+  const char *inBuf = NULL;
+  NSUInteger inLen = [inString length];
+  NSData *inData NS_VALID_UNTIL_END_OF_SCOPE = nil;
+  if (inString) {
+    inBuf = CFStringGetCStringPtr((__bridge CFStringRef)inString, kCFStringEncodingASCII);
+  }
   if (!inBuf) {
-    if (error) {
-      *error = [NSError errorWithDomain:GTMStringEncodingErrorDomain
-                                   code:GTMStringEncodingErrorUnableToConverToAscii
-                               userInfo:nil];
+    inData = [inString dataUsingEncoding:NSASCIIStringEncoding];
+    if (!inData) {
+      if (error) {
+        *error = [NSError errorWithDomain:GTMStringEncodingErrorDomain
+                                     code:GTMStringEncodingErrorUnableToConverToAscii
+                                 userInfo:nil];
 
+      }
+      return nil;
     }
-    return nil;
+    inBuf = [inData bytes];
+    inLen = [inData length];
   }
-  NSUInteger inLen = strlen(inBuf);
 
-  NSUInteger outLen = inLen * shift_ / 8;
+  NSUInteger outLen = [self maximumDecodedLengthForLength:inLen];
   NSMutableData *outData = [NSMutableData dataWithLength:outLen];
-  unsigned char *outBuf = (unsigned char *)[outData mutableBytes];
   NSUInteger outPos = 0;
+  if (![self decodeCharacters:inBuf
+                       length:inLen
+                   intoBuffer:[outData mutableBytes]
+                     capacity:outLen
+                 outputLength:&outPos
+                        error:error]) {
+    return nil;
+  }
+
+  // Shorten buffer if needed due to padding chars
+  [outData setLength:outPos];
+
+  return outData;
+}
+
+- (NSString *)stringByDecoding:(NSString *)inString error:(NSError **)error {
+  NSData *ret = [self decode:inString error:error];
+  NSString *value = nil;
+  if (ret) {
+    value = [[NSString alloc] initWithData:ret encoding:NSUTF8StringEncoding];
+  }
+  return value;
+}
+
+
+#pragma mark -
+
+- (NSUInteger)encodedLengthForLength:(NSUInteger)length bitCount:(int)bitCount {
+  return (bitCount + length * 8) / shift_;
+}
+
+- (NSUInteger)finishEncodingLengthForBitCount:(int)bitCount length:(NSUInteger)length {
+  NSUInteger finishLen = bitCount > 0 ? 1 : 0;
+  if (doPad_) {
+    finishLen += (padLen_ - (length + finishLen) % padLen_) % padLen_;
+  }
+  return finishLen;
+}
 
-  unsigned int buffer = 0;
-  int bitsLeft = 0;
-  BOOL expectPad = NO;
-  for (NSUInteger i = 0; i < inLen; i++) {
-    int val = reverseCharMap_[(int)inBuf[i]];
+- (NSUInteger)decodedLengthForLength:(NSUInteger)length bitCount:(int)bitCount {
+  return (bitCount + length * shift_) / 8;
+}
+
+- (NSUInteger)encodeBytes:(const unsigned char *)inBuf
+                   length:(NSUInteger)inLen
+                 toBuffer:(unsigned char *)outBuf
+                     bits:(unsigned int *)bits
+                 bitCount:(int *)bitCount {
+  unsigned int buffer = *bits;
+  int bitsLeft = *bitCount;
+  NSUInteger inPos = 0;
+  NSUInteger outPos = 0;
+  while (inPos < inLen) {
+    if (bitsLeft == 0) {
+      // On a group boundary, so whole groups can go to the kernels.
+      NSUInteger groupLen = 0;
+      if (useBase64Kernels_) {
+        groupLen = EncodeBase64Vector(inBuf + inPos, inLen - inPos, outBuf + outPos, charMap_);
+        inPos += groupLen;
+        outPos += groupLen / 3 * 4;
+      }
+      groupLen = encodeGroups_(inBuf + inPos, inLen - inPos, outBuf + outPos, charMap_);
+      inPos += groupLen;
+      outPos += groupLen * 8 / shift_;
+      if (inPos == inLen) {
+        break;
+      }
+    }
+    buffer <<= 8;
+    buffer |= inBuf[inPos++];
+    bitsLeft += 8;
+    while (bitsLeft >= shift_) {
+      int idx = (buffer >> (bitsLeft - shift_)) & mask_;
+      bitsLeft -= shift_;
+      outBuf[outPos++] = charMap_[idx];
+    }
+  }
+  *bits = buffer;
+  *bitCount = bitsLeft;
+  return outPos;
+}
+
+- (NSUInteger)finishEncodingBits:(unsigned int)bits
+                        bitCount:(int)bitCount
+                          length:(NSUInteger)length
+                        toBuffer:(unsigned char *)outBuf {
+  NSUInteger outPos = 0;
+  if (bitCount > 0) {
+    // The last bits, padded out with zeros.
+    outBuf[outPos++] = charMap_[(bits << (shift_ - bitCount)) & mask_];
+  }
+  if (doPad_) {
+    while ((length + outPos) % padLen_) {
+      outBuf[outPos++] = paddingChar_;
+    }
+  }
+  return outPos;
+}
+
+- (NSUInteger)decodeCharacters:(const char *)inBuf
+                        length:(NSUInteger)inLen
+                      toBuffer:(unsigned char *)outBuf
+                      capacity:(NSUInteger)capacity
+                          bits:(unsigned int *)bits
+                      bitCount:(int *)bitCount
+                    sawPadding:(BOOL *)sawPadding
+                     indexBase:(NSUInteger)indexBase
+                         error:(NSError **)error {
+  unsigned int buffer = *bits;
+  int bitsLeft = *bitCount;
+  BOOL expectPad = *sawPadding;
+  NSUInteger outPos = 0;
+  NSUInteger i = 0;
+  while (i < inLen) {
+    if (bitsLeft == 0 && !expectPad) {
+      // On a group boundary, so whole groups can go to the kernels. They stop
+      // at the first group with padding, an ignored character or an error in
+      // it (and the vector code at synonyms too), leaving it to the code below,
+      // and pick up again after it.
+      NSUInteger groupLen = 0;
+      if (useBase64Kernels_) {
+        groupLen = DecodeBase64Vector((const unsigned char *)inBuf + i, inLen - i,
+                                      outBuf + outPos, capacity - outPos, charMap_);
+        i += groupLen;
+        outPos += groupLen / 4 * 3;
+      }
+      groupLen = decodeGroups_(inBuf + i, inLen - i, outBuf + outPos, capacity - outPos,
+                               reverseCharMap_);
+      i += groupLen;
+      outPos += groupLen * shift_ / 8;
+      if (i == inLen) {
+        break;
+      }
+    }
+    unsigned char c = (unsigned char)inBuf[i];
+    int val = c < 128 ? reverseCharMap_[c] : kUnknownChar;
     switch (val) {
       case kIgnoreChar:
         break;
       case kPaddingChar:
         expectPad = YES;
         break;
-      case kUnknownChar: {
+      case kUnknownChar:
         if (error) {
-          NSDictionary *userInfo =
-              [NSDictionary dictionaryWithObject:[NSNumber numberWithUnsignedInteger:i]
-                                          forKey:GTMStringEncodingBadCharacterIndexKey];
-          *error = [NSError errorWithDomain:GTMStringEncodingErrorDomain
-                                       code:GTMStringEncodingErrorUnknownCharacter
-                                   userInfo:userInfo];
+          *error = BadCharacterError(GTMStringEncodingErrorUnknownCharacter, indexBase + i);
         }
-        return nil;
-      }
+        return NSNotFound;
       default:
         if (expectPad) {
           if (error) {
-            NSDictionary *userInfo =
-                [NSDictionary dictionaryWithObject:[NSNumber numberWithUnsignedInteger:i]
-                                            forKey:GTMStringEncodingBadCharacterIndexKey];
-            *error = [NSError errorWithDomain:GTMStringEncodingErrorDomain
-                                         code:GTMStringEncodingErrorExpectedPadding
-                                     userInfo:userInfo];
+            *error = BadCharacterError(GTMStringEncodingErrorExpectedPadding, indexBase + i);
           }
-          return nil;
+          return NSNotFound;
         }
         buffer <<= shift_;
         buffer |= val & mask_;
         bitsLeft += shift_;
         if (bitsLeft >= 8) {
+          if (outPos == capacity) {
+            if (error) {
+              *error = BufferTooSmallError();
+            }
+            return NSNotFound;
+          }
           outBuf[outPos++] = (unsigned char)(buffer >> (bitsLeft - 8));
           bitsLeft -= 8;
         }
         break;
     }
+    i++;
   }
+  *bits = buffer;
+  *bitCount = bitsLeft;
+  *sawPadding = expectPad;
+  return outPos;
+}
 
-  if (bitsLeft && buffer & ((1 << bitsLeft) - 1)) {
+- (BOOL)finishDecodingBits:(unsigned int)bits bitCount:(int)bitCount error:(NSError **)error {
+  if (bitCount && bits & ((1 << bitCount) - 1)) {
     if (error) {
       *error = [NSError errorWithDomain:GTMStringEncodingErrorDomain
                                    code:GTMStringEncodingErrorIncompleteTrailingData
                                userInfo:nil];
 
     }
-    return nil;
+    return NO;
   }
+  return YES;
+}
+- (NSUInteger)encodeBytes:(const unsigned char *)inBuf
+                   length:(NSUInteger)inLen
+                 toBuffer:(unsigned char *)outBuf {
+  unsigned int bits = 0;
+  int bitCount = 0;
+  NSUInteger outLen = [self encodeBytes:inBuf
+                                 length:inLen
+                               toBuffer:outBuf
+                                   bits:&bits
+                               bitCount:&bitCount];
+  outLen += [self finishEncodingBits:bits
+                            bitCount:bitCount
+                              length:outLen
+                            toBuffer:outBuf + outLen];
+  return outLen;
+}
 
-  // Shorten buffer if needed due to padding chars
-  [outData setLength:outPos];
+- (NSUInteger)encodeBytes:(const unsigned char *)inBuf
+                   length:(NSUInteger)inLen
+                 toBuffer:(unsigned char *)outBuf
+              workerCount:(NSUInteger)workerCount {
+  // Every piece is a whole number of groups, so each starts with no bits
+  // carried and writes at a known offset.
+  NSUInteger groupBytes = padLen_ * shift_ / 8;
+  NSUInteger pieceLength = inLen / workerCount / groupBytes * groupBytes;
+  __block NSUInteger outLen = 0;
+  dispatch_apply(workerCount,
+                 dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
+                 ^(size_t worker) {
+    NSUInteger start = worker * pieceLength;
+    NSUInteger outStart = start * 8 / shift_;
+    if (worker == workerCount - 1) {
+      // The last piece takes the remainder and the padding.
+      outLen = outStart + [self encodeBytes:inBuf + start
+                                     length:inLen - start
+                                   toBuffer:outBuf + outStart];
+    } else {
+      unsigned int bits = 0;
+      int bitCount = 0;
+      [self encodeBytes:inBuf + start
+                 length:pieceLength
+               toBuffer:outBuf + outStart
+                   bits:&bits
+               bitCount:&bitCount];
+    }
+  });
+  return outLen;
+}
 
-  return outData;
+- (NSUInteger)decodeCharacters:(const char *)inBuf
+                        length:(NSUInteger)inLen
+                      toBuffer:(unsigned char *)outBuf
+                      capacity:(NSUInteger)capacity
+                         error:(NSError **)error {
+  unsigned int bits = 0;
+  int bitCount = 0;
+  BOOL sawPadding = NO;
+  NSUInteger outLen = [self decodeCharacters:inBuf
+                                      length:inLen
+                                    toBuffer:outBuf
+                                    capacity:capacity
+                                        bits:&bits
+                                    bitCount:&bitCount
+                                  sawPadding:&sawPadding
+                                   indexBase:0
+                                       error:error];
+  if (outLen == NSNotFound ||
+      ![self finishDecodingBits:bits bitCount:bitCount error:error]) {
+    return NSNotFound;
+  }
+  return outLen;
 }
 
-- (NSString *)stringByDecoding:(NSString *)inString error:(NSError **)error {
-  NSData *ret = [self decode:inString error:error];
-  NSString *value = nil;
-  if (ret) {
-    value = [[NSString alloc] initWithData:ret encoding:NSUTF8StringEncoding];
+- (NSUInteger)decodeCharacters:(const char *)inBuf
+                        length:(NSUInteger)inLen
+                      toBuffer:(unsigned char *)outBuf
+                      capacity:(NSUInteger)capacity
+                   workerCount:(NSUInteger)workerCount
+                         error:(NSError **)error {
+  // Piece boundaries have to fall on group boundaries, and the output offset
+  // of a piece depends on how many characters before it have values.
+  NSUInteger *starts = (NSUInteger *)calloc(workerCount * 2 + 2, sizeof(NSUInteger));
+  if (!starts) {
+    // COV_NF_START
+    return [self decodeCharacters:inBuf length:inLen toBuffer:outBuf capacity:capacity error:error];
+    // COV_NF_END
   }
-  return value;
+  NSUInteger *outStarts = starts + workerCount + 1;
+  NSUInteger outLen = NSNotFound;
+  if (!ignoresCharacters_) {
+    // Every character should have a value, so each piece is a whole number of
+    // groups, at the offsets that gives. If one doesn't fill its output it
+    // had padding or an unknown character in it, which the serial code
+    // reports at the right index.
+    NSUInteger pieceLength = inLen / workerCount / padLen_ * padLen_;
+    for (NSUInteger worker = 0; worker < workerCount; worker++) {
+      starts[worker] = worker * pieceLength;
+      outStarts[worker] = starts[worker] * shift_ / 8;
+    }
+    starts[workerCount] = inLen;
+    outStarts[workerCount] = capacity;
+    NSError *lastError = nil;
+    if (outStarts[workerCount - 1] <= capacity &&
+        [self decodePieces:inBuf
+                    starts:starts
+                  toBuffer:outBuf
+                 outStarts:outStarts
+               workerCount:workerCount
+              outputLength:&outLen
+                     error:&lastError]) {
+      free(starts);
+      if (outLen == NSNotFound && error) {
+        *error = lastError;
+      }
+      return outLen;
+    }
+    free(starts);
+    return [self decodeCharacters:inBuf length:inLen toBuffer:outBuf capacity:capacity error:error];
+  }
+
+  // Ignored characters (line breaks, say) can be anywhere, so a pre-scan
+  // first counts the characters with values in each piece and notes any
+  // padding or unknown characters, then every boundary moves forward to the
+  // next group boundary and the pieces are decoded once. Padding or unknown
+  // characters before the last piece, a boundary that can't be moved within
+  // its piece, or too small a buffer leave it all to the serial code, which
+  // reports errors at the right index.
+  NSUInteger pieceLength = inLen / workerCount;
+  starts[workerCount] = inLen;
+  NSUInteger *counts = (NSUInteger *)calloc(workerCount * 2, sizeof(NSUInteger));
+  if (!counts) {
+    // COV_NF_START
+    free(starts);
+    return [self decodeCharacters:inBuf length:inLen toBuffer:outBuf capacity:capacity error:error];
+    // COV_NF_END
+  }
+  NSUInteger *unusual = counts + workerCount;
+  // 0 for characters with values, 1 for ignored ones, 2 for anything else.
+  unsigned char classes[256];
+  for (int c = 0; c < 256; c++) {
+    int val = c < 128 ? reverseCharMap_[c] : kUnknownChar;
+    classes[c] = val >= 0 ? 0 : (val == kIgnoreChar ? 1 : 2);
+  }
+  dispatch_apply(workerCount,
+                 dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
+                 ^(size_t worker) {
+    NSUInteger start = worker * pieceLength;
+    NSUInteger end = start + pieceLength;
+    if (worker == workerCount - 1) {
+      end = inLen;
+    }
+    NSUInteger count = 0;
+    unsigned char odd = 0;
+    for (NSUInteger i = start; i < end; i++) {
+      unsigned char kind = classes[(unsigned char)inBuf[i]];
+      count += kind == 0;
+      odd |= kind;
+    }
+    counts[worker] = count;
+    unusual[worker] = odd & 2;
+  });
+  BOOL serial = NO;
+  NSUInteger valueCount = 0;
+  for (NSUInteger worker = 1; worker < workerCount && !serial; worker++) {
+    valueCount += counts[worker - 1];
+    serial = unusual[worker - 1] != 0;
+    NSUInteger pos = worker * pieceLength;
+    NSUInteger end = pos + pieceLength;
+    NSUInteger groupValueCount = valueCount;
+    while (!serial && groupValueCount % padLen_) {
+      if (pos == end) {
+        serial = YES;
+        break;
+      }
+      unsigned char kind = classes[(unsigned char)inBuf[pos++]];
+      if (kind == 0) {
+        groupValueCount++;
+      } else if (kind != 1) {
+        serial = YES;
+      }
+    }
+    starts[worker] = pos;
+    outStarts[worker] = groupValueCount * shift_ / 8;
+  }
+  valueCount += counts[workerCount - 1];
+  outStarts[workerCount] = valueCount * shift_ / 8;
+  free(counts);
+  if (serial || capacity < outStarts[workerCount]) {
+    free(starts);
+    return [self decodeCharacters:inBuf length:inLen toBuffer:outBuf capacity:capacity error:error];
+  }
+  NSError *lastError = nil;
+  BOOL decoded = [self decodePieces:inBuf
+                             starts:starts
+                           toBuffer:outBuf
+                          outStarts:outStarts
+                        workerCount:workerCount
+                       outputLength:&outLen
+                              error:&lastError];
+  _GTMDevAssert(decoded, @"Pieces didn't end on group boundaries");
+  free(starts);
+  if (outLen == NSNotFound && error) {
+    *error = lastError;
+  }
+  return outLen;
+}
+
+- (BOOL)decodePieces:(const char *)inBuf
+              starts:(const NSUInteger *)starts
+            toBuffer:(unsigned char *)outBuf
+           outStarts:(const NSUInteger *)outStarts
+         workerCount:(NSUInteger)workerCount
+        outputLength:(NSUInteger *)outputLength
+               error:(NSError **)error {
+  __block BOOL filled = YES;
+  __block NSUInteger lastOutLen = NSNotFound;
+  __block NSError *lastError = nil;
+  dispatch_apply(workerCount,
+                 dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
+                 ^(size_t worker) {
+    unsigned int bits = 0;
+    int bitCount = 0;
+    BOOL sawPadding = NO;
+    NSError *pieceError = nil;
+    NSUInteger pieceCapacity = outStarts[worker + 1] - outStarts[worker];
+    NSUInteger pieceOutLen = [self decodeCharacters:inBuf + starts[worker]
+                                             length:starts[worker + 1] - starts[worker]
+                                           toBuffer:outBuf + outStarts[worker]
+                                           capacity:pieceCapacity
+                                               bits:&bits
+                                           bitCount:&bitCount
+                                         sawPadding:&sawPadding
+                                          indexBase:starts[worker]
+                                              error:&pieceError];
+    if (worker == workerCount - 1) {
+      if (pieceOutLen != NSNotFound &&
+          [self finishDecodingBits:bits bitCount:bitCount error:&pieceError]) {
+        lastOutLen = outStarts[worker] + pieceOutLen;
+      }
+      lastError = pieceError;
+    } else if (pieceOutLen != pieceCapacity) {
+      // Only possible with more than alphabet characters in it, as the full
+      // output means every character had a value and no bits are left over.
+      filled = NO;
+    }
+  });
+  *outputLength = lastOutLen;
+  if (lastOutLen == NSNotFound && error) {
+    *error = lastError;
+  }
+  return filled;
+}
+@end
+
+@implementation GTMStringEncoder {
+  GTMStringEncoding *encoding_;
+  unsigned int bits_;
+  int bitCount_;
+  // Characters written so far, for the padding.
+  NSUInteger length_;
+}
+
+- (instancetype)initWithEncoding:(GTMStringEncoding *)encoding {
+  if ((self = [super init])) {
+    encoding_ = encoding;
+  }
+  return self;
+}
+
+- (GTMStringEncoding *)encoding {
+  return encoding_;
+}
+
+- (NSUInteger)outputLengthForLength:(NSUInteger)length {
+  return [encoding_ encodedLengthForLength:length bitCount:bitCount_];
+}
+
+- (NSUInteger)finishLength {
+  return [encoding_ finishEncodingLengthForBitCount:bitCount_ length:length_];
+}
+
+- (BOOL)encodeBytes:(const void *)bytes
+             length:(NSUInteger)length
+         intoBuffer:(char *)buffer
+           capacity:(NSUInteger)capacity
+       outputLength:(NSUInteger *)outputLength
+              error:(NSError **)error {
+  if (capacity < [self outputLengthForLength:length]) {
+    if (error) {
+      *error = BufferTooSmallError();
+    }
+    return NO;
+  }
+  NSUInteger outLen = [encoding_ encodeBytes:(const unsigned char *)bytes
+                                      length:length
+                                    toBuffer:(unsigned char *)buffer
+                                        bits:&bits_
+                                    bitCount:&bitCount_];
+  length_ += outLen;
+  *outputLength = outLen;
+  return YES;
+}
+
+- (BOOL)finishIntoBuffer:(char *)buffer
+                capacity:(NSUInteger)capacity
+            outputLength:(NSUInteger *)outputLength
+                   error:(NSError **)error {
+  if (capacity < [self finishLength]) {
+    if (error) {
+      *error = BufferTooSmallError();
+    }
+    return NO;
+  }
+  *outputLength = [encoding_ finishEncodingBits:bits_
+                                       bitCount:bitCount_
+                                         length:length_
+                                       toBuffer:(unsigned char *)buffer];
+  bits_ = 0;
+  bitCount_ = 0;
+  length_ = 0;
+  return YES;
+}
+
+@end
+
+@implementation GTMStringDecoder {
+  GTMStringEncoding *encoding_;
+  unsigned int bits_;
+  int bitCount_;
+  BOOL sawPadding_;
+  // Characters read so far, for the error index.
+  NSUInteger length_;
+}
+
+- (instancetype)initWithEncoding:(GTMStringEncoding *)encoding {
+  if ((self = [super init])) {
+    encoding_ = encoding;
+  }
+  return self;
+}
+
+- (GTMStringEncoding *)encoding {
+  return encoding_;
+}
+
+- (NSUInteger)maximumOutputLengthForLength:(NSUInteger)length {
+  return [encoding_ decodedLengthForLength:length bitCount:bitCount_];
+}
+
+- (void)reset {
+  bits_ = 0;
+  bitCount_ = 0;
+  sawPadding_ = NO;
+  length_ = 0;
+}
+
+- (BOOL)decodeCharacters:(const char *)characters
+                  length:(NSUInteger)length
+              intoBuffer:(void *)buffer
+                capacity:(NSUInteger)capacity
+            outputLength:(NSUInteger *)outputLength
+                   error:(NSError **)error {
+  if (capacity < [self maximumOutputLengthForLength:length]) {
+    if (error) {
+      *error = BufferTooSmallError();
+    }
+    return NO;
+  }
+  NSUInteger outLen = [encoding_ decodeCharacters:characters
+                                           length:length
+                                         toBuffer:(unsigned char *)buffer
+                                         capacity:capacity
+                                             bits:&bits_
+                                         bitCount:&bitCount_
+                                       sawPadding:&sawPadding_
+                                        indexBase:length_
+                                            error:error];
+  if (outLen == NSNotFound) {
+    [self reset];
+    return NO;
+  }
+  length_ += length;
+  *outputLength = outLen;
+  return YES;
+}
+
+- (BOOL)finishWithError:(NSError **)error {
+  BOOL result = [encoding_ finishDecodingBits:bits_ bitCount:bitCount_ error:error];
+  [self reset];
+  return result;
 }
 
 @end
@@ -52,6 +52,9 @@ NS_ASSUME_NONNULL_BEGIN
 // The length of the string must be a power of 2, at least 2 and at most 128.
 // Only 7-bit ASCII characters are permitted in the string.
 //
+// Base64 alphabets that start A-Z a-z 0-9, like the RFC 4648 ones, are
+// encoded and decoded with SIMD (SSSE3/AVX2 or NEON) where available.
+//
 // These characters are the canonical set emitted during encoding.
 // If the characters have alternatives (e.g. case, easily transposed) then use
 // addDecodeSynonyms: to configure them.
@@ -79,6 +82,17 @@ NS_ASSUME_NONNULL_BEGIN
 // Sets the padding character to use during encoding.
 - (void)setPaddingChar:(char)c;
 
+// Indicates whether inputs of a few MB and up are encoded and decoded in
+// pieces on all cores. Each piece is a whole number of groups written to its
+// own part of the output, so the result, errors included, is the same either
+// way. When the encoding ignores some characters (see ignoreCharacters:),
+// the input is first scanned in parallel to find where each piece's output
+// goes, which costs one extra read of it. Input with padding or unknown
+// characters before the last piece is decoded serially, to report errors at
+// the right index. Off by default.
+- (BOOL)doParallel;
+- (void)setDoParallel:(BOOL)doParallel;
+
 // Encode a raw binary buffer to a 7-bit ASCII string.
 - (nullable NSString *)encode:(NSData *)data error:(NSError **)error;
 - (nullable NSString *)encodeString:(NSString *)string error:(NSError **)error;
@@ -87,6 +101,117 @@ NS_ASSUME_NONNULL_BEGIN
 - (nullable NSData *)decode:(NSString *)string error:(NSError **)error;
 - (nullable NSString *)stringByDecoding:(NSString *)string error:(NSError **)error;
 
+// The number of characters encoding |length| bytes produces, padding included.
+- (NSUInteger)encodedLengthForLength:(NSUInteger)length;
+
+// The most bytes decoding |length| characters can produce (fewer if some are
+// padding or ignored).
+- (NSUInteger)maximumDecodedLengthForLength:(NSUInteger)length;
+
+// Encode |length| bytes straight into |buffer|, which holds |capacity|
+// characters, setting |outputLength| to the number written. Nothing is
+// allocated and the output isn't NUL terminated. Fails with
+// GTMStringEncodingErrorBufferTooSmall if |capacity| is less than
+// encodedLengthForLength:.
+- (BOOL)encodeBytes:(const void *)bytes
+             length:(NSUInteger)length
+         intoBuffer:(char *)buffer
+           capacity:(NSUInteger)capacity
+       outputLength:(NSUInteger *)outputLength
+              error:(NSError **)error;
+
+// Decode |length| characters straight into |buffer|, which holds |capacity|
+// bytes, setting |outputLength| to the number written. Characters outside
+// 7-bit ASCII are unknown characters. Fails with
+// GTMStringEncodingErrorBufferTooSmall if the output doesn't fit, which a
+// buffer of maximumDecodedLengthForLength: always does.
+- (BOOL)decodeCharacters:(const char *)characters
+                  length:(NSUInteger)length
+              intoBuffer:(void *)buffer
+                capacity:(NSUInteger)capacity
+            outputLength:(NSUInteger *)outputLength
+                   error:(NSError **)error;
+
+@end
+
+// Encodes a stream of bytes a chunk at a time into caller supplied buffers,
+// carrying the bits of a partial character from one chunk to the next, so
+// memory use doesn't grow with the length of the stream. Chunks can be any
+// length; the characters written are the same as encode:error: of all of them
+// together. Output isn't NUL terminated.
+//
+// An encoder isn't thread safe, and its encoding shouldn't be changed while a
+// stream is in progress.
+@interface GTMStringEncoder : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithEncoding:(GTMStringEncoding *)encoding NS_DESIGNATED_INITIALIZER;
+
+@property(nonatomic, readonly) GTMStringEncoding *encoding;
+
+// The number of characters encoding another |length| bytes writes.
+- (NSUInteger)outputLengthForLength:(NSUInteger)length;
+
+// Encodes |length| bytes into |buffer|, which holds |capacity| characters,
+// setting |outputLength| to the number written. Fails with
+// GTMStringEncodingErrorBufferTooSmall if |capacity| is less than
+// outputLengthForLength:.
+- (BOOL)encodeBytes:(const void *)bytes
+             length:(NSUInteger)length
+         intoBuffer:(char *)buffer
+           capacity:(NSUInteger)capacity
+       outputLength:(NSUInteger *)outputLength
+              error:(NSError **)error;
+
+// The number of characters finishing writes: the last partial character and
+// any padding. Never more than 8.
+- (NSUInteger)finishLength;
+
+// Ends the stream, writing the last partial character and any padding, and
+// readies the encoder for a new stream.
+- (BOOL)finishIntoBuffer:(char *)buffer
+                capacity:(NSUInteger)capacity
+            outputLength:(NSUInteger *)outputLength
+                   error:(NSError **)error;
+
+@end
+
+// Decodes a stream of characters a chunk at a time into caller supplied
+// buffers, the counterpart of GTMStringEncoder. Chunks can be split anywhere,
+// even between the characters of a group; the bytes written are the same as
+// decode:error: of all of them together. The index in a
+// GTMStringEncodingBadCharacterIndexKey counts from the start of the stream.
+//
+// A decoder isn't thread safe, and its encoding shouldn't be changed while a
+// stream is in progress.
+@interface GTMStringDecoder : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithEncoding:(GTMStringEncoding *)encoding NS_DESIGNATED_INITIALIZER;
+
+@property(nonatomic, readonly) GTMStringEncoding *encoding;
+
+// The most bytes decoding another |length| characters can write (ignored
+// characters and padding write none).
+- (NSUInteger)maximumOutputLengthForLength:(NSUInteger)length;
+
+// Decodes |length| characters into |buffer|, which holds |capacity| bytes,
+// setting |outputLength| to the number written. Fails with
+// GTMStringEncodingErrorBufferTooSmall if |capacity| is less than
+// maximumOutputLengthForLength:. After a bad character the decoder is ready
+// for a new stream.
+- (BOOL)decodeCharacters:(const char *)characters
+                  length:(NSUInteger)length
+              intoBuffer:(void *)buffer
+                capacity:(NSUInteger)capacity
+            outputLength:(NSUInteger *)outputLength
+                   error:(NSError **)error;
+
+// Ends the stream, checking that no partial byte is left over, and readies the
+// decoder for a new stream. Decoding never holds back whole bytes, so there is
+// nothing to write.
+- (BOOL)finishWithError:(NSError **)error;
+
 @end
 
 FOUNDATION_EXPORT NSString *const GTMStringEncodingErrorDomain;
@@ -105,6 +230,8 @@ typedef NS_ENUM(NSInteger, GTMStringEncodingError) {
   GTMStringEncodingErrorExpectedPadding,
   // There is unexpected data at the end of the data that could not be decoded.
   GTMStringEncodingErrorIncompleteTrailingData,
+  // A caller supplied buffer is too small for the output.
+  GTMStringEncodingErrorBufferTooSmall,
 };
 
 NS_ASSUME_NONNULL_END
@@ -252,6 +252,29 @@
 }  // testBasics
 
 
+- (void)testByteMessages {
+  GTMLoggerRingBufferWriter *writer =
+    [GTMLoggerRingBufferWriter ringBufferWriterWithCapacity:3
+                                                     writer:countingWriter_];
+
+  // Strings and bytes can be mixed, and wrapping frees the older entries.
+  [writer logMessage:@"oop" level:kGTMLoggerLevelDebug];
+  [writer logMessageBytes:"ack" length:3 level:kGTMLoggerLevelInfo];
+  [writer logMessageBytes:"" length:0 level:kGTMLoggerLevelInfo];
+  [writer logMessageBytes:"bar baz" length:3 level:kGTMLoggerLevelDebug];
+  XCTAssertEqual([writer count], (NSUInteger)3);
+  XCTAssertEqual([writer droppedLogCount], (NSUInteger)1);
+  XCTAssertEqual([countingWriter_ count], (NSUInteger)0);
+
+  [writer logMessageBytes:"blargh" length:6 level:kGTMLoggerLevelError];
+  XCTAssertEqual([writer count], (NSUInteger)0);
+  [self compareWriter:countingWriter_
+        withExpectedLogging:[NSArray arrayWithObjects:@"", @"bar",
+                                     @"blargh", nil]
+                 line:__LINE__];
+}  // testByteMessages
+
+
 - (void)testCornerCases {
   // make sure we work with small buffer sizes.
 
@@ -51,6 +51,35 @@
 @end  // ArrayWriter
 
 
+// A test writer that also accepts messages as bytes, storing those in a
+// separate array so tests can tell which path was used.
+@interface ByteArrayWriter : ArrayWriter <GTMLogByteWriter> {
+ @private
+  NSMutableArray *byteMessages_;
+}
+- (NSArray *)byteMessages;
+@end
+@implementation ByteArrayWriter
+- (instancetype)init {
+  if ((self = [super init])) {
+    byteMessages_ = [[NSMutableArray alloc] init];
+  }
+  return self;
+}
+- (NSArray *)byteMessages {
+  return byteMessages_;
+}
+- (void)logMessageBytes:(const char *)bytes
+                 length:(size_t)length
+                  level:(GTMLoggerLevel)level {
+  NSString *msg = [[NSString alloc] initWithBytes:bytes
+                                           length:length
+                                         encoding:NSUTF8StringEncoding];
+  [byteMessages_ addObject:msg];
+}
+@end  // ByteArrayWriter
+
+
 // A formatter for testing that prepends the word DUMB to log messages, along
 // with the log level number.
 @interface DumbFormatter : GTMLogBasicFormatter
@@ -464,6 +493,116 @@ static BOOL StringMatchesPattern(NSString *str, NSString *pattern) {
   XCTAssertTrue(StringMatchesPattern(msg, pattern), @"msg: %@", msg);
 }
 
+- (void)testByteWriter {
+  ByteArrayWriter *writer = [[ByteArrayWriter alloc] init];
+  GTMLogger *logger = [GTMLogger loggerWithWriter:writer
+                                        formatter:nil  // basic formatter
+                                           filter:nil];  // no filter
+  XCTAssertNotNil(logger);
+
+  // Longer than the initial scratch buffer so it has to grow.
+  NSString *longString = [@"" stringByPaddingToLength:5000
+                                            withString:@"0123456789"
+                                       startingAtIndex:0];
+  [logger logInfo:@"hi %d", 1];
+  [logger logError:@"caf\u00e9 %@", @"\u2603"];
+  [logger logDebug:@"%@", longString];
+  [logger logInfo:@""];
+
+  XCTAssertEqual([[writer messages] count], (NSUInteger)0);
+  NSArray *messages = [writer byteMessages];
+  XCTAssertEqual([messages count], (NSUInteger)4);
+  XCTAssertEqualObjects([messages objectAtIndex:0], @"hi 1");
+  XCTAssertEqualObjects([messages objectAtIndex:1], @"caf\u00e9 \u2603");
+  XCTAssertEqualObjects([messages objectAtIndex:2], longString);
+  XCTAssertEqualObjects([messages objectAtIndex:3], @"");
+
+  // A filter w/o byte support forces the NSString path.
+  [logger setFilter:[[IgnoreFilter alloc] init]];
+  [logger logInfo:@"string %d", 2];
+  [logger logInfo:@"ignore me"];
+  XCTAssertEqual([[writer byteMessages] count], (NSUInteger)4);
+  XCTAssertEqual([[writer messages] count], (NSUInteger)1);
+  XCTAssertEqualObjects([[writer messages] objectAtIndex:0], @"string 2");
+
+  // Subclasses of the basic formatter still get their say on the byte path.
+  [logger setFilter:[[GTMLogMininumLevelFilter alloc]
+                        initWithMinimumLevel:kGTMLoggerLevelInfo]];
+  [logger setFormatter:[[DumbFormatter alloc] init]];
+  [logger logInfo:@"bleh"];
+  [logger logDebug:@"filtered"];
+  XCTAssertEqual([[writer byteMessages] count], (NSUInteger)5);
+  XCTAssertEqualObjects([[writer byteMessages] objectAtIndex:4],
+                        @"DUMB [2] bleh");
+
+  // The standard formatter produces the same layout as bytes.
+  [logger setFormatter:[[GTMLogStandardFormatter alloc] init]];
+  [logger logInfo:@"test %@", @"hi"];
+  XCTAssertEqual([[writer byteMessages] count], (NSUInteger)6);
+  NSString *executableName = [[[NSBundle mainBundle] executablePath] lastPathComponent];
+  NSString *pattern = [NSString stringWithFormat:kFormatBasePattern, executableName, @"test hi"];
+  NSString *msg = [[writer byteMessages] objectAtIndex:5];
+  XCTAssertTrue(StringMatchesPattern(msg, pattern), @"msg: %@", msg);
+
+  // Composite writers hand strings to the writers that only take strings.
+  ArrayWriter *stringWriter = [[ArrayWriter alloc] init];
+  ByteArrayWriter *byteWriter = [[ByteArrayWriter alloc] init];
+  logger = [GTMLogger loggerWithWriter:@[ stringWriter, byteWriter ]
+                             formatter:nil
+                                filter:nil];
+  [logger logInfo:@"both %d", 3];
+  XCTAssertEqualObjects([stringWriter messages], @[ @"both 3" ]);
+  XCTAssertEqualObjects([byteWriter byteMessages], @[ @"both 3" ]);
+}
+
+- (void)testByteWriterCFormats {
+  ByteArrayWriter *writer = [[ByteArrayWriter alloc] init];
+  GTMLogger *logger = [GTMLogger loggerWithWriter:writer
+                                        formatter:nil  // basic formatter
+                                           filter:nil];  // no filter
+  XCTAssertNotNil(logger);
+
+  // Plain C formats and ones that need CFString's formatting.
+  [logger logInfo:@"%s %5.2f %lld%% %p", "caf\xc3\xa9", 3.14159, 42LL, NULL];
+  [logger logInfo:@"%s %C %@", "x", (unichar)0x2603, @"y"];
+  [logger logInfo:@"%2$s %1$-3x|", 255, "z"];
+
+  // A message that exactly fills the scratch buffer: the first grows it to
+  // 1MB, the second is 1MB long.
+  NSString *almost = [@"" stringByPaddingToLength:(1 << 20) - 1
+                                        withString:@"0123456789"
+                                   startingAtIndex:0];
+  NSString *exact = [almost stringByAppendingString:@"!"];
+  [logger logInfo:@"%s", [almost UTF8String]];
+  [logger logInfo:@"%s", [exact UTF8String]];
+
+  NSArray *messages = [writer byteMessages];
+  XCTAssertEqual([messages count], (NSUInteger)5);
+  XCTAssertEqualObjects([messages objectAtIndex:0],
+                        @"caf\u00e9  3.14 42% 0x0");
+  XCTAssertEqualObjects([messages objectAtIndex:1], @"x \u2603 y");
+  XCTAssertEqualObjects([messages objectAtIndex:2], @"z ff |");
+  XCTAssertEqualObjects([messages objectAtIndex:3], almost);
+  XCTAssertEqualObjects([messages objectAtIndex:4], exact);
+}
+
+- (void)testFileHandleByteWriter {
+  NSFileHandle *fh = [NSFileHandle fileHandleForLoggingAtPath:path_ mode:0644];
+  XCTAssertNotNil(fh);
+
+  [fh logMessageBytes:"test 0" length:6 level:kGTMLoggerLevelInfo];
+  [fh logMessageBytes:"test 1 junk" length:6 level:kGTMLoggerLevelError];
+  [fh logMessageBytes:"" length:0 level:kGTMLoggerLevelInfo];
+  [fh closeFile];
+
+  NSError *err = nil;
+  NSString *contents = [NSString stringWithContentsOfFile:path_
+                                                 encoding:NSUTF8StringEncoding
+                                                    error:&err];
+  XCTAssertNotNil(contents, @"Error loading log file: %@", err);
+  XCTAssertEqualObjects(@"test 0\ntest 1\n\n", contents);
+}
+
 - (void)testNoFilter {
   id<GTMLogFilter> filter = [[GTMLogNoFilter alloc] init];
   XCTAssertNotNil(filter);
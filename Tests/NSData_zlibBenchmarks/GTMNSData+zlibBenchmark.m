@@ -0,0 +1,471 @@
+//
+//  GTMNSData+zlibBenchmark.m
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#if !__has_feature(objc_arc)
+#error "This file needs to be compiled with ARC enabled."
+#endif
+
+#import "GTMSenTestCase.h"
+#import "GTMNSData+zlib.h"
+#import <mach/mach.h>
+#import <malloc/malloc.h>
+#import <stdatomic.h>
+#import <zlib.h>
+
+// Throughput, ratio and memory for the GTMNSData+zlib apis.
+//
+// Nothing runs unless GTM_ZLIB_BENCHMARK is set in the environment, so the
+// target is safe to build and run with everything else. Each corpus, at each
+// size, is compressed in gzip, zlib and raw form at every level and then
+// decompressed, with one line reported per combination:
+//
+//   corpus size mode level ratio compressMB/s inflateMB/s
+//     compressAllocs compressKB compressPeakKB
+//     inflateAllocs inflateKB inflatePeakKB
+//
+// Allocs/KB count every malloc (and realloc) made during one run of the
+// operation, on any thread, whether or not it was freed again. PeakKB is how
+// far the process's physical footprint rose above where it started during
+// that run, sampled every millisecond, so it includes zlib's state and any
+// transient buffers but misses spikes shorter than a sample.
+//
+// The apis clip level 0 to 1, so level 0 compresses with zlib directly
+// (stored blocks, no matching); it is the floor the other levels pay for.
+//
+// Other environment variables:
+//   GTM_ZLIB_BENCHMARK_LARGE      also run the 256MB inputs (slow).
+//   GTM_ZLIB_BENCHMARK_OUTPUT     write the results as CSV to this path.
+//   GTM_ZLIB_BENCHMARK_BASELINE   compare against a CSV from an earlier run
+//                                 (say, before a zlib upgrade); a case fails
+//                                 if it got more than
+//   GTM_ZLIB_BENCHMARK_TOLERANCE  percent (default 15) slower, or its ratio
+//                                 more than 1% worse.
+
+typedef enum {
+  BenchmarkModeGzip,
+  BenchmarkModeZlib,
+  BenchmarkModeRaw,
+} BenchmarkMode;
+
+static NSString *const kModeNames[] = { @"gzip", @"zlib", @"raw" };
+
+// Each timed operation is repeated until it has run this long, and the
+// fastest run is reported.
+static const NSTimeInterval kMinimumTimedInterval = 0.05;
+static const NSUInteger kMaximumRepeats = 1000;
+
+// A small deterministic generator, so every run sees the same corpus.
+typedef struct {
+  uint64_t state;
+} Random;
+
+GTM_INLINE uint32_t NextRandom(Random *random) {
+  random->state = random->state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return (uint32_t)(random->state >> 33);
+}
+
+static void AppendFormat(NSMutableData *data, NSString *format, ...) NS_FORMAT_FUNCTION(2, 3);
+static void AppendFormat(NSMutableData *data, NSString *format, ...) {
+  va_list args;
+  va_start(args, format);
+  NSString *string = [[NSString alloc] initWithFormat:format arguments:args];
+  va_end(args);
+  [data appendData:[string dataUsingEncoding:NSUTF8StringEncoding]];
+}
+
+// Server log lines.
+static NSData *LogCorpus(NSUInteger length) {
+  static NSString *const kLevels[] = { @"INFO", @"INFO", @"INFO", @"WARN", @"ERROR", @"DEBUG" };
+  static NSString *const kPaths[] = {
+    @"/api/v1/users", @"/api/v1/orders", @"/static/app.js", @"/healthz", @"/api/v2/search",
+  };
+  Random random = { 1 };
+  NSMutableData *data = [NSMutableData dataWithCapacity:length + 256];
+  for (NSUInteger i = 0; [data length] < length; ++i) {
+    @autoreleasepool {
+      AppendFormat(data, @"2026-01-%02u %02u:%02u:%02u.%03u %@ [worker-%u] GET %@?id=%u %u %ums\n",
+                   1 + NextRandom(&random) % 28, NextRandom(&random) % 24,
+                   NextRandom(&random) % 60, NextRandom(&random) % 60,
+                   NextRandom(&random) % 1000, kLevels[NextRandom(&random) % 6],
+                   NextRandom(&random) % 16, kPaths[NextRandom(&random) % 5],
+                   NextRandom(&random) % 100000,
+                   (NextRandom(&random) % 10) ? 200 : 404, NextRandom(&random) % 2000);
+    }
+  }
+  [data setLength:length];
+  return data;
+}
+
+// API style JSON records.
+static NSData *JSONCorpus(NSUInteger length) {
+  static NSString *const kKinds[] = { @"click", @"view", @"purchase", @"scroll" };
+  Random random = { 2 };
+  NSMutableData *data = [NSMutableData dataWithCapacity:length + 256];
+  for (NSUInteger i = 0; [data length] < length; ++i) {
+    @autoreleasepool {
+      AppendFormat(data,
+                   @"{\"id\":%lu,\"user\":\"user-%u\",\"kind\":\"%@\",\"score\":%u.%02u,"
+                   @"\"tags\":[\"t%u\",\"t%u\"],\"active\":%@}\n",
+                   (unsigned long)i, NextRandom(&random) % 50000, kKinds[NextRandom(&random) % 4],
+                   NextRandom(&random) % 100, NextRandom(&random) % 100,
+                   NextRandom(&random) % 30, NextRandom(&random) % 30,
+                   (NextRandom(&random) % 2) ? @"true" : @"false");
+    }
+  }
+  [data setLength:length];
+  return data;
+}
+
+// Fixed size binary records: counters, timestamps, floats and padding.
+static NSData *BinaryCorpus(NSUInteger length) {
+  Random random = { 3 };
+  NSMutableData *data = [NSMutableData dataWithLength:length];
+  unsigned char *bytes = [data mutableBytes];
+  uint64_t timestamp = 1700000000000ULL;
+  struct {
+    uint32_t sequence;
+    uint32_t flags;
+    uint64_t timestamp;
+    float values[4];
+    unsigned char padding[8];
+  } record;
+  memset(&record, 0, sizeof(record));
+  for (NSUInteger offset = 0; offset < length; offset += sizeof(record)) {
+    record.sequence++;
+    record.flags = (NextRandom(&random) % 8 == 0) ? NextRandom(&random) % 16 : 0;
+    timestamp += NextRandom(&random) % 1000;
+    record.timestamp = timestamp;
+    for (int i = 0; i < 4; ++i) {
+      record.values[i] = (float)(NextRandom(&random) % 10000) / 100.0f;
+    }
+    memcpy(bytes + offset, &record, MIN(sizeof(record), length - offset));
+  }
+  return data;
+}
+
+// Stands in for media and archives: no redundancy left to find.
+static NSData *CompressedCorpus(NSUInteger length) {
+  Random random = { 4 };
+  NSMutableData *data = [NSMutableData dataWithLength:length];
+  uint32_t *words = [data mutableBytes];
+  for (NSUInteger i = 0; i < length / sizeof(uint32_t); ++i) {
+    words[i] = NextRandom(&random);
+  }
+  return data;
+}
+
+// zlib at Z_NO_COMPRESSION, in |mode|'s wrapper.
+static NSData *Store(NSData *data, BenchmarkMode mode) {
+  static const int kWindowBits[] = { MAX_WBITS + 16, MAX_WBITS, -MAX_WBITS };
+  z_stream strm;
+  bzero(&strm, sizeof(z_stream));
+  if (deflateInit2(&strm, Z_NO_COMPRESSION, Z_DEFLATED, kWindowBits[mode], 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return nil;
+  }
+  NSMutableData *result =
+      [NSMutableData dataWithLength:deflateBound(&strm, (uLong)[data length])];
+  strm.next_in = (Bytef *)[data bytes];
+  strm.avail_in = (uInt)[data length];
+  strm.next_out = [result mutableBytes];
+  strm.avail_out = (uInt)[result length];
+  int retCode = deflate(&strm, Z_FINISH);
+  [result setLength:strm.total_out];
+  deflateEnd(&strm);
+  return (retCode == Z_STREAM_END) ? result : nil;
+}
+
+static NSData *Compress(NSData *data, BenchmarkMode mode, int level) {
+  if (level == Z_NO_COMPRESSION) {
+    return Store(data, mode);
+  }
+  switch (mode) {
+    case BenchmarkModeGzip:
+      return [NSData gtm_dataByGzippingData:data compressionLevel:level error:NULL];
+    case BenchmarkModeZlib:
+      return [NSData gtm_dataByDeflatingData:data compressionLevel:level error:NULL];
+    case BenchmarkModeRaw:
+      return [NSData gtm_dataByRawDeflatingData:data compressionLevel:level error:NULL];
+  }
+  return nil;
+}
+
+static NSData *Decompress(NSData *data, BenchmarkMode mode, NSUInteger expectedLength) {
+  if (mode == BenchmarkModeRaw) {
+    return [NSData gtm_dataByRawInflatingData:data expectedLength:expectedLength error:NULL];
+  }
+  return [NSData gtm_dataByInflatingData:data expectedLength:expectedLength error:NULL];
+}
+
+// What one run of an operation cost in memory.
+typedef struct {
+  uint64_t allocations;
+  uint64_t allocatedBytes;
+  uint64_t peakBytes;
+} MemoryUse;
+
+// libmalloc calls malloc_logger (when set) for every allocation and free in
+// every zone; it is what malloc stack logging hooks into.
+typedef void(MallocLogger)(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3,
+                           uintptr_t result, uint32_t framesToSkip);
+extern MallocLogger *malloc_logger;
+#define kMallocLogTypeAllocate 2
+#define kMallocLogTypeDeallocate 4
+#define kMallocLogTypeHasZone 8
+
+static MallocLogger *gPreviousMallocLogger;
+static _Atomic uint64_t gAllocations;
+static _Atomic uint64_t gAllocatedBytes;
+
+static void CountingMallocLogger(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3,
+                                 uintptr_t result, uint32_t framesToSkip) {
+  if (gPreviousMallocLogger) {
+    gPreviousMallocLogger(type, arg1, arg2, arg3, result, framesToSkip + 1);
+  }
+  uint32_t allocation = kMallocLogTypeAllocate | kMallocLogTypeHasZone;
+  if ((type & allocation) != allocation) {
+    return;
+  }
+  // Zone first, then the size; a realloc passes the old pointer before it.
+  uintptr_t size = (type & kMallocLogTypeDeallocate) ? arg3 : arg2;
+  atomic_fetch_add_explicit(&gAllocations, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&gAllocatedBytes, size, memory_order_relaxed);
+}
+
+static uint64_t PhysicalFootprint(void) {
+  task_vm_info_data_t info;
+  mach_msg_type_number_t count = TASK_VM_INFO_COUNT;
+  if (task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+    return 0;
+  }
+  return info.phys_footprint;
+}
+
+// Runs |operation| once, counting its allocations and sampling the footprint
+// from another thread while it runs.
+static NSData *MeasureOperation(NSData *(^operation)(void), MemoryUse *use) {
+  static dispatch_queue_t samplerQueue;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    samplerQueue = dispatch_queue_create("GTMNSData_zlibBenchmark.sampler",
+                                         DISPATCH_QUEUE_SERIAL);
+  });
+  uint64_t baseline = PhysicalFootprint();
+  __block uint64_t peak = baseline;
+  dispatch_source_t sampler =
+      dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, DISPATCH_TIMER_STRICT, samplerQueue);
+  dispatch_source_set_timer(sampler, DISPATCH_TIME_NOW, NSEC_PER_MSEC, 0);
+  dispatch_source_set_event_handler(sampler, ^{
+    peak = MAX(peak, PhysicalFootprint());
+  });
+  dispatch_resume(sampler);
+
+  atomic_store(&gAllocations, 0);
+  atomic_store(&gAllocatedBytes, 0);
+  gPreviousMallocLogger = malloc_logger;
+  malloc_logger = CountingMallocLogger;
+  NSData *result = operation();
+  malloc_logger = gPreviousMallocLogger;
+  use->allocations = atomic_load(&gAllocations);
+  use->allocatedBytes = atomic_load(&gAllocatedBytes);
+
+  dispatch_source_cancel(sampler);
+  dispatch_sync(samplerQueue, ^{
+    peak = MAX(peak, PhysicalFootprint());
+  });
+  use->peakBytes = peak - baseline;
+  return result;
+}
+
+// Runs |operation| until kMinimumTimedInterval has passed (at least once) and
+// returns the fastest run. The first run is measured rather than timed, since
+// counting allocations slows it down; its result and memory use are returned
+// through |result| and |use|.
+static NSTimeInterval TimeOperation(NSUInteger length, NSData *(^operation)(void),
+                                    NSData **result, MemoryUse *use) {
+  @autoreleasepool {
+    *result = MeasureOperation(operation, use);
+  }
+  NSTimeInterval best = DBL_MAX;
+  NSTimeInterval total = 0;
+  // Only one timed run for the big inputs, they take long enough.
+  NSUInteger repeats = (length >= 64 * 1024 * 1024) ? 1 : kMaximumRepeats;
+  for (NSUInteger i = 0; i < repeats && (i == 0 || total < kMinimumTimedInterval); ++i) {
+    @autoreleasepool {
+      NSDate *start = [NSDate date];
+      operation();
+      NSTimeInterval elapsed = -[start timeIntervalSinceNow];
+      best = MIN(best, elapsed);
+      total += elapsed;
+    }
+  }
+  return best;
+}
+
+@interface GTMNSData_zlibBenchmark : GTMTestCase
+@end
+
+@implementation GTMNSData_zlibBenchmark
+
+- (void)testBenchmark {
+  NSDictionary *environment = [[NSProcessInfo processInfo] environment];
+  if (![environment objectForKey:@"GTM_ZLIB_BENCHMARK"]) {
+    NSLog(@"Set GTM_ZLIB_BENCHMARK to run the zlib benchmarks.");
+    return;
+  }
+
+  NSMutableArray *sizes = [NSMutableArray arrayWithObjects:
+      [NSNumber numberWithUnsignedInteger:1024],
+      [NSNumber numberWithUnsignedInteger:64 * 1024],
+      [NSNumber numberWithUnsignedInteger:1024 * 1024],
+      nil];
+  if ([environment objectForKey:@"GTM_ZLIB_BENCHMARK_LARGE"]) {
+    [sizes addObject:[NSNumber numberWithUnsignedInteger:256 * 1024 * 1024]];
+  }
+  struct {
+    __unsafe_unretained NSString *name;
+    NSData *(*generate)(NSUInteger length);
+  } corpora[] = {
+    { @"logs", LogCorpus },
+    { @"json", JSONCorpus },
+    { @"binary", BinaryCorpus },
+    { @"compressed", CompressedCorpus },
+  };
+
+  NSDictionary *baseline = [self loadBaseline:[environment objectForKey:@"GTM_ZLIB_BENCHMARK_BASELINE"]];
+  double tolerance = 15;
+  NSString *toleranceString = [environment objectForKey:@"GTM_ZLIB_BENCHMARK_TOLERANCE"];
+  if ([toleranceString doubleValue] > 0) {
+    tolerance = [toleranceString doubleValue];
+  }
+
+  NSMutableString *csv = [NSMutableString stringWithString:
+      @"corpus,size,mode,level,ratio,compress_mbps,inflate_mbps,"
+      @"compress_allocs,compress_kb,compress_peak_kb,inflate_allocs,inflate_kb,inflate_peak_kb\n"];
+  NSLog(@"%-10s %10s %4s %5s %6s %10s %10s %8s %10s %10s %8s %10s %10s",
+        "corpus", "size", "mode", "level", "ratio", "comp MB/s", "infl MB/s",
+        "c allocs", "c KB", "c peak KB", "i allocs", "i KB", "i peak KB");
+  for (NSNumber *size in sizes) {
+    NSUInteger length = [size unsignedIntegerValue];
+    for (size_t c = 0; c < sizeof(corpora) / sizeof(corpora[0]); ++c) {
+      NSData *input = corpora[c].generate(length);
+      for (int mode = BenchmarkModeGzip; mode <= BenchmarkModeRaw; ++mode) {
+        for (int level = Z_NO_COMPRESSION; level <= Z_BEST_COMPRESSION; ++level) {
+          @autoreleasepool {
+            NSData *compressed = nil;
+            MemoryUse compressUse;
+            NSTimeInterval compressTime = TimeOperation(length, ^{
+              return Compress(input, (BenchmarkMode)mode, level);
+            }, &compressed, &compressUse);
+            NSData *inflated = nil;
+            MemoryUse inflateUse;
+            NSTimeInterval inflateTime = TimeOperation(length, ^{
+              return Decompress(compressed, (BenchmarkMode)mode, length);
+            }, &inflated, &inflateUse);
+            XCTAssertEqualObjects(inflated, input, @"%@ %lu %@ %d", corpora[c].name,
+                                  (unsigned long)length, kModeNames[mode], level);
+
+            double ratio = (double)length / MAX([compressed length], (NSUInteger)1);
+            double megabytes = length / (1024.0 * 1024.0);
+            double compressRate = megabytes / MAX(compressTime, 1e-9);
+            double inflateRate = megabytes / MAX(inflateTime, 1e-9);
+            NSLog(@"%-10s %10lu %4s %5d %6.2f %10.1f %10.1f %8llu %10.1f %10.1f %8llu %10.1f %10.1f",
+                  [corpora[c].name UTF8String], (unsigned long)length,
+                  [kModeNames[mode] UTF8String], level, ratio, compressRate, inflateRate,
+                  compressUse.allocations, compressUse.allocatedBytes / 1024.0,
+                  compressUse.peakBytes / 1024.0, inflateUse.allocations,
+                  inflateUse.allocatedBytes / 1024.0, inflateUse.peakBytes / 1024.0);
+            NSString *key = [NSString stringWithFormat:@"%@,%lu,%@,%d", corpora[c].name,
+                                                       (unsigned long)length, kModeNames[mode],
+                                                       level];
+            [csv appendFormat:@"%@,%.4f,%.2f,%.2f,%llu,%.1f,%.1f,%llu,%.1f,%.1f\n", key, ratio,
+                              compressRate, inflateRate, compressUse.allocations,
+                              compressUse.allocatedBytes / 1024.0, compressUse.peakBytes / 1024.0,
+                              inflateUse.allocations, inflateUse.allocatedBytes / 1024.0,
+                              inflateUse.peakBytes / 1024.0];
+
+            NSArray *previous = [baseline objectForKey:key];
+            if (previous) {
+              [self checkKey:key
+                       ratio:ratio
+                compressRate:compressRate
+                 inflateRate:inflateRate
+                againstFields:previous
+                   tolerance:tolerance];
+            }
+          }
+        }
+      }
+    }
+  }
+
+  NSString *outputPath = [environment objectForKey:@"GTM_ZLIB_BENCHMARK_OUTPUT"];
+  if (outputPath) {
+    NSError *error = nil;
+    XCTAssertTrue([csv writeToFile:outputPath
+                        atomically:YES
+                          encoding:NSUTF8StringEncoding
+                             error:&error],
+                  @"%@", error);
+  }
+}
+
+// Reads a CSV written by an earlier run into key -> fields.
+- (NSDictionary *)loadBaseline:(NSString *)path {
+  if (!path) {
+    return nil;
+  }
+  NSError *error = nil;
+  NSString *contents = [NSString stringWithContentsOfFile:path
+                                                 encoding:NSUTF8StringEncoding
+                                                    error:&error];
+  XCTAssertNotNil(contents, @"%@", error);
+  NSMutableDictionary *baseline = [NSMutableDictionary dictionary];
+  NSArray *lines = [contents componentsSeparatedByString:@"\n"];
+  for (NSUInteger i = 1; i < [lines count]; ++i) {
+    NSArray *fields = [[lines objectAtIndex:i] componentsSeparatedByString:@","];
+    if ([fields count] < 7) {
+      continue;
+    }
+    NSString *key = [[fields subarrayWithRange:NSMakeRange(0, 4)] componentsJoinedByString:@","];
+    [baseline setObject:fields forKey:key];
+  }
+  return baseline;
+}
+
+- (void)checkKey:(NSString *)key
+           ratio:(double)ratio
+    compressRate:(double)compressRate
+     inflateRate:(double)inflateRate
+   againstFields:(NSArray *)fields
+       tolerance:(double)tolerance {
+  double baseRatio = [[fields objectAtIndex:4] doubleValue];
+  double baseCompressRate = [[fields objectAtIndex:5] doubleValue];
+  double baseInflateRate = [[fields objectAtIndex:6] doubleValue];
+  double slowest = 1 - tolerance / 100;
+  XCTAssertGreaterThanOrEqual(ratio, baseRatio * 0.99,
+                              @"%@: ratio %.4f, was %.4f", key, ratio, baseRatio);
+  XCTAssertGreaterThanOrEqual(compressRate, baseCompressRate * slowest,
+                              @"%@: compress %.1f MB/s, was %.1f", key, compressRate,
+                              baseCompressRate);
+  XCTAssertGreaterThanOrEqual(inflateRate, baseInflateRate * slowest,
+                              @"%@: inflate %.1f MB/s, was %.1f", key, inflateRate,
+                              baseInflateRate);
+}
+
+@end
@@ -0,0 +1,293 @@
+//
+//  GTMCompressionCodecTest.m
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#if !__has_feature(objc_arc)
+#error "This file needs to be compiled with ARC enabled."
+#endif
+
+#import "GTMSenTestCase.h"
+#import "GTMCompressionCodec.h"
+#import "GTMLZCodec.h"
+#import "GTMNSData+zlib.h"
+#import "GTMZlibTestData.h"
+#import <zlib.h>
+
+@interface GTMCompressionCodecTest : GTMTestCase
+@end
+
+// A codec that stores its input as is.
+@interface GTMCompressionCodecTestCopyCodec : NSObject <GTMCompressionCodec>
+- (instancetype)initWithIdentifier:(uint8_t)identifier;
+@end
+
+@implementation GTMCompressionCodecTestCopyCodec {
+  uint8_t identifier_;
+}
+
+- (instancetype)init {
+  return [self initWithIdentifier:200];
+}
+
+- (instancetype)initWithIdentifier:(uint8_t)identifier {
+  self = [super init];
+  if (self) {
+    identifier_ = identifier;
+  }
+  return self;
+}
+
+- (uint8_t)codecIdentifier {
+  return identifier_;
+}
+
+- (NSString *)codecName {
+  return [NSString stringWithFormat:@"GTMCompressionCodecTest.copy%u", identifier_];
+}
+
+- (NSUInteger)maximumCompressedLengthForLength:(NSUInteger)length {
+  return length;
+}
+
+- (NSUInteger)maximumDecompressedLengthForLength:(NSUInteger)length {
+  return length;
+}
+
+- (BOOL)compressBytes:(const void *)bytes
+               length:(NSUInteger)length
+     compressionLevel:(int)level
+           intoBuffer:(void *)buffer
+             capacity:(NSUInteger)capacity
+     compressedLength:(NSUInteger *)compressedLength
+                error:(NSError **)error {
+  memcpy(buffer, bytes, length);
+  *compressedLength = length;
+  return YES;
+}
+
+- (BOOL)decompressBytes:(const void *)bytes
+                 length:(NSUInteger)length
+             intoBuffer:(void *)buffer
+           outputLength:(NSUInteger)outputLength
+                  error:(NSError **)error {
+  if (length != outputLength) {
+    if (error) {
+      *error = [NSError errorWithDomain:GTMNSDataZlibErrorDomain
+                                   code:GTMNSDataZlibErrorInternal
+                               userInfo:@{GTMNSDataZlibErrorKey : @(Z_DATA_ERROR)}];
+    }
+    return NO;
+  }
+  memcpy(buffer, bytes, length);
+  return YES;
+}
+
+@end
+
+@implementation GTMCompressionCodecTest
+
+- (void)testBuiltInCodecs {
+  id<GTMCompressionCodec> deflate = [GTMCompressionCodecs deflateCodec];
+  id<GTMCompressionCodec> lz = [GTMCompressionCodecs lzCodec];
+  XCTAssertEqualObjects([deflate codecName], @"deflate");
+  XCTAssertEqual([deflate codecIdentifier], (uint8_t)1);
+  XCTAssertEqualObjects(lz, [GTMLZCodec sharedCodec]);
+  XCTAssertEqualObjects([GTMCompressionCodecs codecNamed:@"deflate"], deflate);
+  XCTAssertEqualObjects([GTMCompressionCodecs codecNamed:@"lz"], lz);
+  XCTAssertEqualObjects([GTMCompressionCodecs codecWithIdentifier:2], lz);
+  XCTAssertNil([GTMCompressionCodecs codecNamed:@"nope"]);
+  XCTAssertNil([GTMCompressionCodecs codecWithIdentifier:99]);
+
+  NSData *input = GTMZlibTestData(500000, GTMZlibTestDataLetters, 3);
+  for (id<GTMCompressionCodec> codec in @[ deflate, lz ]) {
+    NSError *error = nil;
+    NSData *frame = [NSData gtm_dataByCompressingData:input
+                                                codec:codec
+                                     compressionLevel:Z_DEFAULT_COMPRESSION
+                                                error:&error];
+    XCTAssertNotNil(frame, @"%@", error);
+    XCTAssertLessThan([frame length], [input length]);
+    XCTAssertTrue([GTMCompressionCodecs isFrameBytes:[frame bytes] length:[frame length]]);
+    XCTAssertEqual(((const unsigned char *)[frame bytes])[5], [codec codecIdentifier]);
+
+    // Auto-detected alongside zlib and gzip.
+    XCTAssertEqualObjects([NSData gtm_dataByInflatingData:frame error:&error], input,
+                          @"%@: %@", [codec codecName], error);
+    XCTAssertEqualObjects([GTMCompressionCodecs dataByDecompressingFrameBytes:[frame bytes]
+                                                                      length:[frame length]
+                                                               maximumLength:0
+                                                                       error:&error],
+                          input, @"%@", error);
+    // But not by the raw apis.
+    XCTAssertNil([NSData gtm_dataByRawInflatingData:frame error:NULL]);
+  }
+  XCTAssertFalse([GTMCompressionCodecs isFrameBytes:[input bytes] length:[input length]]);
+  XCTAssertFalse([GTMCompressionCodecs isFrameBytes:"GTM" length:3]);
+
+  // Empty input gives nil, as elsewhere.
+  XCTAssertNil([NSData gtm_dataByCompressingData:[NSData data]
+                                           codec:[GTMCompressionCodecs lzCodec]
+                                compressionLevel:1
+                                           error:NULL]);
+}
+
+- (void)testLimits {
+  NSData *input = GTMZlibTestData(100000, GTMZlibTestDataLetters, 3);
+  NSData *frame = [NSData gtm_dataByCompressingData:input
+                                              codec:[GTMCompressionCodecs lzCodec]
+                                   compressionLevel:1
+                                              error:NULL];
+  NSError *error = nil;
+  XCTAssertNil([NSData gtm_dataByInflatingData:frame
+                                 maximumLength:99999
+                                  maximumRatio:0
+                                         error:&error]);
+  XCTAssertEqualObjects([error domain], GTMNSDataZlibErrorDomain);
+  XCTAssertEqual([error code], GTMNSDataZlibErrorOutputLimitExceeded);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibPartialLengthKey], @0);
+  XCTAssertEqualObjects([NSData gtm_dataByInflatingData:frame
+                                          maximumLength:100000
+                                           maximumRatio:0
+                                                  error:&error],
+                        input, @"%@", error);
+  NSUInteger ratio = ([input length] - 1) / [frame length];
+  XCTAssertNil([NSData gtm_dataByInflatingData:frame
+                                 maximumLength:0
+                                  maximumRatio:ratio
+                                         error:&error]);
+  XCTAssertEqual([error code], GTMNSDataZlibErrorOutputLimitExceeded);
+  XCTAssertEqualObjects([NSData gtm_dataByInflatingData:frame
+                                          maximumLength:0
+                                           maximumRatio:ratio + 1
+                                                  error:NULL],
+                        input);
+}
+
+- (void)testDamagedFrames {
+  NSData *input = GTMZlibTestData(20000, GTMZlibTestDataLetters, 3);
+  NSData *frame = [NSData gtm_dataByCompressingData:input
+                                              codec:[GTMCompressionCodecs lzCodec]
+                                   compressionLevel:1
+                                              error:NULL];
+  NSError *error = nil;
+
+  // A changed byte in the original length.
+  NSMutableData *damaged = [frame mutableCopy];
+  ((unsigned char *)[damaged mutableBytes])[8] ^= 1;
+  XCTAssertNil([NSData gtm_dataByInflatingData:damaged error:&error]);
+  XCTAssertEqual([error code], GTMNSDataZlibErrorInternal);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibErrorKey], @(Z_DATA_ERROR));
+
+  // A changed byte in the CRC.
+  damaged = [frame mutableCopy];
+  ((unsigned char *)[damaged mutableBytes])[16] ^= 1;
+  XCTAssertNil([NSData gtm_dataByInflatingData:damaged error:&error]);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibErrorKey], @(Z_DATA_ERROR));
+
+  // An unknown version.
+  damaged = [frame mutableCopy];
+  ((unsigned char *)[damaged mutableBytes])[4] = 2;
+  XCTAssertNil([NSData gtm_dataByInflatingData:damaged error:&error]);
+  XCTAssertEqual([error code], GTMNSDataZlibErrorInternal);
+
+  // Just the header, or part of it.
+  XCTAssertNil([NSData gtm_dataByInflatingData:[frame subdataWithRange:NSMakeRange(0, 20)]
+                                         error:&error]);
+  XCTAssertNil([NSData gtm_dataByInflatingData:[frame subdataWithRange:NSMakeRange(0, 10)]
+                                         error:&error]);
+  XCTAssertEqual([error code], GTMNSDataZlibErrorInternal);
+
+  // An unregistered codec.
+  damaged = [frame mutableCopy];
+  ((unsigned char *)[damaged mutableBytes])[5] = 250;
+  XCTAssertNil([NSData gtm_dataByInflatingData:damaged error:&error]);
+  XCTAssertEqual([error code], GTMNSDataZlibErrorUnknownCodec);
+}
+
+- (void)testForgedLength {
+  // A header claiming far more than its payload could ever hold is rejected
+  // without trying to allocate it.
+  NSData *input = GTMZlibTestData(1000, GTMZlibTestDataLetters, 3);
+  NSData *frame = [NSData gtm_dataByCompressingData:input
+                                              codec:[GTMCompressionCodecs lzCodec]
+                                   compressionLevel:1
+                                              error:NULL];
+  NSMutableData *forged = [frame mutableCopy];
+  unsigned char *header = [forged mutableBytes];
+  uint64_t claimed = 1ULL << 40;
+  for (int i = 0; i < 8; ++i) {
+    header[8 + i] = (unsigned char)(claimed >> (8 * i));
+  }
+  NSError *error = nil;
+  XCTAssertNil([NSData gtm_dataByInflatingData:forged error:&error]);
+  XCTAssertEqual([error code], GTMNSDataZlibErrorInternal);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibErrorKey], @(Z_DATA_ERROR));
+
+  // Same for deflate, and for the most the payload could hold plus one.
+  for (id<GTMCompressionCodec> codec in @[ [GTMCompressionCodecs deflateCodec],
+                                            [GTMCompressionCodecs lzCodec] ]) {
+    frame = [NSData gtm_dataByCompressingData:input
+                                        codec:codec
+                             compressionLevel:1
+                                        error:NULL];
+    forged = [frame mutableCopy];
+    header = [forged mutableBytes];
+    claimed = (uint64_t)[codec maximumDecompressedLengthForLength:[frame length] - 20] + 1;
+    for (int i = 0; i < 8; ++i) {
+      header[8 + i] = (unsigned char)(claimed >> (8 * i));
+    }
+    XCTAssertNil([NSData gtm_dataByInflatingData:forged error:&error], @"%@", [codec codecName]);
+    XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibErrorKey], @(Z_DATA_ERROR));
+  }
+}
+
+- (void)testRegistration {
+  GTMCompressionCodecTestCopyCodec *codec = [[GTMCompressionCodecTestCopyCodec alloc] init];
+  NSData *input = GTMZlibTestData(1000, GTMZlibTestDataLetters, 3);
+  NSData *frame = [NSData gtm_dataByCompressingData:input
+                                              codec:codec
+                                   compressionLevel:1
+                                              error:NULL];
+  XCTAssertEqual([frame length], [input length] + 20);
+
+  // Until it is registered its frames can't be read.
+  NSError *error = nil;
+  if (![GTMCompressionCodecs codecWithIdentifier:200]) {
+    XCTAssertNil([NSData gtm_dataByInflatingData:frame error:&error]);
+    XCTAssertEqual([error code], GTMNSDataZlibErrorUnknownCodec);
+    XCTAssertTrue([GTMCompressionCodecs registerCodec:codec]);
+  }
+  XCTAssertEqualObjects([GTMCompressionCodecs codecNamed:[codec codecName]], codec);
+  XCTAssertEqualObjects([NSData gtm_dataByInflatingData:frame error:&error], input, @"%@", error);
+
+  // Names and identifiers can't be taken twice.
+  XCTAssertFalse([GTMCompressionCodecs registerCodec:codec]);
+  XCTAssertFalse([GTMCompressionCodecs registerCodec:[GTMLZCodec sharedCodec]]);
+
+  // Identifiers below 128 are kept for codecs in GTM, even unused ones.
+  for (NSNumber *identifier in @[ @0, @1, @3, @127 ]) {
+    uint8_t reservedIdentifier = [identifier unsignedCharValue];
+    GTMCompressionCodecTestCopyCodec *reserved =
+        [[GTMCompressionCodecTestCopyCodec alloc] initWithIdentifier:reservedIdentifier];
+    XCTAssertFalse([GTMCompressionCodecs registerCodec:reserved], @"%@", identifier);
+    XCTAssertNil([GTMCompressionCodecs codecNamed:[reserved codecName]]);
+  }
+  XCTAssertEqualObjects([GTMCompressionCodecs codecWithIdentifier:1],
+                        [GTMCompressionCodecs deflateCodec]);
+}
+
+@end
@@ -0,0 +1,143 @@
+//
+//  GTMLZCodecTest.m
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#if !__has_feature(objc_arc)
+#error "This file needs to be compiled with ARC enabled."
+#endif
+
+#import "GTMSenTestCase.h"
+#import "GTMLZCodec.h"
+#import "GTMNSData+zlib.h"
+#import "GTMZlibTestData.h"
+#import <zlib.h>
+
+@interface GTMLZCodecTest : GTMTestCase
+@end
+
+static NSData *Compress(GTMLZCodec *codec, NSData *input) {
+  NSUInteger capacity = [codec maximumCompressedLengthForLength:[input length]];
+  NSMutableData *output = [NSMutableData dataWithLength:capacity];
+  NSUInteger length = 0;
+  NSError *error = nil;
+  if (![codec compressBytes:[input bytes]
+                     length:[input length]
+           compressionLevel:Z_DEFAULT_COMPRESSION
+                 intoBuffer:[output mutableBytes]
+                   capacity:capacity
+           compressedLength:&length
+                      error:&error]) {
+    return nil;
+  }
+  [output setLength:length];
+  return output;
+}
+
+static NSData *Decompress(GTMLZCodec *codec, NSData *input, NSUInteger length,
+                          NSError **error) {
+  NSMutableData *output = [NSMutableData dataWithLength:length];
+  if (![codec decompressBytes:[input bytes]
+                       length:[input length]
+                   intoBuffer:[output mutableBytes]
+                 outputLength:length
+                        error:error]) {
+    return nil;
+  }
+  return output;
+}
+
+@implementation GTMLZCodecTest
+
+- (void)testRoundTrip {
+  GTMLZCodec *codec = [GTMLZCodec sharedCodec];
+  XCTAssertEqual([codec codecIdentifier], (uint8_t)2);
+  XCTAssertEqualObjects([codec codecName], @"lz");
+  NSUInteger lengths[] = { 1, 5, 12, 13, 100, 65536, 300000, 4 * 1024 * 1024 + 7 };
+  GTMZlibTestDataKind kinds[] = {
+    GTMZlibTestDataRandom, GTMZlibTestDataZeros, GTMZlibTestDataPattern, GTMZlibTestDataWords,
+  };
+  for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); ++k) {
+    GTMZlibTestDataKind kind = kinds[k];
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i) {
+      NSData *input = GTMZlibTestData(lengths[i], kind, 11);
+      NSData *compressed = Compress(codec, input);
+      XCTAssertNotNil(compressed);
+      XCTAssertLessThanOrEqual([compressed length],
+                               [codec maximumCompressedLengthForLength:[input length]]);
+      NSError *error = nil;
+      XCTAssertEqualObjects(Decompress(codec, compressed, [input length], &error), input,
+                            @"kind %d length %lu: %@", (int)kind, (unsigned long)lengths[i],
+                            error);
+      if (kind != GTMZlibTestDataRandom && lengths[i] >= 100) {
+        XCTAssertLessThan([compressed length], [input length] / 2,
+                          @"kind %d length %lu", (int)kind, (unsigned long)lengths[i]);
+      }
+    }
+  }
+
+  // Random data is stored, costing just the block header.
+  NSData *random = GTMZlibTestData(10000, GTMZlibTestDataRandom, 11);
+  XCTAssertEqual([Compress(codec, random) length], [random length] + 4);
+
+  // Too small a buffer is refused rather than overrun.
+  unsigned char small[16];
+  NSUInteger length = 0;
+  NSError *error = nil;
+  XCTAssertFalse([codec compressBytes:[random bytes]
+                               length:[random length]
+                     compressionLevel:1
+                           intoBuffer:small
+                             capacity:sizeof(small)
+                     compressedLength:&length
+                                error:&error]);
+  XCTAssertEqualObjects([error domain], GTMNSDataZlibErrorDomain);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibErrorKey], @(Z_BUF_ERROR));
+}
+
+- (void)testDamagedInput {
+  GTMLZCodec *codec = [GTMLZCodec sharedCodec];
+  NSData *input = GTMZlibTestData(100000, GTMZlibTestDataWords, 11);
+  NSData *compressed = Compress(codec, input);
+  NSError *error = nil;
+
+  // The wrong length, either way.
+  XCTAssertNil(Decompress(codec, compressed, [input length] - 1, &error));
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibErrorKey], @(Z_DATA_ERROR));
+  XCTAssertNil(Decompress(codec, compressed, [input length] + 1, NULL));
+
+  // Truncated, or with something after it.
+  NSData *truncated = [compressed subdataWithRange:NSMakeRange(0, [compressed length] - 1)];
+  XCTAssertNil(Decompress(codec, truncated, [input length], NULL));
+  NSMutableData *extra = [compressed mutableCopy];
+  [extra appendBytes:"x" length:1];
+  XCTAssertNil(Decompress(codec, extra, [input length], NULL));
+
+  // Flipped bytes never read or write out of bounds; they either fail or
+  // decode to something else.
+  uint32_t seed = 5;
+  for (int i = 0; i < 2000; ++i) {
+    NSMutableData *damaged = [compressed mutableCopy];
+    unsigned char *bytes = [damaged mutableBytes];
+    for (int j = 0; j < 4; ++j) {
+      seed = seed * 1103515245 + 12345;
+      bytes[(seed >> 8) % [damaged length]] ^= (unsigned char)(1 + (seed >> 24) % 255);
+    }
+    (void)Decompress(codec, damaged, [input length], NULL);
+  }
+}
+
+@end
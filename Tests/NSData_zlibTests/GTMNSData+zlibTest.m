@@ -19,6 +19,9 @@
 #import "GTMSenTestCase.h"
 #import "GTMNSData+zlib.h"
 #import <stdlib.h> // for random/srandomdev
+#import <libkern/OSByteOrder.h>
+#import <fcntl.h>
+#import <unistd.h>
 #import <zlib.h>
 
 @interface GTMNSData_zlibTest : GTMTestCase
@@ -627,7 +630,7 @@ static BOOL HasGzipHeader(NSData *data) {
     [input appendData:scratch];
   }
 
-  // The internal buffer size for GTM's deflate/inflate is 1024.
+  // The smallest internal buffer size for GTM's deflate/inflate is 1024.
   NSUInteger internalBufferSize = 1024;
 
   // Should deflate to more then one buffer size to make sure the internal loop
@@ -656,4 +659,608 @@ static BOOL HasGzipHeader(NSData *data) {
   error = nil;
 }
 
+- (void)testParallelGzip {
+  // Big enough for a number of blocks, with data that changes across them.
+  NSMutableData *input = [NSMutableData dataWithCapacity:2048 * sizeof(randomDataLarge)];
+  NSMutableData *scratch = [NSMutableData dataWithLength:sizeof(randomDataLarge)];
+  uint8_t *scratchBytes = [scratch mutableBytes];
+  for (NSUInteger i = 0; i < 2048; ++i) {
+    for (NSUInteger j = 0; j < sizeof(randomDataLarge); ++j) {
+      scratchBytes[j] = randomDataLarge[j] ^ (i % 3);
+    }
+    [input appendData:scratch];
+  }
+
+  NSError *error = nil;
+  int levels[] = { Z_DEFAULT_COMPRESSION, 1, 9 };
+  for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); ++i) {
+    NSData *gzipped = [NSData gtm_dataByParallelGzippingData:input
+                                            compressionLevel:levels[i]
+                                                       error:&error];
+    XCTAssertNotNil(gzipped, @"level %d: %@", levels[i], error);
+    NSData *inflated = [NSData gtm_dataByInflatingData:gzipped error:&error];
+    XCTAssertEqualObjects(inflated, input, @"level %d: %@", levels[i], error);
+
+    // Priming each block keeps it close to the serial result.
+    NSData *serial = [NSData gtm_dataByGzippingData:input
+                                   compressionLevel:levels[i]
+                                              error:&error];
+    XCTAssertLessThan([gzipped length], [serial length] + [serial length] / 20);
+  }
+
+  // Small input takes the serial path.
+  NSData *small = [NSData dataWithBytes:randomDataLarge length:sizeof(randomDataLarge)];
+  NSData *gzipped = [NSData gtm_dataByParallelGzippingData:small
+                                          compressionLevel:Z_DEFAULT_COMPRESSION
+                                                     error:&error];
+  XCTAssertEqualObjects([NSData gtm_dataByInflatingData:gzipped error:&error], small);
+  XCTAssertNil([NSData gtm_dataByParallelGzippingBytes:[small bytes]
+                                                length:0
+                                      compressionLevel:Z_DEFAULT_COMPRESSION
+                                                 error:&error]);
+}
+
+- (void)testMultipleGzipMembers {
+  NSData *first = [NSData dataWithBytes:randomDataLarge length:100];
+  NSData *second = [NSData dataWithBytes:randomDataLarge + 100 length:200];
+  NSError *error = nil;
+  NSMutableData *concatenated =
+      [NSMutableData dataWithData:[NSData gtm_dataByGzippingData:first error:&error]];
+  [concatenated appendData:[NSData gtm_dataByGzippingData:second error:&error]];
+
+  NSMutableData *expected = [NSMutableData dataWithData:first];
+  [expected appendData:second];
+  NSData *inflated = [NSData gtm_dataByInflatingData:concatenated error:&error];
+  XCTAssertEqualObjects(inflated, expected, @"%@", error);
+
+  // Junk after the last member is still caught.
+  [concatenated appendBytes:randomDataLarge length:20];
+  error = nil;
+  XCTAssertNil([NSData gtm_dataByInflatingData:concatenated error:&error]);
+  GTMCheckRemainingError(error, 20);
+
+  // A zlib stream has no members, anything after it is left over.
+  NSMutableData *deflated =
+      [NSMutableData dataWithData:[NSData gtm_dataByDeflatingData:first error:&error]];
+  [deflated appendData:[NSData gtm_dataByGzippingData:second error:&error]];
+  NSUInteger gzippedLength = [deflated length] - [[NSData gtm_dataByDeflatingData:first
+                                                                            error:&error] length];
+  error = nil;
+  XCTAssertNil([NSData gtm_dataByInflatingData:deflated error:&error]);
+  GTMCheckRemainingError(error, (int)gzippedLength);
+}
+
+- (void)testBlockGzip {
+  // A few BGZF blocks worth of data.
+  NSMutableData *input = [NSMutableData dataWithCapacity:400 * sizeof(randomDataLarge)];
+  for (int i = 0; i < 400; ++i) {
+    [input appendBytes:randomDataLarge length:sizeof(randomDataLarge) - (i % 7)];
+  }
+
+  NSError *error = nil;
+  NSData *index = nil;
+  NSData *blockGzipped = [NSData gtm_dataByBlockGzippingData:input
+                                            compressionLevel:Z_DEFAULT_COMPRESSION
+                                                       index:&index
+                                                       error:&error];
+  XCTAssertNotNil(blockGzipped, @"%@", error);
+  XCTAssertTrue(HasGzipHeader(blockGzipped));
+
+  // Readable by the normal api and the parallel one.
+  XCTAssertEqualObjects([NSData gtm_dataByInflatingData:blockGzipped error:&error], input);
+  XCTAssertEqualObjects([NSData gtm_dataByParallelInflatingData:blockGzipped error:&error],
+                        input);
+
+  // The index has an entry for each member after the first; the input was
+  // split every 0xff00 bytes.
+  NSUInteger memberCount = ([input length] + 0xff00 - 1) / 0xff00;
+  XCTAssertEqual([index length], 8 + (memberCount - 1) * 16);
+  const uint8_t *indexBytes = [index bytes];
+  XCTAssertEqual(OSReadLittleInt64(indexBytes, 0), (uint64_t)(memberCount - 1));
+  for (NSUInteger i = 1; i < memberCount; ++i) {
+    uint64_t compressedOffset = OSReadLittleInt64(indexBytes, 8 + (i - 1) * 16);
+    uint64_t uncompressedOffset = OSReadLittleInt64(indexBytes, 16 + (i - 1) * 16);
+    XCTAssertEqual(uncompressedOffset, (uint64_t)(i * 0xff00));
+    // Each member can be inflated on its own from its offset.
+    NSData *member = [blockGzipped subdataWithRange:NSMakeRange((NSUInteger)compressedOffset,
+                                                                [blockGzipped length] - (NSUInteger)compressedOffset)];
+    NSData *inflated = [NSData gtm_dataByInflatingData:member error:&error];
+    XCTAssertEqualObjects(inflated,
+                          [input subdataWithRange:NSMakeRange((NSUInteger)uncompressedOffset,
+                                                              [input length] - (NSUInteger)uncompressedOffset)]);
+  }
+
+  // Corruption in a member is reported.
+  NSMutableData *corrupt = [NSMutableData dataWithData:blockGzipped];
+  ((uint8_t *)[corrupt mutableBytes])[100] ^= 0xff;  // In the first member's data.
+  error = nil;
+  XCTAssertNil([NSData gtm_dataByParallelInflatingData:corrupt error:&error]);
+  XCTAssertEqual([error code], (NSInteger)GTMNSDataZlibErrorInternal);
+
+  // Non BGZF data still works with the parallel api.
+  NSData *gzipped = [NSData gtm_dataByGzippingData:input error:&error];
+  XCTAssertEqualObjects([NSData gtm_dataByParallelInflatingData:gzipped error:&error], input);
+  NSData *deflated = [NSData gtm_dataByDeflatingData:input error:&error];
+  XCTAssertEqualObjects([NSData gtm_dataByParallelInflatingData:deflated error:&error], input);
+}
+
+- (void)testExpectedLength {
+  NSMutableData *input = [NSMutableData dataWithCapacity:16 * sizeof(randomDataLarge)];
+  for (int i = 0; i < 16; ++i) {
+    [input appendBytes:randomDataLarge length:sizeof(randomDataLarge)];
+  }
+  NSError *error = nil;
+  NSData *gzipped = [NSData gtm_dataByGzippingData:input error:&error];
+  NSData *rawDeflated = [NSData gtm_dataByRawDeflatingData:input error:&error];
+  XCTAssertNotNil(gzipped);
+  XCTAssertNotNil(rawDeflated);
+
+  // Right, too small, too large and no hint all give the same result.
+  NSUInteger hints[] = { [input length], 1, [input length] * 100, 0 };
+  for (size_t i = 0; i < sizeof(hints) / sizeof(hints[0]); ++i) {
+    NSData *inflated = [NSData gtm_dataByInflatingData:gzipped
+                                        expectedLength:hints[i]
+                                                 error:&error];
+    XCTAssertEqualObjects(inflated, input, @"hint %lu", (unsigned long)hints[i]);
+    inflated = [NSData gtm_dataByRawInflatingData:rawDeflated
+                                   expectedLength:hints[i]
+                                            error:&error];
+    XCTAssertEqualObjects(inflated, input, @"hint %lu", (unsigned long)hints[i]);
+  }
+
+  // A bogus gzip trailer is only a hint for sizing, inflate still catches it.
+  NSMutableData *badTrailer = [NSMutableData dataWithData:gzipped];
+  uint8_t *bytes = [badTrailer mutableBytes];
+  bytes[[badTrailer length] - 1] = 0xff;
+  error = nil;
+  XCTAssertNil([NSData gtm_dataByInflatingData:badTrailer error:&error]);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibErrorKey],
+                        [NSNumber numberWithInt:Z_DATA_ERROR]);
+}
+
+- (void)testMappedData {
+  // Memory mapped input should work the same as in memory input.
+  NSMutableData *input = [NSMutableData dataWithCapacity:64 * sizeof(randomDataLarge)];
+  for (int i = 0; i < 64; ++i) {
+    [input appendBytes:randomDataLarge length:sizeof(randomDataLarge)];
+  }
+  NSString *path =
+      [NSTemporaryDirectory() stringByAppendingPathComponent:
+          [NSString stringWithFormat:@"GTMNSData_zlibTest-%d", getpid()]];
+  NSError *error = nil;
+  NSData *compressed = [NSData gtm_dataByGzippingData:input error:&error];
+  XCTAssertNotNil(compressed, @"failed to gzip: %@", error);
+  XCTAssertTrue([compressed writeToFile:path options:NSDataWritingAtomic error:&error]);
+
+  NSData *mapped = [NSData dataWithContentsOfFile:path
+                                          options:NSDataReadingMappedAlways
+                                            error:&error];
+  XCTAssertNotNil(mapped, @"failed to map: %@", error);
+  NSData *uncompressed = [NSData gtm_dataByInflatingData:mapped error:&error];
+  XCTAssertEqualObjects(uncompressed, input);
+  XCTAssertTrue([[NSFileManager defaultManager] removeItemAtPath:path error:NULL]);
+}
+
+- (void)testPresetDictionary {
+  // Small JSON-ish records with a lot in common.
+  NSMutableArray *records = [NSMutableArray array];
+  srandom(7);
+  for (int i = 0; i < 400; ++i) {
+    NSString *record =
+        [NSString stringWithFormat:@"{\"id\":%ld,\"user\":{\"name\":\"user%ld\","
+                                   @"\"verified\":%@},\"currency\":\"USD\","
+                                   @"\"amount\":%ld.%02ld,\"tags\":[\"payments\"]}",
+                                   random(), random() % 50, (random() % 2) ? @"true" : @"false",
+                                   random() % 1000, random() % 100];
+    [records addObject:[record dataUsingEncoding:NSUTF8StringEncoding]];
+  }
+  NSArray *samples = [records subarrayWithRange:NSMakeRange(0, 200)];
+  NSData *dictionary = [NSData gtm_dictionaryFromSamples:samples maxLength:2048];
+  XCTAssertGreaterThan([dictionary length], (NSUInteger)0);
+  XCTAssertLessThanOrEqual([dictionary length], (NSUInteger)2048);
+  // No samples, no dictionary.
+  XCTAssertEqual([[NSData gtm_dictionaryFromSamples:[NSArray array] maxLength:0] length],
+                 (NSUInteger)0);
+
+  NSUInteger plainTotal = 0;
+  NSUInteger dictionaryTotal = 0;
+  NSError *error = nil;
+  for (NSUInteger i = 200; i < [records count]; ++i) {
+    NSData *record = [records objectAtIndex:i];
+    NSData *plain = [NSData gtm_dataByRawDeflatingData:record
+                                      compressionLevel:9
+                                                 error:&error];
+    NSData *raw = [NSData gtm_dataByRawDeflatingData:record
+                                    compressionLevel:9
+                                          dictionary:dictionary
+                                               error:&error];
+    XCTAssertNotNil(raw, @"%@", error);
+    plainTotal += [plain length];
+    dictionaryTotal += [raw length];
+    XCTAssertEqualObjects([NSData gtm_dataByRawInflatingData:raw
+                                                  dictionary:dictionary
+                                                       error:&error],
+                          record);
+
+    NSData *zlib = [NSData gtm_dataByDeflatingData:record
+                                  compressionLevel:9
+                                        dictionary:dictionary
+                                             error:&error];
+    XCTAssertNotNil(zlib, @"%@", error);
+    XCTAssertEqualObjects([NSData gtm_dataByInflatingData:zlib
+                                               dictionary:dictionary
+                                                    error:&error],
+                          record);
+  }
+  // The records are mostly boilerplate, so the dictionary should pay off.
+  XCTAssertLessThan(dictionaryTotal * 2, plainTotal);
+
+  NSData *record = [records lastObject];
+  NSData *zlib = [NSData gtm_dataByDeflatingData:record
+                                compressionLevel:9
+                                      dictionary:dictionary
+                                           error:&error];
+  // Without the dictionary.
+  error = nil;
+  XCTAssertNil([NSData gtm_dataByInflatingData:zlib error:&error]);
+  GTMCheckZLibError(error, Z_NEED_DICT);
+  // With the wrong one.
+  NSData *other = [@"some other dictionary" dataUsingEncoding:NSUTF8StringEncoding];
+  XCTAssertNil([NSData gtm_dataByInflatingData:zlib dictionary:other error:&error]);
+  GTMCheckZLibError(error, Z_DATA_ERROR);
+  // A dictionary that isn't needed is ignored.
+  NSData *gzipped = [NSData gtm_dataByGzippingData:record error:&error];
+  XCTAssertEqualObjects([NSData gtm_dataByInflatingData:gzipped
+                                             dictionary:dictionary
+                                                  error:&error],
+                        record);
+}
+
+- (void)testFiles {
+  NSMutableData *input = [NSMutableData dataWithCapacity:128 * sizeof(randomDataLarge)];
+  for (int i = 0; i < 128; ++i) {
+    [input appendBytes:randomDataLarge length:sizeof(randomDataLarge)];
+    [input appendBytes:&i length:sizeof(i)];
+  }
+  NSString *base =
+      [NSTemporaryDirectory() stringByAppendingPathComponent:
+          [NSString stringWithFormat:@"GTMNSData_zlibTest-files-%d", getpid()]];
+  NSString *sourcePath = [base stringByAppendingString:@".in"];
+  NSString *gzipPath = [base stringByAppendingString:@".gz"];
+  NSString *outputPath = [base stringByAppendingString:@".out"];
+  NSError *error = nil;
+  XCTAssertTrue([input writeToFile:sourcePath options:0 error:&error]);
+
+  for (int parallel = 0; parallel < 2; ++parallel) {
+    XCTAssertTrue([NSData gtm_gzipFileAtPath:sourcePath
+                                      toPath:gzipPath
+                            compressionLevel:6
+                                    parallel:parallel
+                                       error:&error], @"%@", error);
+    NSData *gzipped = [NSData dataWithContentsOfFile:gzipPath];
+    XCTAssertTrue(HasGzipHeader(gzipped));
+    XCTAssertEqualObjects([NSData gtm_dataByInflatingData:gzipped error:&error], input);
+
+    XCTAssertTrue([NSData gtm_gunzipFileAtPath:gzipPath toPath:outputPath error:&error],
+                  @"%@", error);
+    XCTAssertEqualObjects([NSData dataWithContentsOfFile:outputPath], input);
+  }
+
+  // An empty file round trips too.
+  XCTAssertTrue([[NSData data] writeToFile:sourcePath options:0 error:&error]);
+  XCTAssertTrue([NSData gtm_gzipFileAtPath:sourcePath
+                                    toPath:gzipPath
+                          compressionLevel:1
+                                     error:&error]);
+  XCTAssertTrue([NSData gtm_gunzipFileAtPath:gzipPath toPath:outputPath error:&error]);
+  XCTAssertEqual([[NSData dataWithContentsOfFile:outputPath] length], (NSUInteger)0);
+
+  // Missing input.
+  error = nil;
+  XCTAssertFalse([NSData gtm_gunzipFileAtPath:[base stringByAppendingString:@".missing"]
+                                       toPath:outputPath
+                                        error:&error]);
+  XCTAssertEqualObjects([error domain], NSPOSIXErrorDomain);
+  XCTAssertEqual([error code], (NSInteger)ENOENT);
+
+  // A file can't be compressed onto itself.
+  error = nil;
+  XCTAssertFalse([NSData gtm_gzipFileAtPath:sourcePath
+                                     toPath:sourcePath
+                           compressionLevel:1
+                                      error:&error]);
+  XCTAssertEqual([error code], (NSInteger)EINVAL);
+  XCTAssertTrue([[NSFileManager defaultManager] fileExistsAtPath:sourcePath]);
+
+  // Bad input fails and leaves no output behind.
+  NSData *gzipped = [NSData gtm_dataByGzippingData:input error:&error];
+  NSMutableData *suffixed = [NSMutableData dataWithData:gzipped];
+  [suffixed appendBytes:randomDataSmall length:sizeof(randomDataSmall)];
+  XCTAssertTrue([suffixed writeToFile:gzipPath options:0 error:&error]);
+  error = nil;
+  XCTAssertFalse([NSData gtm_gunzipFileAtPath:gzipPath toPath:outputPath error:&error]);
+  GTMCheckRemainingError(error, (int)sizeof(randomDataSmall));
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:outputPath]);
+  XCTAssertTrue([[gzipped subdataWithRange:NSMakeRange(0, [gzipped length] / 2)]
+                    writeToFile:gzipPath options:0 error:&error]);
+  XCTAssertFalse([NSData gtm_gunzipFileAtPath:gzipPath toPath:outputPath error:&error]);
+  GTMCheckZLibError(error, Z_BUF_ERROR);
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:outputPath]);
+
+  [[NSFileManager defaultManager] removeItemAtPath:sourcePath error:NULL];
+  [[NSFileManager defaultManager] removeItemAtPath:gzipPath error:NULL];
+}
+
+- (void)testOutputLimits {
+  // 1MB of zeros deflates to about 1KB, over a 1000:1 ratio.
+  NSData *zeros = [NSMutableData dataWithLength:1024 * 1024];
+  NSError *error = nil;
+  NSData *gzipped = [NSData gtm_dataByGzippingData:zeros error:&error];
+  NSData *rawDeflated = [NSData gtm_dataByRawDeflatingData:zeros error:&error];
+  XCTAssertNotNil(gzipped);
+  XCTAssertNotNil(rawDeflated);
+
+  // No limits, or limits that fit exactly, decode everything.
+  XCTAssertEqualObjects([NSData gtm_dataByInflatingData:gzipped
+                                          maximumLength:0
+                                           maximumRatio:0
+                                                  error:&error], zeros);
+  XCTAssertEqualObjects([NSData gtm_dataByInflatingData:gzipped
+                                          maximumLength:[zeros length]
+                                           maximumRatio:0
+                                                  error:&error], zeros);
+  XCTAssertEqualObjects([NSData gtm_dataByRawInflatingData:rawDeflated
+                                             maximumLength:[zeros length]
+                                              maximumRatio:10000
+                                                     error:&error], zeros);
+
+  // One byte short stops with the partial length.
+  error = nil;
+  XCTAssertNil([NSData gtm_dataByInflatingData:gzipped
+                                 maximumLength:[zeros length] - 1
+                                  maximumRatio:0
+                                         error:&error]);
+  XCTAssertEqualObjects([error domain], GTMNSDataZlibErrorDomain);
+  XCTAssertEqual([error code], (NSInteger)GTMNSDataZlibErrorOutputLimitExceeded);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibPartialLengthKey],
+                        [NSNumber numberWithUnsignedInteger:[zeros length] - 1]);
+
+  // A small length limit stops long before the end of the input.
+  error = nil;
+  XCTAssertNil([NSData gtm_dataByRawInflatingData:rawDeflated
+                                    maximumLength:1000
+                                     maximumRatio:0
+                                            error:&error]);
+  XCTAssertEqual([error code], (NSInteger)GTMNSDataZlibErrorOutputLimitExceeded);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibPartialLengthKey],
+                        [NSNumber numberWithUnsignedInteger:1000]);
+  XCTAssertGreaterThan([[[error userInfo] objectForKey:GTMNSDataZlibRemainingBytesKey]
+                           unsignedIntegerValue], (NSUInteger)0);
+
+  // So does a ratio limit.
+  error = nil;
+  XCTAssertNil([NSData gtm_dataByInflatingBytes:[gzipped bytes]
+                                         length:[gzipped length]
+                                  maximumLength:0
+                                   maximumRatio:100
+                                          error:&error]);
+  XCTAssertEqual([error code], (NSInteger)GTMNSDataZlibErrorOutputLimitExceeded);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibPartialLengthKey],
+                        [NSNumber numberWithUnsignedInteger:[gzipped length] * 100]);
+
+  // Ordinary data is well inside a sensible ratio.
+  NSData *text = [NSData dataWithBytes:randomDataLarge length:sizeof(randomDataLarge)];
+  NSData *deflated = [NSData gtm_dataByDeflatingData:text error:&error];
+  XCTAssertEqualObjects([NSData gtm_dataByInflatingBytes:[deflated bytes]
+                                                  length:[deflated length]
+                                           maximumLength:0
+                                            maximumRatio:100
+                                                   error:&error], text);
+}
+
+
+- (void)testChecksums {
+  // A few MB so the parallel versions have several pieces to combine.
+  NSMutableData *input = [NSMutableData dataWithCapacity:8192 * sizeof(randomDataLarge)];
+  NSMutableData *scratch = [NSMutableData dataWithLength:sizeof(randomDataLarge)];
+  uint8_t *scratchBytes = [scratch mutableBytes];
+  for (NSUInteger i = 0; i < 8192; ++i) {
+    for (NSUInteger j = 0; j < sizeof(randomDataLarge); ++j) {
+      scratchBytes[j] = randomDataLarge[j] ^ (uint8_t)(i * 7 + (i >> 8));
+    }
+    [input appendData:scratch];
+  }
+  const Bytef *bytes = [input bytes];
+  uInt length = (uInt)[input length];
+  uint32_t crc = (uint32_t)crc32(0, bytes, length);
+  uint32_t adler = (uint32_t)adler32(1, bytes, length);
+
+  XCTAssertEqual([input gtm_crc32], crc);
+  XCTAssertEqual([input gtm_adler32], adler);
+  XCTAssertEqual([input gtm_parallelCrc32], crc);
+  XCTAssertEqual([input gtm_parallelAdler32], adler);
+  XCTAssertEqual([[NSData data] gtm_crc32], (uint32_t)0);
+  XCTAssertEqual([[NSData data] gtm_adler32], (uint32_t)1);
+
+  // Lengths around the accelerated paths' block sizes, at odd alignments.
+  NSUInteger lengths[] = { 0, 1, 15, 16, 63, 64, 65, 127, 1000, 4097 };
+  for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i) {
+    for (NSUInteger offset = 0; offset < 4; ++offset) {
+      XCTAssertEqual([NSData gtm_crc32OfBytes:bytes + offset length:lengths[i] crc:12345],
+                     (uint32_t)crc32(12345, bytes + offset, (uInt)lengths[i]),
+                     @"length %lu offset %lu", (unsigned long)lengths[i], (unsigned long)offset);
+      XCTAssertEqual([NSData gtm_adler32OfBytes:bytes + offset length:lengths[i] adler:1],
+                     (uint32_t)adler32(1, bytes + offset, (uInt)lengths[i]));
+    }
+  }
+  XCTAssertEqual([NSData gtm_crc32OfBytes:NULL length:10 crc:77], (uint32_t)77);
+
+  // Piece by piece, and combined from separate pieces.
+  NSUInteger split = [input length] / 3 + 5;
+  uint32_t firstCrc = [NSData gtm_crc32OfBytes:bytes length:split crc:0];
+  XCTAssertEqual([NSData gtm_crc32OfBytes:bytes + split length:length - split crc:firstCrc],
+                 crc);
+  uint32_t secondCrc = [NSData gtm_crc32OfBytes:bytes + split length:length - split crc:0];
+  XCTAssertEqual([NSData gtm_crc32ByCombiningCrc32:firstCrc
+                                         withCrc32:secondCrc
+                                            length:length - split],
+                 crc);
+  uint32_t firstAdler = [NSData gtm_adler32OfBytes:bytes length:split adler:1];
+  uint32_t secondAdler = [NSData gtm_adler32OfBytes:bytes + split length:length - split adler:1];
+  XCTAssertEqual([NSData gtm_adler32ByCombiningAdler32:firstAdler
+                                           withAdler32:secondAdler
+                                                length:length - split],
+                 adler);
+
+  // The gzip trailer agrees.
+  NSData *gzipped = [NSData gtm_dataByParallelGzippingData:input
+                                          compressionLevel:1
+                                                     error:NULL];
+  const uint8_t *trailer = (const uint8_t *)[gzipped bytes] + [gzipped length] - 8;
+  XCTAssertEqual(OSReadLittleInt32(trailer, 0), crc);
+}
+
+
+- (void)testInflateToSink {
+  // A few MB, so several sink buffers' worth, as two gzip members.
+  NSMutableData *input = [NSMutableData dataWithCapacity:4096 * sizeof(randomDataLarge)];
+  for (NSUInteger i = 0; i < 4096; ++i) {
+    [input appendBytes:randomDataLarge length:(i % 4) ? sizeof(randomDataLarge) / 2
+                                                      : sizeof(randomDataLarge)];
+  }
+  NSError *error = nil;
+  NSMutableData *gzipped = [NSMutableData dataWithData:[NSData gtm_dataByGzippingData:input
+                                                                                error:&error]];
+  [gzipped appendData:[NSData gtm_dataByGzippingData:input error:&error]];
+  NSMutableData *expected = [NSMutableData dataWithData:input];
+  [expected appendData:input];
+
+  // A file.
+  NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:
+                       [NSString stringWithFormat:@"GTMNSData_zlibTest-sink-%d", getpid()]];
+  int fd = open([path fileSystemRepresentation], O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  XCTAssertGreaterThanOrEqual(fd, 0);
+  XCTAssertTrue([NSData gtm_inflateData:gzipped toFileDescriptor:fd error:&error], @"%@", error);
+  close(fd);
+  XCTAssertEqualObjects([NSData dataWithContentsOfFile:path], expected);
+  unlink([path fileSystemRepresentation]);
+
+  // A non-blocking pipe, far smaller than the output, read on another thread.
+  int fds[2];
+  XCTAssertEqual(pipe(fds), 0);
+  fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+  NSMutableData *piped = [NSMutableData data];
+  XCTestExpectation *drained = [self expectationWithDescription:@"drained"];
+  dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+    char buffer[4096];
+    ssize_t count;
+    while ((count = read(fds[0], buffer, sizeof(buffer))) > 0) {
+      [piped appendBytes:buffer length:(NSUInteger)count];
+    }
+    [drained fulfill];
+  });
+  XCTAssertTrue([NSData gtm_inflateData:gzipped toFileDescriptor:fds[1] error:&error], @"%@", error);
+  close(fds[1]);
+  [self waitForExpectationsWithTimeout:60 handler:nil];
+  close(fds[0]);
+  XCTAssertEqualObjects(piped, expected);
+
+  // Streams.
+  NSOutputStream *stream = [NSOutputStream outputStreamToMemory];
+  [stream open];
+  XCTAssertTrue([NSData gtm_inflateData:gzipped toOutputStream:stream error:&error], @"%@", error);
+  XCTAssertEqualObjects([stream propertyForKey:NSStreamDataWrittenToMemoryStreamKey], expected);
+  [stream close];
+  uint8_t small[1000];
+  stream = [NSOutputStream outputStreamToBuffer:small capacity:sizeof(small)];
+  [stream open];
+  XCTAssertFalse([NSData gtm_inflateData:gzipped toOutputStream:stream error:&error]);
+  XCTAssertNotNil(error);
+  XCTAssertEqual(memcmp(small, [expected bytes], sizeof(small)), 0);
+  [stream close];
+  error = nil;
+  stream = [NSOutputStream outputStreamToMemory];  // Never opened.
+  XCTAssertFalse([NSData gtm_inflateData:gzipped toOutputStream:stream error:&error]);
+  XCTAssertNotNil(error);
+
+  // A sink that takes a little at a time and keeps saying it would block.
+  NSMutableData *sunk = [NSMutableData data];
+  __block NSUInteger calls = 0;
+  XCTAssertTrue([NSData gtm_inflateData:gzipped
+                                 toSink:^NSInteger(const void *bytes, NSUInteger length,
+                                                   NSError **sinkError) {
+                                   if (++calls % 3 == 0) {
+                                     return 0;
+                                   }
+                                   NSUInteger taken = MIN(length, (NSUInteger)100000);
+                                   [sunk appendBytes:bytes length:taken];
+                                   return (NSInteger)taken;
+                                 }
+                                  error:&error], @"%@", error);
+  XCTAssertEqualObjects(sunk, expected);
+
+  // A sink's failure comes back.
+  NSError *sinkFailure = [NSError errorWithDomain:@"GTMNSData+zlibTest" code:7 userInfo:nil];
+  error = nil;
+  XCTAssertFalse([NSData gtm_inflateData:gzipped
+                                  toSink:^NSInteger(const void *bytes, NSUInteger length,
+                                                    NSError **sinkError) {
+                                    *sinkError = sinkFailure;
+                                    return -1;
+                                  }
+                                   error:&error]);
+  XCTAssertEqualObjects(error, sinkFailure);
+
+  // A sink that never takes anything times out rather than hanging.
+  error = nil;
+  XCTAssertFalse([NSData gtm_inflateData:gzipped
+                                  toSink:^NSInteger(const void *bytes, NSUInteger length,
+                                                    NSError **sinkError) {
+                                    return 0;
+                                  }
+                                 timeout:0.2
+                                   error:&error]);
+  XCTAssertEqualObjects([error domain], NSPOSIXErrorDomain);
+  XCTAssertEqual([error code], (NSInteger)ETIMEDOUT);
+
+  // In the background, with the completion on the main queue.
+  stream = [NSOutputStream outputStreamToMemory];
+  [stream open];
+  XCTestExpectation *inflated = [self expectationWithDescription:@"inflated"];
+  [NSData gtm_inflateData:gzipped
+           toOutputStream:stream
+          completionQueue:dispatch_get_main_queue()
+               completion:^(BOOL succeeded, NSError *completionError) {
+                 XCTAssertTrue([NSThread isMainThread]);
+                 XCTAssertTrue(succeeded, @"%@", completionError);
+                 [inflated fulfill];
+               }];
+  [self waitForExpectationsWithTimeout:60 handler:nil];
+  XCTAssertEqualObjects([stream propertyForKey:NSStreamDataWrittenToMemoryStreamKey], expected);
+  [stream close];
+
+  // Bad input.
+  GTMZlibOutputSink ignore = ^NSInteger(const void *bytes, NSUInteger length,
+                                        NSError **sinkError) {
+    return (NSInteger)length;
+  };
+  error = nil;
+  XCTAssertFalse([NSData gtm_inflateBytes:[gzipped bytes]
+                                   length:[gzipped length] - 10
+                                   toSink:ignore
+                                    error:&error]);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibErrorKey],
+                        [NSNumber numberWithInt:Z_BUF_ERROR]);
+  error = nil;
+  XCTAssertFalse([NSData gtm_inflateData:[NSData data] toSink:ignore error:&error]);
+  XCTAssertEqualObjects([error domain], GTMNSDataZlibErrorDomain);
+  NSMutableData *suffixed = [NSMutableData dataWithData:gzipped];
+  [suffixed appendBytes:"junk" length:4];
+  error = nil;
+  XCTAssertFalse([NSData gtm_inflateData:suffixed toSink:ignore error:&error]);
+  XCTAssertEqual([error code], (NSInteger)GTMNSDataZlibErrorDataRemaining);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibRemainingBytesKey],
+                        [NSNumber numberWithUnsignedInteger:4]);
+}
+
 @end
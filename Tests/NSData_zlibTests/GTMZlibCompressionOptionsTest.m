@@ -0,0 +1,186 @@
+//
+//  GTMZlibCompressionOptionsTest.m
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#if !__has_feature(objc_arc)
+#error "This file needs to be compiled with ARC enabled."
+#endif
+
+#import "GTMSenTestCase.h"
+#import "GTMZlibCompressionOptions.h"
+#import "GTMZlibCompressor.h"
+#import "GTMNSData+zlib.h"
+#import <zlib.h>
+
+@interface GTMZlibCompressionOptionsTest : GTMTestCase
+@end
+
+// JSON like text.
+static NSData *TextData(NSUInteger length) {
+  NSMutableData *data = [NSMutableData dataWithCapacity:length + 100];
+  for (NSUInteger i = 0; [data length] < length; ++i) {
+    NSString *line = [NSString stringWithFormat:@"{\"seq\":%lu,\"user\":\"u%lu\"}\n",
+                                                (unsigned long)i, (unsigned long)(i * 7 % 1000)];
+    [data appendData:[line dataUsingEncoding:NSUTF8StringEncoding]];
+  }
+  [data setLength:length];
+  return data;
+}
+
+// Long runs of a few byte values, like a simple bitmap.
+static NSData *RunData(NSUInteger length) {
+  NSMutableData *data = [NSMutableData dataWithLength:length];
+  unsigned char *bytes = [data mutableBytes];
+  uint32_t seed = 3;
+  for (NSUInteger i = 0; i < length;) {
+    seed = seed * 1103515245 + 12345;
+    unsigned char value = (unsigned char)((seed >> 16) % 4 ? 0 : seed >> 24);
+    NSUInteger run = 1 + (seed >> 8) % 40;
+    for (; run && i < length; --run) {
+      bytes[i++] = value;
+    }
+  }
+  return data;
+}
+
+// Pseudo random bytes.
+static NSData *NoiseData(NSUInteger length) {
+  NSMutableData *data = [NSMutableData dataWithLength:length];
+  unsigned char *bytes = [data mutableBytes];
+  uint32_t seed = 11;
+  for (NSUInteger i = 0; i < length; ++i) {
+    seed = seed * 1103515245 + 12345;
+    bytes[i] = (unsigned char)(seed >> 16);
+  }
+  return data;
+}
+
+@implementation GTMZlibCompressionOptionsTest
+
+- (void)testDefaultsAndClipping {
+  GTMZlibCompressionOptions *options = [GTMZlibCompressionOptions defaultOptions];
+  XCTAssertEqual([options compressionLevel], Z_DEFAULT_COMPRESSION);
+  XCTAssertEqual([options strategy], GTMZlibCompressionStrategyDefault);
+  XCTAssertEqual([options memoryLevel], 8);
+  XCTAssertEqual([options windowBits], 15);
+  XCTAssertFalse([options isAutomatic]);
+
+  [options setCompressionLevel:42];
+  XCTAssertEqual([options compressionLevel], 9);
+  [options setCompressionLevel:0];
+  XCTAssertEqual([options compressionLevel], 1);
+  [options setMemoryLevel:0];
+  XCTAssertEqual([options memoryLevel], 1);
+  [options setWindowBits:8];
+  XCTAssertEqual([options windowBits], 9);
+  [options setWindowBits:16];
+  XCTAssertEqual([options windowBits], 15);
+
+  GTMZlibCompressionOptions *copy = [options copy];
+  XCTAssertEqualObjects(copy, options);
+  [copy setStrategy:GTMZlibCompressionStrategyFiltered];
+  XCTAssertNotEqualObjects(copy, options);
+}
+
+- (void)testPresets {
+  NSString *presets[] = {
+    GTMZlibCompressionPresetFastText,
+    GTMZlibCompressionPresetSmallMemory,
+    GTMZlibCompressionPresetBinaryRLE,
+    GTMZlibCompressionPresetHuffmanOnly,
+    GTMZlibCompressionPresetAutomatic,
+  };
+  NSData *inputs[] = { TextData(300 * 1024), RunData(300 * 1024), NoiseData(100 * 1024) };
+  for (size_t i = 0; i < sizeof(presets) / sizeof(presets[0]); ++i) {
+    GTMZlibCompressionOptions *options = [GTMZlibCompressionOptions optionsWithPreset:presets[i]];
+    XCTAssertNotNil(options, @"%@", presets[i]);
+    for (size_t j = 0; j < sizeof(inputs) / sizeof(inputs[0]); ++j) {
+      NSError *error = nil;
+      NSData *gzipped = [NSData gtm_dataByGzippingData:inputs[j] options:options error:&error];
+      XCTAssertNotNil(gzipped, @"%@: %@", presets[i], error);
+      XCTAssertEqualObjects([NSData gtm_dataByInflatingData:gzipped error:&error], inputs[j]);
+      NSData *deflated = [NSData gtm_dataByDeflatingData:inputs[j] options:options error:&error];
+      XCTAssertEqualObjects([NSData gtm_dataByInflatingData:deflated error:&error], inputs[j]);
+      NSData *rawDeflated = [NSData gtm_dataByRawDeflatingData:inputs[j]
+                                                       options:options
+                                                         error:&error];
+      XCTAssertEqualObjects([NSData gtm_dataByRawInflatingData:rawDeflated error:&error],
+                            inputs[j]);
+    }
+  }
+  XCTAssertEqual([[GTMZlibCompressionOptions optionsWithPreset:GTMZlibCompressionPresetBinaryRLE]
+                     strategy],
+                 GTMZlibCompressionStrategyRLE);
+  XCTAssertTrue([[GTMZlibCompressionOptions optionsWithPreset:@"auto"] isAutomatic]);
+  XCTAssertNil([GTMZlibCompressionOptions optionsWithPreset:@"no-such-preset"]);
+
+  // nil options are the defaults.
+  NSData *text = TextData(10000);
+  XCTAssertEqualObjects([NSData gtm_dataByDeflatingData:text options:nil error:NULL],
+                        [NSData gtm_dataByDeflatingData:text error:NULL]);
+}
+
+- (void)testAutomaticSelection {
+  GTMZlibCompressionOptions *text =
+      [GTMZlibCompressionOptions optionsForBytes:[TextData(1024 * 1024) bytes]
+                                          length:1024 * 1024];
+  XCTAssertEqualObjects(text,
+                        [GTMZlibCompressionOptions optionsWithPreset:GTMZlibCompressionPresetFastText]);
+  NSData *runs = RunData(200 * 1024);
+  XCTAssertEqual([[GTMZlibCompressionOptions optionsForBytes:[runs bytes]
+                                                      length:[runs length]] strategy],
+                 GTMZlibCompressionStrategyRLE);
+  NSData *noise = NoiseData(10000);
+  XCTAssertEqual([[GTMZlibCompressionOptions optionsForBytes:[noise bytes]
+                                                      length:[noise length]] strategy],
+                 GTMZlibCompressionStrategyHuffmanOnly);
+  XCTAssertEqualObjects([GTMZlibCompressionOptions optionsForBytes:NULL length:0],
+                        [GTMZlibCompressionOptions defaultOptions]);
+
+  // A compressor with automatic options follows its input.
+  NSError *error = nil;
+  GTMZlibCompressor *compressor =
+      [GTMZlibCompressor compressorWithFormat:GTMZlibStreamFormatZlib
+                                      options:[GTMZlibCompressionOptions
+                                                  optionsWithPreset:GTMZlibCompressionPresetAutomatic]
+                                        error:&error];
+  XCTAssertNotNil(compressor, @"%@", error);
+  XCTAssertTrue([[compressor options] isAutomatic]);
+  NSData *inputs[] = { runs, noise, TextData(5000), runs };
+  for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+    NSData *compressed = [compressor compressData:inputs[i] error:&error];
+    XCTAssertEqualObjects([NSData gtm_dataByInflatingData:compressed error:&error], inputs[i]);
+  }
+}
+
+- (void)testSmallMemory {
+  // A 1KB window still decodes with the normal apis, and the options are kept
+  // apart from the defaults in the compressor pool.
+  GTMZlibCompressionOptions *small =
+      [GTMZlibCompressionOptions optionsWithPreset:GTMZlibCompressionPresetSmallMemory];
+  NSData *text = TextData(100 * 1024);
+  NSError *error = nil;
+  NSData *smallDeflated = [NSData gtm_dataByDeflatingData:text options:small error:&error];
+  NSData *deflated = [NSData gtm_dataByDeflatingData:text error:&error];
+  XCTAssertNotEqualObjects(smallDeflated, deflated);
+  XCTAssertEqualObjects([NSData gtm_dataByInflatingData:smallDeflated error:&error], text);
+  XCTAssertEqualObjects([NSData gtm_dataByDeflatingData:text error:&error], deflated);
+  XCTAssertEqualObjects([NSData gtm_dataByDeflatingData:text options:small error:&error],
+                        smallDeflated);
+}
+
+@end
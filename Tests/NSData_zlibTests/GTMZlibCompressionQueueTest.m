@@ -0,0 +1,191 @@
+//
+//  GTMZlibCompressionQueueTest.m
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#if !__has_feature(objc_arc)
+#error "This file needs to be compiled with ARC enabled."
+#endif
+
+#import "GTMSenTestCase.h"
+#import "GTMZlibCompressionQueue.h"
+#import "GTMNSData+zlib.h"
+#import "GTMZlibTestData.h"
+
+@interface GTMZlibCompressionQueueTest : GTMTestCase
+@end
+
+@implementation GTMZlibCompressionQueueTest
+
+- (void)testRoundTrip {
+  GTMZlibCompressionQueue *queue = [[GTMZlibCompressionQueue alloc] initWithMaximumConcurrentWorkers:2];
+  XCTAssertEqual([queue maximumConcurrentWorkers], (NSUInteger)2);
+  NSData *input = GTMZlibTestData(200 * 1024, GTMZlibTestDataLetters, 1);
+  dispatch_queue_t callbackQueue =
+      dispatch_queue_create("GTMZlibCompressionQueueTest", DISPATCH_QUEUE_SERIAL);
+  XCTestExpectation *done = [self expectationWithDescription:@"round trip"];
+  [queue compressData:input
+                format:GTMZlibStreamFormatGzip
+      compressionLevel:6
+         callbackQueue:callbackQueue
+            completion:^(NSData *compressed, NSError *error) {
+              XCTAssertNotNil(compressed, @"%@", error);
+              XCTAssertLessThan([compressed length], [input length]);
+              XCTAssertEqualObjects([NSData gtm_dataByInflatingData:compressed error:NULL], input);
+              [queue decompressData:compressed
+                             format:GTMZlibStreamFormatAutoDetect
+                      callbackQueue:callbackQueue
+                         completion:^(NSData *decompressed, NSError *error2) {
+                           XCTAssertEqualObjects(decompressed, input, @"%@", error2);
+                           [done fulfill];
+                         }];
+            }];
+  [self waitForExpectationsWithTimeout:30 handler:nil];
+
+  // Bad input fails with the usual error.
+  XCTestExpectation *failed = [self expectationWithDescription:@"bad input"];
+  [queue decompressData:GTMZlibTestData(100, GTMZlibTestDataLetters, 2)
+                 format:GTMZlibStreamFormatZlib
+          callbackQueue:nil
+             completion:^(NSData *result, NSError *error) {
+               XCTAssertTrue([NSThread isMainThread]);
+               XCTAssertNil(result);
+               XCTAssertEqualObjects([error domain], GTMNSDataZlibErrorDomain);
+               [failed fulfill];
+             }];
+  [self waitForExpectationsWithTimeout:30 handler:nil];
+
+  XCTestExpectation *shared = [self expectationWithDescription:@"shared queue"];
+  [NSData gtm_deflateData:input
+         compressionLevel:1
+            callbackQueue:callbackQueue
+               completion:^(NSData *compressed, NSError *error) {
+                 [NSData gtm_inflateData:compressed
+                           callbackQueue:callbackQueue
+                              completion:^(NSData *decompressed, NSError *error2) {
+                                XCTAssertEqualObjects(decompressed, input, @"%@", error2);
+                                [shared fulfill];
+                              }];
+               }];
+  [self waitForExpectationsWithTimeout:30 handler:nil];
+}
+
+- (void)testCancel {
+  // One worker, kept busy so the rest stay queued.
+  GTMZlibCompressionQueue *queue = [[GTMZlibCompressionQueue alloc] initWithMaximumConcurrentWorkers:1];
+  dispatch_queue_t callbackQueue =
+      dispatch_queue_create("GTMZlibCompressionQueueTest", DISPATCH_QUEUE_SERIAL);
+  XCTestExpectation *busy = [self expectationWithDescription:@"busy"];
+  NSData *busyInput = GTMZlibTestData(8 * 1024 * 1024, GTMZlibTestDataLetters, 3);
+  GTMZlibCompressionTask *busyTask = [queue compressData:busyInput
+                                                  format:GTMZlibStreamFormatZlib
+                                        compressionLevel:9
+                                           callbackQueue:callbackQueue
+                                              completion:^(NSData *result, NSError *error) {
+                                                [busy fulfill];
+                                              }];
+  const int kTaskCount = 20;
+  NSMutableArray *tasks = [NSMutableArray array];
+  __block int calls = 0;
+  __block int cancels = 0;
+  XCTestExpectation *all = [self expectationWithDescription:@"all"];
+  for (int i = 0; i < kTaskCount; ++i) {
+    [tasks addObject:[queue compressData:GTMZlibTestData(1000, GTMZlibTestDataLetters, i)
+                                  format:GTMZlibStreamFormatZlib
+                        compressionLevel:6
+                           callbackQueue:callbackQueue
+                              completion:^(NSData *result, NSError *error) {
+                                if (error) {
+                                  XCTAssertNil(result);
+                                  XCTAssertEqualObjects([error domain], NSCocoaErrorDomain);
+                                  XCTAssertEqual([error code], NSUserCancelledError);
+                                  ++cancels;
+                                } else {
+                                  XCTAssertNotNil(result);
+                                }
+                                if (++calls == kTaskCount) {
+                                  [all fulfill];
+                                }
+                              }]];
+  }
+  for (int i = 0; i < kTaskCount; i += 2) {
+    [tasks[i] cancel];
+    XCTAssertTrue([tasks[i] isCancelled]);
+    // Again does nothing.
+    [tasks[i] cancel];
+  }
+  [self waitForExpectationsWithTimeout:60 handler:nil];
+  XCTAssertEqual(calls, kTaskCount);
+  XCTAssertEqual(cancels, kTaskCount / 2);
+  XCTAssertFalse([busyTask isCancelled]);
+
+  // Finished tasks can't be cancelled.
+  [tasks[1] cancel];
+  XCTAssertFalse([tasks[1] isCancelled]);
+  GTMZlibCompressionQueueStatistics statistics = [queue statistics];
+  XCTAssertEqual(statistics.cancelledTasks, (uint64_t)kTaskCount / 2);
+  XCTAssertEqual(statistics.completedTasks, (uint64_t)kTaskCount / 2 + 1);
+}
+
+- (void)testBatching {
+  GTMZlibCompressionQueue *queue = [[GTMZlibCompressionQueue alloc] initWithMaximumConcurrentWorkers:4];
+  dispatch_queue_t callbackQueues[] = {
+    dispatch_queue_create("GTMZlibCompressionQueueTest.1", DISPATCH_QUEUE_SERIAL),
+    dispatch_queue_create("GTMZlibCompressionQueueTest.2", DISPATCH_QUEUE_SERIAL),
+  };
+  const int kTaskCount = 500;
+  __block int calls = 0;
+  XCTestExpectation *all = [self expectationWithDescription:@"all"];
+  NSMutableArray *orders[] = { [NSMutableArray array], [NSMutableArray array] };
+  for (int i = 0; i < kTaskCount; ++i) {
+    NSData *input = GTMZlibTestData(100 + i, GTMZlibTestDataLetters, i);
+    NSMutableArray *order = orders[i % 2];
+    [queue compressData:input
+                  format:GTMZlibStreamFormatRaw
+        compressionLevel:6
+           callbackQueue:callbackQueues[i % 2]
+              completion:^(NSData *result, NSError *error) {
+                XCTAssertEqualObjects([NSData gtm_dataByRawInflatingData:result error:NULL],
+                                      input, @"%@", error);
+                [order addObject:@(i)];
+                @synchronized(all) {
+                  if (++calls == kTaskCount) {
+                    [all fulfill];
+                  }
+                }
+              }];
+  }
+  [self waitForExpectationsWithTimeout:60 handler:nil];
+
+  GTMZlibCompressionQueueStatistics statistics = [queue statistics];
+  XCTAssertEqual(statistics.completedTasks, (uint64_t)kTaskCount);
+  XCTAssertEqual(statistics.cancelledTasks, (uint64_t)0);
+  // Small tasks get picked up several at a time.
+  XCTAssertLessThan(statistics.batches, statistics.completedTasks);
+  XCTAssertGreaterThanOrEqual(statistics.maximumWaitTime, statistics.averageWaitTime);
+  XCTAssertLessThanOrEqual(statistics.activeWorkers, (NSUInteger)4);
+  // With more than one worker, ordering is only kept within a batch, but
+  // each task is delivered once.
+  XCTAssertEqual([orders[0] count] + [orders[1] count], (NSUInteger)kTaskCount);
+
+  [queue resetStatistics];
+  statistics = [queue statistics];
+  XCTAssertEqual(statistics.completedTasks, (uint64_t)0);
+  XCTAssertEqual(statistics.batches, (uint64_t)0);
+  XCTAssertEqual(statistics.averageWaitTime, 0.0);
+}
+
+@end
@@ -0,0 +1,332 @@
+//
+//  GTMZlibCompressorTest.m
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#if !__has_feature(objc_arc)
+#error "This file needs to be compiled with ARC enabled."
+#endif
+
+#import "GTMSenTestCase.h"
+#import "GTMZlibCompressor.h"
+#import "GTMNSData+zlib.h"
+#import <zlib.h>
+
+@interface GTMZlibCompressorTest : GTMTestCase
+@end
+
+// A small message that varies with |seed|.
+static NSData *Message(NSUInteger seed) {
+  NSString *message =
+      [NSString stringWithFormat:@"{\"seq\":%lu,\"kind\":\"event\",\"payload\":\"%@\"}",
+                                 (unsigned long)seed,
+                                 [@"" stringByPaddingToLength:(seed % 200)
+                                                   withString:@"abc"
+                                              startingAtIndex:0]];
+  return [message dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+@implementation GTMZlibCompressorTest
+
+- (void)testReuse {
+  GTMZlibStreamFormat formats[] = {
+    GTMZlibStreamFormatZlib,
+    GTMZlibStreamFormatGzip,
+    GTMZlibStreamFormatRaw,
+  };
+  for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i) {
+    NSError *error = nil;
+    GTMZlibCompressor *compressor = [GTMZlibCompressor compressorWithFormat:formats[i]
+                                                           compressionLevel:6
+                                                                      error:&error];
+    GTMZlibDecompressor *decompressor =
+        [GTMZlibDecompressor decompressorWithFormat:formats[i] error:&error];
+    XCTAssertNotNil(compressor);
+    XCTAssertNotNil(decompressor);
+    XCTAssertEqual([compressor format], formats[i]);
+    XCTAssertEqual([compressor compressionLevel], 6);
+
+    for (NSUInteger seed = 0; seed < 50; ++seed) {
+      NSData *message = Message(seed);
+      NSData *compressed = [compressor compressData:message error:&error];
+      XCTAssertNotNil(compressed, @"%@", error);
+      // Each result stands alone, the same as the one shot apis make.
+      NSData *expected = nil;
+      switch (formats[i]) {
+        case GTMZlibStreamFormatZlib:
+          expected = [NSData gtm_dataByDeflatingData:message compressionLevel:6 error:&error];
+          break;
+        case GTMZlibStreamFormatGzip:
+          expected = [NSData gtm_dataByGzippingData:message compressionLevel:6 error:&error];
+          break;
+        default:
+          expected = [NSData gtm_dataByRawDeflatingData:message compressionLevel:6 error:&error];
+          break;
+      }
+      XCTAssertEqualObjects(compressed, expected);
+      XCTAssertEqualObjects([decompressor decompressData:compressed error:&error], message);
+    }
+  }
+}
+
+- (void)testErrorsDontStick {
+  NSError *error = nil;
+  GTMZlibDecompressor *decompressor =
+      [GTMZlibDecompressor decompressorWithFormat:GTMZlibStreamFormatAutoDetect error:&error];
+  NSData *message = Message(120);
+  NSData *compressed = [NSData gtm_dataByGzippingData:message error:&error];
+
+  // Truncated, then trailing junk, then garbage...
+  XCTAssertNil([decompressor decompressData:[compressed subdataWithRange:NSMakeRange(0, 20)]
+                                      error:&error]);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibErrorKey],
+                        [NSNumber numberWithInt:Z_BUF_ERROR]);
+  NSMutableData *suffixed = [NSMutableData dataWithData:compressed];
+  [suffixed appendBytes:"xyz" length:3];
+  error = nil;
+  XCTAssertNil([decompressor decompressData:suffixed error:&error]);
+  XCTAssertEqual([error code], (NSInteger)GTMNSDataZlibErrorDataRemaining);
+  error = nil;
+  XCTAssertNil([decompressor decompressData:message error:&error]);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibErrorKey],
+                        [NSNumber numberWithInt:Z_DATA_ERROR]);
+
+  // ...and it still works afterwards.
+  XCTAssertEqualObjects([decompressor decompressData:compressed error:&error], message);
+
+  // Gzip can't use a dictionary, which doesn't break the compressor either.
+  GTMZlibCompressor *compressor = [GTMZlibCompressor compressorWithFormat:GTMZlibStreamFormatGzip
+                                                         compressionLevel:1
+                                                                    error:&error];
+  error = nil;
+  XCTAssertNil([compressor compressBytes:[message bytes]
+                                  length:[message length]
+                              dictionary:message
+                                   error:&error]);
+  XCTAssertEqual([error code], (NSInteger)GTMNSDataZlibErrorInternal);
+  XCTAssertEqualObjects([decompressor decompressData:[compressor compressData:message error:&error]
+                                               error:&error],
+                        message);
+}
+
+- (void)testDictionaries {
+  NSError *error = nil;
+  NSData *dictionary = Message(199);
+  GTMZlibCompressor *compressor = [GTMZlibCompressor compressorWithFormat:GTMZlibStreamFormatZlib
+                                                         compressionLevel:9
+                                                                    error:&error];
+  GTMZlibDecompressor *decompressor =
+      [GTMZlibDecompressor decompressorWithFormat:GTMZlibStreamFormatZlib error:&error];
+  for (NSUInteger seed = 150; seed < 160; ++seed) {
+    NSData *message = Message(seed);
+    // Alternating with and without a dictionary on the same contexts.
+    NSData *withDictionary = [compressor compressBytes:[message bytes]
+                                                length:[message length]
+                                            dictionary:dictionary
+                                                 error:&error];
+    NSData *without = [compressor compressData:message error:&error];
+    XCTAssertLessThan([withDictionary length], [without length]);
+    XCTAssertEqualObjects([decompressor decompressBytes:[withDictionary bytes]
+                                                 length:[withDictionary length]
+                                         expectedLength:0
+                                             dictionary:dictionary
+                                                  error:&error],
+                          message);
+    XCTAssertEqualObjects([decompressor decompressData:without error:&error], message);
+  }
+}
+
+- (void)testPoolFromManyThreads {
+  const size_t kCount = 2000;
+  __block NSUInteger failures = 0;
+  dispatch_apply(kCount, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t i) {
+    NSData *message = Message(i);
+    int level = (int)(i % 9) + 1;
+    NSData *compressed = [NSData gtm_dataByDeflatingData:message
+                                        compressionLevel:level
+                                                   error:NULL];
+    NSData *inflated = [NSData gtm_dataByInflatingData:compressed error:NULL];
+    NSData *direct = [GTMZlibCompressor compressBytes:[message bytes]
+                                               length:[message length]
+                                               format:GTMZlibStreamFormatRaw
+                                     compressionLevel:level
+                                           dictionary:nil
+                                                error:NULL];
+    NSData *directInflated = [GTMZlibDecompressor decompressBytes:[direct bytes]
+                                                           length:[direct length]
+                                                           format:GTMZlibStreamFormatRaw
+                                                   expectedLength:[message length]
+                                                       dictionary:nil
+                                                            error:NULL];
+    if (![inflated isEqual:message] || ![directInflated isEqual:message]) {
+      @synchronized(self) {
+        ++failures;
+      }
+    }
+  });
+  XCTAssertEqual(failures, (NSUInteger)0);
+}
+
+- (void)testMessages {
+  NSError *error = nil;
+  GTMZlibMessageCompressor *takeover =
+      [GTMZlibMessageCompressor compressorWithCompressionLevel:6 error:&error];
+  GTMZlibMessageCompressor *independent =
+      [[GTMZlibMessageCompressor alloc] initWithCompressionLevel:6
+                                                 contextTakeover:NO
+                                                           error:&error];
+  GTMZlibMessageDecompressor *takeoverDecompressor =
+      [GTMZlibMessageDecompressor decompressorWithError:&error];
+  GTMZlibMessageDecompressor *independentDecompressor =
+      [[GTMZlibMessageDecompressor alloc] initWithContextTakeover:NO error:&error];
+  XCTAssertNotNil(takeover);
+  XCTAssertNotNil(independent);
+  XCTAssertTrue([takeover contextTakeover]);
+  XCTAssertFalse([independentDecompressor contextTakeover]);
+
+  NSUInteger takeoverLength = 0;
+  NSUInteger independentLength = 0;
+  for (NSUInteger seed = 0; seed < 200; ++seed) {
+    // Every so often an empty message.
+    NSData *message = (seed % 50 == 0) ? [NSData data] : Message(seed);
+    NSData *compressed = [takeover compressMessage:message error:&error];
+    XCTAssertNotNil(compressed, @"%@", error);
+    NSData *alone = [independent compressMessage:message error:&error];
+    XCTAssertNotNil(alone, @"%@", error);
+    takeoverLength += [compressed length];
+    independentLength += [alone length];
+
+    // No sync flush marker on the wire.
+    XCTAssertFalse([compressed length] >= 4 &&
+                   memcmp((const char *)[compressed bytes] + [compressed length] - 4,
+                          "\x00\x00\xff\xff", 4) == 0);
+    XCTAssertEqualObjects([takeoverDecompressor decompressMessage:compressed error:&error],
+                          message, @"%@", error);
+    XCTAssertEqualObjects([independentDecompressor decompressMessage:alone error:&error],
+                          message, @"%@", error);
+    // Without takeover each message is a complete raw stream on its own.
+    if ([message length]) {
+      NSMutableData *finished = [NSMutableData dataWithData:alone];
+      [finished appendBytes:"\x00\x00\xff\xff\x03\x00" length:6];
+      XCTAssertEqualObjects([NSData gtm_dataByRawInflatingData:finished error:&error], message);
+    }
+  }
+  // Earlier messages make the later ones far cheaper.
+  XCTAssertLessThan(takeoverLength * 2, independentLength);
+}
+
+- (void)testMessageErrors {
+  NSError *error = nil;
+  GTMZlibMessageDecompressor *decompressor =
+      [GTMZlibMessageDecompressor decompressorWithError:&error];
+
+  // A peer may end the stream with a final block; the next message starts a
+  // new one.
+  NSData *message = Message(42);
+  NSData *finished = [NSData gtm_dataByRawDeflatingData:message error:&error];
+  XCTAssertEqualObjects([decompressor decompressMessage:finished error:&error], message);
+  XCTAssertEqualObjects([decompressor decompressMessage:finished error:&error], message);
+  NSMutableData *suffixed = [NSMutableData dataWithData:finished];
+  [suffixed appendBytes:"xyz" length:3];
+  error = nil;
+  XCTAssertNil([decompressor decompressMessage:suffixed error:&error]);
+  XCTAssertEqual([error code], (NSInteger)GTMNSDataZlibErrorDataRemaining);
+
+  // Garbage fails, and the decompressor starts over afterwards.
+  error = nil;
+  XCTAssertNil([decompressor decompressMessage:[NSData dataWithBytes:"\xff\xff\xff" length:3]
+                                         error:&error]);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibErrorKey],
+                        [NSNumber numberWithInt:Z_DATA_ERROR]);
+  GTMZlibMessageCompressor *compressor =
+      [GTMZlibMessageCompressor compressorWithCompressionLevel:1 error:&error];
+  XCTAssertEqualObjects([decompressor decompressMessage:[compressor compressMessage:message
+                                                                              error:&error]
+                                                  error:&error],
+                        message);
+
+  // Messages can be capped.
+  [decompressor setMaximumMessageLength:10];
+  error = nil;
+  XCTAssertNil([decompressor decompressMessage:[compressor compressMessage:message error:&error]
+                                         error:&error]);
+  XCTAssertEqual([error code], (NSInteger)GTMNSDataZlibErrorOutputLimitExceeded);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibPartialLengthKey],
+                        [NSNumber numberWithUnsignedInteger:10]);
+}
+
+- (void)testScatteredInput {
+  NSMutableData *whole = [NSMutableData data];
+  NSMutableArray *pieces = [NSMutableArray array];
+  dispatch_data_t dispatchData = dispatch_data_empty;
+  for (NSUInteger seed = 0; seed < 300; ++seed) {
+    // Some empty pieces mixed in.
+    NSData *piece = (seed % 17 == 0) ? [NSData data] : Message(seed);
+    [whole appendData:piece];
+    [pieces addObject:piece];
+    dispatch_data_t region = dispatch_data_create([piece bytes], [piece length], NULL,
+                                                  DISPATCH_DATA_DESTRUCTOR_DEFAULT);
+    dispatchData = dispatch_data_create_concat(dispatchData, region);
+  }
+  XCTAssertGreaterThan(dispatch_data_get_size(dispatchData), (size_t)0);
+
+  // The same stream as compressing the pieces as one buffer.
+  NSError *error = nil;
+  XCTAssertEqualObjects([NSData gtm_dataByGzippingDataArray:pieces
+                                           compressionLevel:6
+                                                      error:&error],
+                        [NSData gtm_dataByGzippingData:whole compressionLevel:6 error:&error]);
+  XCTAssertEqualObjects([NSData gtm_dataByDeflatingDataArray:pieces
+                                            compressionLevel:2
+                                                       error:&error],
+                        [NSData gtm_dataByDeflatingData:whole compressionLevel:2 error:&error]);
+  XCTAssertEqualObjects([NSData gtm_dataByRawDeflatingDataArray:pieces
+                                               compressionLevel:9
+                                                          error:&error],
+                        [NSData gtm_dataByRawDeflatingData:whole compressionLevel:9 error:&error]);
+  XCTAssertEqualObjects([NSData gtm_dataByGzippingDispatchData:dispatchData
+                                              compressionLevel:6
+                                                         error:&error],
+                        [NSData gtm_dataByGzippingData:whole compressionLevel:6 error:&error]);
+  XCTAssertEqualObjects([NSData gtm_dataByDeflatingDispatchData:dispatchData
+                                               compressionLevel:6
+                                                          error:&error],
+                        [NSData gtm_dataByDeflatingData:whole compressionLevel:6 error:&error]);
+  XCTAssertEqualObjects(
+      [NSData gtm_dataByRawInflatingData:[NSData gtm_dataByRawDeflatingDispatchData:dispatchData
+                                                                   compressionLevel:1
+                                                                              error:&error]
+                                   error:&error],
+      whole);
+
+  // A reused compressor too.
+  GTMZlibCompressor *compressor = [GTMZlibCompressor compressorWithFormat:GTMZlibStreamFormatZlib
+                                                         compressionLevel:6
+                                                                    error:&error];
+  NSData *expected = [compressor compressData:whole error:&error];
+  XCTAssertEqualObjects([compressor compressDataArray:pieces error:&error], expected);
+  XCTAssertEqualObjects([compressor compressDispatchData:dispatchData error:&error], expected);
+
+  // Nothing to compress is nil, like the other apis.
+  XCTAssertNil([NSData gtm_dataByGzippingDataArray:[NSArray arrayWithObject:[NSData data]]
+                                  compressionLevel:6
+                                             error:&error]);
+  XCTAssertNil([NSData gtm_dataByGzippingDispatchData:dispatch_data_empty
+                                     compressionLevel:6
+                                                error:&error]);
+}
+
+@end
@@ -0,0 +1,182 @@
+//
+//  GTMZlibIndexTest.m
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#if !__has_feature(objc_arc)
+#error "This file needs to be compiled with ARC enabled."
+#endif
+
+#import "GTMSenTestCase.h"
+#import "GTMZlibIndex.h"
+#import "GTMNSData+zlib.h"
+#import "GTMZlibTestData.h"
+#import <zlib.h>
+
+@interface GTMZlibIndexTest : GTMTestCase
+@end
+
+@implementation GTMZlibIndexTest
+
+// Reads a spread of ranges through |index| and checks them against |expected|.
+- (void)checkRangesOfIndex:(GTMZlibIndex *)index
+                  fromData:(NSData *)compressed
+                  expected:(NSData *)expected {
+  NSUInteger length = [expected length];
+  NSRange ranges[] = {
+    NSMakeRange(0, length),
+    NSMakeRange(0, 1),
+    NSMakeRange(length - 1, 1),
+    NSMakeRange(length / 3, 100000),
+    NSMakeRange(length / 2 + 17, 5),
+    NSMakeRange(12345, 300000),
+  };
+  for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); ++i) {
+    NSError *error = nil;
+    NSData *read = [index readRange:ranges[i] fromData:compressed error:&error];
+    XCTAssertEqualObjects(read, [expected subdataWithRange:ranges[i]],
+                          @"range %@: %@", NSStringFromRange(ranges[i]), error);
+  }
+}
+
+- (void)testFormats {
+  NSData *data = GTMZlibTestData(2 * 1024 * 1024, GTMZlibTestDataWords, 7);
+  NSError *error = nil;
+  NSData *gzipped = [NSData gtm_dataByGzippingData:data compressionLevel:1 error:&error];
+  NSData *deflated = [NSData gtm_dataByDeflatingData:data compressionLevel:1 error:&error];
+  NSData *rawDeflated = [NSData gtm_dataByRawDeflatingData:data compressionLevel:1 error:&error];
+
+  struct {
+    __unsafe_unretained NSData *compressed;
+    GTMZlibStreamFormat format;
+    GTMZlibStreamFormat expectedFormat;
+  } cases[] = {
+    { gzipped, GTMZlibStreamFormatAutoDetect, GTMZlibStreamFormatGzip },
+    { deflated, GTMZlibStreamFormatAutoDetect, GTMZlibStreamFormatZlib },
+    { rawDeflated, GTMZlibStreamFormatRaw, GTMZlibStreamFormatRaw },
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    GTMZlibIndex *index = [GTMZlibIndex indexWithData:cases[i].compressed
+                                               format:cases[i].format
+                                             spanSize:128 * 1024
+                                                error:&error];
+    XCTAssertNotNil(index, @"%@", error);
+    XCTAssertEqual([index format], cases[i].expectedFormat);
+    XCTAssertEqual([index uncompressedLength], (uint64_t)[data length]);
+    XCTAssertEqual([index compressedLength], (uint64_t)[cases[i].compressed length]);
+    XCTAssertGreaterThan([index accessPointCount], (NSUInteger)4);
+    [self checkRangesOfIndex:index fromData:cases[i].compressed expected:data];
+  }
+}
+
+- (void)testSerialization {
+  NSData *data = GTMZlibTestData(1024 * 1024, GTMZlibTestDataWords, 7);
+  NSError *error = nil;
+  NSData *gzipped = [NSData gtm_dataByGzippingData:data compressionLevel:1 error:&error];
+  GTMZlibIndex *index = [GTMZlibIndex indexWithData:gzipped
+                                             format:GTMZlibStreamFormatGzip
+                                           spanSize:64 * 1024
+                                              error:&error];
+  XCTAssertNotNil(index, @"%@", error);
+
+  NSData *serialized = [index serializedData];
+  // The windows compress, so it is much smaller than 32KB a point.
+  XCTAssertLessThan([serialized length], [index accessPointCount] * 32 * 1024 / 2);
+  GTMZlibIndex *loaded = [GTMZlibIndex indexWithSerializedData:serialized error:&error];
+  XCTAssertNotNil(loaded, @"%@", error);
+  XCTAssertEqual([loaded accessPointCount], [index accessPointCount]);
+  XCTAssertEqual([loaded uncompressedLength], [index uncompressedLength]);
+  XCTAssertEqualObjects([loaded serializedData], serialized);
+  [self checkRangesOfIndex:loaded fromData:gzipped expected:data];
+
+  // Damaged indexes are rejected.
+  error = nil;
+  XCTAssertNil([GTMZlibIndex indexWithSerializedData:[serialized subdataWithRange:NSMakeRange(0, 40)]
+                                               error:&error]);
+  XCTAssertEqual([error code], (NSInteger)GTMNSDataZlibErrorInternal);
+  NSMutableData *badMagic = [NSMutableData dataWithData:serialized];
+  ((uint8_t *)[badMagic mutableBytes])[0] = 'X';
+  error = nil;
+  XCTAssertNil([GTMZlibIndex indexWithSerializedData:badMagic error:&error]);
+  XCTAssertEqual([error code], (NSInteger)GTMNSDataZlibErrorInternal);
+}
+
+- (void)testMultipleMembers {
+  NSData *data = GTMZlibTestData(600 * 1024, GTMZlibTestDataWords, 7);
+  NSData *first = [data subdataWithRange:NSMakeRange(0, 250 * 1024)];
+  NSData *second = [data subdataWithRange:NSMakeRange(250 * 1024, [data length] - 250 * 1024)];
+  NSError *error = nil;
+  NSMutableData *gzipped =
+      [NSMutableData dataWithData:[NSData gtm_dataByGzippingData:first compressionLevel:1 error:&error]];
+  [gzipped appendData:[NSData gtm_dataByGzippingData:second compressionLevel:1 error:&error]];
+
+  GTMZlibIndex *index = [GTMZlibIndex indexWithData:gzipped
+                                             format:GTMZlibStreamFormatAutoDetect
+                                           spanSize:32 * 1024
+                                              error:&error];
+  XCTAssertEqual([index uncompressedLength], (uint64_t)[data length]);
+  // Across the member boundary.
+  NSRange range = NSMakeRange(200 * 1024, 100 * 1024);
+  XCTAssertEqualObjects([index readRange:range fromData:gzipped error:&error],
+                        [data subdataWithRange:range]);
+  [self checkRangesOfIndex:index fromData:gzipped expected:data];
+}
+
+- (void)testErrors {
+  NSData *data = GTMZlibTestData(100 * 1024, GTMZlibTestDataWords, 7);
+  NSError *error = nil;
+  NSData *gzipped = [NSData gtm_dataByGzippingData:data error:&error];
+
+  // Truncated data can't be indexed.
+  error = nil;
+  XCTAssertNil([GTMZlibIndex indexWithData:[gzipped subdataWithRange:NSMakeRange(0, 1000)]
+                                    format:GTMZlibStreamFormatGzip
+                                  spanSize:0
+                                     error:&error]);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibErrorKey],
+                        [NSNumber numberWithInt:Z_BUF_ERROR]);
+
+  // Nor can data with junk after it.
+  NSMutableData *suffixed = [NSMutableData dataWithData:gzipped];
+  [suffixed appendBytes:"junk" length:4];
+  error = nil;
+  XCTAssertNil([GTMZlibIndex indexWithData:suffixed
+                                    format:GTMZlibStreamFormatGzip
+                                  spanSize:0
+                                     error:&error]);
+  XCTAssertEqual([error code], (NSInteger)GTMNSDataZlibErrorDataRemaining);
+
+  // Reading needs the same data the index was built from.
+  GTMZlibIndex *index = [GTMZlibIndex indexWithData:gzipped
+                                             format:GTMZlibStreamFormatGzip
+                                           spanSize:0
+                                              error:&error];
+  XCTAssertNotNil(index);
+  error = nil;
+  XCTAssertNil([index readRange:NSMakeRange(0, 10) fromData:suffixed error:&error]);
+  XCTAssertEqual([error code], (NSInteger)GTMNSDataZlibErrorInternal);
+
+  // Ranges past the end are clipped.
+  XCTAssertEqualObjects([index readRange:NSMakeRange([data length] - 10, 100)
+                                fromData:gzipped
+                                   error:&error],
+                        [data subdataWithRange:NSMakeRange([data length] - 10, 10)]);
+  XCTAssertEqual([[index readRange:NSMakeRange([data length] + 10, 100)
+                          fromData:gzipped
+                             error:&error] length], (NSUInteger)0);
+}
+
+@end
@@ -0,0 +1,291 @@
+//
+//  GTMZlibStreamTest.m
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+#if !__has_feature(objc_arc)
+#error "This file needs to be compiled with ARC enabled."
+#endif
+
+#import "GTMSenTestCase.h"
+#import "GTMZlibStream.h"
+#import "GTMNSData+zlib.h"
+#import "GTMZlibTestData.h"
+#import <zlib.h>
+
+@interface GTMZlibStreamTest : GTMTestCase
+@end
+
+// Feeds |data| to |stream| in |chunkSize| pieces, then finishes it.
+static NSData *RunStream(GTMZlibStream *stream, NSData *data,
+                         NSUInteger chunkSize, NSError **error) {
+  NSMutableData *result = [NSMutableData data];
+  GTMZlibStreamOutputHandler handler = ^(const void *bytes, NSUInteger length) {
+    [result appendBytes:bytes length:length];
+  };
+  const uint8_t *bytes = [data bytes];
+  for (NSUInteger offset = 0; offset < [data length]; offset += chunkSize) {
+    NSUInteger length = MIN(chunkSize, [data length] - offset);
+    if (![stream appendBytes:bytes + offset
+                      length:length
+               outputHandler:handler
+                       error:error]) {
+      return nil;
+    }
+  }
+  if (![stream finishWithOutputHandler:handler error:error]) {
+    return nil;
+  }
+  return result;
+}
+
+@implementation GTMZlibStreamTest
+
+- (void)testRoundTripFormats {
+  NSData *data = GTMZlibTestData(300 * 1024, GTMZlibTestDataLetters, 1);
+  GTMZlibStreamFormat formats[] = {
+    GTMZlibStreamFormatZlib,
+    GTMZlibStreamFormatGzip,
+    GTMZlibStreamFormatRaw,
+  };
+  for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i) {
+    NSError *error = nil;
+    GTMZlibStream *deflater = [GTMZlibStream deflateStreamWithFormat:formats[i]
+                                                    compressionLevel:9
+                                                               error:&error];
+    XCTAssertNotNil(deflater);
+    XCTAssertTrue([deflater isDeflating]);
+    deflater.outputChunkSize = 100;  // Lots of small output chunks.
+    NSData *compressed = RunStream(deflater, data, 777, &error);
+    XCTAssertNotNil(compressed, @"format %d: %@", (int)formats[i], error);
+    XCTAssertTrue([deflater isFinished]);
+    XCTAssertEqual([deflater totalBytesIn], (uint64_t)[data length]);
+    XCTAssertEqual([deflater totalBytesOut], (uint64_t)[compressed length]);
+
+    // The one shot apis understand the output.
+    NSData *inflated = (formats[i] == GTMZlibStreamFormatRaw)
+        ? [NSData gtm_dataByRawInflatingData:compressed error:&error]
+        : [NSData gtm_dataByInflatingData:compressed error:&error];
+    XCTAssertEqualObjects(inflated, data);
+
+    // And the stream understands them, fed a byte at a time.
+    GTMZlibStreamFormat inflateFormat =
+        (formats[i] == GTMZlibStreamFormatRaw) ? GTMZlibStreamFormatRaw
+                                               : GTMZlibStreamFormatAutoDetect;
+    GTMZlibStream *inflater = [GTMZlibStream inflateStreamWithFormat:inflateFormat
+                                                               error:&error];
+    XCTAssertNotNil(inflater);
+    XCTAssertFalse([inflater isDeflating]);
+    inflated = RunStream(inflater, compressed, 1, &error);
+    XCTAssertEqualObjects(inflated, data, @"format %d: %@", (int)formats[i], error);
+    XCTAssertTrue([inflater isFinished]);
+  }
+}
+
+- (void)testFlush {
+  NSError *error = nil;
+  GTMZlibStream *deflater = [GTMZlibStream deflateStreamWithFormat:GTMZlibStreamFormatRaw
+                                                  compressionLevel:Z_DEFAULT_COMPRESSION
+                                                             error:&error];
+  GTMZlibStream *inflater = [GTMZlibStream inflateStreamWithFormat:GTMZlibStreamFormatRaw
+                                                             error:&error];
+  XCTAssertNotNil(deflater);
+  XCTAssertNotNil(inflater);
+
+  NSMutableData *compressed = [NSMutableData data];
+  GTMZlibStreamOutputHandler collect = ^(const void *bytes, NSUInteger length) {
+    [compressed appendBytes:bytes length:length];
+  };
+  NSMutableData *inflated = [NSMutableData data];
+  GTMZlibStreamOutputHandler collectInflated = ^(const void *bytes, NSUInteger length) {
+    [inflated appendBytes:bytes length:length];
+  };
+
+  // After each flush everything written so far can be decoded.
+  NSData *data = GTMZlibTestData(5000, GTMZlibTestDataLetters, 1);
+  for (int i = 0; i < 3; ++i) {
+    [compressed setLength:0];
+    XCTAssertTrue([deflater appendData:data outputHandler:collect error:&error]);
+    XCTAssertTrue([deflater flushWithOutputHandler:collect error:&error]);
+    XCTAssertGreaterThan([compressed length], (NSUInteger)4);
+    const uint8_t *tail = (const uint8_t *)[compressed bytes] + [compressed length] - 4;
+    const uint8_t kSyncMarker[] = { 0x00, 0x00, 0xff, 0xff };
+    XCTAssertEqual(memcmp(tail, kSyncMarker, 4), 0);
+
+    [inflated setLength:0];
+    XCTAssertTrue([inflater appendData:compressed
+                         outputHandler:collectInflated
+                                 error:&error]);
+    XCTAssertEqualObjects(inflated, data);
+    XCTAssertFalse([inflater isFinished]);
+  }
+  XCTAssertTrue([deflater finishWithOutputHandler:collect error:&error]);
+  XCTAssertTrue([deflater isFinished]);
+}
+
+- (void)testCallerBuffers {
+  NSData *data = GTMZlibTestData(64 * 1024, GTMZlibTestDataLetters, 1);
+  NSError *error = nil;
+  GTMZlibStream *deflater = [GTMZlibStream deflateStreamWithFormat:GTMZlibStreamFormatGzip
+                                                  compressionLevel:1
+                                                             error:&error];
+  XCTAssertNotNil(deflater);
+
+  NSMutableData *compressed = [NSMutableData data];
+  uint8_t buffer[333];
+  const uint8_t *input = [data bytes];
+  NSUInteger inputLeft = [data length];
+  while (![deflater isFinished]) {
+    NSUInteger bytesRead = 0, bytesWritten = 0;
+    XCTAssertTrue([deflater processBytes:input
+                                  length:inputLeft
+                               bytesRead:&bytesRead
+                                toBuffer:buffer
+                                capacity:sizeof(buffer)
+                            bytesWritten:&bytesWritten
+                                   flush:GTMZlibStreamFlushFinish
+                                   error:&error]);
+    input += bytesRead;
+    inputLeft -= bytesRead;
+    [compressed appendBytes:buffer length:bytesWritten];
+  }
+  XCTAssertEqual(inputLeft, (NSUInteger)0);
+  XCTAssertEqualObjects([NSData gtm_dataByInflatingData:compressed error:&error], data);
+
+  // Once finished, nothing more is used.
+  NSUInteger bytesRead = 1, bytesWritten = 1;
+  XCTAssertTrue([deflater processBytes:[data bytes]
+                                length:[data length]
+                             bytesRead:&bytesRead
+                              toBuffer:buffer
+                              capacity:sizeof(buffer)
+                          bytesWritten:&bytesWritten
+                                 flush:GTMZlibStreamFlushNone
+                                 error:&error]);
+  XCTAssertEqual(bytesRead, (NSUInteger)0);
+  XCTAssertEqual(bytesWritten, (NSUInteger)0);
+}
+
+- (void)testInflateErrors {
+  NSData *data = GTMZlibTestData(10000, GTMZlibTestDataLetters, 1);
+  NSError *error = nil;
+  NSData *compressed = [NSData gtm_dataByGzippingData:data error:&error];
+  XCTAssertNotNil(compressed);
+  void (^ignore)(const void *, NSUInteger) = ^(const void *bytes, NSUInteger length) {};
+
+  // Truncated data fails at finish.
+  GTMZlibStream *inflater = [GTMZlibStream inflateStreamWithFormat:GTMZlibStreamFormatAutoDetect
+                                                             error:&error];
+  XCTAssertTrue([inflater appendBytes:[compressed bytes]
+                               length:[compressed length] - 10
+                        outputHandler:ignore
+                                error:&error]);
+  XCTAssertFalse([inflater finishWithOutputHandler:ignore error:&error]);
+  XCTAssertEqualObjects([error domain], GTMNSDataZlibErrorDomain);
+  XCTAssertEqual([error code], (NSInteger)GTMNSDataZlibErrorInternal);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibErrorKey],
+                        [NSNumber numberWithInt:Z_BUF_ERROR]);
+
+  // Trailing data is reported.
+  NSMutableData *suffixed = [NSMutableData dataWithData:compressed];
+  [suffixed appendBytes:[data bytes] length:20];
+  inflater = [GTMZlibStream inflateStreamWithFormat:GTMZlibStreamFormatAutoDetect
+                                              error:&error];
+  error = nil;
+  XCTAssertFalse([inflater appendData:suffixed outputHandler:ignore error:&error]);
+  XCTAssertEqual([error code], (NSInteger)GTMNSDataZlibErrorDataRemaining);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibRemainingBytesKey],
+                        [NSNumber numberWithUnsignedInteger:20]);
+
+  // Garbage is a data error.
+  inflater = [GTMZlibStream inflateStreamWithFormat:GTMZlibStreamFormatZlib
+                                              error:&error];
+  error = nil;
+  XCTAssertFalse([inflater appendData:data outputHandler:ignore error:&error]);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMNSDataZlibErrorKey],
+                        [NSNumber numberWithInt:Z_DATA_ERROR]);
+}
+
+
+- (void)testAdaptiveLevel {
+  NSData *data = GTMZlibTestData(8 * 1024 * 1024, GTMZlibTestDataLetters, 1);
+  NSError *error = nil;
+
+  // A fixed level stays put.
+  GTMZlibStream *deflater = [GTMZlibStream deflateStreamWithFormat:GTMZlibStreamFormatGzip
+                                                  compressionLevel:Z_DEFAULT_COMPRESSION
+                                                             error:&error];
+  XCTAssertEqual([deflater compressionLevel], 6);
+  XCTAssertNotNil(RunStream(deflater, data, 64 * 1024, &error));
+  XCTAssertEqual([deflater compressionLevel], 6);
+
+  // No machine keeps up with this, so the level goes all the way down...
+  deflater = [GTMZlibStream deflateStreamWithFormat:GTMZlibStreamFormatGzip
+                                   compressionLevel:9
+                                              error:&error];
+  [deflater setTargetThroughput:1e12];
+  NSData *compressed = RunStream(deflater, data, 100 * 1000, &error);
+  XCTAssertNotNil(compressed, @"%@", error);
+  XCTAssertEqual([deflater compressionLevel], Z_BEST_SPEED);
+  // ...and the level changes along the way don't upset inflate.
+  XCTAssertEqualObjects([NSData gtm_dataByInflatingData:compressed error:&error], data);
+
+  // Any machine beats this one, so the level climbs.
+  deflater = [GTMZlibStream deflateStreamWithFormat:GTMZlibStreamFormatRaw
+                                   compressionLevel:1
+                                              error:&error];
+  [deflater setTargetThroughput:1];
+  compressed = RunStream(deflater, data, 1024 * 1024, &error);
+  XCTAssertGreaterThan([deflater compressionLevel], 1);
+  XCTAssertEqualObjects([NSData gtm_dataByRawInflatingData:compressed error:&error], data);
+
+  // A tiny CPU budget behaves like a high target.
+  deflater = [GTMZlibStream deflateStreamWithFormat:GTMZlibStreamFormatZlib
+                                   compressionLevel:9
+                                              error:&error];
+  [deflater setCPUBudget:1e-9];
+  compressed = RunStream(deflater, data, 300 * 1000, &error);
+  XCTAssertEqual([deflater compressionLevel], Z_BEST_SPEED);
+  XCTAssertEqualObjects([NSData gtm_dataByInflatingData:compressed error:&error], data);
+
+  // Inflate streams ignore the settings.
+  GTMZlibStream *inflater = [GTMZlibStream inflateStreamWithFormat:GTMZlibStreamFormatAutoDetect
+                                                             error:&error];
+  [inflater setTargetThroughput:1e12];
+  XCTAssertEqualObjects(RunStream(inflater, compressed, 4096, &error), data);
+  XCTAssertEqual([inflater compressionLevel], 0);
+
+  // The one shot apis.
+  XCTAssertEqualObjects([NSData gtm_dataByInflatingData:[NSData gtm_dataByGzippingData:data
+                                                                      targetThroughput:1e12
+                                                                                 error:&error]
+                                                  error:&error],
+                        data);
+  XCTAssertEqualObjects([NSData gtm_dataByInflatingData:[NSData gtm_dataByDeflatingData:data
+                                                                       targetThroughput:1
+                                                                                  error:&error]
+                                                  error:&error],
+                        data);
+  XCTAssertEqualObjects(
+      [NSData gtm_dataByRawInflatingData:[NSData gtm_dataByRawDeflatingData:data
+                                                            targetThroughput:50e6
+                                                                       error:&error]
+                                   error:&error],
+      data);
+  XCTAssertNil([NSData gtm_dataByGzippingBytes:NULL length:0 targetThroughput:1 error:&error]);
+}
+
+@end
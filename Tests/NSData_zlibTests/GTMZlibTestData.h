@@ -0,0 +1,70 @@
+//
+//  GTMZlibTestData.h
+//
+//  Copyright 2026 Google Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+//  use this file except in compliance with the License.  You may obtain a copy
+//  of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+//  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+//  License for the specific language governing permissions and limitations under
+//  the License.
+//
+
+// Test input for the NSData_zlib tests.
+
+#import <Foundation/Foundation.h>
+#import "GTMDefines.h"
+
+typedef NS_ENUM(NSInteger, GTMZlibTestDataKind) {
+  // Random bytes, which don't compress.
+  GTMZlibTestDataRandom,
+  // All zeros.
+  GTMZlibTestDataZeros,
+  // "abcabc...".
+  GTMZlibTestDataPattern,
+  // Random letters from a small alphabet, which compress but not to nothing.
+  GTMZlibTestDataLetters,
+  // Random words from a small vocabulary, in lines.
+  GTMZlibTestDataWords,
+};
+
+// Returns |length| bytes of |kind|. The same |seed| gives the same bytes.
+GTM_INLINE NSData *GTMZlibTestData(NSUInteger length, GTMZlibTestDataKind kind,
+                                   uint32_t seed) {
+  static const char *const kWords[] = {
+    "alpha ", "beta ", "gamma ", "delta\n", "epsilon ", "zeta ", "eta ", "theta\n",
+  };
+  NSMutableData *data = [NSMutableData dataWithLength:length];
+  unsigned char *bytes = [data mutableBytes];
+  NSUInteger i = 0;
+  while (i < length) {
+    seed = seed * 1103515245 + 12345;
+    switch (kind) {
+      case GTMZlibTestDataRandom:
+        bytes[i++] = (unsigned char)(seed >> 16);
+        break;
+      case GTMZlibTestDataZeros:
+        ++i;
+        break;
+      case GTMZlibTestDataPattern:
+        bytes[i] = (unsigned char)("abc"[i % 3]);
+        ++i;
+        break;
+      case GTMZlibTestDataLetters:
+        bytes[i++] = (unsigned char)('a' + (seed >> 16) % 8);
+        break;
+      case GTMZlibTestDataWords:
+        for (const char *word = kWords[(seed >> 16) % 8]; *word && i < length; ++word) {
+          bytes[i++] = (unsigned char)*word;
+        }
+        break;
+    }
+  }
+  return data;
+}
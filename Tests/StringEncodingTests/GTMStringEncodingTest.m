@@ -22,6 +22,29 @@
 @interface GTMStringEncodingTest : GTMTestCase
 @end
 
+// Encodes a bit at a time, without padding, for checking the fast paths.
+static NSString *ReferenceEncode(NSData *data, NSString *alphabet) {
+  int shift = 0;
+  while ((1U << shift) < [alphabet length]) {
+    shift++;
+  }
+  const unsigned char *bytes = [data bytes];
+  NSUInteger bits = [data length] * 8;
+  NSMutableString *result = [NSMutableString string];
+  for (NSUInteger bit = 0; bit < bits; bit += shift) {
+    NSUInteger value = 0;
+    for (int i = 0; i < shift; i++) {
+      NSUInteger b = bit + i;
+      value <<= 1;
+      if (b < bits) {
+        value |= (bytes[b / 8] >> (7 - b % 8)) & 1;
+      }
+    }
+    [result appendFormat:@"%C", [alphabet characterAtIndex:value]];
+  }
+  return result;
+}
+
 @implementation GTMStringEncodingTest
 
 // Empty inputs should result in empty outputs.
@@ -189,6 +212,328 @@
   XCTAssertNil(error);
 }
 
+// Long inputs go through the SIMD kernels where the CPU has them; check them
+// against Foundation's base64 at every alignment of the tail.
+- (void)testBase64Long {
+  GTMStringEncoding *coder = [GTMStringEncoding rfc4648Base64StringEncoding];
+  GTMStringEncoding *websafe = [GTMStringEncoding rfc4648Base64WebsafeStringEncoding];
+  NSMutableData *data = [NSMutableData dataWithLength:1024 * 1024 + 7];
+  unsigned char *bytes = [data mutableBytes];
+  uint32_t seed = 1;
+  for (NSUInteger i = 0; i < [data length]; i++) {
+    seed = seed * 1103515245 + 12345;
+    bytes[i] = (unsigned char)(seed >> 16);
+  }
+  NSError *error = nil;
+  NSUInteger lengths[] = { 47, 48, 49, 100, 191, 192, 193, 1000, [data length] };
+  for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    NSData *input = [data subdataWithRange:NSMakeRange(0, lengths[i])];
+    NSString *expected = [input base64EncodedStringWithOptions:0];
+    XCTAssertEqualStrings([coder encode:input error:&error], expected);
+    XCTAssertEqualObjects([coder decode:expected error:&error], input);
+    NSString *expectedWebsafe =
+        [[expected stringByReplacingOccurrencesOfString:@"+" withString:@"-"]
+            stringByReplacingOccurrencesOfString:@"/" withString:@"_"];
+    XCTAssertEqualStrings([websafe encode:input error:&error], expectedWebsafe);
+    XCTAssertEqualObjects([websafe decode:expectedWebsafe error:&error], input);
+    // The other alphabet's characters are errors.
+    if ([expected rangeOfString:@"+"].location != NSNotFound) {
+      XCTAssertNil([websafe decode:expected error:&error]);
+      XCTAssertEqual([error code], GTMStringEncodingErrorUnknownCharacter);
+    }
+    error = nil;
+  }
+
+  // Line breaks in the middle of long runs of alphabet characters.
+  [coder ignoreCharacters:@"\r\n"];
+  NSString *wrapped =
+      [data base64EncodedStringWithOptions:NSDataBase64Encoding76CharacterLineLength];
+  XCTAssertEqualObjects([coder decode:wrapped error:&error], data);
+  XCTAssertNil(error);
+
+  // A bad character well inside a vector sized block is found at its index.
+  NSMutableString *bad =
+      [NSMutableString stringWithString:[data base64EncodedStringWithOptions:0]];
+  [bad replaceCharactersInRange:NSMakeRange(1001, 1) withString:@"*"];
+  XCTAssertNil([coder decode:bad error:&error]);
+  XCTAssertEqual([error code], GTMStringEncodingErrorUnknownCharacter);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMStringEncodingBadCharacterIndexKey],
+                        [NSNumber numberWithUnsignedInteger:1001]);
+  // As is padding there.
+  [bad replaceCharactersInRange:NSMakeRange(1001, 1) withString:@"="];
+  XCTAssertNil([coder decode:bad error:&error]);
+  XCTAssertEqual([error code], GTMStringEncodingErrorExpectedPadding);
+}
+
+// Every alphabet size, around the word sized fast path's boundaries.
+- (void)testAllAlphabetSizes {
+  NSMutableString *characters = [NSMutableString string];
+  for (unichar c = 0; c < 128; c++) {
+    [characters appendFormat:@"%C", c];
+  }
+  unsigned char bytes[200];
+  uint32_t seed = 7;
+  for (NSUInteger i = 0; i < sizeof(bytes); i++) {
+    seed = seed * 1103515245 + 12345;
+    bytes[i] = (unsigned char)(seed >> 16);
+  }
+  NSError *error = nil;
+  for (NSUInteger size = 2; size <= 128; size *= 2) {
+    // Start at '!' so small alphabets are printable; base128 needs them all.
+    NSUInteger start = size < 64 ? '!' : 128 - size;
+    NSString *alphabet = [characters substringWithRange:NSMakeRange(start, size)];
+    GTMStringEncoding *coder = [GTMStringEncoding stringEncodingWithString:alphabet];
+    for (NSUInteger length = 0; length < sizeof(bytes); length += (length < 24 ? 1 : 17)) {
+      NSData *data = [NSData dataWithBytes:bytes length:length];
+      NSString *encoded = [coder encode:data error:&error];
+      XCTAssertEqualStrings(encoded, ReferenceEncode(data, alphabet),
+                            @"size %lu length %lu", (unsigned long)size, (unsigned long)length);
+      // Base128's alphabet includes NUL, which decode: reads past.
+      XCTAssertEqualObjects([coder decode:encoded error:&error], data,
+                            @"size %lu length %lu", (unsigned long)size, (unsigned long)length);
+    }
+  }
+
+  // Synonyms decode in the fast path too, and errors are reported at the
+  // right index.
+  GTMStringEncoding *hex = [GTMStringEncoding hexStringEncoding];
+  NSData *data = [NSData dataWithBytes:bytes length:100];
+  NSString *encoded = [hex encode:data error:&error];
+  XCTAssertEqualObjects([hex decode:[encoded lowercaseString] error:&error], data);
+  NSMutableString *bad = [NSMutableString stringWithString:encoded];
+  [bad replaceCharactersInRange:NSMakeRange(150, 1) withString:@"G"];
+  XCTAssertNil([hex decode:bad error:&error]);
+  XCTAssertEqual([error code], GTMStringEncodingErrorUnknownCharacter);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMStringEncodingBadCharacterIndexKey],
+                        [NSNumber numberWithUnsignedInteger:150]);
+}
+
+- (void)testBufferApis {
+  GTMStringEncoding *coder = [GTMStringEncoding rfc4648Base64StringEncoding];
+  XCTAssertEqual([coder encodedLengthForLength:0], (NSUInteger)0);
+  XCTAssertEqual([coder encodedLengthForLength:1], (NSUInteger)4);
+  XCTAssertEqual([coder encodedLengthForLength:3], (NSUInteger)4);
+  XCTAssertEqual([coder encodedLengthForLength:4], (NSUInteger)8);
+  XCTAssertEqual([coder maximumDecodedLengthForLength:8], (NSUInteger)6);
+
+  char chars[16];
+  NSUInteger outLen = 0;
+  NSError *error = nil;
+  XCTAssertTrue([coder encodeBytes:"foob"
+                            length:4
+                        intoBuffer:chars
+                          capacity:8
+                      outputLength:&outLen
+                             error:&error]);
+  XCTAssertEqual(outLen, (NSUInteger)8);
+  XCTAssertEqual(strncmp(chars, "Zm9vYg==", 8), 0);
+  XCTAssertFalse([coder encodeBytes:"foob"
+                             length:4
+                         intoBuffer:chars
+                           capacity:7
+                       outputLength:&outLen
+                              error:&error]);
+  XCTAssertEqual([error code], GTMStringEncodingErrorBufferTooSmall);
+
+  // Padding doesn't need room, but real bytes do.
+  unsigned char bytes[8];
+  XCTAssertTrue([coder decodeCharacters:"Zm9vYg=="
+                                 length:8
+                             intoBuffer:bytes
+                               capacity:4
+                           outputLength:&outLen
+                                  error:&error]);
+  XCTAssertEqual(outLen, (NSUInteger)4);
+  XCTAssertEqual(memcmp(bytes, "foob", 4), 0);
+  XCTAssertFalse([coder decodeCharacters:"Zm9vYg=="
+                                  length:8
+                              intoBuffer:bytes
+                                capacity:3
+                            outputLength:&outLen
+                                   error:&error]);
+  XCTAssertEqual([error code], GTMStringEncodingErrorBufferTooSmall);
+
+  // Lengths are given, so NUL and non-ASCII are just bad characters.
+  XCTAssertFalse([coder decodeCharacters:"Zm9v\0g=="
+                                  length:8
+                              intoBuffer:bytes
+                                capacity:sizeof(bytes)
+                            outputLength:&outLen
+                                   error:&error]);
+  XCTAssertEqual([error code], GTMStringEncodingErrorUnknownCharacter);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMStringEncodingBadCharacterIndexKey],
+                        [NSNumber numberWithUnsignedInteger:4]);
+  XCTAssertFalse([coder decodeCharacters:"Zm9v\xc3g=="
+                                  length:8
+                              intoBuffer:bytes
+                                capacity:sizeof(bytes)
+                            outputLength:&outLen
+                                   error:&error]);
+  XCTAssertEqual([error code], GTMStringEncodingErrorUnknownCharacter);
+}
+
+// Large inputs split across cores give the same results as serial ones.
+- (void)testParallel {
+  NSMutableData *data = [NSMutableData dataWithLength:8 * 1024 * 1024 + 5];
+  unsigned char *bytes = [data mutableBytes];
+  uint32_t seed = 13;
+  for (NSUInteger i = 0; i < [data length]; i++) {
+    seed = seed * 1103515245 + 12345;
+    bytes[i] = (unsigned char)(seed >> 16);
+  }
+  NSArray *coders = @[
+    [GTMStringEncoding rfc4648Base64StringEncoding],
+    [GTMStringEncoding rfc4648Base32StringEncoding],
+    [GTMStringEncoding hexStringEncoding],
+  ];
+  NSError *error = nil;
+  for (GTMStringEncoding *coder in coders) {
+    XCTAssertFalse([coder doParallel]);
+    NSString *expected = [coder encode:data error:&error];
+    [coder setDoParallel:YES];
+    XCTAssertEqualStrings([coder encode:data error:&error], expected, @"%@", coder);
+    XCTAssertEqualObjects([coder decode:expected error:&error], data, @"%@ %@", coder, error);
+  }
+
+  // Ignored characters move the pieces' output.
+  GTMStringEncoding *coder = [GTMStringEncoding rfc4648Base64StringEncoding];
+  [coder setDoParallel:YES];
+  [coder ignoreCharacters:@"\r\n"];
+  NSString *wrapped =
+      [data base64EncodedStringWithOptions:NSDataBase64Encoding76CharacterLineLength];
+  XCTAssertEqualObjects([coder decode:wrapped error:&error], data, @"%@", error);
+
+  // Errors are reported at the same index as serially, wherever they are.
+  NSString *encoded = [data base64EncodedStringWithOptions:0];
+  NSUInteger indexes[] = { 10, [encoded length] / 2 + 1, [encoded length] - 10 };
+  for (size_t i = 0; i < sizeof(indexes) / sizeof(indexes[0]); i++) {
+    NSMutableString *bad = [NSMutableString stringWithString:encoded];
+    [bad replaceCharactersInRange:NSMakeRange(indexes[i], 1) withString:@"*"];
+    XCTAssertNil([coder decode:bad error:&error]);
+    XCTAssertEqual([error code], GTMStringEncodingErrorUnknownCharacter);
+    XCTAssertEqualObjects([[error userInfo] objectForKey:GTMStringEncodingBadCharacterIndexKey],
+                          [NSNumber numberWithUnsignedInteger:indexes[i]]);
+    [bad replaceCharactersInRange:NSMakeRange(indexes[i], 1) withString:@"="];
+    XCTAssertNil([coder decode:bad error:&error]);
+    XCTAssertEqual([error code], GTMStringEncodingErrorExpectedPadding);
+    XCTAssertEqualObjects([[error userInfo] objectForKey:GTMStringEncodingBadCharacterIndexKey],
+                          [NSNumber numberWithUnsignedInteger:indexes[i] + 1]);
+  }
+}
+
+// Streams split into chunks of every few lengths give the same output as the
+// one shot calls.
+- (void)testStreaming {
+  NSMutableData *data = [NSMutableData dataWithLength:100000];
+  unsigned char *bytes = [data mutableBytes];
+  uint32_t seed = 9;
+  for (NSUInteger i = 0; i < [data length]; i++) {
+    seed = seed * 1103515245 + 12345;
+    bytes[i] = (unsigned char)(seed >> 16);
+  }
+  NSArray *coders = @[
+    [GTMStringEncoding rfc4648Base64StringEncoding],
+    [GTMStringEncoding rfc4648Base32StringEncoding],
+    [GTMStringEncoding hexStringEncoding],
+    [GTMStringEncoding binaryStringEncoding],
+  ];
+  NSError *error = nil;
+  for (GTMStringEncoding *coder in coders) {
+    NSString *expected = [coder encode:data error:&error];
+    GTMStringEncoder *encoder = [[GTMStringEncoder alloc] initWithEncoding:coder];
+    GTMStringDecoder *decoder = [[GTMStringDecoder alloc] initWithEncoding:coder];
+    // Twice, as finishing readies them for another stream.
+    for (int pass = 0; pass < 2; pass++) {
+      NSMutableData *encoded = [NSMutableData data];
+      char chars[8000];
+      NSUInteger outLen = 0;
+      for (NSUInteger pos = 0, chunk = 1; pos < [data length];
+           pos += chunk, chunk = chunk * 3 % 997) {
+        chunk = MIN(chunk, [data length] - pos);
+        NSUInteger expectedLen = [encoder outputLengthForLength:chunk];
+        XCTAssertTrue([encoder encodeBytes:bytes + pos
+                                    length:chunk
+                                intoBuffer:chars
+                                  capacity:sizeof(chars)
+                              outputLength:&outLen
+                                     error:&error], @"%@", error);
+        XCTAssertEqual(outLen, expectedLen);
+        [encoded appendBytes:chars length:outLen];
+      }
+      NSUInteger finishLength = [encoder finishLength];
+      XCTAssertTrue([encoder finishIntoBuffer:chars
+                                     capacity:sizeof(chars)
+                                 outputLength:&outLen
+                                        error:&error]);
+      XCTAssertEqual(outLen, finishLength);
+      [encoded appendBytes:chars length:outLen];
+      NSString *string = [[NSString alloc] initWithData:encoded encoding:NSASCIIStringEncoding];
+      XCTAssertEqualStrings(string, expected, @"%@", coder);
+
+      NSMutableData *decoded = [NSMutableData data];
+      unsigned char buffer[8000];
+      const char *characters = [encoded bytes];
+      for (NSUInteger pos = 0, chunk = 1; pos < [encoded length];
+           pos += chunk, chunk = chunk * 7 % 1999) {
+        chunk = MIN(chunk, [encoded length] - pos);
+        XCTAssertTrue([decoder decodeCharacters:characters + pos
+                                         length:chunk
+                                     intoBuffer:buffer
+                                       capacity:sizeof(buffer)
+                                   outputLength:&outLen
+                                          error:&error], @"%@", error);
+        [decoded appendBytes:buffer length:outLen];
+      }
+      XCTAssertTrue([decoder finishWithError:&error]);
+      XCTAssertEqualObjects(decoded, data, @"%@", coder);
+    }
+  }
+
+  // Too small a buffer is refused rather than overrun.
+  GTMStringEncoding *coder = [GTMStringEncoding rfc4648Base64StringEncoding];
+  GTMStringEncoder *encoder = [[GTMStringEncoder alloc] initWithEncoding:coder];
+  char chars[4];
+  NSUInteger outLen = 0;
+  XCTAssertEqual([encoder outputLengthForLength:4], (NSUInteger)5);
+  XCTAssertFalse([encoder encodeBytes:bytes
+                               length:4
+                           intoBuffer:chars
+                             capacity:sizeof(chars)
+                         outputLength:&outLen
+                                error:&error]);
+  XCTAssertEqual([error code], GTMStringEncodingErrorBufferTooSmall);
+
+  // Errors count from the start of the stream.
+  GTMStringDecoder *decoder = [[GTMStringDecoder alloc] initWithEncoding:coder];
+  unsigned char buffer[16];
+  XCTAssertTrue([decoder decodeCharacters:"QUJD"
+                                   length:4
+                               intoBuffer:buffer
+                                 capacity:sizeof(buffer)
+                             outputLength:&outLen
+                                    error:&error]);
+  XCTAssertEqual(outLen, (NSUInteger)3);
+  XCTAssertFalse([decoder decodeCharacters:"RE\xc3"
+                                    length:3
+                                intoBuffer:buffer
+                                  capacity:sizeof(buffer)
+                              outputLength:&outLen
+                                     error:&error]);
+  XCTAssertEqual([error code], GTMStringEncodingErrorUnknownCharacter);
+  XCTAssertEqualObjects([[error userInfo] objectForKey:GTMStringEncodingBadCharacterIndexKey],
+                        [NSNumber numberWithUnsignedInteger:6]);
+
+  // A partial byte left at the end.
+  XCTAssertTrue([decoder decodeCharacters:"QUJDR"
+                                   length:5
+                               intoBuffer:buffer
+                                 capacity:sizeof(buffer)
+                             outputLength:&outLen
+                                    error:&error]);
+  XCTAssertFalse([decoder finishWithError:&error]);
+  XCTAssertEqual([error code], GTMStringEncodingErrorIncompleteTrailingData);
+}
+
 - (void)testBase64Websafe {
   // RFC4648 test vectors
   GTMStringEncoding *coder =